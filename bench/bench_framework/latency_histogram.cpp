@@ -0,0 +1,73 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "latency_histogram.h"
+#include <cmath>
+
+namespace density_bench
+{
+    constexpr unsigned LatencyHistogram::sub_bucket_bits;
+    constexpr size_t   LatencyHistogram::sub_bucket_count;
+    constexpr size_t   LatencyHistogram::bucket_count;
+
+    double cycles_per_nanosecond()
+    {
+        static double const s_cycles_per_nanosecond = [] {
+            using Clock            = std::chrono::steady_clock;
+            auto const start_time  = Clock::now();
+            auto const start_cycle = read_cycle_counter();
+            while (Clock::now() - start_time < std::chrono::milliseconds(20))
+            {
+            }
+            auto const cycles = read_cycle_counter() - start_cycle;
+            auto const nanoseconds =
+              std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time);
+            return static_cast<double>(cycles) / static_cast<double>(nanoseconds.count());
+        }();
+        return s_cycles_per_nanosecond;
+    }
+
+    void LatencyHistogram::merge(const LatencyHistogram & i_source)
+    {
+        for (size_t index = 0; index < bucket_count; index++)
+            m_counts[index] += i_source.m_counts[index];
+        m_count += i_source.m_count;
+        if (i_source.m_max > m_max)
+            m_max = i_source.m_max;
+    }
+
+    uint64_t LatencyHistogram::bucket_upper_value(size_t i_index) noexcept
+    {
+        if (i_index < sub_bucket_count)
+            return i_index;
+        size_t const   shift      = i_index / sub_bucket_count - 1;
+        uint64_t const sub_bucket = i_index % sub_bucket_count + sub_bucket_count;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    uint64_t LatencyHistogram::percentile(double i_percentile) const
+    {
+        if (m_count == 0)
+            return 0;
+
+        auto target = static_cast<uint64_t>(std::ceil(i_percentile / 100. * m_count));
+        if (target == 0)
+            target = 1;
+
+        uint64_t cumulative = 0;
+        for (size_t index = 0; index < bucket_count; index++)
+        {
+            cumulative += m_counts[index];
+            if (cumulative >= target)
+            {
+                auto const value = bucket_upper_value(index);
+                return value < m_max ? value : m_max;
+            }
+        }
+        return m_max;
+    }
+
+} // namespace density_bench
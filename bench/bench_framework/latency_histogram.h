@@ -0,0 +1,123 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace density_bench
+{
+    /* Returns a timestamp in cycles. On x86 it is the time stamp counter, that is constant rate and
+        synchronized between cores on the processors with an invariant TSC. On other architectures
+        it is the steady clock in nanoseconds. */
+    inline uint64_t read_cycle_counter() noexcept
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now().time_since_epoch())
+                                       .count());
+#endif
+    }
+
+    /* Returns the frequency of read_cycle_counter. It is measured against the steady clock the
+        first time this function is called. */
+    double cycles_per_nanosecond();
+
+    /* Histogram of latencies with logarithmic buckets, in the style of HdrHistogram. Every power of
+        2 is divided in 128 linear sub-buckets, so the relative error of a percentile is below 1%,
+        and recording a value is an increment in a fixed array. The values are in cycles. */
+    class LatencyHistogram
+    {
+      public:
+        static constexpr unsigned sub_bucket_bits  = 7;
+        static constexpr size_t   sub_bucket_count = size_t(1) << sub_bucket_bits;
+        static constexpr size_t   bucket_count     = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+        LatencyHistogram() : m_counts(bucket_count, 0) {}
+
+        void record(uint64_t i_value) noexcept
+        {
+            m_counts[bucket_index(i_value)]++;
+            m_count++;
+            if (i_value > m_max)
+                m_max = i_value;
+        }
+
+        void merge(const LatencyHistogram & i_source);
+
+        bool     empty() const noexcept { return m_count == 0; }
+        uint64_t count() const noexcept { return m_count; }
+        uint64_t max() const noexcept { return m_max; }
+
+        /* Returns the value such that i_percentile percent of the recorded values are less than or
+            equal to it, with the precision of the buckets. i_percentile must be in (0, 100]. */
+        uint64_t percentile(double i_percentile) const;
+
+      private:
+        static size_t bucket_index(uint64_t i_value) noexcept
+        {
+            if (i_value < sub_bucket_count)
+                return static_cast<size_t>(i_value);
+            unsigned const shift = most_significant_bit(i_value) - sub_bucket_bits;
+            return (shift + 1) * sub_bucket_count +
+                   static_cast<size_t>((i_value >> shift) - sub_bucket_count);
+        }
+
+        static uint64_t bucket_upper_value(size_t i_index) noexcept;
+
+        static unsigned most_significant_bit(uint64_t i_value) noexcept
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanReverse64(&index, i_value);
+            return index;
+#elif defined(__GNUC__) || defined(__clang__)
+            return 63 - static_cast<unsigned>(__builtin_clzll(i_value));
+#else
+            unsigned index = 0;
+            while (i_value >>= 1)
+                index++;
+            return index;
+#endif
+        }
+
+      private:
+        std::vector<uint64_t> m_counts;
+        uint64_t              m_count = 0;
+        uint64_t              m_max   = 0;
+    };
+
+    enum class LatencyKind
+    {
+        put,        // duration of a put
+        consume,    // duration of a successful consume
+        end_to_end, // from the begin of a put to the end of the consume of the same element
+    };
+
+    constexpr size_t latency_kind_count = 3;
+
+    inline const char * latency_kind_name(LatencyKind i_kind)
+    {
+        switch (i_kind)
+        {
+        case LatencyKind::put:
+            return "put";
+        case LatencyKind::consume:
+            return "consume";
+        default:
+            return "end_to_end";
+        }
+    }
+
+} // namespace density_bench
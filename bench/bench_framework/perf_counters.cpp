@@ -0,0 +1,178 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define DENSITY_BENCH_PERF_EVENTS 1
+#else
+#define DENSITY_BENCH_PERF_EVENTS 0
+#endif
+
+namespace density_bench
+{
+    const char * hardware_counter_name(HardwareCounter i_counter)
+    {
+        switch (i_counter)
+        {
+        case HardwareCounter::cycles:
+            return "cycles";
+        case HardwareCounter::instructions:
+            return "instructions";
+        case HardwareCounter::l1d_misses:
+            return "l1d_misses";
+        case HardwareCounter::llc_misses:
+            return "llc_misses";
+        case HardwareCounter::branch_misses:
+            return "branch_misses";
+        default:
+            return "dtlb_misses";
+        }
+    }
+
+#if DENSITY_BENCH_PERF_EVENTS
+
+    namespace
+    {
+        uint64_t cache_event(uint64_t i_cache, uint64_t i_operation, uint64_t i_result)
+        {
+            return i_cache | (i_operation << 8) | (i_result << 16);
+        }
+
+        int open_counter(HardwareCounter i_counter)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            switch (i_counter)
+            {
+            case HardwareCounter::cycles:
+                attributes.type   = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case HardwareCounter::instructions:
+                attributes.type   = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case HardwareCounter::l1d_misses:
+                attributes.type   = PERF_TYPE_HW_CACHE;
+                attributes.config = cache_event(
+                  PERF_COUNT_HW_CACHE_L1D,
+                  PERF_COUNT_HW_CACHE_OP_READ,
+                  PERF_COUNT_HW_CACHE_RESULT_MISS);
+                break;
+            case HardwareCounter::llc_misses:
+                attributes.type   = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+            case HardwareCounter::branch_misses:
+                attributes.type   = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case HardwareCounter::dtlb_misses:
+                attributes.type   = PERF_TYPE_HW_CACHE;
+                attributes.config = cache_event(
+                  PERF_COUNT_HW_CACHE_DTLB,
+                  PERF_COUNT_HW_CACHE_OP_READ,
+                  PERF_COUNT_HW_CACHE_RESULT_MISS);
+                break;
+            }
+            attributes.read_format =
+              PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attributes.inherit        = 1; // count the threads created by the test too
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv     = 1;
+
+            // this thread, any processor, no group
+            return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+    } // namespace
+
+    PerfCounters::PerfCounters()
+    {
+        for (size_t index = 0; index < hardware_counter_count; index++)
+            m_file_descriptors[index] = open_counter(static_cast<HardwareCounter>(index));
+    }
+
+    PerfCounters::~PerfCounters()
+    {
+        for (auto file_descriptor : m_file_descriptors)
+        {
+            if (file_descriptor >= 0)
+                close(file_descriptor);
+        }
+    }
+
+    bool PerfCounters::read(size_t i_index, Reading & o_reading) const
+    {
+        uint64_t values[3];
+        auto const file_descriptor = m_file_descriptors[i_index];
+        if (file_descriptor < 0)
+            return false;
+        if (::read(file_descriptor, values, sizeof(values)) != sizeof(values))
+            return false;
+        o_reading.m_value        = values[0];
+        o_reading.m_time_enabled = values[1];
+        o_reading.m_time_running = values[2];
+        return true;
+    }
+
+#else
+
+    PerfCounters::PerfCounters() { m_file_descriptors.fill(-1); }
+
+    PerfCounters::~PerfCounters() {}
+
+    bool PerfCounters::read(size_t, Reading &) const { return false; }
+
+#endif
+
+    bool PerfCounters::is_available() const
+    {
+        for (auto file_descriptor : m_file_descriptors)
+        {
+            if (file_descriptor >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    /* The counters are never reset: the kernel adds the counts of the exited threads to a separate
+        total that a reset does not clear, so start and stop take differences. */
+    void PerfCounters::start()
+    {
+        for (size_t index = 0; index < hardware_counter_count; index++)
+            read(index, m_start[index]);
+    }
+
+    CounterValues PerfCounters::stop()
+    {
+        CounterValues result;
+        for (size_t index = 0; index < hardware_counter_count; index++)
+        {
+            Reading end;
+            if (read(index, end))
+            {
+                auto const value   = end.m_value - m_start[index].m_value;
+                auto const enabled = end.m_time_enabled - m_start[index].m_time_enabled;
+                auto const running = end.m_time_running - m_start[index].m_time_running;
+                if (running > 0)
+                {
+                    result.m_values[index] = static_cast<uint64_t>(
+                      static_cast<double>(value) * static_cast<double>(enabled) /
+                      static_cast<double>(running));
+                    result.m_valid[index] = true;
+                }
+            }
+        }
+        return result;
+    }
+
+} // namespace density_bench
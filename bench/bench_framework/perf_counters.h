@@ -0,0 +1,84 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace density_bench
+{
+    enum class HardwareCounter
+    {
+        cycles,
+        instructions,
+        l1d_misses,    // L1 data cache read misses
+        llc_misses,    // last level cache misses
+        branch_misses, // mispredicted branches
+        dtlb_misses,   // data TLB read misses
+    };
+
+    constexpr size_t hardware_counter_count = 6;
+
+    const char * hardware_counter_name(HardwareCounter i_counter);
+
+    /* Values of the hardware counters between a start and a stop. A counter is not valid if the
+        system does not support it, or if it was never scheduled on the processor. */
+    struct CounterValues
+    {
+        std::array<uint64_t, hardware_counter_count> m_values{};
+        std::array<bool, hardware_counter_count>     m_valid{};
+
+        uint64_t value(HardwareCounter i_counter) const
+        {
+            return m_values[static_cast<size_t>(i_counter)];
+        }
+
+        bool is_valid(HardwareCounter i_counter) const
+        {
+            return m_valid[static_cast<size_t>(i_counter)];
+        }
+    };
+
+    /* Hardware performance counters of the calling thread and of the threads it creates after the
+        construction, read with perf_event_open. The events of the threads are added to the counters
+        when the threads exit, so the threads started in the measured code must be joined before
+        stop. If the platform is not Linux, or the kernel does not allow to open the counters (see
+        /proc/sys/kernel/perf_event_paranoid), the object is not available. The kernel multiplexes
+        the counters if there are more events than hardware counters: the values are scaled
+        accordingly. */
+    class PerfCounters
+    {
+      public:
+        PerfCounters();
+
+        PerfCounters(const PerfCounters &) = delete;
+        PerfCounters & operator=(const PerfCounters &) = delete;
+
+        ~PerfCounters();
+
+        /* Returns whether at least a counter has been opened */
+        bool is_available() const;
+
+        void start();
+
+        /* Returns the counts since the last call to start */
+        CounterValues stop();
+
+      private:
+        struct Reading
+        {
+            uint64_t m_value{}, m_time_enabled{}, m_time_running{};
+        };
+
+        bool read(size_t i_index, Reading & o_reading) const;
+
+      private:
+        std::array<int, hardware_counter_count>     m_file_descriptors;
+        std::array<Reading, hardware_counter_count> m_start;
+    };
+
+} // namespace density_bench
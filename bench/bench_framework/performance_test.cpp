@@ -30,6 +30,21 @@ namespace density_bench
       int                           i_start_line,
       PerformanceTest::TestFunction i_function,
       int                           i_end_line)
+    {
+        add_test(PerformanceTest(read_source(i_source_file, i_start_line, i_end_line), i_function));
+    }
+
+    void PerformanceTestGroup::add_test(
+      const char *                            i_source_file,
+      int                                     i_start_line,
+      PerformanceTest::ConcurrentTestFunction i_function,
+      int                                     i_end_line)
+    {
+        add_test(PerformanceTest(read_source(i_source_file, i_start_line, i_end_line), i_function));
+    }
+
+    std::string PerformanceTestGroup::read_source(
+      const char * i_source_file, int i_start_line, int i_end_line)
     {
         auto const source_file = s_source_dir + i_source_file;
 
@@ -94,7 +109,6 @@ namespace density_bench
             line.erase(line.begin(), line.begin() + std::min(white_prefix_length, line.length()));
             source_code += line + "#nl#";
         }
-
-        add_test(PerformanceTest(source_code.c_str(), std::move(i_function)));
+        return source_code;
     }
 } // namespace density_bench
@@ -5,6 +5,7 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #pragma once
+#include "thread_team.h"
 #include <string>
 #include <vector>
 
@@ -18,17 +19,28 @@ namespace density_bench
       public:
         using TestFunction = void (*)(size_t i_cardinality);
 
+        /* Function of a concurrent test. It must run the threads with ThreadTeam::run. */
+        using ConcurrentTestFunction = void (*)(size_t i_cardinality, ThreadTeam & i_team);
+
         PerformanceTest(std::string i_source_code, TestFunction i_function)
             : m_source_code(std::move(i_source_code)), m_function(i_function)
         {
         }
 
-        const std::string & source_code() const { return m_source_code; }
-        TestFunction        function() const { return m_function; }
+        PerformanceTest(std::string i_source_code, ConcurrentTestFunction i_function)
+            : m_source_code(std::move(i_source_code)), m_concurrent_function(i_function)
+        {
+        }
+
+        const std::string &    source_code() const { return m_source_code; }
+        TestFunction           function() const { return m_function; }
+        ConcurrentTestFunction concurrent_function() const { return m_concurrent_function; }
+        bool                   is_concurrent() const { return m_concurrent_function != nullptr; }
 
       private:
-        std::string  m_source_code;
-        TestFunction m_function;
+        std::string            m_source_code;
+        TestFunction           m_function            = nullptr;
+        ConcurrentTestFunction m_concurrent_function = nullptr;
     };
 
     class PerformanceTestGroup
@@ -59,6 +71,12 @@ namespace density_bench
           PerformanceTest::TestFunction i_function,
           int                           i_end_line);
 
+        void add_test(
+          const char *                            i_source_file,
+          int                                     i_start_line,
+          PerformanceTest::ConcurrentTestFunction i_function,
+          int                                     i_end_line);
+
         const std::string & name() const { return m_name; }
         const std::string & version_label() const { return m_version_label; }
         const std::string & description() const { return m_description; }
@@ -81,16 +99,35 @@ namespace density_bench
             m_cardinality_end = i_cardinality_end;
         }
 
+        /* Sets the number of producer and consumer threads of the concurrent tests of the group. If
+            i_pin_threads is true, every thread is pinned to a processor. */
+        void set_threads(size_t i_producer_count, size_t i_consumer_count, bool i_pin_threads = true)
+        {
+            m_producer_count = i_producer_count;
+            m_consumer_count = i_consumer_count;
+            m_pin_threads    = i_pin_threads;
+        }
+
+        size_t producer_count() const { return m_producer_count; }
+        size_t consumer_count() const { return m_consumer_count; }
+        bool   pin_threads() const { return m_pin_threads; }
+
         const std::vector<PerformanceTest> & tests() const { return m_tests; }
 
         static void set_source_dir(const char * i_dir);
 
         static const char * set_source_dir() { return s_source_dir.c_str(); }
 
+      private:
+        static std::string read_source(const char * i_source_file, int i_start_line, int i_end_line);
+
       private:
         size_t                       m_cardinality_start = 0;
         size_t                       m_cardinality_step  = 1000;
         size_t                       m_cardinality_end   = 80000;
+        size_t                       m_producer_count    = 1;
+        size_t                       m_consumer_count    = 1;
+        bool                         m_pin_threads       = true;
         std::vector<PerformanceTest> m_tests;
         std::string                  m_name, m_description, m_prolog_code, m_version_label;
 
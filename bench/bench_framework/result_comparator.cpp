@@ -0,0 +1,279 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "result_comparator.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace density_bench
+{
+    namespace
+    {
+        struct TestSamples
+        {
+            std::string         m_group;
+            size_t              m_test_index{};
+            std::string         m_source;
+            std::map<size_t, std::vector<double>>
+              m_nanoseconds_per_element; // by cardinality
+        };
+
+        /* Comparison of a test at a single cardinality */
+        struct CardinalityComparison
+        {
+            size_t m_cardinality{};
+            double m_baseline_median{}, m_candidate_median{};
+            double m_relative_change{}, m_p_value{1.};
+            bool   m_significant{};
+        };
+
+        using SampleMap = std::map<std::string, TestSamples>;
+
+        /* Splits a line in fields. Fields may be quoted, with "" as escape of the quote. */
+        std::vector<std::string> split_csv_line(const std::string & i_line)
+        {
+            std::vector<std::string> fields(1);
+            bool                     quoted = false;
+            for (size_t index = 0; index < i_line.size(); index++)
+            {
+                char const c = i_line[index];
+                if (quoted)
+                {
+                    if (c != '"')
+                        fields.back() += c;
+                    else if (index + 1 < i_line.size() && i_line[index + 1] == '"')
+                        fields.back() += i_line[++index];
+                    else
+                        quoted = false;
+                }
+                else if (c == '"')
+                    quoted = true;
+                else if (c == ',')
+                    fields.emplace_back();
+                else if (c != '\r')
+                    fields.back() += c;
+            }
+            return fields;
+        }
+
+        SampleMap load_samples(const char * i_file_name)
+        {
+            std::ifstream file(i_file_name);
+            if (!file)
+                throw std::runtime_error(
+                  std::string("can't open for read the file ") + i_file_name);
+
+            // group, test_index, test, producers, consumers, cardinality, duration_ns
+            SampleMap   result;
+            std::string line;
+            bool        header = true;
+            while (std::getline(file, line))
+            {
+                if (line.empty() || line[0] == '#')
+                    continue;
+                if (header)
+                {
+                    header = false;
+                    continue;
+                }
+
+                auto const fields = split_csv_line(line);
+                if (fields.size() != 7)
+                    throw std::runtime_error(
+                      std::string("malformed row in ") + i_file_name + ": " + line);
+
+                auto const cardinality = std::stod(fields[5]);
+                if (cardinality <= 0.)
+                    continue;
+
+                auto & samples = result[fields[0] + '\n' + fields[2]];
+                samples.m_group      = fields[0];
+                samples.m_test_index = static_cast<size_t>(std::stoul(fields[1]));
+                samples.m_source     = fields[2];
+                samples.m_nanoseconds_per_element[static_cast<size_t>(cardinality)].push_back(
+                  std::stod(fields[6]) / cardinality);
+            }
+            return result;
+        }
+
+        double median(std::vector<double> i_values)
+        {
+            std::sort(i_values.begin(), i_values.end());
+            auto const size = i_values.size();
+            return size % 2 != 0 ? i_values[size / 2]
+                                 : (i_values[size / 2 - 1] + i_values[size / 2]) / 2.;
+        }
+
+        CardinalityComparison compare_cardinality(
+          size_t                      i_cardinality,
+          const std::vector<double> & i_baseline,
+          const std::vector<double> & i_candidate,
+          const ComparisonConfig &    i_config)
+        {
+            CardinalityComparison result;
+            result.m_cardinality      = i_cardinality;
+            result.m_baseline_median  = median(i_baseline);
+            result.m_candidate_median = median(i_candidate);
+            result.m_relative_change  = result.m_baseline_median > 0.
+                                         ? result.m_candidate_median / result.m_baseline_median - 1.
+                                         : 0.;
+            result.m_p_value          = mann_whitney_p_value(i_baseline, i_candidate);
+            result.m_significant =
+              result.m_p_value < i_config.m_significance &&
+              std::abs(result.m_relative_change) >= i_config.m_min_relative_change;
+            return result;
+        }
+
+        /* First line of the source of the test that is not the header of a lambda, for the
+            report */
+        std::string test_label(const TestSamples & i_samples)
+        {
+            std::string const & source = i_samples.m_source;
+            std::string         line;
+            for (size_t start = 0; start < source.size();)
+            {
+                auto end = source.find("#nl#", start);
+                if (end == std::string::npos)
+                    end = source.size();
+                line = source.substr(start, end - start);
+                line.erase(0, line.find_first_not_of(" \t"));
+                if (!line.empty() && line[0] != '[')
+                    break;
+                start = end + 4;
+            }
+            return i_samples.m_group + " [" + std::to_string(i_samples.m_test_index) + "] " + line;
+        }
+    } // namespace
+
+    double mann_whitney_p_value(
+      const std::vector<double> & i_first, const std::vector<double> & i_second)
+    {
+        auto const first_size  = static_cast<double>(i_first.size());
+        auto const second_size = static_cast<double>(i_second.size());
+        if (i_first.empty() || i_second.empty())
+            return 1.;
+
+        // pairs (value, belongs to the first sample), sorted by value
+        std::vector<std::pair<double, bool>> values;
+        values.reserve(i_first.size() + i_second.size());
+        for (auto value : i_first)
+            values.emplace_back(value, true);
+        for (auto value : i_second)
+            values.emplace_back(value, false);
+        std::sort(values.begin(), values.end());
+
+        // sum of the ranks of the first sample, with ties getting the average rank
+        double first_rank_sum = 0., tie_correction = 0.;
+        for (size_t index = 0; index < values.size();)
+        {
+            size_t end = index + 1;
+            while (end < values.size() && values[end].first == values[index].first)
+                end++;
+            auto const tie_count    = static_cast<double>(end - index);
+            auto const average_rank = (index + 1 + end) / 2.;
+            for (size_t tie = index; tie < end; tie++)
+            {
+                if (values[tie].second)
+                    first_rank_sum += average_rank;
+            }
+            tie_correction += tie_count * tie_count * tie_count - tie_count;
+            index = end;
+        }
+
+        auto const total = first_size + second_size;
+        auto const u     = first_rank_sum - first_size * (first_size + 1.) / 2.;
+        auto const mean  = first_size * second_size / 2.;
+        auto const variance =
+          first_size * second_size / 12. * ((total + 1.) - tie_correction / (total * (total - 1.)));
+        if (variance <= 0.)
+            return 1.;
+
+        // continuity correction
+        auto const distance = std::max(std::abs(u - mean) - 0.5, 0.);
+        return std::erfc(distance / std::sqrt(variance) / std::sqrt(2.));
+    }
+
+    size_t compare_results(
+      const char *             i_baseline_file,
+      const char *             i_candidate_file,
+      std::ostream &           i_ostream,
+      const ComparisonConfig & i_config)
+    {
+        auto const baseline  = load_samples(i_baseline_file);
+        auto const candidate = load_samples(i_candidate_file);
+
+        size_t regressions = 0, improvements = 0, compared = 0;
+        for (auto const & candidate_test : candidate)
+        {
+            auto const baseline_it = baseline.find(candidate_test.first);
+            if (baseline_it == baseline.end())
+                continue;
+
+            /* Every cardinality is compared on its own, as the duration per element depends on
+                the cardinality. The worst cardinality is the significant regression with the
+                highest change, or else the cardinality with the highest change. */
+            bool                  has_worst = false, regressed = false, improved = false;
+            CardinalityComparison worst;
+            for (auto const & candidate_samples : candidate_test.second.m_nanoseconds_per_element)
+            {
+                auto const & baseline_by_cardinality = baseline_it->second.m_nanoseconds_per_element;
+                auto const   baseline_samples = baseline_by_cardinality.find(candidate_samples.first);
+                if (baseline_samples == baseline_by_cardinality.end())
+                    continue;
+
+                auto const comparison = compare_cardinality(
+                  candidate_samples.first,
+                  baseline_samples->second,
+                  candidate_samples.second,
+                  i_config);
+                bool const is_regression =
+                  comparison.m_significant && comparison.m_relative_change > 0.;
+                bool const is_worst_regression =
+                  worst.m_significant && worst.m_relative_change > 0.;
+                if (comparison.m_significant && !is_regression)
+                    improved = true;
+                if (!has_worst || (is_regression && !is_worst_regression) ||
+                    (is_regression == is_worst_regression &&
+                     comparison.m_relative_change > worst.m_relative_change))
+                {
+                    worst     = comparison;
+                    has_worst = true;
+                }
+                regressed = regressed || is_regression;
+            }
+            if (!has_worst)
+                continue;
+
+            const char * verdict = "same";
+            if (regressed)
+            {
+                verdict = "REGRESSION";
+                regressions++;
+            }
+            else if (improved)
+            {
+                verdict = "improvement";
+                improvements++;
+            }
+            compared++;
+
+            i_ostream << verdict << '\t' << (worst.m_relative_change >= 0. ? "+" : "")
+                      << worst.m_relative_change * 100. << "%\tp=" << worst.m_p_value << '\t'
+                      << worst.m_baseline_median << " -> " << worst.m_candidate_median
+                      << " ns/element at cardinality " << worst.m_cardinality << '\t'
+                      << test_label(candidate_test.second) << '\n';
+        }
+
+        i_ostream << "compared " << compared << " tests: " << regressions << " regressions, "
+                  << improvements << " improvements" << std::endl;
+        return regressions;
+    }
+
+} // namespace density_bench
@@ -0,0 +1,38 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <ostream>
+#include <vector>
+
+namespace density_bench
+{
+    struct ComparisonConfig
+    {
+        double m_significance        = 0.01; // maximum p-value of a significant change
+        double m_min_relative_change = 0.02; // changes of the median below this are ignored
+    };
+
+    /* Returns the two-sided p-value of the Mann-Whitney U test, that is the probability that two
+        samples at least this different come from the same distribution. Uses the normal
+        approximation with the correction for ties, so it is accurate if both samples have at
+        least 8 values or so. */
+    double mann_whitney_p_value(
+      const std::vector<double> & i_first, const std::vector<double> & i_second);
+
+    /* Loads two files written by Results::save_to_csv, and compares the duration per element of
+        every test found in both. Every cardinality is compared separately, using its repetitions
+        as samples. A test is a regression if, for any cardinality, the candidate median is
+        significantly higher than the baseline median. Prints a line for every test, with its
+        worst cardinality, and returns the number of regressions. Throws std::runtime_error if a
+        file can't be read. */
+    size_t compare_results(
+      const char *             i_baseline_file,
+      const char *             i_candidate_file,
+      std::ostream &           i_ostream,
+      const ComparisonConfig & i_config = ComparisonConfig());
+
+} // namespace density_bench
@@ -0,0 +1,106 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "soak_monitor.h"
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <fstream>
+#include <unistd.h>
+#endif
+
+namespace density_bench
+{
+    uint64_t process_resident_bytes()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.WorkingSetSize;
+#elif defined(__linux__)
+        // the second field of statm is the resident set size in pages
+        std::ifstream statm("/proc/self/statm");
+        uint64_t      size = 0, resident = 0;
+        if (!(statm >> size >> resident))
+            return 0;
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif
+    }
+
+    SoakMonitor::SoakMonitor(size_t i_thread_count, std::vector<std::string> i_gauge_names)
+        : m_gauge_names(std::move(i_gauge_names)), m_slots(new ThreadSlot[i_thread_count]),
+          m_thread_count(i_thread_count)
+    {
+        for (size_t index = 0; index < m_thread_count; index++)
+        {
+            auto & slot = m_slots[index];
+            slot.m_gauges.reset(new std::atomic<int64_t>[m_gauge_names.size()]);
+            for (size_t gauge = 0; gauge < m_gauge_names.size(); gauge++)
+                slot.m_gauges[gauge].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void SoakMonitor::write_header(
+      std::ostream &                   i_ostream,
+      const char *                     i_label,
+      const std::vector<std::string> & i_gauge_names)
+    {
+        i_ostream << i_label << ",seconds,operations_per_second,resident_bytes";
+        for (auto const & name : i_gauge_names)
+            i_ostream << ',' << name;
+        i_ostream << std::endl;
+    }
+
+    void SoakMonitor::run(
+      std::chrono::seconds      i_duration,
+      std::chrono::milliseconds i_interval,
+      const std::string &       i_label,
+      std::ostream &            i_ostream)
+    {
+        using Clock                    = std::chrono::steady_clock;
+        auto const start_time          = Clock::now();
+        auto       sample_time         = start_time;
+        uint64_t   previous_operations = 0;
+        while (sample_time - start_time < i_duration)
+        {
+            auto const previous_time = sample_time;
+            sample_time += i_interval;
+            std::this_thread::sleep_until(sample_time);
+            auto const now = Clock::now();
+
+            uint64_t operations = 0;
+            for (size_t index = 0; index < m_thread_count; index++)
+                operations += m_slots[index].m_operations.load(std::memory_order_relaxed);
+
+            auto const elapsed = std::chrono::duration<double>(now - start_time).count();
+            auto const interval_seconds =
+              std::chrono::duration<double>(now - previous_time).count();
+            i_ostream << i_label << ',' << elapsed << ','
+                      << static_cast<double>(operations - previous_operations) / interval_seconds
+                      << ',' << process_resident_bytes();
+            for (size_t gauge = 0; gauge < m_gauge_names.size(); gauge++)
+            {
+                int64_t sum = 0;
+                for (size_t index = 0; index < m_thread_count; index++)
+                    sum += m_slots[index].m_gauges[gauge].load(std::memory_order_relaxed);
+                i_ostream << ',' << sum;
+            }
+            i_ostream << std::endl;
+
+            previous_operations = operations;
+            sample_time         = now;
+        }
+        m_stop.store(true, std::memory_order_relaxed);
+    }
+
+} // namespace density_bench
@@ -0,0 +1,84 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace density_bench
+{
+    /* Returns the resident set size of the process in bytes, or 0 if it is not available */
+    uint64_t process_resident_bytes();
+
+    /* Samples the throughput of the threads of a long running test, some values published by the
+        threads (the gauges), and the resident set size of the process. The sampling thread calls
+        run, that writes a csv row for every interval until the duration elapses. The threads
+        perform operations until should_stop returns true, publishing their progress in their
+        slot every few operations. */
+    class SoakMonitor
+    {
+      public:
+        /* The values published by a thread. They are written only by the owning thread, and read
+            by the sampling thread. */
+        class ThreadSlot
+        {
+          public:
+            void add_operations(uint64_t i_operations) noexcept
+            {
+                m_operations.store(
+                  m_operations.load(std::memory_order_relaxed) + i_operations,
+                  std::memory_order_relaxed);
+            }
+
+            void set_gauge(size_t i_index, int64_t i_value) noexcept
+            {
+                m_gauges[i_index].store(i_value, std::memory_order_relaxed);
+            }
+
+          private:
+            friend class SoakMonitor;
+            std::atomic<uint64_t>                   m_operations{0};
+            std::unique_ptr<std::atomic<int64_t>[]> m_gauges;
+        };
+
+        /* The value of every gauge in the rows is the sum of the values published by the
+            threads */
+        SoakMonitor(size_t i_thread_count, std::vector<std::string> i_gauge_names);
+
+        SoakMonitor(const SoakMonitor &) = delete;
+        SoakMonitor & operator=(const SoakMonitor &) = delete;
+
+        ThreadSlot & slot(size_t i_thread_index) { return m_slots[i_thread_index]; }
+
+        bool should_stop() const noexcept { return m_stop.load(std::memory_order_relaxed); }
+
+        /* Writes the header of the csv. i_label is the name of the first column. */
+        static void write_header(
+          std::ostream &                   i_ostream,
+          const char *                     i_label,
+          const std::vector<std::string> & i_gauge_names);
+
+        /* Samples until the duration has elapsed, then sets the stop flag. Every row starts with
+            i_label. */
+        void run(
+          std::chrono::seconds      i_duration,
+          std::chrono::milliseconds i_interval,
+          const std::string &       i_label,
+          std::ostream &            i_ostream);
+
+      private:
+        std::vector<std::string>      m_gauge_names;
+        std::unique_ptr<ThreadSlot[]> m_slots;
+        size_t                        m_thread_count;
+        std::atomic<bool>             m_stop{false};
+    };
+
+} // namespace density_bench
@@ -8,9 +8,12 @@
 #include "environment.h"
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <ctime>
+#include <density/density_common.h>
 #include <fstream>
 #include <iomanip>
+#include <memory>
 #include <random>
 #ifdef _MSC_VER
 #include <time.h>
@@ -117,9 +120,15 @@ namespace density_bench
             void generate_performance_operations(const TestTree & i_test_tree, Operations & i_dest);
 
           private:
-            TestConfig m_config;
+            TestConfig                    m_config;
+            std::unique_ptr<PerfCounters> m_counters; // null if hardware counters are disabled
         };
 
+        double cycles_to_ns(uint64_t i_cycles)
+        {
+            return static_cast<double>(i_cycles) / cycles_per_nanosecond();
+        }
+
         // https://stackoverflow.com/questions/2896600/how-to-replace-all-occurrences-of-a-character-in-string
         std::string replace_all(std::string str, const std::string & from, const std::string & to)
         {
@@ -132,6 +141,56 @@ namespace density_bench
             return str;
         }
 
+        std::string json_string(const std::string & i_source)
+        {
+            std::string result = "\"";
+            for (char c : i_source)
+            {
+                switch (c)
+                {
+                case '"':
+                    result += "\\\"";
+                    break;
+                case '\\':
+                    result += "\\\\";
+                    break;
+                case '\n':
+                    result += "\\n";
+                    break;
+                case '\t':
+                    result += "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        char buffer[8];
+                        snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+                        result += buffer;
+                    }
+                    else
+                        result += c;
+                }
+            }
+            return result + '"';
+        }
+
+        std::string csv_field(const std::string & i_source)
+        {
+            return '"' + replace_all(i_source, "\"", "\"\"") + '"';
+        }
+
+        /* UTC date and time in ISO 8601 */
+        std::string format_time(std::chrono::system_clock::time_point i_time)
+        {
+            auto const time = std::chrono::system_clock::to_time_t(i_time);
+            char       buffer[32];
+            auto const length =
+              std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&time));
+            if (length == 0)
+                return std::string();
+            return buffer;
+        }
+
     } // namespace detail
 
     namespace
@@ -173,6 +232,42 @@ namespace density_bench
         m_performance_results.insert(std::make_pair(TestId{i_test, i_cardinality}, i_duration));
     }
 
+    void Results::add_thread_results(
+      const PerformanceTest *           i_test,
+      size_t                            i_cardinality,
+      const std::vector<ThreadResult> & i_thread_results)
+    {
+        m_thread_results.insert(std::make_pair(TestId{i_test, i_cardinality}, i_thread_results));
+    }
+
+    void Results::add_latency(
+      const PerformanceTest * i_test, LatencyKind i_kind, const LatencyHistogram & i_histogram)
+    {
+        auto & histograms = m_latencies[i_test];
+        histograms.resize(latency_kind_count);
+        histograms[static_cast<size_t>(i_kind)].merge(i_histogram);
+    }
+
+    void Results::add_event_counts(
+      const PerformanceTest *                 i_test,
+      size_t                                  i_cardinality,
+      const std::map<std::string, uint64_t> & i_event_counts)
+    {
+        auto & test_events = m_events[i_test];
+        for (auto const & event : i_event_counts)
+        {
+            auto & total = test_events[event.first];
+            total.m_count += event.second;
+            total.m_elements += i_cardinality;
+        }
+    }
+
+    void Results::add_counters(
+      const PerformanceTest * i_test, size_t i_cardinality, const CounterValues & i_counters)
+    {
+        m_counter_results.insert(std::make_pair(TestId{i_test, i_cardinality}, i_counters));
+    }
+
     namespace detail
     {
         void Session::generate_performance_operations(
@@ -186,13 +281,50 @@ namespace density_bench
                 {
                     for (auto & test : test_group.tests())
                     {
-                        i_dest.push_back([&test, cardinality](Results & results) {
+                        if (test.is_concurrent())
+                        {
+                            i_dest.push_back([this, &test, &test_group, cardinality](
+                                               Results & results) {
+                                using namespace std::chrono;
+                                ThreadTeam team(
+                                  test_group.producer_count(),
+                                  test_group.consumer_count(),
+                                  test_group.pin_threads());
+                                if (m_counters)
+                                    m_counters->start();
+                                const auto time_before = high_resolution_clock::now();
+                                test.concurrent_function()(cardinality, team);
+                                const auto duration = duration_cast<nanoseconds>(
+                                  high_resolution_clock::now() - time_before);
+                                results.add_result(&test, cardinality, duration);
+                                if (m_counters)
+                                    results.add_counters(&test, cardinality, m_counters->stop());
+                                results.add_thread_results(&test, cardinality, team.results());
+                                results.add_event_counts(&test, cardinality, team.event_counts());
+                                for (size_t kind = 0; kind < latency_kind_count; kind++)
+                                {
+                                    auto const latency_kind = static_cast<LatencyKind>(kind);
+                                    if (team.has_latency(latency_kind))
+                                    {
+                                        results.add_latency(
+                                          &test, latency_kind, team.merged_latency(latency_kind));
+                                    }
+                                }
+                            });
+                            continue;
+                        }
+
+                        i_dest.push_back([this, &test, cardinality](Results & results) {
                             using namespace std::chrono;
+                            if (m_counters)
+                                m_counters->start();
                             const auto time_before = high_resolution_clock::now();
                             test.function()(cardinality);
                             const auto duration = duration_cast<nanoseconds>(
                               high_resolution_clock::now() - time_before);
                             results.add_result(&test, cardinality, duration);
+                            if (m_counters)
+                                results.add_counters(&test, cardinality, m_counters->stop());
                         });
                     }
                 }
@@ -213,6 +345,16 @@ namespace density_bench
 
             std::mt19937 random;
 
+            /* the counters are opened before any thread of the tests is created, so that they
+                are inherited */
+            m_counters.reset();
+            if (m_config.m_hardware_counters)
+            {
+                m_counters.reset(new PerfCounters);
+                if (!m_counters->is_available())
+                    m_counters.reset();
+            }
+
             // generate operation array
             Operations operations;
             for (size_t repetition_index = 0; repetition_index < m_config.m_performance_repetitions;
@@ -279,6 +421,8 @@ namespace density_bench
             i_ostream << "CARDINALITY_END:" << performance_test_group.cardinality_end()
                       << std::endl;
             i_ostream << "MULTEPLICITY:" << m_config.m_performance_repetitions << std::endl;
+            i_ostream << "PRODUCERS:" << performance_test_group.producer_count() << std::endl;
+            i_ostream << "CONSUMERS:" << performance_test_group.consumer_count() << std::endl;
 
             // write legend
             i_ostream << "LEGEND_START:" << std::endl;
@@ -321,6 +465,95 @@ namespace density_bench
                 i_ostream << std::endl;
             }
             i_ostream << "TABLE_END:-----------------------" << std::endl;
+
+            /* threads of the concurrent tests: cardinality, test index, role, thread index,
+                operations, nanoseconds, pinned */
+            i_ostream << "THREADS_START:-----------------------" << std::endl;
+            for (size_t cardinality = performance_test_group.cardinality_start();
+                 cardinality < performance_test_group.cardinality_end();
+                 cardinality += performance_test_group.cardinality_step())
+            {
+                size_t test_index = 0;
+                for (auto & test : performance_test_group.tests())
+                {
+                    auto range = m_thread_results.equal_range(TestId{&test, cardinality});
+                    for (auto it = range.first; it != range.second; ++it)
+                    {
+                        for (auto const & thread : it->second)
+                        {
+                            i_ostream << "THREAD:" << cardinality << '\t' << test_index << '\t'
+                                      << (thread.m_role == ThreadRole::producer ? "producer"
+                                                                                : "consumer")
+                                      << '\t' << thread.m_index << '\t' << thread.m_operations
+                                      << '\t' << thread.m_duration.count() << '\t'
+                                      << (thread.m_pinned ? "pinned" : "not_pinned") << std::endl;
+                        }
+                    }
+                    test_index++;
+                }
+            }
+            i_ostream << "THREADS_END:-----------------------" << std::endl;
+
+            /* latencies of the concurrent tests, in nanoseconds: test index, kind, count, p50, p99,
+                p99.9, max */
+            i_ostream << "LATENCIES_START:-----------------------" << std::endl;
+            {
+                size_t test_index = 0;
+                for (auto & test : performance_test_group.tests())
+                {
+                    auto const it = m_latencies.find(&test);
+                    for (size_t kind = 0; it != m_latencies.end() && kind < latency_kind_count;
+                         kind++)
+                    {
+                        auto const & histogram = it->second[kind];
+                        if (!histogram.empty())
+                        {
+                            i_ostream << "LATENCY:" << test_index << '\t'
+                                      << latency_kind_name(static_cast<LatencyKind>(kind)) << '\t'
+                                      << histogram.count() << '\t'
+                                      << detail::cycles_to_ns(histogram.percentile(50.)) << '\t'
+                                      << detail::cycles_to_ns(histogram.percentile(99.)) << '\t'
+                                      << detail::cycles_to_ns(histogram.percentile(99.9)) << '\t'
+                                      << detail::cycles_to_ns(histogram.max()) << std::endl;
+                        }
+                    }
+                    test_index++;
+                }
+            }
+            i_ostream << "LATENCIES_END:-----------------------" << std::endl;
+
+            /* hardware counters: cardinality, test index, and the counters in the order of
+                COUNTER_NAMES, in repetition order. An unavailable counter is written as '-'. */
+            i_ostream << "COUNTERS_START:-----------------------" << std::endl;
+            i_ostream << "COUNTER_NAMES:";
+            for (size_t counter = 0; counter < hardware_counter_count; counter++)
+                i_ostream << hardware_counter_name(static_cast<HardwareCounter>(counter)) << '\t';
+            i_ostream << std::endl;
+            for (size_t cardinality = performance_test_group.cardinality_start();
+                 cardinality < performance_test_group.cardinality_end();
+                 cardinality += performance_test_group.cardinality_step())
+            {
+                size_t test_index = 0;
+                for (auto & test : performance_test_group.tests())
+                {
+                    auto range = m_counter_results.equal_range(TestId{&test, cardinality});
+                    for (auto it = range.first; it != range.second; ++it)
+                    {
+                        i_ostream << "COUNTERS:" << cardinality << '\t' << test_index;
+                        for (size_t counter = 0; counter < hardware_counter_count; counter++)
+                        {
+                            i_ostream << '\t';
+                            if (it->second.m_valid[counter])
+                                i_ostream << it->second.m_values[counter];
+                            else
+                                i_ostream << '-';
+                        }
+                        i_ostream << std::endl;
+                    }
+                    test_index++;
+                }
+            }
+            i_ostream << "COUNTERS_END:-----------------------" << std::endl;
             i_ostream << "PERFORMANCE_TEST_GROUP_END:" << i_path << std::endl;
         }
 
@@ -330,6 +563,195 @@ namespace density_bench
         }
     }
 
+    void Results::collect_groups(
+      std::string i_path, const TestTree & i_test_tree, std::vector<GroupRef> & o_groups)
+    {
+        for (const auto & performance_test_group : i_test_tree.performance_tests())
+            o_groups.push_back(GroupRef{i_path, &performance_test_group});
+
+        for (const auto & node : i_test_tree.children())
+            collect_groups(i_path + node.name() + '/', node, o_groups);
+    }
+
+    void Results::save_to_json(const char * i_filename) const
+    {
+        std::ofstream file(i_filename, std::ios_base::out | std::ios_base::trunc);
+        save_to_json(file);
+    }
+
+    void Results::save_to_json(std::ostream & i_ostream) const
+    {
+        using detail::json_string;
+
+        Environment environment;
+        i_ostream << "{\n";
+        i_ostream << "  \"environment\": {\n";
+        i_ostream << "    \"date\": "
+                  << json_string(detail::format_time(environment.startup_clock())) << ",\n";
+        i_ostream << "    \"density_version\": " << json_string(density::version) << ",\n";
+        i_ostream << "    \"compiler\": " << json_string(environment.compiler()) << ",\n";
+        i_ostream << "    \"os\": " << json_string(environment.operating_sytem()) << ",\n";
+        i_ostream << "    \"system\": " << json_string(environment.system_info()) << ",\n";
+        i_ostream << "    \"sizeof_pointer\": " << environment.sizeof_pointer() << "\n";
+        i_ostream << "  },\n";
+        i_ostream << "  \"config\": {\n";
+        i_ostream << "    \"repetitions\": " << m_config.m_performance_repetitions << ",\n";
+        i_ostream << "    \"random_shuffle\": " << (m_config.m_random_shuffle ? "true" : "false")
+                  << ",\n";
+        i_ostream << "    \"hardware_counters\": "
+                  << (m_config.m_hardware_counters ? "true" : "false") << "\n";
+        i_ostream << "  },\n";
+
+        std::vector<GroupRef> groups;
+        collect_groups("", m_test_tree, groups);
+
+        i_ostream << "  \"groups\": [";
+        const char * group_separator = "\n";
+        for (auto const & group_ref : groups)
+        {
+            auto const & group = *group_ref.m_group;
+            i_ostream << group_separator << "    {\n";
+            group_separator = ",\n";
+            i_ostream << "      \"path\": " << json_string(group_ref.m_path) << ",\n";
+            i_ostream << "      \"name\": " << json_string(group.name()) << ",\n";
+            i_ostream << "      \"version_label\": " << json_string(group.version_label()) << ",\n";
+            i_ostream << "      \"cardinality_start\": " << group.cardinality_start() << ",\n";
+            i_ostream << "      \"cardinality_step\": " << group.cardinality_step() << ",\n";
+            i_ostream << "      \"cardinality_end\": " << group.cardinality_end() << ",\n";
+            i_ostream << "      \"producers\": " << group.producer_count() << ",\n";
+            i_ostream << "      \"consumers\": " << group.consumer_count() << ",\n";
+            i_ostream << "      \"tests\": [";
+
+            const char * test_separator = "\n";
+            for (auto const & test : group.tests())
+            {
+                i_ostream << test_separator << "        {\n";
+                test_separator = ",\n";
+                i_ostream << "          \"source\": "
+                          << json_string(detail::replace_all(test.source_code(), "#nl#", "\n"))
+                          << ",\n";
+
+                // durations of the repetitions, and hardware counters if any, for every cardinality
+                i_ostream << "          \"rows\": [";
+                const char * row_separator = "\n";
+                for (size_t cardinality = group.cardinality_start();
+                     cardinality < group.cardinality_end();
+                     cardinality += group.cardinality_step())
+                {
+                    i_ostream << row_separator << "            {\"cardinality\": " << cardinality
+                              << ", \"durations_ns\": [";
+                    row_separator = ",\n";
+                    auto range = m_performance_results.equal_range(TestId{&test, cardinality});
+                    for (auto it = range.first; it != range.second; ++it)
+                        i_ostream << (it == range.first ? "" : ", ") << it->second.count();
+                    i_ostream << "]";
+
+                    auto counter_range = m_counter_results.equal_range(TestId{&test, cardinality});
+                    if (counter_range.first != counter_range.second)
+                    {
+                        i_ostream << ", \"counters\": [";
+                        for (auto it = counter_range.first; it != counter_range.second; ++it)
+                        {
+                            i_ostream << (it == counter_range.first ? "{" : ", {");
+                            const char * counter_separator = "";
+                            for (size_t counter = 0; counter < hardware_counter_count; counter++)
+                            {
+                                if (it->second.m_valid[counter])
+                                {
+                                    i_ostream << counter_separator << '"'
+                                              << hardware_counter_name(
+                                                   static_cast<HardwareCounter>(counter))
+                                              << "\": " << it->second.m_values[counter];
+                                    counter_separator = ", ";
+                                }
+                            }
+                            i_ostream << "}";
+                        }
+                        i_ostream << "]";
+                    }
+                    i_ostream << "}";
+                }
+                i_ostream << "\n          ]";
+
+                auto const latency_it = m_latencies.find(&test);
+                if (latency_it != m_latencies.end())
+                {
+                    i_ostream << ",\n          \"latencies_ns\": {";
+                    const char * latency_separator = "\n";
+                    for (size_t kind = 0; kind < latency_kind_count; kind++)
+                    {
+                        auto const & histogram = latency_it->second[kind];
+                        if (!histogram.empty())
+                        {
+                            i_ostream << latency_separator << "            \""
+                                      << latency_kind_name(static_cast<LatencyKind>(kind))
+                                      << "\": {\"count\": " << histogram.count() << ", \"p50\": "
+                                      << detail::cycles_to_ns(histogram.percentile(50.))
+                                      << ", \"p99\": "
+                                      << detail::cycles_to_ns(histogram.percentile(99.))
+                                      << ", \"p99.9\": "
+                                      << detail::cycles_to_ns(histogram.percentile(99.9))
+                                      << ", \"max\": " << detail::cycles_to_ns(histogram.max())
+                                      << "}";
+                            latency_separator = ",\n";
+                        }
+                    }
+                    i_ostream << "\n          }";
+                }
+                i_ostream << "\n        }";
+            }
+            i_ostream << "\n      ]\n    }";
+        }
+        i_ostream << "\n  ]\n}\n";
+    }
+
+    void Results::save_to_csv(const char * i_filename) const
+    {
+        std::ofstream file(i_filename, std::ios_base::out | std::ios_base::trunc);
+        save_to_csv(file);
+    }
+
+    void Results::save_to_csv(std::ostream & i_ostream) const
+    {
+        using detail::csv_field;
+
+        Environment environment;
+        i_ostream << "# date: " << detail::format_time(environment.startup_clock()) << '\n';
+        i_ostream << "# density_version: " << density::version << '\n';
+        i_ostream << "# compiler: " << environment.compiler() << '\n';
+        i_ostream << "# os: " << environment.operating_sytem() << '\n';
+        i_ostream << "# system: " << environment.system_info() << '\n';
+        i_ostream << "# sizeof_pointer: " << environment.sizeof_pointer() << '\n';
+        i_ostream << "# repetitions: " << m_config.m_performance_repetitions << '\n';
+        i_ostream << "group,test_index,test,producers,consumers,cardinality,duration_ns\n";
+
+        std::vector<GroupRef> groups;
+        collect_groups("", m_test_tree, groups);
+        for (auto const & group_ref : groups)
+        {
+            auto const & group      = *group_ref.m_group;
+            auto const   group_name = csv_field(group_ref.m_path + group.name());
+            size_t       test_index = 0;
+            for (auto const & test : group.tests())
+            {
+                auto const test_source = csv_field(test.source_code());
+                for (size_t cardinality = group.cardinality_start();
+                     cardinality < group.cardinality_end();
+                     cardinality += group.cardinality_step())
+                {
+                    auto range = m_performance_results.equal_range(TestId{&test, cardinality});
+                    for (auto it = range.first; it != range.second; ++it)
+                    {
+                        i_ostream << group_name << ',' << test_index << ',' << test_source << ','
+                                  << group.producer_count() << ',' << group.consumer_count() << ','
+                                  << cardinality << ',' << it->second.count() << '\n';
+                    }
+                }
+                test_index++;
+            }
+        }
+    }
+
     void Results::print_summary(std::ostream & i_ostream)
     {
         struct TestAvgDuration
@@ -352,13 +774,67 @@ namespace density_bench
             test_data.m_count += 1.0;
         }
 
-        m_test_tree.recursive_for_each_child([&tests, &i_ostream](const TestTree & i_test) {
+        // compute the average throughput of every thread of the concurrent tests
+        struct ThreadAvgThroughput
+        {
+            ThreadRole m_role;
+            size_t     m_index;
+            double     m_avg_throughput{0.};
+            double     m_count{1.};
+        };
+        std::unordered_map<const PerformanceTest *, std::vector<ThreadAvgThroughput>> threads;
+        for (const auto & result : m_thread_results)
+        {
+            auto & test_threads = threads[result.first.m_test];
+            test_threads.resize(result.second.size());
+            for (size_t index = 0; index < result.second.size(); index++)
+            {
+                auto & thread_data   = test_threads[index];
+                thread_data.m_role  = result.second[index].m_role;
+                thread_data.m_index = result.second[index].m_index;
+                thread_data.m_avg_throughput +=
+                  (result.second[index].throughput() - thread_data.m_avg_throughput) /
+                  thread_data.m_count;
+                thread_data.m_count += 1.0;
+            }
+        }
+
+        /* sum of the hardware counters and of the cardinalities of every test, to compute the
+            counts per element */
+        struct TestCounters
+        {
+            std::array<double, hardware_counter_count> m_totals{};
+            std::array<double, hardware_counter_count> m_elements{};
+        };
+        std::unordered_map<const PerformanceTest *, TestCounters> counters;
+        for (const auto & result : m_counter_results)
+        {
+            auto & test_counters = counters[result.first.m_test];
+            for (size_t counter = 0; counter < hardware_counter_count; counter++)
+            {
+                if (result.second.m_valid[counter])
+                {
+                    test_counters.m_totals[counter] +=
+                      static_cast<double>(result.second.m_values[counter]);
+                    test_counters.m_elements[counter] +=
+                      static_cast<double>(result.first.m_cardinality);
+                }
+            }
+        }
+
+        auto const & latencies = m_latencies;
+        auto const & events    = m_events;
+        m_test_tree.recursive_for_each_child([&](const TestTree & i_test) {
             for (const auto & group : i_test.performance_tests())
             {
                 struct TestResult
                 {
-                    std::string m_code;
-                    double      m_duration;
+                    std::string                      m_code;
+                    double                           m_duration;
+                    std::vector<ThreadAvgThroughput> m_threads;
+                    const std::vector<LatencyHistogram> * m_latencies;
+                    TestCounters                          m_counters;
+                    const PerformanceTest *               m_test;
                 };
 
                 double                  max_duration = -1;
@@ -370,6 +846,12 @@ namespace density_bench
                     result.m_code =
                       std::string("\t") + detail::replace_all(result.m_code, "#nl#", "\n\t");
                     result.m_duration = tests[&test].m_avg_duration;
+                    result.m_threads  = threads[&test];
+                    result.m_counters = counters[&test];
+                    result.m_test     = &test;
+                    auto const latency_it = latencies.find(&test);
+                    result.m_latencies =
+                      latency_it != latencies.end() ? &latency_it->second : nullptr;
                     max_duration      = std::max(max_duration, result.m_duration);
                     results.push_back(result);
                 }
@@ -387,6 +869,59 @@ namespace density_bench
                     double const duration_percentage = (result.m_duration / max_duration) * 100.;
                     i_ostream << " * average duration: " << duration_percentage << "% ("
                               << result.m_duration << " secs)\n";
+                    for (auto const & thread : result.m_threads)
+                    {
+                        i_ostream << "   "
+                                  << (thread.m_role == ThreadRole::producer ? "producer "
+                                                                            : "consumer ")
+                                  << thread.m_index << ": " << thread.m_avg_throughput
+                                  << " ops/sec\n";
+                    }
+                    for (size_t kind = 0;
+                         result.m_latencies != nullptr && kind < latency_kind_count;
+                         kind++)
+                    {
+                        auto const & histogram = (*result.m_latencies)[kind];
+                        if (!histogram.empty())
+                        {
+                            i_ostream << "   " << latency_kind_name(static_cast<LatencyKind>(kind))
+                                      << " latency (ns): p50 "
+                                      << detail::cycles_to_ns(histogram.percentile(50.)) << ", p99 "
+                                      << detail::cycles_to_ns(histogram.percentile(99.))
+                                      << ", p99.9 "
+                                      << detail::cycles_to_ns(histogram.percentile(99.9))
+                                      << ", max " << detail::cycles_to_ns(histogram.max()) << "\n";
+                        }
+                    }
+                    bool has_counters = false;
+                    for (size_t counter = 0; counter < hardware_counter_count; counter++)
+                    {
+                        if (result.m_counters.m_elements[counter] > 0.)
+                        {
+                            auto const name =
+                              hardware_counter_name(static_cast<HardwareCounter>(counter));
+                            i_ostream << (has_counters ? ", " : "   per element: ") << name << ' '
+                                      << result.m_counters.m_totals[counter] /
+                                           result.m_counters.m_elements[counter];
+                            has_counters = true;
+                        }
+                    }
+                    if (has_counters)
+                        i_ostream << "\n";
+                    auto const test_events = events.find(result.m_test);
+                    if (test_events != events.end() && !test_events->second.empty())
+                    {
+                        i_ostream << "   events per element:";
+                        const char * separator = " ";
+                        for (auto const & event : test_events->second)
+                        {
+                            auto const elements = static_cast<double>(event.second.m_elements);
+                            i_ostream << separator << event.first << ' '
+                                      << (elements > 0. ? event.second.m_count / elements : 0.);
+                            separator = ", ";
+                        }
+                        i_ostream << "\n";
+                    }
                     i_ostream << result.m_code << "\n---------------------------------------\n";
                 }
             }
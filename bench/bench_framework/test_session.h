@@ -5,9 +5,12 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #pragma once
+#include "perf_counters.h"
 #include "test_tree.h"
 #include <chrono>
 #include <deque>
+#include <map>
+#include <string>
 #include <type_traits>
 #include <unordered_map>
 
@@ -19,6 +22,7 @@ namespace density_bench
     {
         bool   m_random_shuffle          = true;
         size_t m_performance_repetitions = 8;
+        bool   m_hardware_counters       = false; // see PerfCounters
     };
 
     class Results
@@ -31,16 +35,54 @@ namespace density_bench
 
         void add_result(const PerformanceTest * i_test, size_t i_cardinality, Duration i_duration);
 
+        void add_thread_results(
+          const PerformanceTest *           i_test,
+          size_t                            i_cardinality,
+          const std::vector<ThreadResult> & i_thread_results);
+
+        /* Merges a histogram of latencies in the histogram of the test, that accumulates all the
+            cardinalities and repetitions */
+        void add_latency(
+          const PerformanceTest * i_test, LatencyKind i_kind, const LatencyHistogram & i_histogram);
+
+        void add_counters(
+          const PerformanceTest * i_test, size_t i_cardinality, const CounterValues & i_counters);
+
+        void add_event_counts(
+          const PerformanceTest *                 i_test,
+          size_t                                  i_cardinality,
+          const std::map<std::string, uint64_t> & i_event_counts);
+
         void save_to(const char * i_filename) const;
 
         void save_to(std::ostream & i_ostream) const;
 
+        /* Writes the results and the environment in JSON. Durations are in nanoseconds. */
+        void save_to_json(const char * i_filename) const;
+
+        void save_to_json(std::ostream & i_ostream) const;
+
+        /* Writes a row for every measured duration. The environment is written in the leading lines,
+            that start with '#'. This is the format read by compare_results. */
+        void save_to_csv(const char * i_filename) const;
+
+        void save_to_csv(std::ostream & i_ostream) const;
+
         void print_summary(std::ostream & i_ostream);
 
       private:
         void save_to_impl(
           std::string i_path, const TestTree & i_test_tree, std::ostream & i_ostream) const;
 
+        struct GroupRef
+        {
+            std::string                  m_path;
+            const PerformanceTestGroup * m_group;
+        };
+
+        static void collect_groups(
+          std::string i_path, const TestTree & i_test_tree, std::vector<GroupRef> & o_groups);
+
       private:
         struct TestId
         {
@@ -61,8 +103,19 @@ namespace density_bench
             }
         };
         std::unordered_multimap<TestId, Duration, TestIdHash> m_performance_results;
-        const TestTree &                                      m_test_tree;
-        const TestConfig                                      m_config;
+        std::unordered_multimap<TestId, std::vector<ThreadResult>, TestIdHash> m_thread_results;
+        std::unordered_map<const PerformanceTest *, std::vector<LatencyHistogram>> m_latencies;
+        std::unordered_multimap<TestId, CounterValues, TestIdHash>             m_counter_results;
+
+        /* sum of the counts and of the cardinalities, for every test and event */
+        struct EventTotal
+        {
+            uint64_t m_count{};
+            uint64_t m_elements{};
+        };
+        std::unordered_map<const PerformanceTest *, std::map<std::string, EventTotal>> m_events;
+        const TestTree &                                                       m_test_tree;
+        const TestConfig                                                       m_config;
     };
 
     struct Progression
@@ -7,6 +7,7 @@
 #include "test_tree.h"
 #include <algorithm>
 #include <random>
+#include <stdexcept>
 #include <string.h>
 
 namespace density_bench
@@ -0,0 +1,107 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "thread_team.h"
+#include "test_framework/threading_extensions.h"
+#include <thread>
+
+namespace density_bench
+{
+    void ThreadTeam::run(const ThreadFunction & i_producer, const ThreadFunction & i_consumer)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        size_t const thread_count    = m_producer_count + m_consumer_count;
+        auto const   processor_count = density_tests::get_num_of_processors();
+
+        m_results.clear();
+        m_results.resize(thread_count);
+        m_latencies.clear();
+        m_latencies.resize(thread_count);
+        m_event_counts.clear();
+
+        std::atomic<size_t> ready_count{0};
+        std::atomic<bool>   start{false};
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for (size_t thread_index = 0; thread_index < thread_count; thread_index++)
+        {
+            auto & result = m_results[thread_index];
+            bool const is_producer = thread_index < m_producer_count;
+            result.m_role          = is_producer ? ThreadRole::producer : ThreadRole::consumer;
+            result.m_index         = is_producer ? thread_index : thread_index - m_producer_count;
+
+            threads.emplace_back([&, thread_index, is_producer] {
+                auto & thread_result = m_results[thread_index];
+                if (m_pin_threads && processor_count > 0)
+                {
+                    auto const cpu = thread_index % processor_count;
+                    thread_result.m_pinned =
+                      cpu < 64 && density_tests::set_thread_affinity(uint64_t(1) << cpu);
+                }
+
+                // start barrier
+                ready_count.fetch_add(1);
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                auto const start_time = Clock::now();
+                auto const & function      = is_producer ? i_producer : i_consumer;
+                thread_result.m_operations = function(thread_result.m_index);
+                thread_result.m_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  Clock::now() - start_time);
+            });
+        }
+
+        while (ready_count.load() < thread_count)
+            std::this_thread::yield();
+        start.store(true, std::memory_order_release);
+
+        for (auto & thread : threads)
+            thread.join();
+    }
+
+    LatencyHistogram & ThreadTeam::latency(ThreadRole i_role, size_t i_index, LatencyKind i_kind)
+    {
+        size_t const thread_index =
+          i_role == ThreadRole::producer ? i_index : m_producer_count + i_index;
+        auto & histogram = m_latencies[thread_index][static_cast<size_t>(i_kind)];
+        if (!histogram)
+            histogram.reset(new LatencyHistogram);
+        return *histogram;
+    }
+
+    bool ThreadTeam::has_latency(LatencyKind i_kind) const
+    {
+        for (auto const & thread_latencies : m_latencies)
+        {
+            auto const & histogram = thread_latencies[static_cast<size_t>(i_kind)];
+            if (histogram && !histogram->empty())
+                return true;
+        }
+        return false;
+    }
+
+    void ThreadTeam::add_event_count(const std::string & i_event, uint64_t i_count)
+    {
+        std::lock_guard<std::mutex> lock(m_event_mutex);
+        m_event_counts[i_event] += i_count;
+    }
+
+    LatencyHistogram ThreadTeam::merged_latency(LatencyKind i_kind) const
+    {
+        LatencyHistogram result;
+        for (auto const & thread_latencies : m_latencies)
+        {
+            auto const & histogram = thread_latencies[static_cast<size_t>(i_kind)];
+            if (histogram)
+                result.merge(*histogram);
+        }
+        return result;
+    }
+
+} // namespace density_bench
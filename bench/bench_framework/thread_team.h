@@ -0,0 +1,105 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "latency_histogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace density_bench
+{
+    enum class ThreadRole
+    {
+        producer,
+        consumer
+    };
+
+    /* Measurement of a thread of a concurrent test */
+    struct ThreadResult
+    {
+        ThreadRole               m_role{ThreadRole::producer};
+        size_t                   m_index{}; // index among the threads with the same role
+        size_t                   m_operations{}; // returned by the thread function
+        std::chrono::nanoseconds m_duration{}; // from the start barrier to the return
+        bool                     m_pinned{false};
+
+        /* Operations per second */
+        double throughput() const
+        {
+            return m_duration.count() > 0
+                     ? static_cast<double>(m_operations) * 1.e9 / m_duration.count()
+                     : 0.;
+        }
+    };
+
+    /* Set of producer and consumer threads that execute a concurrent test. The threads are created
+        and optionally pinned to a processor before the measurement, and they wait on a start
+        barrier, so that the creation of the threads is not measured, and all the threads contend
+        from the beginning. */
+    class ThreadTeam
+    {
+      public:
+        /* Function executed by a thread. The argument is the index of the thread among the threads
+            with the same role, and the return value is the number of operations it has done. */
+        using ThreadFunction = std::function<size_t(size_t i_index)>;
+
+        ThreadTeam(size_t i_producer_count, size_t i_consumer_count, bool i_pin_threads)
+            : m_producer_count(i_producer_count), m_consumer_count(i_consumer_count),
+              m_pin_threads(i_pin_threads)
+        {
+        }
+
+        size_t producer_count() const { return m_producer_count; }
+        size_t consumer_count() const { return m_consumer_count; }
+        bool   pin_threads() const { return m_pin_threads; }
+
+        /* Runs the producers and the consumers concurrently, and waits for them. The thread i is
+            pinned to the processor i modulo the number of processors. Producers get the lower
+            processor indices. */
+        void run(const ThreadFunction & i_producer, const ThreadFunction & i_consumer);
+
+        /* Results of the threads of the last run, producers first */
+        const std::vector<ThreadResult> & results() const { return m_results; }
+
+        /* Returns the histogram of a thread for a kind of latency. It must be called inside run by
+            the thread itself: the histogram is allocated by the thread the first time, and it is
+            not accessed by other threads until run returns, so recording a latency requires no
+            synchronization. */
+        LatencyHistogram & latency(ThreadRole i_role, size_t i_index, LatencyKind i_kind);
+
+        /* Returns whether any thread of the last run has recorded a latency of this kind. */
+        bool has_latency(LatencyKind i_kind) const;
+
+        /* Returns the merged histograms of all the threads of the last run for a kind of latency */
+        LatencyHistogram merged_latency(LatencyKind i_kind) const;
+
+        /* Adds a count to a named event, like the slow path of an allocator. A thread should call it
+            once, when it has finished, because it locks a mutex. The summary reports the events per
+            element of the cardinality. */
+        void add_event_count(const std::string & i_event, uint64_t i_count);
+
+        /* Events counted in the last run */
+        const std::map<std::string, uint64_t> & event_counts() const { return m_event_counts; }
+
+      private:
+        using ThreadLatencies = std::array<std::unique_ptr<LatencyHistogram>, latency_kind_count>;
+
+        size_t const                 m_producer_count, m_consumer_count;
+        bool const                   m_pin_threads;
+        std::vector<ThreadResult>    m_results;
+        std::vector<ThreadLatencies> m_latencies;
+        std::mutex                   m_event_mutex;
+        std::map<std::string, uint64_t> m_event_counts;
+    };
+
+} // namespace density_bench
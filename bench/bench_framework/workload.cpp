@@ -0,0 +1,59 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "workload.h"
+#include <random>
+#include <stdexcept>
+
+namespace density_bench
+{
+    WorkloadSequence::WorkloadSequence(const WorkloadConfig & i_config, size_t i_element_count)
+    {
+        if (i_config.m_kinds.empty() || i_config.m_kinds.size() > 256)
+            throw std::invalid_argument("a workload must have from 1 to 256 kinds of elements");
+
+        std::vector<double> weights;
+        for (auto const & kind : i_config.m_kinds)
+            weights.push_back(kind.m_weight);
+
+        std::mt19937                 random(i_config.m_seed);
+        std::discrete_distribution<> kind_distribution(weights.begin(), weights.end());
+        m_kinds.reserve(i_element_count);
+        for (size_t index = 0; index < i_element_count; index++)
+        {
+            auto const kind = kind_distribution(random);
+            m_kinds.push_back(static_cast<uint8_t>(kind));
+            m_total_size += i_config.m_kinds[kind].m_size;
+        }
+
+        m_burst_ends.resize(i_element_count, false);
+        if (i_config.m_mean_burst_length >= 1.)
+        {
+            // 1 + a geometric distribution, with the requested mean
+            std::geometric_distribution<size_t> length_distribution(
+              1. / i_config.m_mean_burst_length);
+            for (size_t index = 0; index < i_element_count;)
+            {
+                index += 1 + length_distribution(random);
+                if (index <= i_element_count)
+                    m_burst_ends[index - 1] = true;
+            }
+            m_pause_cycles = static_cast<uint64_t>(
+              static_cast<double>(i_config.m_pause_nanoseconds) * cycles_per_nanosecond());
+        }
+    }
+
+    Workload::Workload(WorkloadConfig i_config) : m_config(std::move(i_config)) {}
+
+    const WorkloadSequence & Workload::sequence(size_t i_element_count)
+    {
+        auto & sequence = m_sequences[i_element_count];
+        if (!sequence)
+            sequence.reset(new WorkloadSequence(m_config, i_element_count));
+        return *sequence;
+    }
+
+} // namespace density_bench
@@ -0,0 +1,85 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "latency_histogram.h"
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace density_bench
+{
+    /* A kind of element of a workload. A test maps every kind to a type with this size and
+        alignment, so the kinds of a WorkloadConfig must be in the same order of the types. */
+    struct ElementKind
+    {
+        size_t m_size;
+        size_t m_alignment;
+        double m_weight; // relative frequency of the kind
+    };
+
+    struct WorkloadConfig
+    {
+        std::vector<ElementKind> m_kinds;
+        double   m_mean_burst_length = 0.; // the burst lengths are geometric. 0 means no bursts
+        uint64_t m_pause_nanoseconds = 0;  // busy wait of a producer after every burst
+        uint32_t m_seed              = 1;
+    };
+
+    /* The elements of a workload, generated before the measure. The kinds are drawn independently
+        according to their weights. */
+    class WorkloadSequence
+    {
+      public:
+        WorkloadSequence(const WorkloadConfig & i_config, size_t i_element_count);
+
+        size_t element_count() const noexcept { return m_kinds.size(); }
+
+        size_t kind(size_t i_index) const noexcept { return m_kinds[i_index]; }
+
+        /* Returns whether the element is the last of a burst, so that the producer should call
+            pause after putting it */
+        bool ends_burst(size_t i_index) const noexcept { return m_burst_ends[i_index]; }
+
+        /* Busy waits for the pause between the bursts */
+        void pause() const noexcept
+        {
+            auto const start = read_cycle_counter();
+            while (read_cycle_counter() - start < m_pause_cycles)
+            {
+            }
+        }
+
+        /* Sum of the sizes of the elements */
+        size_t total_size() const noexcept { return m_total_size; }
+
+      private:
+        std::vector<uint8_t> m_kinds;
+        std::vector<bool>    m_burst_ends;
+        uint64_t             m_pause_cycles = 0;
+        size_t               m_total_size   = 0;
+    };
+
+    /* Generates and caches the sequences of a workload, so that the generation is not part of the
+        measured duration. The sequence of a given element count is always the same. */
+    class Workload
+    {
+      public:
+        explicit Workload(WorkloadConfig i_config);
+
+        const WorkloadConfig & config() const noexcept { return m_config; }
+
+        /* Not thread safe: should be called by the test before starting the threads */
+        const WorkloadSequence & sequence(size_t i_element_count);
+
+      private:
+        WorkloadConfig                                      m_config;
+        std::map<size_t, std::unique_ptr<WorkloadSequence>> m_sequences;
+    };
+
+} // namespace density_bench
@@ -9,9 +9,11 @@
 #endif
 
 #include "bench_framework/performance_test.h"
+#include "bench_framework/result_comparator.h"
 #include "bench_framework/test_session.h"
 #include "bench_framework/test_tree.h"
 #include <chrono>
+#include <cstring>
 #include <density/density_common.h>
 #include <fstream>
 #include <iostream>
@@ -20,6 +22,15 @@ namespace density_bench
 {
     void single_thread_tests(TestTree & i_tree);
     void lifo_tests(TestTree & i_tree);
+    void conc_queue_lock_tests(TestTree & i_tree);
+    void reentrant_consume_tests(TestTree & i_tree);
+    void concurrent_queue_tests(TestTree & i_tree);
+    void flavor_matrix_tests(TestTree & i_tree);
+    void latency_tests(TestTree & i_tree);
+    void allocator_tests(TestTree & i_tree);
+    void workload_tests(TestTree & i_tree);
+    void soak_tests(
+      std::chrono::seconds i_duration, size_t i_thread_count, std::ostream & i_ostream);
 } // namespace density_bench
 
 bool touch_file(const char * i_file_name) { return !std::ofstream(i_file_name).fail(); }
@@ -35,8 +46,11 @@ int main(int argc, char * argv[])
     std::cout << "density_bench - built on " __DATE__ " at " __TIME__ << std::endl;
     std::cout << "density version: " << density::version << std::endl;
 
-    std::string out_file;
+    std::string out_file, json_file, csv_file;
     std::string src_dir;
+    std::string baseline_file, candidate_file;
+    TestConfig  config;
+    int         soak_seconds = 0, soak_threads = 4;
 
     char string_argument[4096];
     for (int i = 1; i < argc; i++)
@@ -45,30 +59,111 @@ int main(int argc, char * argv[])
         {
             out_file = string_argument;
         }
+        else if (sscanf(argv[i], "-json: %4095s", string_argument) == 1)
+        {
+            json_file = string_argument;
+        }
+        else if (sscanf(argv[i], "-csv: %4095s", string_argument) == 1)
+        {
+            csv_file = string_argument;
+        }
+        else if (sscanf(argv[i], "-baseline: %4095s", string_argument) == 1)
+        {
+            baseline_file = string_argument;
+        }
+        else if (sscanf(argv[i], "-candidate: %4095s", string_argument) == 1)
+        {
+            candidate_file = string_argument;
+        }
         else if (sscanf(argv[i], "-source: %4095s", string_argument) == 1)
         {
             src_dir = string_argument;
         }
+        else if (sscanf(argv[i], "-soak: %d", &soak_seconds) == 1)
+        {
+        }
+        else if (sscanf(argv[i], "-soak_threads: %d", &soak_threads) == 1)
+        {
+        }
+        else if (strcmp(argv[i], "-hardware_counters") == 0)
+        {
+            config.m_hardware_counters = true;
+        }
         else
         {
             std::cerr << "unrecognized commandline argument: " << argv[i] << std::endl;
         }
     }
 
-    if (!out_file.empty())
+    /* comparison of two csv files: no test is run, and the exit code is 1 if there are
+        regressions */
+    if (!baseline_file.empty() || !candidate_file.empty())
     {
-        if (!touch_file(out_file.c_str()))
+        if (baseline_file.empty() || candidate_file.empty())
+        {
+            std::cerr << "-baseline and -candidate must be used together" << std::endl;
+            return -1;
+        }
+        try
+        {
+            return compare_results(baseline_file.c_str(), candidate_file.c_str(), std::cout) == 0
+                     ? 0
+                     : 1;
+        }
+        catch (const std::exception & i_exception)
         {
-            std::cerr << "can't open for write the file " << out_file << std::endl;
+            std::cerr << i_exception.what() << std::endl;
             return -1;
         }
     }
 
+    for (auto file : {&out_file, &json_file, &csv_file})
+    {
+        if (!file->empty() && !touch_file(file->c_str()))
+        {
+            std::cerr << "can't open for write the file " << *file << std::endl;
+            return -1;
+        }
+    }
+
+    /* soak mode: every concurrent queue is loaded and unloaded for the specified seconds, and a
+        csv row is written every second, to the csv file or to the standard output */
+    if (soak_seconds > 0)
+    {
+        if (soak_threads <= 0)
+        {
+            std::cerr << "-soak_threads must be positive" << std::endl;
+            return -1;
+        }
+        std::ofstream soak_file;
+        if (!csv_file.empty())
+            soak_file.open(csv_file);
+        soak_tests(
+          std::chrono::seconds(soak_seconds),
+          static_cast<size_t>(soak_threads),
+          csv_file.empty() ? std::cout : soak_file);
+        return 0;
+    }
+
+    if (config.m_hardware_counters && !PerfCounters().is_available())
+    {
+        std::cerr << "hardware counters are not available "
+                     "(see /proc/sys/kernel/perf_event_paranoid)"
+                  << std::endl;
+    }
+
     PerformanceTestGroup::set_source_dir(src_dir.c_str());
 
     TestTree root("density");
     single_thread_tests(root);
     lifo_tests(root);
+    conc_queue_lock_tests(root);
+    reentrant_consume_tests(root);
+    concurrent_queue_tests(root);
+    flavor_matrix_tests(root);
+    latency_tests(root);
+    allocator_tests(root);
+    workload_tests(root);
 
     auto progression = [](const Progression & i_progression) {
         auto const millisecs = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -82,12 +177,20 @@ int main(int argc, char * argv[])
         std::cout << std::endl;
     };
 
-    auto result = run_session(root, TestConfig(), progression);
+    auto result = run_session(root, config, progression);
 
     if (!out_file.empty())
     {
         result.save_to(out_file.c_str());
     }
+    if (!json_file.empty())
+    {
+        result.save_to_json(json_file.c_str());
+    }
+    if (!csv_file.empty())
+    {
+        result.save_to_csv(csv_file.c_str());
+    }
 
     result.print_summary(std::cout);
 }
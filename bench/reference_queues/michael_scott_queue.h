@@ -0,0 +1,240 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+
+namespace density_bench
+{
+    /* Unbounded lock-free queue of Maged Michael and Michael Scott ("Simple, Fast, and Practical
+        Non-Blocking and Blocking Concurrent Queue Algorithms", 1996), with the counted pointers and
+        the free list of the paper. The nodes are never returned to the system before the
+        destruction of the queue: they are allocated in chunks and addressed by a 32-bit index, so
+        that an index and its ABA counter fit in a 64-bit atomic. The values are stored in relaxed
+        atomics, because a consumer may read the value of a node that has just been recycled (the
+        read value is then discarded). */
+    template <typename VALUE> class MichaelScottQueue
+    {
+        static_assert(
+          std::is_trivially_copyable<VALUE>::value, "MichaelScottQueue requires a trivial VALUE");
+
+      public:
+        MichaelScottQueue() : m_chunks(new std::atomic<Node *>[max_chunks])
+        {
+            for (uint32_t chunk = 0; chunk < max_chunks; chunk++)
+                m_chunks[chunk].store(nullptr, std::memory_order_relaxed);
+            auto const dummy = new_node();
+            m_head.store(pack(dummy, 0), std::memory_order_relaxed);
+            m_tail.store(pack(dummy, 0), std::memory_order_relaxed);
+        }
+
+        MichaelScottQueue(const MichaelScottQueue &) = delete;
+        MichaelScottQueue & operator=(const MichaelScottQueue &) = delete;
+
+        ~MichaelScottQueue()
+        {
+            for (uint32_t chunk = 0; chunk < max_chunks; chunk++)
+                delete[] m_chunks[chunk].load(std::memory_order_relaxed);
+        }
+
+        void push(const VALUE & i_value)
+        {
+            auto const new_index = allocate_node();
+            auto &     new_node  = node(new_index);
+            new_node.m_value.store(i_value, std::memory_order_relaxed);
+            auto const old_next = new_node.m_next.load(std::memory_order_relaxed);
+            new_node.m_next.store(pack(null_index, tag(old_next) + 1), std::memory_order_relaxed);
+
+            for (;;)
+            {
+                auto   tail      = m_tail.load(std::memory_order_acquire);
+                auto & tail_node = node(index(tail));
+                auto   next      = tail_node.m_next.load(std::memory_order_acquire);
+                if (tail != m_tail.load(std::memory_order_acquire))
+                    continue;
+
+                if (index(next) == null_index)
+                {
+                    if (tail_node.m_next.compare_exchange_weak(
+                          next,
+                          pack(new_index, tag(next) + 1),
+                          std::memory_order_release,
+                          std::memory_order_relaxed))
+                    {
+                        m_tail.compare_exchange_strong(
+                          tail,
+                          pack(new_index, tag(tail) + 1),
+                          std::memory_order_release,
+                          std::memory_order_relaxed);
+                        return;
+                    }
+                }
+                else
+                {
+                    // the tail is lagging behind: help the other producer
+                    m_tail.compare_exchange_strong(
+                      tail,
+                      pack(index(next), tag(tail) + 1),
+                      std::memory_order_release,
+                      std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool try_pop(VALUE & o_value)
+        {
+            for (;;)
+            {
+                auto       head = m_head.load(std::memory_order_acquire);
+                auto       tail = m_tail.load(std::memory_order_acquire);
+                auto const next = node(index(head)).m_next.load(std::memory_order_acquire);
+                if (head != m_head.load(std::memory_order_acquire))
+                    continue;
+
+                if (index(head) == index(tail))
+                {
+                    if (index(next) == null_index)
+                        return false;
+                    m_tail.compare_exchange_strong(
+                      tail,
+                      pack(index(next), tag(tail) + 1),
+                      std::memory_order_release,
+                      std::memory_order_relaxed);
+                }
+                else if (index(next) != null_index) // else head has been recycled meanwhile
+                {
+                    auto const value = node(index(next)).m_value.load(std::memory_order_relaxed);
+                    if (m_head.compare_exchange_weak(
+                          head,
+                          pack(index(next), tag(head) + 1),
+                          std::memory_order_acq_rel,
+                          std::memory_order_relaxed))
+                    {
+                        o_value = value;
+                        free_node(index(head));
+                        return true;
+                    }
+                }
+            }
+        }
+
+        bool try_pop()
+        {
+            VALUE value;
+            return try_pop(value);
+        }
+
+        bool empty() const noexcept
+        {
+            auto const head = m_head.load(std::memory_order_acquire);
+            return index(node(index(head)).m_next.load(std::memory_order_acquire)) == null_index;
+        }
+
+      private:
+        static constexpr uint32_t null_index      = UINT32_MAX;
+        static constexpr unsigned chunk_bits      = 12;
+        static constexpr uint32_t chunk_size      = uint32_t(1) << chunk_bits;
+        static constexpr uint32_t max_chunks      = uint32_t(1) << 16;
+        static constexpr size_t   cache_line_size = 64;
+
+        struct Node
+        {
+            std::atomic<uint64_t> m_next; // index and counter of the next node
+            std::atomic<VALUE>    m_value;
+        };
+
+        static uint64_t pack(uint32_t i_index, uint32_t i_tag) noexcept
+        {
+            return (static_cast<uint64_t>(i_tag) << 32) | i_index;
+        }
+
+        static uint32_t index(uint64_t i_pointer) noexcept
+        {
+            return static_cast<uint32_t>(i_pointer);
+        }
+
+        static uint32_t tag(uint64_t i_pointer) noexcept
+        {
+            return static_cast<uint32_t>(i_pointer >> 32);
+        }
+
+        Node & node(uint32_t i_index) const noexcept
+        {
+            return m_chunks[i_index >> chunk_bits].load(std::memory_order_acquire)
+              [i_index & (chunk_size - 1)];
+        }
+
+        /* Takes a node from the free list, or creates a new one */
+        uint32_t allocate_node()
+        {
+            auto head = m_free_head.load(std::memory_order_acquire);
+            while (index(head) != null_index)
+            {
+                auto const next = node(index(head)).m_next.load(std::memory_order_relaxed);
+                if (m_free_head.compare_exchange_weak(
+                      head,
+                      pack(index(next), tag(head) + 1),
+                      std::memory_order_acquire,
+                      std::memory_order_acquire))
+                    return index(head);
+            }
+            return new_node();
+        }
+
+        void free_node(uint32_t i_index) noexcept
+        {
+            auto & freed = node(i_index);
+            auto   head  = m_free_head.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                auto const old_next = freed.m_next.load(std::memory_order_relaxed);
+                freed.m_next.store(
+                  pack(index(head), tag(old_next) + 1), std::memory_order_relaxed);
+                if (m_free_head.compare_exchange_weak(
+                      head,
+                      pack(i_index, tag(head) + 1),
+                      std::memory_order_release,
+                      std::memory_order_relaxed))
+                    return;
+            }
+        }
+
+        /* Assigns a new index, allocating its chunk if it does not exist yet */
+        uint32_t new_node()
+        {
+            auto const new_index = m_node_count.fetch_add(1, std::memory_order_relaxed);
+            if (new_index >= max_chunks * chunk_size - 1)
+                throw std::bad_alloc();
+            auto & chunk = m_chunks[new_index >> chunk_bits];
+            if (chunk.load(std::memory_order_acquire) == nullptr)
+            {
+                std::unique_ptr<Node[]> new_chunk(new Node[chunk_size]);
+                for (uint32_t index = 0; index < chunk_size; index++)
+                    new_chunk[index].m_next.store(pack(null_index, 0), std::memory_order_relaxed);
+                Node * expected = nullptr;
+                if (chunk.compare_exchange_strong(
+                      expected, new_chunk.get(), std::memory_order_acq_rel))
+                    new_chunk.release();
+            }
+            return new_index;
+        }
+
+      private:
+        std::unique_ptr<std::atomic<Node *>[]> m_chunks;
+        std::atomic<uint32_t>                  m_node_count{0};
+        std::atomic<uint64_t>                  m_free_head{pack(null_index, 0)};
+        char                                   m_padding_1[cache_line_size];
+        std::atomic<uint64_t>                  m_tail{0};
+        char                                   m_padding_2[cache_line_size];
+        std::atomic<uint64_t>                  m_head{0};
+        char                                   m_padding_3[cache_line_size];
+    };
+
+} // namespace density_bench
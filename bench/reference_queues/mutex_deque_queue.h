@@ -0,0 +1,54 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <deque>
+#include <mutex>
+
+namespace density_bench
+{
+    /* Unbounded queue made of a std::deque protected by a std::mutex. It is the simplest thread
+        safe queue, used as reference. */
+    template <typename VALUE> class MutexDequeQueue
+    {
+      public:
+        void push(const VALUE & i_value)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_deque.push_back(i_value);
+        }
+
+        bool try_pop(VALUE & o_value)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_deque.empty())
+                return false;
+            o_value = std::move(m_deque.front());
+            m_deque.pop_front();
+            return true;
+        }
+
+        bool try_pop()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_deque.empty())
+                return false;
+            m_deque.pop_front();
+            return true;
+        }
+
+        bool empty() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_deque.empty();
+        }
+
+      private:
+        mutable std::mutex m_mutex;
+        std::deque<VALUE>  m_deque;
+    };
+
+} // namespace density_bench
@@ -0,0 +1,128 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <assert.h>
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <thread>
+#include <type_traits>
+
+namespace density_bench
+{
+    /* Bounded multi-producer multi-consumer ring buffer of Dmitry Vyukov
+        (http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue). Every cell
+        has a sequence number that tells to producers and consumers whether it is free or full, so
+        a put or a consume is a single compare-exchange on the tail or the head. The values must be
+        trivially copyable. */
+    template <typename VALUE> class VyukovMpmcQueue
+    {
+        static_assert(
+          std::is_trivially_copyable<VALUE>::value, "VyukovMpmcQueue requires a trivial VALUE");
+
+      public:
+        /* i_capacity must be a power of 2 */
+        explicit VyukovMpmcQueue(size_t i_capacity = 64 * 1024)
+            : m_cells(new Cell[i_capacity]), m_mask(i_capacity - 1)
+        {
+            assert(i_capacity >= 2 && (i_capacity & (i_capacity - 1)) == 0);
+            for (size_t index = 0; index < i_capacity; index++)
+                m_cells[index].m_sequence.store(index, std::memory_order_relaxed);
+        }
+
+        VyukovMpmcQueue(const VyukovMpmcQueue &) = delete;
+        VyukovMpmcQueue & operator=(const VyukovMpmcQueue &) = delete;
+
+        bool try_push(const VALUE & i_value) noexcept
+        {
+            auto position = m_tail.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                auto &     cell     = m_cells[position & m_mask];
+                auto const sequence = cell.m_sequence.load(std::memory_order_acquire);
+                auto const difference =
+                  static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+                if (difference == 0)
+                {
+                    if (m_tail.compare_exchange_weak(
+                          position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.m_value = i_value;
+                        cell.m_sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                    return false; // full
+                else
+                    position = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        /* Waits while the queue is full */
+        void push(const VALUE & i_value) noexcept
+        {
+            while (!try_push(i_value))
+                std::this_thread::yield();
+        }
+
+        bool try_pop(VALUE & o_value) noexcept
+        {
+            auto position = m_head.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                auto &     cell     = m_cells[position & m_mask];
+                auto const sequence = cell.m_sequence.load(std::memory_order_acquire);
+                auto const difference =
+                  static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position + 1);
+                if (difference == 0)
+                {
+                    if (m_head.compare_exchange_weak(
+                          position, position + 1, std::memory_order_relaxed))
+                    {
+                        o_value = cell.m_value;
+                        cell.m_sequence.store(position + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                    return false; // empty
+                else
+                    position = m_head.load(std::memory_order_relaxed);
+            }
+        }
+
+        bool try_pop() noexcept
+        {
+            VALUE value;
+            return try_pop(value);
+        }
+
+        bool empty() const noexcept
+        {
+            return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_relaxed);
+        }
+
+      private:
+        static constexpr size_t cache_line_size = 64;
+
+        struct Cell
+        {
+            std::atomic<size_t> m_sequence;
+            VALUE               m_value;
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        size_t const            m_mask;
+        char                    m_padding_1[cache_line_size];
+        std::atomic<size_t>     m_tail{0};
+        char                    m_padding_2[cache_line_size];
+        std::atomic<size_t>     m_head{0};
+        char                    m_padding_3[cache_line_size];
+    };
+
+} // namespace density_bench
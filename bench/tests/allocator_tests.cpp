@@ -0,0 +1,562 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/test_tree.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <density/default_allocator.h>
+#include <memory>
+#include <string>
+#include <thread>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace density_bench
+{
+    /* Pages of the default allocator */
+    struct DensityPages
+    {
+        static constexpr bool has_statistics = true;
+
+        static void * allocate() { return density::default_allocator().allocate_page(); }
+
+        static void deallocate(void * i_page) noexcept
+        {
+            density::default_allocator().deallocate_page(i_page);
+        }
+    };
+
+    /* Zeroed pages of the default allocator, deallocated without altering them */
+    struct DensityZeroedPages
+    {
+        static constexpr bool has_statistics = true;
+
+        static void * allocate() { return density::default_allocator().allocate_page_zeroed(); }
+
+        static void deallocate(void * i_page) noexcept
+        {
+            density::default_allocator().deallocate_page_zeroed(i_page);
+        }
+    };
+
+    /* Pages of the default allocator requested with a lock-free progress guarantee, so they can be
+        only recycled or carved from the memory reserved by reserve_lockfree_page_memory. */
+    struct DensityLockFreePages
+    {
+        static constexpr bool has_statistics = true;
+
+        static void * allocate() noexcept
+        {
+            return density::default_allocator().try_allocate_page(density::progress_lock_free);
+        }
+
+        static void deallocate(void * i_page) noexcept
+        {
+            if (i_page != nullptr)
+                density::default_allocator().deallocate_page(i_page);
+        }
+    };
+
+    /* Blocks of the size of a page from malloc, not aligned */
+    struct MallocPages
+    {
+        static constexpr bool has_statistics = false;
+
+        static void * allocate() noexcept
+        {
+            return std::malloc(density::default_allocator::page_size);
+        }
+
+        static void deallocate(void * i_page) noexcept { std::free(i_page); }
+    };
+
+    /* Blocks with the size and the alignment of a page from the aligned allocation of the system.
+        posix_memalign is used instead of aligned_alloc, that is C++17. */
+    struct AlignedPages
+    {
+        static constexpr bool has_statistics = false;
+
+        static void * allocate() noexcept
+        {
+#ifdef _MSC_VER
+            return _aligned_malloc(
+              density::default_allocator::page_size, density::default_allocator::page_alignment);
+#else
+            void * page = nullptr;
+            if (
+              posix_memalign(
+                &page,
+                density::default_allocator::page_alignment,
+                density::default_allocator::page_size) != 0)
+                return nullptr;
+            return page;
+#endif
+        }
+
+        static void deallocate(void * i_page) noexcept
+        {
+#ifdef _MSC_VER
+            _aligned_free(i_page);
+#else
+            std::free(i_page);
+#endif
+        }
+    };
+
+    /* Resets the statistics of the page allocator of the calling thread, and when destroyed adds
+        them to the events of the team. Does nothing if DENSITY_PAGE_ALLOCATOR_STATISTICS is not
+        defined, or if i_enabled is false. */
+    class PageStatisticsScope
+    {
+      public:
+        PageStatisticsScope(ThreadTeam & i_team, bool i_enabled) : m_team(i_team)
+        {
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+            m_enabled = i_enabled;
+            if (m_enabled)
+                density::default_allocator::reset_thread_statistics();
+#else
+            (void)i_enabled;
+#endif
+        }
+
+        PageStatisticsScope(const PageStatisticsScope &) = delete;
+        PageStatisticsScope & operator=(const PageStatisticsScope &) = delete;
+
+        ~PageStatisticsScope()
+        {
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+            if (!m_enabled)
+                return;
+            auto const & statistics = density::default_allocator::thread_statistics();
+            m_team.add_event_count("slow_path", statistics.m_slow_path_allocations);
+            m_team.add_event_count("steal", statistics.m_steal_allocations);
+            m_team.add_event_count("system", statistics.m_system_allocations);
+            m_team.add_event_count("zeroing", statistics.m_zeroing_allocations);
+            m_team.add_event_count("private_free", statistics.m_private_deallocations);
+            m_team.add_event_count("failed", statistics.m_failed_allocations);
+            m_team.add_event_count("deferred_unpin", statistics.m_deferred_unpins);
+#endif
+        }
+
+      private:
+        ThreadTeam & m_team;
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+        bool m_enabled = false;
+#endif
+    };
+
+    /* Allocates and deallocates i_cardinality pages, in batches of BATCH_SIZE pages. The first byte
+        of every page is written. */
+    template <typename PAGES, size_t BATCH_SIZE>
+    void batch_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        i_team.run(
+          [&](size_t) {
+              PageStatisticsScope statistics(i_team, PAGES::has_statistics);
+              void *              pages[BATCH_SIZE];
+              for (size_t done = 0; done < i_cardinality;)
+              {
+                  size_t const count = std::min(BATCH_SIZE, i_cardinality - done);
+                  for (size_t index = 0; index < count; index++)
+                  {
+                      pages[index] = PAGES::allocate();
+                      // the write prevents the compiler from removing a malloc followed by a free
+                      if (pages[index] != nullptr)
+                          *static_cast<volatile char *>(pages[index]) = 0;
+                  }
+                  for (size_t index = 0; index < count; index++)
+                      PAGES::deallocate(pages[index]);
+                  done += count;
+              }
+              return i_cardinality;
+          },
+          [](size_t) { return size_t(0); });
+    }
+
+    /* Single-producer single-consumer ring of pages, used to move pages between two threads
+        without allocating */
+    class PageRing
+    {
+      public:
+        bool try_push(void * i_page) noexcept
+        {
+            auto const tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) == capacity)
+                return false;
+            m_slots[tail % capacity] = i_page;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool try_pop(void *& o_page) noexcept
+        {
+            auto const head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+                return false;
+            o_page = m_slots[head % capacity];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+      private:
+        static constexpr size_t capacity = 256;
+        std::atomic<size_t>     m_head{0};
+        char                    m_head_padding[64];
+        std::atomic<size_t>     m_tail{0};
+        char                    m_tail_padding[64];
+        void *                  m_slots[capacity];
+    };
+
+    /* Every producer allocates its share of i_cardinality pages, and every consumer deallocates the
+        pages of a producer, so the pages are always freed by a thread other than the one that has
+        allocated them. The producers must be as many as the consumers. */
+    template <typename PAGES> void cross_thread_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        size_t const thread_pairs = i_team.producer_count();
+        std::unique_ptr<PageRing[]> rings(new PageRing[thread_pairs]);
+        auto const share = [&](size_t i_index) {
+            return i_cardinality / thread_pairs + (i_index < i_cardinality % thread_pairs ? 1 : 0);
+        };
+
+        i_team.run(
+          [&](size_t i_index) {
+              PageStatisticsScope statistics(i_team, PAGES::has_statistics);
+              size_t const        count = share(i_index);
+              for (size_t i = 0; i < count; i++)
+              {
+                  auto const page = PAGES::allocate();
+                  while (!rings[i_index].try_push(page))
+                      std::this_thread::yield();
+              }
+              return count;
+          },
+          [&](size_t i_index) {
+              PageStatisticsScope statistics(i_team, PAGES::has_statistics);
+              size_t const        count = share(i_index);
+              for (size_t i = 0; i < count; i++)
+              {
+                  void * page;
+                  while (!rings[i_index].try_pop(page))
+                      std::this_thread::yield();
+                  PAGES::deallocate(page);
+              }
+              return count;
+          });
+    }
+
+    /* Every thread allocates bursts of BURST_SIZE pages and then deallocates them. When its slot is
+        empty a thread takes the pages released by the others, so with the default allocator this
+        is a steal-heavy pattern. */
+    template <typename PAGES, size_t BURST_SIZE>
+    void burst_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        size_t const thread_count = i_team.producer_count();
+        i_team.run(
+          [&](size_t i_index) {
+              PageStatisticsScope statistics(i_team, PAGES::has_statistics);
+              size_t const        count = i_cardinality / thread_count +
+                                   (i_index < i_cardinality % thread_count ? 1 : 0);
+              void * pages[BURST_SIZE];
+              for (size_t done = 0; done < count;)
+              {
+                  // a burst size depending on the thread avoids that the threads go in lockstep
+                  size_t const burst = std::min(BURST_SIZE - i_index % BURST_SIZE, count - done);
+                  for (size_t index = 0; index < burst; index++)
+                      pages[index] = PAGES::allocate();
+                  for (size_t index = 0; index < burst; index++)
+                      PAGES::deallocate(pages[index]);
+                  done += burst;
+              }
+              return count;
+          },
+          [](size_t) { return size_t(0); });
+    }
+
+    constexpr size_t pinned_page_count = 16;
+
+    /* Pins and unpins the pages of the default allocator */
+    struct BlockingPins
+    {
+        static constexpr bool has_statistics = true;
+
+        static void pin(void * i_page) noexcept { density::default_allocator().pin_page(i_page); }
+
+        static void unpin(void * i_page) noexcept
+        {
+            density::default_allocator().unpin_page(i_page);
+        }
+    };
+
+    /* Pins and unpins the pages of the default allocator with a wait-free progress guarantee, so
+        the unpins may be deferred */
+    struct WaitFreePins
+    {
+        static constexpr bool has_statistics = true;
+
+        static void pin(void * i_page) noexcept
+        {
+            while (!density::default_allocator().try_pin_page(density::progress_wait_free, i_page))
+            {
+            }
+        }
+
+        static void unpin(void * i_page) noexcept
+        {
+            density::default_allocator().unpin_page(density::progress_wait_free, i_page);
+        }
+    };
+
+    /* A plain atomic ref-count for every page, as reference */
+    struct AtomicRefCountPins
+    {
+        static constexpr bool has_statistics = false;
+
+        static std::atomic<uintptr_t> & ref_count(void * i_page) noexcept
+        {
+            static std::atomic<uintptr_t> s_ref_counts[pinned_page_count];
+            auto const address = reinterpret_cast<uintptr_t>(i_page);
+            return s_ref_counts[(address / density::default_allocator::page_alignment) %
+                                pinned_page_count];
+        }
+
+        static void pin(void * i_page) noexcept
+        {
+            ref_count(i_page).fetch_add(1, std::memory_order_acquire);
+        }
+
+        static void unpin(void * i_page) noexcept
+        {
+            ref_count(i_page).fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    /* The threads share i_cardinality pins of a small set of pages, reading a byte of the page
+        while it is pinned, like the consumers of a lock-free queue do. */
+    template <typename PINS> void pin_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        density::default_allocator allocator;
+        void *                     pages[pinned_page_count];
+        for (auto & page : pages)
+            page = allocator.allocate_page_zeroed();
+
+        size_t const        thread_count = i_team.producer_count();
+        std::atomic<size_t> checksum{0};
+        i_team.run(
+          [&](size_t i_index) {
+              PageStatisticsScope statistics(i_team, PINS::has_statistics);
+              size_t const        count = i_cardinality / thread_count +
+                                   (i_index < i_cardinality % thread_count ? 1 : 0);
+              size_t sum = 0;
+              for (size_t i = 0; i < count; i++)
+              {
+                  auto const page = pages[(i * 7 + i_index) % pinned_page_count];
+                  PINS::pin(page);
+                  sum += *static_cast<volatile unsigned char *>(page);
+                  PINS::unpin(page);
+              }
+              checksum.fetch_add(sum, std::memory_order_relaxed);
+              return count;
+          },
+          [](size_t) { return size_t(0); });
+
+        for (auto page : pages)
+            allocator.deallocate_page_zeroed(page);
+    }
+
+    void single_thread_allocator_tests(TestTree & i_tree)
+    {
+        PerformanceTestGroup group("allocator_single_thread", "");
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(1, 0);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              batch_load<DensityPages, 1>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              batch_load<DensityPages, 256>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              batch_load<DensityZeroedPages, 256>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              density::default_allocator::reserve_lockfree_page_memory(
+                256 * density::default_allocator::page_size);
+              batch_load<DensityLockFreePages, 256>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              batch_load<MallocPages, 1>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              batch_load<MallocPages, 256>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              batch_load<AlignedPages, 256>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree["allocator_single_thread"].add_performance_test(group);
+    }
+
+    template <size_t THREAD_PAIRS> void cross_thread_allocator_tests(TestTree & i_tree)
+    {
+        std::string const name = "allocator_cross_thread_" + std::to_string(THREAD_PAIRS) + "p_" +
+                                 std::to_string(THREAD_PAIRS) + "c";
+        PerformanceTestGroup group(name, "");
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(THREAD_PAIRS, THREAD_PAIRS);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              cross_thread_load<DensityPages>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              cross_thread_load<MallocPages>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              cross_thread_load<AlignedPages>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree[name.c_str()].add_performance_test(group);
+    }
+
+    void burst_allocator_tests(TestTree & i_tree)
+    {
+        PerformanceTestGroup group("allocator_bursts_4_threads", "");
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(4, 0);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              burst_load<DensityPages, 64>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              burst_load<MallocPages, 64>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              burst_load<AlignedPages, 64>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree["allocator_bursts_4_threads"].add_performance_test(group);
+    }
+
+    void pin_allocator_tests(TestTree & i_tree)
+    {
+        PerformanceTestGroup group("allocator_pins_4_threads", "");
+
+        group.set_cardinality_start(100000);
+        group.set_cardinality_step(200000);
+        group.set_cardinality_end(2000000);
+        group.set_threads(4, 0);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              pin_load<BlockingPins>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              pin_load<WaitFreePins>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              pin_load<AtomicRefCountPins>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree["allocator_pins_4_threads"].add_performance_test(group);
+    }
+
+    void allocator_tests(TestTree & i_tree)
+    {
+        single_thread_allocator_tests(i_tree);
+        cross_thread_allocator_tests<1>(i_tree);
+        cross_thread_allocator_tests<4>(i_tree);
+        burst_allocator_tests(i_tree);
+        pin_allocator_tests(i_tree);
+    }
+
+} // namespace density_bench
@@ -0,0 +1,121 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/test_tree.h"
+#include <array>
+#include <density/conc_function_queue.h>
+#include <density/mutexes.h>
+
+namespace density_bench
+{
+    /* Every producer of the team alternates a push and a consume, so the mutex is always contended
+        when there are many threads. The size of the capture of the callable determines the length
+        of the critical section of the push. The team has no consumers. */
+    template <typename QUEUE, size_t CAPTURE_SIZE>
+    void mixed_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        QUEUE queue;
+
+        size_t const thread_count = i_team.producer_count();
+        i_team.run(
+          [&](size_t) {
+              std::array<char, CAPTURE_SIZE> capture{};
+              size_t const                   count = i_cardinality / thread_count;
+              for (size_t i = 0; i < count; i++)
+              {
+                  queue.push([capture] {
+                      volatile char c = capture[0];
+                      (void)c;
+                  });
+                  queue.try_consume();
+              }
+              return count * 2;
+          },
+          [](size_t) -> size_t { return 0; });
+
+        while (queue.try_consume())
+        {
+        }
+    }
+
+    template <size_t THREAD_COUNT, size_t CAPTURE_SIZE>
+    void conc_queue_lock_tests(TestTree & i_tree, const char * i_name)
+    {
+        PerformanceTestGroup group(i_name, "");
+
+        using namespace density;
+
+        group.set_cardinality_start(1000);
+        group.set_cardinality_step(10000);
+        group.set_cardinality_end(100000);
+        group.set_threads(THREAD_COUNT, 0);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_function_queue<void()>;
+              mixed_load<Queue, CAPTURE_SIZE>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_function_queue<
+                void(),
+                default_allocator,
+                function_standard_erasure,
+                lock_single,
+                adaptive_mutex>;
+              mixed_load<Queue, CAPTURE_SIZE>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_function_queue<
+                void(),
+                default_allocator,
+                function_standard_erasure,
+                lock_single,
+                ticket_mutex>;
+              mixed_load<Queue, CAPTURE_SIZE>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_function_queue<
+                void(),
+                default_allocator,
+                function_standard_erasure,
+                lock_head_tail,
+                adaptive_mutex>;
+              mixed_load<Queue, CAPTURE_SIZE>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree[i_name].add_performance_test(group);
+    }
+
+    void conc_queue_lock_tests(TestTree & i_tree)
+    {
+        conc_queue_lock_tests<1, 8>(i_tree, "conc_queue_lock_1_short");
+        conc_queue_lock_tests<4, 8>(i_tree, "conc_queue_lock_4_short");
+        conc_queue_lock_tests<16, 8>(i_tree, "conc_queue_lock_16_short");
+        conc_queue_lock_tests<1, 512>(i_tree, "conc_queue_lock_1_long");
+        conc_queue_lock_tests<4, 512>(i_tree, "conc_queue_lock_4_long");
+        conc_queue_lock_tests<16, 512>(i_tree, "conc_queue_lock_16_long");
+    }
+
+} // namespace density_bench
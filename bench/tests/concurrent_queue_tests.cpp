@@ -0,0 +1,117 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/test_tree.h"
+#include "reference_queues/michael_scott_queue.h"
+#include "reference_queues/mutex_deque_queue.h"
+#include "reference_queues/vyukov_mpmc_queue.h"
+#include "tests/producer_consumer_load.h"
+#include <density/conc_heter_queue.h>
+#include <density/lf_heter_queue.h>
+#include <density/mutexes.h>
+#include <density/sp_heter_queue.h>
+#include <string>
+
+namespace density_bench
+{
+    template <size_t PRODUCER_COUNT, size_t CONSUMER_COUNT>
+    void concurrent_queue_tests(TestTree & i_tree)
+    {
+        std::string const name = "concurrent_queue_" + std::to_string(PRODUCER_COUNT) + "p_" +
+                                 std::to_string(CONSUMER_COUNT) + "c";
+        PerformanceTestGroup group(name, "");
+
+        using namespace density;
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(PRODUCER_COUNT, CONSUMER_COUNT);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_heter_queue<>;
+              producer_consumer_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = sp_heter_queue<>;
+              producer_consumer_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_heter_queue<>;
+              producer_consumer_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_heter_queue<
+                runtime_type<>,
+                default_allocator,
+                lock_head_tail,
+                adaptive_mutex>;
+              producer_consumer_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        // reference implementations
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = VyukovMpmcQueue<int>;
+              producer_consumer_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = MichaelScottQueue<int>;
+              producer_consumer_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = MutexDequeQueue<int>;
+              producer_consumer_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree[name.c_str()].add_performance_test(group);
+    }
+
+    void concurrent_queue_tests(TestTree & i_tree)
+    {
+        concurrent_queue_tests<1, 1>(i_tree);
+        concurrent_queue_tests<2, 2>(i_tree);
+        concurrent_queue_tests<4, 4>(i_tree);
+        concurrent_queue_tests<8, 8>(i_tree);
+        concurrent_queue_tests<1, 4>(i_tree);
+        concurrent_queue_tests<4, 1>(i_tree);
+    }
+
+} // namespace density_bench
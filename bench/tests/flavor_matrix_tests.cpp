@@ -0,0 +1,241 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/test_tree.h"
+#include "tests/producer_consumer_load.h"
+#include <density/lf_function_queue.h>
+#include <density/lf_heter_queue.h>
+#include <density/sp_heter_queue.h>
+#include <string>
+
+namespace density_bench
+{
+    inline const char * flavor_name(density::concurrency_cardinality i_cardinality)
+    {
+        using namespace density;
+        return i_cardinality == concurrency_single ? "concurrency_single" : "concurrency_multiple";
+    }
+
+    inline const char * flavor_name(density::consistency_model i_consistency)
+    {
+        using namespace density;
+        return i_consistency == consistency_relaxed ? "consistency_relaxed"
+                                                    : "consistency_sequential";
+    }
+
+    inline const char * flavor_name(density::function_type_erasure i_erasure)
+    {
+        using namespace density;
+        return i_erasure == function_standard_erasure ? "function_standard_erasure"
+                                                      : "function_manual_clear";
+    }
+
+    inline const char * flavor_name(const density::default_busy_wait &)
+    {
+        return "default_busy_wait";
+    }
+
+    inline const char * flavor_name(const density::adaptive_busy_wait &)
+    {
+        return "adaptive_busy_wait";
+    }
+
+    /* Gives to a function queue the interface used by producer_consumer_load. Every element is a
+        lambda capturing an int, so that it has the size of the elements of the heterogeneous
+        queues. */
+    template <typename FUNCTION_QUEUE> class FunctionQueueLoad
+    {
+      public:
+        void push(int i_value)
+        {
+            m_queue.push([i_value] { (void)i_value; });
+        }
+
+        bool try_pop() { return m_queue.try_consume(); }
+
+        bool empty() { return m_queue.empty(); }
+
+      private:
+        FUNCTION_QUEUE m_queue;
+    };
+
+    /* Adds to the group a test on QUEUE. The code of the test would be the same for every flavor,
+        so its type is used as source code. */
+    template <typename QUEUE>
+    void add_flavor_test(PerformanceTestGroup & i_group, const std::string & i_type_name)
+    {
+        i_group.add_test(PerformanceTest(
+          "using Queue = " + i_type_name +
+            ";#nl#producer_consumer_load<Queue>(i_cardinality, i_team);",
+          &producer_consumer_load<QUEUE>));
+    }
+
+    template <
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY,
+      density::consistency_model       CONSISTENCY_MODEL>
+    void add_lf_heter_queue_flavor(PerformanceTestGroup & i_group)
+    {
+        using namespace density;
+        using Queue = lf_heter_queue<
+          runtime_type<>,
+          default_allocator,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          CONSISTENCY_MODEL>;
+
+        add_flavor_test<Queue>(
+          i_group,
+          std::string("lf_heter_queue<runtime_type<>, default_allocator, ") +
+            flavor_name(PROD_CARDINALITY) + ", " + flavor_name(CONSUMER_CARDINALITY) + ", " +
+            flavor_name(CONSISTENCY_MODEL) + ">");
+    }
+
+    template <
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY>
+    void add_lf_heter_queue_flavors(PerformanceTestGroup & i_group)
+    {
+        using namespace density;
+        add_lf_heter_queue_flavor<PROD_CARDINALITY, CONSUMER_CARDINALITY, consistency_sequential>(
+          i_group);
+        add_lf_heter_queue_flavor<PROD_CARDINALITY, CONSUMER_CARDINALITY, consistency_relaxed>(
+          i_group);
+    }
+
+    template <
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY,
+      typename BUSY_WAIT>
+    void add_sp_heter_queue_flavor(PerformanceTestGroup & i_group)
+    {
+        using namespace density;
+        using Queue = sp_heter_queue<
+          runtime_type<>,
+          default_allocator,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          BUSY_WAIT>;
+
+        add_flavor_test<Queue>(
+          i_group,
+          std::string("sp_heter_queue<runtime_type<>, default_allocator, ") +
+            flavor_name(PROD_CARDINALITY) + ", " + flavor_name(CONSUMER_CARDINALITY) + ", " +
+            flavor_name(BUSY_WAIT()) + ">");
+    }
+
+    template <
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY>
+    void add_sp_heter_queue_flavors(PerformanceTestGroup & i_group)
+    {
+        using namespace density;
+        add_sp_heter_queue_flavor<PROD_CARDINALITY, CONSUMER_CARDINALITY, default_busy_wait>(
+          i_group);
+        add_sp_heter_queue_flavor<PROD_CARDINALITY, CONSUMER_CARDINALITY, adaptive_busy_wait>(
+          i_group);
+    }
+
+    template <
+      density::function_type_erasure   ERASURE,
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY,
+      density::consistency_model       CONSISTENCY_MODEL>
+    void add_lf_function_queue_flavor(PerformanceTestGroup & i_group)
+    {
+        using namespace density;
+        using Queue = lf_function_queue<
+          void(),
+          default_allocator,
+          ERASURE,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          CONSISTENCY_MODEL>;
+
+        add_flavor_test<FunctionQueueLoad<Queue>>(
+          i_group,
+          std::string("FunctionQueueLoad<lf_function_queue<void(), default_allocator, ") +
+            flavor_name(ERASURE) + ", " + flavor_name(PROD_CARDINALITY) + ", " +
+            flavor_name(CONSUMER_CARDINALITY) + ", " + flavor_name(CONSISTENCY_MODEL) + ">>");
+    }
+
+    template <
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY>
+    void add_lf_function_queue_flavors(PerformanceTestGroup & i_group)
+    {
+        using namespace density;
+        add_lf_function_queue_flavor<
+          function_standard_erasure,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          consistency_sequential>(i_group);
+        add_lf_function_queue_flavor<
+          function_standard_erasure,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          consistency_relaxed>(i_group);
+        add_lf_function_queue_flavor<
+          function_manual_clear,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          consistency_sequential>(i_group);
+        add_lf_function_queue_flavor<
+          function_manual_clear,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          consistency_relaxed>(i_group);
+    }
+
+    /* Adds all the flavors of the queues with the given cardinalities */
+    template <
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY>
+    void add_flavors(PerformanceTestGroup & i_group)
+    {
+        add_lf_heter_queue_flavors<PROD_CARDINALITY, CONSUMER_CARDINALITY>(i_group);
+        add_sp_heter_queue_flavors<PROD_CARDINALITY, CONSUMER_CARDINALITY>(i_group);
+        add_lf_function_queue_flavors<PROD_CARDINALITY, CONSUMER_CARDINALITY>(i_group);
+    }
+
+    /* Adds a group with all the flavors of lf_heter_queue, sp_heter_queue and lf_function_queue
+        that can be used with the given number of producers and consumers: a single cardinality
+        is valid only if the topology has one thread of that side. The summary of the group sorts
+        the flavors by duration, so the last one is the configuration to pick. */
+    template <size_t PRODUCER_COUNT, size_t CONSUMER_COUNT>
+    void flavor_matrix_tests(TestTree & i_tree)
+    {
+        std::string const name = "flavor_matrix_" + std::to_string(PRODUCER_COUNT) + "p_" +
+                                 std::to_string(CONSUMER_COUNT) + "c";
+        using namespace density;
+        PerformanceTestGroup group(name, "");
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(PRODUCER_COUNT, CONSUMER_COUNT);
+
+        add_flavors<concurrency_multiple, concurrency_multiple>(group);
+        if (PRODUCER_COUNT == 1)
+            add_flavors<concurrency_single, concurrency_multiple>(group);
+        if (CONSUMER_COUNT == 1)
+            add_flavors<concurrency_multiple, concurrency_single>(group);
+        if (PRODUCER_COUNT == 1 && CONSUMER_COUNT == 1)
+            add_flavors<concurrency_single, concurrency_single>(group);
+
+        i_tree[name.c_str()].add_performance_test(group);
+    }
+
+    void flavor_matrix_tests(TestTree & i_tree)
+    {
+        flavor_matrix_tests<1, 1>(i_tree);
+        flavor_matrix_tests<1, 4>(i_tree);
+        flavor_matrix_tests<4, 1>(i_tree);
+        flavor_matrix_tests<4, 4>(i_tree);
+    }
+
+} // namespace density_bench
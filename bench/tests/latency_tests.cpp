@@ -0,0 +1,330 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/test_tree.h"
+#include <assert.h>
+#include <atomic>
+#include <cstring>
+#include <density/byte_queue.h>
+#include <density/conc_heter_queue.h>
+#include <density/heter_queue.h>
+#include <density/lf_byte_queue.h>
+#include <density/lf_heter_queue.h>
+#include <density/mutexes.h>
+#include <density/priority_heter_queue.h>
+#include <density/sp_heter_queue.h>
+#include <string>
+
+namespace density_bench
+{
+    /* Puts and reads the timestamps of the elements. The heterogeneous queues store an uint64_t. */
+    template <typename QUEUE> struct TimestampQueue
+    {
+        static void push(QUEUE & i_queue, size_t /*i_producer*/, uint64_t i_timestamp)
+        {
+            i_queue.push(i_timestamp);
+        }
+
+        template <typename CONSUME>
+        static uint64_t read(const CONSUME & i_consume)
+        {
+            return i_consume.template element<uint64_t>();
+        }
+    };
+
+    /* Every producer puts in its own level */
+    template <
+      typename RUNTIME_TYPE,
+      size_t                           N_LEVELS,
+      typename ALLOCATOR_TYPE,
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY>
+    struct TimestampQueue<density::priority_heter_queue<
+      RUNTIME_TYPE,
+      N_LEVELS,
+      ALLOCATOR_TYPE,
+      PROD_CARDINALITY,
+      CONSUMER_CARDINALITY>>
+    {
+        template <typename QUEUE>
+        static void push(QUEUE & i_queue, size_t i_producer, uint64_t i_timestamp)
+        {
+            i_queue.push(i_producer % N_LEVELS, i_timestamp);
+        }
+
+        template <typename CONSUME>
+        static uint64_t read(const CONSUME & i_consume)
+        {
+            return i_consume.template element<uint64_t>();
+        }
+    };
+
+    /* The byte queues store the timestamp as a message of 8 bytes */
+    template <typename ALLOCATOR_TYPE> struct TimestampQueue<density::byte_queue<ALLOCATOR_TYPE>>
+    {
+        template <typename QUEUE>
+        static void push(QUEUE & i_queue, size_t /*i_producer*/, uint64_t i_timestamp)
+        {
+            i_queue.push(&i_timestamp, sizeof(i_timestamp));
+        }
+
+        template <typename CONSUME>
+        static uint64_t read(const CONSUME & i_consume)
+        {
+            uint64_t timestamp;
+            assert(i_consume.span().size() == sizeof(timestamp));
+            std::memcpy(&timestamp, i_consume.span().data(), sizeof(timestamp));
+            return timestamp;
+        }
+    };
+
+    template <
+      typename ALLOCATOR_TYPE,
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY,
+      density::consistency_model       CONSISTENCY_MODEL>
+    struct TimestampQueue<
+      density::
+        lf_byte_queue<ALLOCATOR_TYPE, PROD_CARDINALITY, CONSUMER_CARDINALITY, CONSISTENCY_MODEL>>
+        : TimestampQueue<density::byte_queue<ALLOCATOR_TYPE>>
+    {
+    };
+
+    /* The producers share i_cardinality pushes of the timestamp taken at the begin of the push. The
+        consumers record the time from that timestamp to the end of the consume. Consumers terminate
+        like in producer_consumer_load. */
+    template <typename QUEUE> void latency_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        using Timestamps = TimestampQueue<QUEUE>;
+
+        QUEUE               queue;
+        std::atomic<size_t> consumed{0};
+
+        size_t const producer_count = i_team.producer_count();
+        i_team.run(
+          [&](size_t i_index) {
+              auto & put_latency = i_team.latency(ThreadRole::producer, i_index, LatencyKind::put);
+              size_t const count = i_cardinality / producer_count +
+                                   (i_index < i_cardinality % producer_count ? 1 : 0);
+              for (size_t i = 0; i < count; i++)
+              {
+                  auto const start = read_cycle_counter();
+                  Timestamps::push(queue, i_index, start);
+                  put_latency.record(read_cycle_counter() - start);
+              }
+              return count;
+          },
+          [&](size_t i_index) {
+              auto & consume_latency =
+                i_team.latency(ThreadRole::consumer, i_index, LatencyKind::consume);
+              auto & end_to_end_latency =
+                i_team.latency(ThreadRole::consumer, i_index, LatencyKind::end_to_end);
+              typename QUEUE::consume_operation consume;
+              size_t                            operations = 0, unpublished = 0;
+              while (consumed.load(std::memory_order_relaxed) < i_cardinality)
+              {
+                  auto const start = read_cycle_counter();
+                  if (queue.try_start_consume(consume))
+                  {
+                      auto const timestamp = Timestamps::read(consume);
+                      consume.commit();
+                      auto const end = read_cycle_counter();
+                      consume_latency.record(end - start);
+                      // with a non-invariant TSC the counters of two cores may be not synchronized
+                      end_to_end_latency.record(end > timestamp ? end - timestamp : 0);
+                      operations++;
+                      unpublished++;
+                  }
+                  else if (unpublished != 0)
+                  {
+                      consumed.fetch_add(unpublished, std::memory_order_relaxed);
+                      unpublished = 0;
+                  }
+              }
+              return operations;
+          });
+
+        assert(queue.empty());
+    }
+
+    /* Used for the queues that are not thread safe: a single producer puts and then immediately
+        consumes every element, so the end-to-end latency is the sum of a put and a consume on hot
+        cache. */
+    template <typename QUEUE>
+    void single_thread_latency_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        using Timestamps = TimestampQueue<QUEUE>;
+
+        QUEUE queue;
+        i_team.run(
+          [&](size_t i_index) {
+              auto & put_latency = i_team.latency(ThreadRole::producer, i_index, LatencyKind::put);
+              auto & consume_latency =
+                i_team.latency(ThreadRole::producer, i_index, LatencyKind::consume);
+              auto & end_to_end_latency =
+                i_team.latency(ThreadRole::producer, i_index, LatencyKind::end_to_end);
+              typename QUEUE::consume_operation consume;
+              for (size_t i = 0; i < i_cardinality; i++)
+              {
+                  auto const start = read_cycle_counter();
+                  Timestamps::push(queue, i_index, start);
+                  auto const put_end = read_cycle_counter();
+                  put_latency.record(put_end - start);
+
+                  bool const consumed = queue.try_start_consume(consume);
+                  assert(consumed);
+                  (void)consumed;
+                  auto const timestamp = Timestamps::read(consume);
+                  consume.commit();
+                  auto const end = read_cycle_counter();
+                  consume_latency.record(end - put_end);
+                  end_to_end_latency.record(end - timestamp);
+              }
+              return i_cardinality;
+          },
+          [](size_t) { return size_t(0); });
+
+        assert(queue.empty());
+    }
+
+    template <size_t PRODUCER_COUNT, size_t CONSUMER_COUNT> void latency_tests(TestTree & i_tree)
+    {
+        std::string const name = "latency_" + std::to_string(PRODUCER_COUNT) + "p_" +
+                                 std::to_string(CONSUMER_COUNT) + "c";
+        PerformanceTestGroup group(name, "");
+
+        using namespace density;
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(PRODUCER_COUNT, CONSUMER_COUNT);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_heter_queue<>;
+              latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_heter_queue<
+                runtime_type<>,
+                default_allocator,
+                concurrency_multiple,
+                concurrency_multiple,
+                consistency_relaxed>;
+              latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = sp_heter_queue<>;
+              latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_heter_queue<>;
+              latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_heter_queue<
+                runtime_type<>,
+                default_allocator,
+                lock_head_tail,
+                adaptive_mutex>;
+              latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = priority_heter_queue<>;
+              latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_byte_queue<>;
+              latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree[name.c_str()].add_performance_test(group);
+    }
+
+    void single_thread_latency_tests(TestTree & i_tree)
+    {
+        PerformanceTestGroup group("latency_single_thread", "");
+
+        using namespace density;
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(1, 0);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = heter_queue<>;
+              single_thread_latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = byte_queue<>;
+              single_thread_latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_heter_queue<>;
+              single_thread_latency_load<Queue>(i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree["latency_single_thread"].add_performance_test(group);
+    }
+
+    void latency_tests(TestTree & i_tree)
+    {
+        single_thread_latency_tests(i_tree);
+        latency_tests<1, 1>(i_tree);
+        latency_tests<4, 4>(i_tree);
+    }
+
+} // namespace density_bench
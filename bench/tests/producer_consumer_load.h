@@ -0,0 +1,67 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "bench_framework/thread_team.h"
+#include <assert.h>
+#include <atomic>
+#include <stddef.h>
+
+namespace density_bench
+{
+    /* Body of a consumer thread of a load: pops from i_queue until i_consumed reaches
+        i_cardinality, and returns the number of pops. The count of the pops is published to
+        i_consumed only when the queue is found empty, so that the shared counter is not contended
+        while the queue is not empty. */
+    template <typename QUEUE>
+    size_t consume_load(QUEUE & i_queue, std::atomic<size_t> & i_consumed, size_t i_cardinality)
+    {
+        size_t operations = 0, unpublished = 0;
+        while (i_consumed.load(std::memory_order_relaxed) < i_cardinality)
+        {
+            if (i_queue.try_pop())
+            {
+                operations++;
+                unpublished++;
+            }
+            else if (unpublished != 0)
+            {
+                i_consumed.fetch_add(unpublished, std::memory_order_relaxed);
+                unpublished = 0;
+            }
+        }
+        return operations;
+    }
+
+    /* The producers share i_cardinality pushes of an int. The consumers pop until all the elements
+        have been consumed, using consume_load. */
+    template <typename QUEUE> void producer_consumer_load(size_t i_cardinality, ThreadTeam & i_team)
+    {
+        QUEUE               queue;
+        std::atomic<size_t> consumed{0};
+
+        size_t const producer_count = i_team.producer_count();
+        size_t const consumer_count = i_team.consumer_count();
+        i_team.run(
+          [&](size_t i_index) {
+              size_t const count = i_cardinality / producer_count +
+                                   (i_index < i_cardinality % producer_count ? 1 : 0);
+              for (size_t i = 0; i < count; i++)
+                  queue.push(static_cast<int>(i));
+              return count;
+          },
+          [&](size_t) { return consume_load(queue, consumed, i_cardinality); });
+
+        if (consumer_count == 0)
+        {
+            while (queue.try_pop())
+            {
+            }
+        }
+        assert(queue.empty());
+    }
+
+} // namespace density_bench
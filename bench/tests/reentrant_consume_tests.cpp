@@ -0,0 +1,72 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/test_tree.h"
+#include <assert.h>
+#include <density/heter_queue.h>
+#include <vector>
+
+namespace density_bench
+{
+    void reentrant_consume_tests(TestTree & i_tree)
+    {
+        PerformanceTestGroup group("heter_queue_reentrant_consume", "");
+
+        using namespace density;
+
+        group.set_cardinality_start(1000);
+        group.set_cardinality_step(1000);
+        group.set_cardinality_end(10000);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality) {
+              heter_queue<> queue;
+              for (size_t i = 0; i < i_cardinality; i++)
+                  queue.push(static_cast<int>(i));
+
+              for (size_t i = 0; i < i_cardinality; i++)
+              {
+                  auto consume = queue.try_start_reentrant_consume();
+                  consume.commit();
+              }
+              assert(queue.empty());
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality) {
+              heter_queue<> queue;
+              size_t const  in_flight_count = 10000;
+              for (size_t i = 0; i < in_flight_count + i_cardinality; i++)
+                  queue.push(static_cast<int>(i));
+
+              // 10k reentrant consumes in progress at the head of the queue
+              std::vector<heter_queue<>::reentrant_consume_operation> in_flight;
+              in_flight.reserve(in_flight_count);
+              for (size_t i = 0; i < in_flight_count; i++)
+                  in_flight.push_back(queue.try_start_reentrant_consume());
+
+              for (size_t i = 0; i < i_cardinality; i++)
+              {
+                  auto consume = queue.try_start_reentrant_consume();
+                  consume.commit();
+              }
+
+              for (auto & consume : in_flight)
+                  consume.commit();
+              assert(queue.empty());
+          },
+          __LINE__);
+
+        i_tree["heter_queue_reentrant_consume"].add_performance_test(group);
+    }
+
+} // namespace density_bench
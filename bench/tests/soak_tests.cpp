@@ -0,0 +1,146 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/soak_monitor.h"
+#include <array>
+#include <density/conc_heter_queue.h>
+#include <density/default_allocator.h>
+#include <density/lf_heter_queue.h>
+#include <density/sp_heter_queue.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace density_bench
+{
+    /* Gauges published by the threads of a soak test. The page counts of a thread come from the
+        statistics of its page allocator, so they are available only if
+        DENSITY_PAGE_ALLOCATOR_STATISTICS is defined. */
+    enum SoakGauge
+    {
+        soak_queue_elements, // pushes minus pops
+        soak_live_pages,     // pages allocated minus pages deallocated
+        soak_system_pages,   // pages carved from the memory of the system
+        soak_private_pages,  // pages in the private stacks of the page allocators
+    };
+
+    std::vector<std::string> soak_gauge_names()
+    {
+        return {"queue_elements", "live_pages", "system_pages", "private_pages"};
+    }
+
+    /* Publishes the gauges of the calling thread in its slot */
+    inline void publish_soak_gauges(SoakMonitor::ThreadSlot & i_slot, int64_t i_queue_elements)
+    {
+        i_slot.set_gauge(soak_queue_elements, i_queue_elements);
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+        auto const & statistics = density::default_allocator::thread_statistics();
+        i_slot.set_gauge(
+          soak_live_pages,
+          static_cast<int64_t>(statistics.m_allocations - statistics.m_failed_allocations) -
+            static_cast<int64_t>(statistics.m_deallocations));
+        i_slot.set_gauge(soak_system_pages, static_cast<int64_t>(statistics.m_system_allocations));
+        i_slot.set_gauge(
+          soak_private_pages,
+          static_cast<int64_t>(statistics.m_private_deallocations) -
+            static_cast<int64_t>(statistics.m_private_allocations));
+#endif
+    }
+
+    /* Elements of different size, so that pages are not filled uniformly */
+    template <size_t SIZE> struct SoakElement
+    {
+        std::array<unsigned char, SIZE> m_payload;
+    };
+
+    /* Like HeterLoadUnloadTest every thread pushes and pops, but randomly: in the load phases 3
+        operations out of 4 are pushes, in the unload phases 1 out of 4. The phases switch every
+        2^20 operations, so the queue grows and shrinks and its pages are allocated and
+        deallocated continuously. */
+    template <typename QUEUE>
+    void soak_test(
+      const std::string &  i_queue_name,
+      std::chrono::seconds i_duration,
+      size_t               i_thread_count,
+      std::ostream &       i_ostream)
+    {
+        QUEUE       queue;
+        SoakMonitor monitor(i_thread_count, soak_gauge_names());
+
+        std::vector<std::thread> threads;
+        for (size_t thread_index = 0; thread_index < i_thread_count; thread_index++)
+        {
+            threads.emplace_back([&queue, &monitor, thread_index] {
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+                density::default_allocator::reset_thread_statistics();
+#endif
+                auto &   slot           = monitor.slot(thread_index);
+                uint32_t random         = static_cast<uint32_t>(thread_index * 2654435761u + 1);
+                uint64_t operation      = 0;
+                int64_t  queue_elements = 0;
+                while (!monitor.should_stop())
+                {
+                    for (int batch = 0; batch < 1024; batch++, operation++)
+                    {
+                        // xorshift32
+                        random ^= random << 13;
+                        random ^= random >> 17;
+                        random ^= random << 5;
+
+                        bool const load_phase = ((operation >> 20) & 1) == 0;
+                        bool const push       = (random & 3) != 0 ? load_phase : !load_phase;
+                        if (push)
+                        {
+                            switch ((random >> 8) & 3)
+                            {
+                            case 0:
+                                queue.push(static_cast<uint32_t>(operation));
+                                break;
+                            case 1:
+                                queue.push(SoakElement<40>());
+                                break;
+                            case 2:
+                                queue.push(SoakElement<200>());
+                                break;
+                            default:
+                                queue.push(std::string(random % 64, 'x'));
+                                break;
+                            }
+                            queue_elements++;
+                        }
+                        else if (queue.try_pop())
+                            queue_elements--;
+                    }
+                    slot.add_operations(1024);
+                    publish_soak_gauges(slot, queue_elements);
+                }
+            });
+        }
+
+        monitor.run(i_duration, std::chrono::milliseconds(1000), i_queue_name, i_ostream);
+
+        for (auto & thread : threads)
+            thread.join();
+
+        while (queue.try_pop())
+        {
+        }
+    }
+
+    void soak_tests(
+      std::chrono::seconds i_duration, size_t i_thread_count, std::ostream & i_ostream)
+    {
+        using namespace density;
+
+        SoakMonitor::write_header(i_ostream, "queue", soak_gauge_names());
+
+        soak_test<lf_heter_queue<>>("lf_heter_queue", i_duration, i_thread_count, i_ostream);
+        soak_test<conc_heter_queue<>>("conc_heter_queue", i_duration, i_thread_count, i_ostream);
+        soak_test<sp_heter_queue<>>("sp_heter_queue", i_duration, i_thread_count, i_ostream);
+    }
+
+} // namespace density_bench
@@ -0,0 +1,343 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+
+#include "bench_framework/test_tree.h"
+#include "bench_framework/workload.h"
+#include "tests/producer_consumer_load.h"
+#include <assert.h>
+#include <atomic>
+#include <cstring>
+#include <density/conc_heter_queue.h>
+#include <density/heter_queue.h>
+#include <density/lf_heter_queue.h>
+#include <density/mutexes.h>
+#include <density/priority_heter_queue.h>
+#include <density/sp_heter_queue.h>
+#include <initializer_list>
+#include <string>
+
+namespace density_bench
+{
+    /* Element of a workload. The producer writes all the payload, like a real message. */
+    template <size_t SIZE, size_t ALIGNMENT> struct alignas(ALIGNMENT) Message
+    {
+        Message() { std::memset(m_payload, 0x5A, SIZE); }
+
+        unsigned char m_payload[SIZE];
+    };
+
+    /* Puts an element in a queue */
+    template <typename QUEUE> struct WorkloadQueue
+    {
+        template <typename MESSAGE> static void emplace(QUEUE & i_queue, size_t /*i_producer*/)
+        {
+            i_queue.template emplace<MESSAGE>();
+        }
+    };
+
+    /* Every producer puts in its own level */
+    template <
+      typename RUNTIME_TYPE,
+      size_t                           N_LEVELS,
+      typename ALLOCATOR_TYPE,
+      density::concurrency_cardinality PROD_CARDINALITY,
+      density::concurrency_cardinality CONSUMER_CARDINALITY>
+    struct WorkloadQueue<density::priority_heter_queue<
+      RUNTIME_TYPE,
+      N_LEVELS,
+      ALLOCATOR_TYPE,
+      PROD_CARDINALITY,
+      CONSUMER_CARDINALITY>>
+    {
+        using Queue = density::priority_heter_queue<
+          RUNTIME_TYPE,
+          N_LEVELS,
+          ALLOCATOR_TYPE,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY>;
+
+        template <typename MESSAGE> static void emplace(Queue & i_queue, size_t i_producer)
+        {
+            i_queue.template emplace<MESSAGE>(i_producer % N_LEVELS);
+        }
+    };
+
+    /* The types of the elements of a workload. The kind i of a WorkloadSequence is the i-th
+        type. */
+    template <typename... MESSAGES> struct MessageSet
+    {
+        static std::vector<ElementKind> kinds(std::initializer_list<double> i_weights)
+        {
+            std::vector<ElementKind> result{{sizeof(MESSAGES), alignof(MESSAGES), 0.}...};
+            assert(i_weights.size() == result.size());
+            size_t index = 0;
+            for (auto weight : i_weights)
+                result[index++].m_weight = weight;
+            return result;
+        }
+
+        template <typename QUEUE>
+        static void push(QUEUE & i_queue, size_t i_producer, size_t i_kind)
+        {
+            using PushFunction = void (*)(QUEUE &, size_t);
+            static PushFunction const s_functions[] = {
+              &WorkloadQueue<QUEUE>::template emplace<MESSAGES>...};
+            s_functions[i_kind](i_queue, i_producer);
+        }
+    };
+
+    /* Mostly small elements, some over-aligned, and rarely an element that does not fit in a page
+        of the default allocator, so it is allocated externally. */
+    using MixedMessages = MessageSet<
+      Message<8, 8>,
+      Message<24, 8>,
+      Message<64, 8>,
+      Message<48, 64>,
+      Message<480, 16>,
+      Message<4000, 256>,
+      Message<80000, 8>>;
+
+    struct SteadyWorkload
+    {
+        static const char * name() { return "steady"; }
+
+        static Workload & get()
+        {
+            static Workload s_workload([] {
+                WorkloadConfig config;
+                config.m_kinds = MixedMessages::kinds({40., 25., 15., 8., 8., 3.9, 0.1});
+                return config;
+            }());
+            return s_workload;
+        }
+    };
+
+    /* Bursts of 64 elements on average, with a pause of 2 microseconds between the bursts */
+    struct BurstyWorkload
+    {
+        static const char * name() { return "bursty"; }
+
+        static Workload & get()
+        {
+            static Workload s_workload([] {
+                WorkloadConfig config;
+                config.m_kinds = MixedMessages::kinds({40., 25., 15., 8., 8., 3.9, 0.1});
+                config.m_mean_burst_length = 64.;
+                config.m_pause_nanoseconds = 2000;
+                return config;
+            }());
+            return s_workload;
+        }
+    };
+
+    /* The producers share the elements of the sequence, pausing after every burst. The consumers
+        pop with consume_load. */
+    template <typename MESSAGES, typename QUEUE>
+    void workload_load(Workload & i_workload, size_t i_cardinality, ThreadTeam & i_team)
+    {
+        auto const &        sequence = i_workload.sequence(i_cardinality);
+        QUEUE               queue;
+        std::atomic<size_t> consumed{0};
+
+        size_t const producer_count = i_team.producer_count();
+        i_team.run(
+          [&](size_t i_index) {
+              size_t const begin = i_cardinality * i_index / producer_count;
+              size_t const end   = i_cardinality * (i_index + 1) / producer_count;
+              for (size_t i = begin; i < end; i++)
+              {
+                  MESSAGES::push(queue, i_index, sequence.kind(i));
+                  if (sequence.ends_burst(i))
+                      sequence.pause();
+              }
+              return end - begin;
+          },
+          [&](size_t) { return consume_load(queue, consumed, i_cardinality); });
+
+        assert(queue.empty());
+    }
+
+    /* A single thread puts every burst and then consumes it. The pauses are skipped. */
+    template <typename MESSAGES, typename QUEUE>
+    void single_thread_workload_load(
+      Workload & i_workload, size_t i_cardinality, ThreadTeam & i_team)
+    {
+        auto const & sequence = i_workload.sequence(i_cardinality);
+        QUEUE        queue;
+        i_team.run(
+          [&](size_t i_index) {
+              for (size_t i = 0; i < i_cardinality; i++)
+              {
+                  MESSAGES::push(queue, i_index, sequence.kind(i));
+                  if (sequence.ends_burst(i) || i + 1 == i_cardinality)
+                  {
+                      while (queue.try_pop())
+                      {
+                      }
+                  }
+              }
+              return i_cardinality;
+          },
+          [](size_t) { return size_t(0); });
+
+        assert(queue.empty());
+    }
+
+    void single_thread_workload_tests(TestTree & i_tree)
+    {
+        PerformanceTestGroup group("workload_single_thread", "");
+
+        using namespace density;
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(1, 0);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = heter_queue<>;
+              single_thread_workload_load<MixedMessages, Queue>(
+                BurstyWorkload::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_heter_queue<>;
+              single_thread_workload_load<MixedMessages, Queue>(
+                BurstyWorkload::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_heter_queue<>;
+              single_thread_workload_load<MixedMessages, Queue>(
+                BurstyWorkload::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = sp_heter_queue<>;
+              single_thread_workload_load<MixedMessages, Queue>(
+                BurstyWorkload::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = priority_heter_queue<>;
+              single_thread_workload_load<MixedMessages, Queue>(
+                BurstyWorkload::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree["workload_single_thread"].add_performance_test(group);
+    }
+
+    template <typename WORKLOAD, size_t PRODUCER_COUNT, size_t CONSUMER_COUNT>
+    void workload_tests(TestTree & i_tree)
+    {
+        std::string const name = std::string("workload_") + WORKLOAD::name() + "_" +
+                                 std::to_string(PRODUCER_COUNT) + "p_" +
+                                 std::to_string(CONSUMER_COUNT) + "c";
+        PerformanceTestGroup group(name, "");
+
+        using namespace density;
+
+        group.set_cardinality_start(10000);
+        group.set_cardinality_step(20000);
+        group.set_cardinality_end(200000);
+        group.set_threads(PRODUCER_COUNT, CONSUMER_COUNT);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_heter_queue<>;
+              workload_load<MixedMessages, Queue>(WORKLOAD::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = lf_heter_queue<
+                runtime_type<>,
+                default_allocator,
+                concurrency_multiple,
+                concurrency_multiple,
+                consistency_relaxed>;
+              workload_load<MixedMessages, Queue>(WORKLOAD::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = sp_heter_queue<>;
+              workload_load<MixedMessages, Queue>(WORKLOAD::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_heter_queue<>;
+              workload_load<MixedMessages, Queue>(WORKLOAD::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = conc_heter_queue<
+                runtime_type<>,
+                default_allocator,
+                lock_head_tail,
+                adaptive_mutex>;
+              workload_load<MixedMessages, Queue>(WORKLOAD::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        group.add_test(
+          __FILE__,
+          __LINE__,
+          [](size_t i_cardinality, ThreadTeam & i_team) {
+              using Queue = priority_heter_queue<>;
+              workload_load<MixedMessages, Queue>(WORKLOAD::get(), i_cardinality, i_team);
+          },
+          __LINE__);
+
+        i_tree[name.c_str()].add_performance_test(group);
+    }
+
+    void workload_tests(TestTree & i_tree)
+    {
+        single_thread_workload_tests(i_tree);
+        workload_tests<SteadyWorkload, 1, 1>(i_tree);
+        workload_tests<SteadyWorkload, 4, 4>(i_tree);
+        workload_tests<BurstyWorkload, 4, 4>(i_tree);
+    }
+
+} // namespace density_bench
@@ -0,0 +1,272 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <density/detail/byte_runtime_type.h>
+#include <density/heter_queue.h>
+
+namespace density
+{
+    /** FIFO pseudo-container of byte messages. byte_queue is an adaptor for heter_queue.
+
+        @tparam ALLOCATOR_TYPE Allocator type to be used. This type must satisfy the requirements of both \ref UntypedAllocator_requirements
+                "UntypedAllocator" and \ref PagedAllocator_requirements "PagedAllocator". The default is density::default_allocator.
+
+        Every element of a byte_queue is a contiguous block of bytes, prefixed by its length. There is no runtime type: besides
+        the control block, the only overhead of an element is a prefix holding its length. The first byte of every message is aligned to
+        message_alignment, so that integers can be read in place. A message is added in two steps: the
+        function reserve allocates the storage of the message and returns a put_transaction, that exposes the storage as a
+        byte_span. After the bytes are written in place (for example by a call to <code>recv</code>), the transaction is committed,
+        optionally specifying the actual length of the message, that can be less than the reserved one. The consumer accesses the
+        message in place with consume_operation::span, so no intermediate buffer is needed.
+
+        \snippet byte_queue_examples.cpp byte_queue reserve example 1
+
+        Messages that don't fit in a page are allocated in an external block, as any other element of heter_queue.
+
+        \n <b>Thread safeness</b>: None. The user is responsible of avoiding data races.
+        \n <b>Exception safeness</b>: Any function of byte_queue is noexcept or provides the strong exception guarantee.
+    */
+    template <typename ALLOCATOR_TYPE = default_allocator> class byte_queue
+    {
+      private:
+        using UnderlyingQueue = heter_queue<detail::ByteRuntimeType, ALLOCATOR_TYPE>;
+        UnderlyingQueue m_queue;
+
+      public:
+        /** Whether multiple threads can do put operations on the same queue without any further synchronization. */
+        static constexpr bool concurrent_puts = false;
+
+        /** Whether multiple threads can do consume operations on the same queue without any further synchronization. */
+        static constexpr bool concurrent_consumes = false;
+
+        /** Whether puts and consumes can be done concurrently without any further synchronization. In any case unsynchronized concurrency is
+            constrained by concurrent_puts and concurrent_consumes. */
+        static constexpr bool concurrent_put_consumes = false;
+
+        /** Whether this queue is sequential consistent. */
+        static constexpr bool is_seq_cst = true;
+
+        /** Alignment of the first byte of every message. */
+        static constexpr size_t message_alignment = detail::ByteRuntimeType::s_message_alignment;
+
+        /** Default constructor. */
+        constexpr byte_queue() noexcept = default;
+
+        /** Copy constructor. The messages are copied with memcpy. */
+        byte_queue(const byte_queue & i_source) = default;
+
+        /** Move constructor. */
+        byte_queue(byte_queue && i_source) noexcept = default;
+
+        /** Copy assignment. The messages are copied with memcpy. */
+        byte_queue & operator=(const byte_queue & i_source) = default;
+
+        /** Move assignment. */
+        byte_queue & operator=(byte_queue && i_source) noexcept = default;
+
+        /** Swaps two byte queues. */
+        friend void swap(byte_queue & i_first, byte_queue & i_second) noexcept
+        {
+            using std::swap;
+            swap(i_first.m_queue, i_second.m_queue);
+        }
+
+        /** Move-only class that holds the state of a put transaction. The storage of the message is allocated
+            when the transaction is started, and it is exposed by the function span. If the transaction is
+            destroyed before commit has been called, it is canceled. Until the transaction is committed or
+            canceled, the queue is not in a consistent state, and calling any function on it causes undefined behavior. */
+        class put_transaction
+        {
+          public:
+            /** Constructs an empty put transaction */
+            put_transaction() noexcept = default;
+
+            /** Move constructs a put_transaction, transferring the state from the source. */
+            put_transaction(put_transaction && i_source) noexcept = default;
+
+            /** Move assigns a put_transaction, transferring the state from the source. If this object
+                is not empty, its transaction is canceled. */
+            put_transaction & operator=(put_transaction && i_source) noexcept = default;
+
+            /** Swaps two instances of put_transaction. */
+            friend void swap(put_transaction & i_first, put_transaction & i_second) noexcept
+            {
+                using std::swap;
+                swap(i_first.m_put, i_second.m_put);
+            }
+
+            /** Returns true whether this object is not currently bound to a transaction. */
+            bool empty() const noexcept { return m_put.empty(); }
+
+            /** Returns true whether this object is bound to a transaction. Same to !put_transaction::empty. */
+            explicit operator bool() const noexcept { return m_put.operator bool(); }
+
+            /** Returns the storage reserved for the message. Its content is indeterminate until it is written.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            byte_span span() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return byte_span(m_put.element_ptr(), m_put.complete_type().message_size());
+            }
+
+            /** Truncates the message to the specified size. The storage exceeding the new size of the message
+                is not reclaimed until the message is consumed.
+
+                \pre The behavior is undefined if either:
+                    - this transaction is empty
+                    - i_size is greater than the current size of the message */
+            void shrink(size_t i_size) noexcept { m_put.mutable_complete_type().shrink(i_size); }
+
+            /** Makes the message observable, with its current size. This object becomes empty.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            void commit() noexcept { m_put.commit(); }
+
+            /** Makes the message observable, truncating it to the specified size. This object becomes empty.
+                Equivalent to a call to shrink followed by a call to commit.
+
+                \pre The behavior is undefined if either:
+                    - this transaction is empty
+                    - i_actual_size is greater than the current size of the message
+
+            \snippet byte_queue_examples.cpp byte_queue reserve example 1 */
+            void commit(size_t i_actual_size) noexcept
+            {
+                shrink(i_actual_size);
+                m_put.commit();
+            }
+
+            /** Cancels the transaction. This object becomes empty.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            void cancel() noexcept { m_put.cancel(); }
+
+          private:
+            explicit put_transaction(typename UnderlyingQueue::template put_transaction<> && i_put) noexcept
+                : m_put(std::move(i_put))
+            {
+            }
+            friend class byte_queue;
+
+          private:
+            typename UnderlyingQueue::template put_transaction<> m_put;
+        };
+
+        /** Move-only class that holds the state of a consume operation. If the operation is destroyed before
+            commit has been called, it is canceled and the message remains in the queue. */
+        class consume_operation
+        {
+          public:
+            /** Constructs an empty consume operation */
+            consume_operation() noexcept = default;
+
+            /** Move constructs a consume_operation, transferring the state from the source. */
+            consume_operation(consume_operation && i_source) noexcept = default;
+
+            /** Move assigns a consume_operation, transferring the state from the source. If this object
+                is not empty, its operation is canceled. */
+            consume_operation & operator=(consume_operation && i_source) noexcept = default;
+
+            /** Swaps two instances of consume_operation. */
+            friend void swap(consume_operation & i_first, consume_operation & i_second) noexcept
+            {
+                using std::swap;
+                swap(i_first.m_consume, i_second.m_consume);
+            }
+
+            /** Returns true whether this object does not hold the state of an operation. */
+            bool empty() const noexcept { return m_consume.empty(); }
+
+            /** Returns true whether this object holds the state of an operation. Same to !consume_operation::empty. */
+            explicit operator bool() const noexcept { return m_consume.operator bool(); }
+
+            /** Returns the message being consumed. The bytes can be read and modified in place until the
+                operation is committed.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            byte_span span() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return byte_span(m_consume.element_ptr(), m_consume.complete_type().message_size());
+            }
+
+            /** Removes the message from the queue. This object becomes empty.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void commit() noexcept { m_consume.commit(); }
+
+            /** Cancels the operation, leaving the message in the queue. This object becomes empty.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void cancel() noexcept { m_consume.cancel(); }
+
+          private:
+            typename UnderlyingQueue::consume_operation m_consume;
+            friend class byte_queue;
+        };
+
+        /** Begins a transaction that appends a message of the specified size. The storage of the message is exposed
+            by put_transaction::span, and the message becomes observable when the transaction is committed.
+                @param i_size size of the message in bytes. It is the maximum size that can be committed.
+
+            <b>Complexity</b>: constant.
+            \n <b>Throws</b>: unspecified.
+            \n <b>Exception guarantee</b>: strong (in case of exception the function has no observable effects).
+
+            \snippet byte_queue_examples.cpp byte_queue reserve example 1 */
+        put_transaction reserve(size_t i_size)
+        {
+            return put_transaction(m_queue.start_dyn_push(detail::ByteRuntimeType(i_size)));
+        }
+
+        /** Appends a message, copying it from the source.
+                @param i_source pointer to the first byte to copy. Can be null if i_size is zero.
+                @param i_size number of bytes to copy
+
+            \snippet byte_queue_examples.cpp byte_queue push example 1 */
+        void push(const void * i_source, size_t i_size)
+        {
+            auto put = reserve(i_size);
+            if (i_size != 0) // i_source may be null
+                std::memcpy(put.span().data(), i_source, i_size);
+            put.commit();
+        }
+
+        /** Tries to start a consume operation.
+            @return a consume_operation which is empty if there are no messages to consume
+
+            \snippet byte_queue_examples.cpp byte_queue try_start_consume example 1 */
+        consume_operation try_start_consume() noexcept
+        {
+            consume_operation result;
+            m_queue.try_start_consume(result.m_consume);
+            return result;
+        }
+
+        /** Tries to start a consume operation using an existing consume_operation object.
+            @param i_consume reference to a consume_operation to be used. If it is non-empty
+                it gets canceled before trying to start the new consume.
+            @return whether i_consume is non-empty after the call, that is whether the queue was
+                not empty. */
+        bool try_start_consume(consume_operation & i_consume) noexcept
+        {
+            return m_queue.try_start_consume(i_consume.m_consume);
+        }
+
+        /** Removes the first message of the queue, if any.
+            @return whether a message was removed, that is whether the queue was not empty. */
+        bool try_pop() noexcept { return m_queue.try_pop(); }
+
+        /** Deletes all the messages in the queue. */
+        void clear() noexcept { m_queue.clear(); }
+
+        /** Returns whether the queue contains no messages. */
+        bool empty() const noexcept { return m_queue.empty(); }
+    };
+
+} // namespace density
@@ -0,0 +1,250 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <density/density_common.h>
+#include <density/runtime_type.h>
+#include <exception>
+#include <functional> // for std::hash
+
+namespace density
+{
+    namespace detail
+    {
+        /** Global registry of the feature tables of a feature tuple. Every target type gets an index
+            when it's bound for the first time to a compact_runtime_type. The index 0 is reserved
+            to the empty type. */
+        template <typename TUPLE> class FeatureTableRegistry
+        {
+          public:
+            static uint32_t register_table(const TUPLE * i_table) noexcept
+            {
+                auto const id = s_count.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (id >= compact_runtime_type_capacity)
+                {
+                    DENSITY_ASSERT(!"compact_runtime_type_capacity exceeded");
+                    std::terminate();
+                }
+                s_tables[id] = i_table;
+                return id;
+            }
+
+            static const TUPLE * get(uint32_t i_id) noexcept
+            {
+                DENSITY_ASSERT_INTERNAL(i_id < compact_runtime_type_capacity);
+                return s_tables[i_id];
+            }
+
+          private:
+            static std::atomic<uint32_t> s_count;
+            static const TUPLE *         s_tables[compact_runtime_type_capacity];
+        };
+
+        template <typename TUPLE> std::atomic<uint32_t> FeatureTableRegistry<TUPLE>::s_count{0};
+
+        template <typename TUPLE>
+        const TUPLE * FeatureTableRegistry<TUPLE>::s_tables[compact_runtime_type_capacity];
+
+        /** Provides the index of FeatureTable<TUPLE, TARGET_TYPE> in the registry. The registration
+            is performed on the first call, and it is thread safe. The index is published by the
+            initialization of a function-local static, so any thread that reads it can also read
+            the entry of the registry. */
+        template <typename TUPLE, typename TARGET_TYPE> struct FeatureTableId
+        {
+            static uint32_t get() noexcept
+            {
+                static const uint32_t s_id = FeatureTableRegistry<TUPLE>::register_table(
+                  &FeatureTable<TUPLE, TARGET_TYPE>::s_table);
+                return s_id;
+            }
+        };
+
+    } // namespace detail
+
+    /** Class template that performs type-erasure like runtime_type, but stores a 32-bit index in a
+        global registry of feature tables instead of a pointer to the feature table.
+            @tparam FEATURES... list of features to be captures from the target type.
+
+        Specializations of compact_runtime_type satisfy the requirements of \ref RuntimeType_requirements "RuntimeType",
+        and support the same set of features of runtime_type. On 64-bit platforms a compact_runtime_type is half the size
+        of a runtime_type: when used as runtime type of an heter_queue (or conc_heter_queue), elements whose
+        alignment is not greater than alignof(uint32_t) are allocated right after the compact_runtime_type, instead
+        of being aligned to heter_queue::min_alignment. For example an heter_queue<compact_runtime_type<>> of int's
+        uses 16 bytes per element, while an heter_queue<runtime_type<>> uses 24 bytes per element.
+
+        The price to pay is an indirection in the registry every time a feature is used. Furthermore make is
+        not constexpr, and the first time a target type is bound it is registered. The registry of every feature
+        list can hold up to density::compact_runtime_type_capacity types.
+
+        A compact_runtime_type can be converted to a runtime_type with the same feature list:
+
+        \snippet runtime_type_examples.cpp compact_runtime_type example 1 */
+    template <typename... FEATURES> class compact_runtime_type
+    {
+      public:
+        /** Type of the runtime_type with the same feature list. */
+        using full_runtime_type = runtime_type<FEATURES...>;
+
+        /** feature_list associated to the template arguments. If to template arguments is provided, \ref default_type_features is used. */
+        using feature_list_type = typename full_runtime_type::feature_list_type;
+
+        /** Alias for <code>feature_list_type::tuple_type</code>. */
+        using tuple_type = typename feature_list_type::tuple_type;
+
+        /** Creates a compact_runtime_type bound to a target type.
+                @tparam TARGET_TYPE type to bind to the returned compact_runtime_type.
+
+        \b Throws: nothing */
+        template <typename TARGET_TYPE> static compact_runtime_type make() noexcept
+        {
+            return compact_runtime_type(
+              detail::FeatureTableId<tuple_type, typename std::decay<TARGET_TYPE>::type>::get());
+        }
+
+        /** Constructs an empty compact_runtime_type not associated with any type.
+
+        \b Throws: nothing */
+        constexpr compact_runtime_type() noexcept = default;
+
+        /** Returns a runtime_type bound to the same target type of this compact_runtime_type.
+
+        \b Throws: nothing */
+        full_runtime_type to_runtime_type() const noexcept
+        {
+            return full_runtime_type(feature_table());
+        }
+
+        /** Returns the index of the target type in the registry, or zero if this compact_runtime_type is empty. */
+        constexpr uint32_t id() const noexcept { return m_id; }
+
+        /** Swaps two instances.
+
+        \b Throws: nothing */
+        friend void swap(compact_runtime_type & i_first, compact_runtime_type & i_second) noexcept
+        {
+            std::swap(i_first.m_id, i_second.m_id);
+        }
+
+        /** Returns whether this compact_runtime_type is not bound to a target type.
+
+        \b Throws: nothing */
+        constexpr bool empty() const noexcept { return m_id == 0; }
+
+        /** Unbinds from a target. If the compact_runtime_type was already empty this function has no effect.
+
+        \b Throws: nothing */
+        DENSITY_CPP14_CONSTEXPR void clear() noexcept { m_id = 0; }
+
+        /** Returns the size of the target type. See runtime_type::size. */
+        size_t size() const noexcept { return get_feature<f_size>()(); }
+
+        /** Returns the alignment of the target type. See runtime_type::alignment. */
+        size_t alignment() const noexcept { return get_feature<f_alignment>()(); }
+
+        /** Value-initializes an instance of the target type. See runtime_type::default_construct. */
+        void default_construct(void * i_dest) const
+        {
+            DENSITY_ASSERT(!empty());
+            get_feature<f_default_construct>()(i_dest);
+        }
+
+        /** Copy-constructs an instance of the target type. See runtime_type::copy_construct. */
+        void copy_construct(void * i_dest, const void * i_source) const
+        {
+            DENSITY_ASSERT(!empty());
+            get_feature<f_copy_construct>()(i_dest, i_source);
+        }
+
+        /** Move-constructs an instance of the target type. See runtime_type::move_construct. */
+        void move_construct(void * i_dest, void * i_source) const
+        {
+            DENSITY_ASSERT(!empty());
+            get_feature<f_move_construct>()(i_dest, i_source);
+        }
+
+        /** Destroys an instance of the target type. See runtime_type::destroy. */
+        void destroy(void * i_dest) const noexcept
+        {
+            DENSITY_ASSERT(!empty());
+            get_feature<f_destroy>()(i_dest);
+        }
+
+        /** Returns the std::type_info of the target type. See runtime_type::type_info. */
+        const std::type_info & type_info() const noexcept
+        {
+            DENSITY_ASSERT(!empty());
+            return get_feature<f_rtti>()();
+        }
+
+        /** Compares two instances of the target type. See runtime_type::are_equal. */
+        bool are_equal(const void * i_first, const void * i_second) const noexcept
+        {
+            DENSITY_ASSERT(i_first != nullptr && i_second != nullptr && !empty());
+            return get_feature<f_equal>()(i_first, i_second);
+        }
+
+        /** Returns the instance of a feature associated to the target type. See runtime_type::get_feature. */
+        template <typename FEATURE> const FEATURE & get_feature() const noexcept
+        {
+            static_assert(has_features<feature_list_type, FEATURE>::value, "feature not found");
+            return std::get<detail::Tuple_FindFirst<tuple_type, FEATURE>::index>(*feature_table());
+        }
+
+        /** Returns true whether this two compact_runtime_type have the same target type.
+
+            \b Throws: nothing. */
+        constexpr bool operator==(const compact_runtime_type & i_other) const noexcept
+        {
+            return m_id == i_other.m_id;
+        }
+
+        /** Returns true whether this two compact_runtime_type have different target types.
+
+            \b Throws: nothing. */
+        constexpr bool operator!=(const compact_runtime_type & i_other) const noexcept
+        {
+            return m_id != i_other.m_id;
+        }
+
+        /** Returns whether the target type of this compact_runtime_type is exactly the one specified in the
+            template parameter.
+
+            \b Throws: nothing. */
+        template <typename TARGET_TYPE> bool is() const noexcept
+        {
+            return m_id ==
+                   detail::FeatureTableId<tuple_type, typename std::decay<TARGET_TYPE>::type>::get();
+        }
+
+      private:
+        constexpr compact_runtime_type(uint32_t i_id) noexcept : m_id(i_id) {}
+
+        const tuple_type * feature_table() const noexcept
+        {
+            return detail::FeatureTableRegistry<tuple_type>::get(m_id);
+        }
+
+      private:
+        uint32_t m_id = 0;
+    };
+} // namespace density
+
+namespace std
+{
+    /** Partial specialization of std::hash to allow the use of density::compact_runtime_type as key
+        in unordered associative containers. */
+    template <typename... FEATURES> struct hash<density::compact_runtime_type<FEATURES...>>
+    {
+        size_t operator()(const density::compact_runtime_type<FEATURES...> & i_runtime_type) const
+          noexcept
+        {
+            return std::hash<uint32_t>()(i_runtime_type.id());
+        }
+    };
+
+} // namespace std
@@ -13,7 +13,9 @@ namespace density
     template <
       typename CALLABLE,
       typename ALLOCATOR_TYPE       = default_allocator,
-      function_type_erasure ERASURE = function_standard_erasure>
+      function_type_erasure ERASURE = function_standard_erasure,
+      lock_granularity LOCKING      = lock_single,
+      typename MUTEX                = std::mutex>
     class conc_function_queue;
 
     /** Thread-safe heterogeneous FIFO pseudo-container specialized to hold callable objects. conc_function_queue is an adaptor for conc_heter_queue.
@@ -22,6 +24,10 @@ namespace density
         @tparam ALLOCATOR_TYPE Allocator type to be used. This type must satisfy the requirements of both \ref UntypedAllocator_requirements
                 "UntypedAllocator" and \ref PagedAllocator_requirements "PagedAllocator". The default is density::default_allocator.
         @tparam ERASURE Type erasure to use the callable objects. Must be a member of density::function_type_erasure.
+        @tparam LOCKING Specifies whether producers and consumers share the same mutex. Must be a member of density::lock_granularity.
+            See conc_heter_queue for details.
+        @tparam MUTEX Type of the mutexes used to protect the queue. It must satisfy the requirements of
+            [Lockable](https://en.cppreference.com/w/cpp/named_req/Lockable). The default is std::mutex.
 
         conc_function_queue is basically a function_queue protected from data-races by a mutex. Non-reentrant operations (put or
         consumes) lock the mutex only once. Reentrant operations lock the mutex once when starting, and a second time to commit or cancel. Anyway
@@ -37,8 +43,9 @@ namespace density
 
         \n Implementation note: If ERASURE == function_manual_clear, a runtime type associated with a value is actually a pointer to a function
             that invokes and destroys the callable object. In this case the size of a value is a pair of pointers, plus the capture (if any).
-            \n If ERASURE == function_standard_erasure the runtime type has an additional pointer to a function that destroys the callable object
-            without invoking it.
+            \n If ERASURE == function_standard_erasure the runtime type is a pointer to a static table that contains both the invoke-destroy function
+            and a function that destroys the callable object without invoking it. The size of a value is the same, but invoking a callable
+            requires an additional indirection.
 
         \n <b>Thread safeness</b>: Put and consumes can be executed concurrently.
         \n <b>Exception safeness</b>: Any function of conc_function_queue is noexcept or provides the strong exception guarantee.
@@ -48,20 +55,26 @@ namespace density
       typename RET_VAL,
       typename... PARAMS,
       typename ALLOCATOR_TYPE,
-      function_type_erasure ERASURE>
-    class conc_function_queue<RET_VAL(PARAMS...), ALLOCATOR_TYPE, ERASURE>
+      function_type_erasure ERASURE,
+      lock_granularity LOCKING,
+      typename MUTEX>
+    class conc_function_queue<RET_VAL(PARAMS...), ALLOCATOR_TYPE, ERASURE, LOCKING, MUTEX>
 #else
     template <
       typename CALLABLE,
       typename ALLOCATOR_TYPE       = default_allocator,
-      function_type_erasure ERASURE = function_standard_erasure>
+      function_type_erasure ERASURE = function_standard_erasure,
+      lock_granularity LOCKING      = lock_single,
+      typename MUTEX                = std::mutex>
     class conc_function_queue
 #endif
     {
       private:
         using UnderlyingQueue = conc_heter_queue<
           detail::FunctionRuntimeType<ERASURE, RET_VAL(PARAMS...)>,
-          ALLOCATOR_TYPE>;
+          ALLOCATOR_TYPE,
+          LOCKING,
+          MUTEX>;
         UnderlyingQueue m_queue;
 
       public:
@@ -10,6 +10,87 @@
 
 namespace density
 {
+    namespace detail
+    {
+        /** \internal Tail state of a conc_heter_queue. With lock_single it is empty, and the tail is
+            the same of the head. */
+        template <typename QUEUE, lock_granularity LOCKING, typename MUTEX> class ConcQueueTail
+        {
+          public:
+            constexpr ConcQueueTail() noexcept = default;
+
+            template <typename ALLOCATOR_TYPE>
+            constexpr explicit ConcQueueTail(ALLOCATOR_TYPE &&) noexcept
+            {
+            }
+
+            friend void swap(ConcQueueTail &, ConcQueueTail &) noexcept {}
+
+            MUTEX & tail_mutex(MUTEX & i_head_mutex) const noexcept { return i_head_mutex; }
+
+            QUEUE & tail_queue(QUEUE & i_head_queue) noexcept { return i_head_queue; }
+
+            const QUEUE & tail_queue(const QUEUE & i_head_queue) const noexcept
+            {
+                return i_head_queue;
+            }
+
+            /** Used by consumers when the head queue has no element to consume. */
+            bool refill_head(QUEUE &) noexcept { return false; }
+        };
+
+        /** \internal Tail state of a conc_heter_queue with lock_head_tail. Producers put in the tail
+            queue. When the head queue runs out of elements, consumers move all the elements of the tail
+            queue to the head queue with heter_queue::splice_back, that just links the pages. The mutex
+            is aligned to destructive_interference_size, so that it does not share a cache line with the head. */
+        template <typename QUEUE, typename MUTEX> class ConcQueueTail<QUEUE, lock_head_tail, MUTEX>
+        {
+          public:
+            constexpr ConcQueueTail() noexcept = default;
+
+            constexpr explicit ConcQueueTail(const typename QUEUE::allocator_type & i_allocator) noexcept
+                : m_tail_queue(i_allocator)
+            {
+            }
+
+            ConcQueueTail(ConcQueueTail && i_source) noexcept
+                : m_tail_queue(std::move(i_source.m_tail_queue))
+            {
+            }
+
+            ConcQueueTail & operator=(ConcQueueTail && i_source) noexcept
+            {
+                m_tail_queue = std::move(i_source.m_tail_queue);
+                return *this;
+            }
+
+            friend void swap(ConcQueueTail & i_first, ConcQueueTail & i_second) noexcept
+            {
+                swap(i_first.m_tail_queue, i_second.m_tail_queue);
+            }
+
+            MUTEX & tail_mutex(MUTEX &) const noexcept { return m_tail_mutex; }
+
+            QUEUE & tail_queue(QUEUE &) noexcept { return m_tail_queue; }
+
+            const QUEUE & tail_queue(const QUEUE &) const noexcept { return m_tail_queue; }
+
+            /** Used by consumers when the head queue has no element to consume. The caller must own
+                the lock on the head mutex. */
+            bool refill_head(QUEUE & i_head_queue) noexcept
+            {
+                std::lock_guard<MUTEX> lock(m_tail_mutex);
+                i_head_queue.splice_back(m_tail_queue);
+                return true;
+            }
+
+          private:
+            alignas(destructive_interference_size) mutable MUTEX m_tail_mutex;
+            QUEUE m_tail_queue;
+        };
+
+    } // namespace detail
+
     /** Class template implementing a concurrent heterogeneous FIFO pseudo-container.
 
         conc_heter_queue is a concurrent version of heter_queue, with a mutex embedded within.
@@ -19,6 +100,14 @@ namespace density
                 This type must satisfy the requirements of \ref RuntimeType_requirements "RuntimeType". The default is runtime_type.
         @tparam ALLOCATOR_TYPE Allocator type to be used. This type must satisfy the requirements of both \ref UntypedAllocator_requirements
                 "UntypedAllocator" and \ref PagedAllocator_requirements "PagedAllocator". The default is density::default_allocator.
+        @tparam LOCKING Specifies whether producers and consumers share the same mutex. Must be a member of density::lock_granularity.
+                The default is density::lock_single.
+        @tparam MUTEX Type of the mutexes used to protect the inner queues. It must satisfy the requirements of
+                [Lockable](https://en.cppreference.com/w/cpp/named_req/Lockable). The default is std::mutex.
+                density::adaptive_mutex and density::ticket_mutex (defined in density/mutexes.h) are alternatives
+                that may perform better when the critical sections are short.
+
+        \snippet conc_queue_examples.cpp conc_heter_queue mutex example 1
 
         \n <b>Thread safeness</b>: Put and consumes can be executed concurrently. Lifetime function can't.
         \n <b>Exception safeness</b>: Any function of conc_heter_queue is noexcept or provides the strong exception guarantee.
@@ -26,16 +115,35 @@ namespace density
 
         Implementation and performance notes
         --------------------------
-        conc_heter_queue is basically an heter_queue protected by an std::mutex to avoid data races.
+        conc_heter_queue is basically an heter_queue protected by a mutex to avoid data races.
 
         Non-reentrant operations keep the mutex locked during the whole operation (until the operation is
         canceled or committed). Reentrant operations minimize the durations of the locks: the mutex is locked once when
-        the operation starts, and another time to commit or cancel the operation. */
-    template <typename RUNTIME_TYPE = runtime_type<>, typename ALLOCATOR_TYPE = default_allocator>
+        the operation starts, and another time to commit or cancel the operation.
+
+        If LOCKING is lock_head_tail, producers and consumers use two distinct heter_queue's, each protected by its
+        own mutex. Producers put elements in the tail queue. Consumers consume from the head queue. When it has no
+        elements to consume, a consumer locks the tail mutex and moves all the elements of the tail queue to the head
+        queue in constant time (see heter_queue::splice_back). So producers and consumers contend only when the queue is
+        nearly empty, and a producer in the middle of a non-reentrant put does not block consumers that have elements to
+        consume. The commit and the cancel of a reentrant put lock both mutexes, because the element may have been
+        moved to the head queue in the meanwhile.
+        In this mode the allocator is copied in both the inner queues, so it must be copy-constructible, and every
+        copy of the allocator must be able to deallocate the pages allocated by the others (this is true for default_allocator).
+
+        \snippet conc_queue_examples.cpp conc_heter_queue lock_head_tail example 1 */
+    template <
+      typename RUNTIME_TYPE    = runtime_type<>,
+      typename ALLOCATOR_TYPE  = default_allocator,
+      lock_granularity LOCKING = lock_single,
+      typename MUTEX           = std::mutex>
     class conc_heter_queue
+        : private detail::ConcQueueTail<heter_queue<RUNTIME_TYPE, ALLOCATOR_TYPE>, LOCKING, MUTEX>
     {
         using InnerQueue = heter_queue<RUNTIME_TYPE, ALLOCATOR_TYPE>;
 
+        using Tail = detail::ConcQueueTail<InnerQueue, LOCKING, MUTEX>;
+
         /** This type is used to make some functions of the inner classes accessible only by the queue */
         enum class PrivateType
         {
@@ -94,7 +202,7 @@ namespace density
 
             \snippet conc_queue_examples.cpp conc_heter_queue construct_copy_alloc example 1 */
         constexpr explicit conc_heter_queue(const ALLOCATOR_TYPE & i_source_allocator) noexcept
-            : m_queue(i_source_allocator)
+            : Tail(i_source_allocator), m_queue(i_source_allocator)
         {
         }
 
@@ -109,7 +217,8 @@ namespace density
 
         \snippet conc_queue_examples.cpp conc_heter_queue construct_move_alloc example 1 */
         constexpr explicit conc_heter_queue(ALLOCATOR_TYPE && i_source_allocator) noexcept
-            : m_queue(std::move(i_source_allocator))
+            : Tail(static_cast<const ALLOCATOR_TYPE &>(i_source_allocator)),
+              m_queue(std::move(i_source_allocator))
         {
         }
 
@@ -123,7 +232,7 @@ namespace density
 
         \snippet conc_queue_examples.cpp conc_heter_queue move_construct example 1 */
         conc_heter_queue(conc_heter_queue && i_source) noexcept
-            : m_queue(std::move(i_source.m_queue))
+            : Tail(std::move(static_cast<Tail &>(i_source))), m_queue(std::move(i_source.m_queue))
         {
         }
 
@@ -141,7 +250,8 @@ namespace density
         \snippet conc_queue_examples.cpp conc_heter_queue move_assign example 1 */
         conc_heter_queue & operator=(conc_heter_queue && i_source) noexcept
         {
-            m_queue = std::move(i_source.m_queue);
+            static_cast<Tail &>(*this) = std::move(static_cast<Tail &>(i_source));
+            m_queue                    = std::move(i_source.m_queue);
             return *this;
         }
 
@@ -171,9 +281,9 @@ namespace density
 
         \snippet conc_queue_examples.cpp conc_heter_queue swap example 1 */
         friend void swap(
-          conc_heter_queue<RUNTIME_TYPE, ALLOCATOR_TYPE> & i_first,
-          conc_heter_queue<RUNTIME_TYPE, ALLOCATOR_TYPE> & i_second) noexcept
+          conc_heter_queue & i_first, conc_heter_queue & i_second) noexcept
         {
+            swap(static_cast<Tail &>(i_first), static_cast<Tail &>(i_second));
             swap(i_first.m_queue, i_second.m_queue);
         }
 
@@ -192,8 +302,8 @@ namespace density
         \snippet conc_queue_examples.cpp conc_heter_queue empty example 1 */
         bool empty() const noexcept
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            return m_queue.empty();
+            AllLocks lock(*this);
+            return m_queue.empty() && (LOCKING == lock_single || tail_queue().empty());
         }
 
         /** Deletes all the elements in the queue.
@@ -205,8 +315,60 @@ namespace density
         \snippet conc_queue_examples.cpp conc_heter_queue clear example 1 */
         void clear() noexcept
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
+            AllLocks lock(*this);
             m_queue.clear();
+            if (LOCKING == lock_head_tail)
+                tail_queue().clear();
+        }
+
+        /** Invokes a function on every element of the queue, splitting the work between the tasks of an executor.
+            See heter_queue::parallel_for_each. The mutexes are locked during the whole call, so the elements are
+            visited as a consistent snapshot of the queue.
+
+            \pre The behavior is undefined if i_func alters the queue.
+
+            <b>Complexity</b>: linear.
+            \n <b>Throws</b>: std::bad_alloc, and anything thrown by the executor or by i_func.
+
+        \snippet conc_queue_examples.cpp conc_heter_queue parallel_for_each example 1 */
+        template <typename EXECUTOR, typename FUNC>
+        void parallel_for_each(EXECUTOR && i_executor, FUNC && i_func)
+        {
+            AllLocks lock(*this);
+            m_queue.parallel_for_each(i_executor, i_func);
+            if (LOCKING == lock_head_tail)
+                tail_queue().parallel_for_each(i_executor, i_func);
+        }
+
+        /** Moves all the elements of another queue to the end of this queue, without copying or moving them.
+            See heter_queue::splice_back. The mutexes of both queues are locked during the operation.
+                @param i_source queue to take the elements from. After the call it is empty.
+
+            \pre The behavior is undefined if either:
+                - i_source is this queue
+                - there is a put or a consume operation in progress on i_source
+                - the allocator of this queue can't deallocate the pages allocated by the allocator of i_source
+
+            <b>Complexity</b>: constant.
+            \n <b>Throws</b>: Nothing.
+
+        \snippet conc_queue_examples.cpp conc_heter_queue splice_back example 1 */
+        void splice_back(conc_heter_queue & i_source) noexcept
+        {
+            DENSITY_ASSERT(&i_source != this);
+            std::unique_lock<MUTEX> lock(m_mutex, std::defer_lock);
+            std::unique_lock<MUTEX> source_lock(i_source.m_mutex, std::defer_lock);
+            std::unique_lock<MUTEX> tail_lock(tail_mutex(), std::defer_lock);
+            std::unique_lock<MUTEX> source_tail_lock(i_source.tail_mutex(), std::defer_lock);
+            if (LOCKING == lock_head_tail)
+                std::lock(lock, source_lock, tail_lock, source_tail_lock);
+            else
+                std::lock(lock, source_lock);
+
+            // the elements are appended to the tail, so they are consumed after the ones already in the queue
+            tail_queue().splice_back(i_source.m_queue);
+            if (LOCKING == lock_head_tail)
+                tail_queue().splice_back(i_source.tail_queue());
         }
 
         /** Move-only class template that can be bound to a put transaction, otherwise it's empty.
@@ -509,7 +671,7 @@ namespace density
             /** \internal - private function, usable only within the library */
             put_transaction(
               PrivateType,
-              std::unique_lock<std::mutex> && i_lock,
+              std::unique_lock<MUTEX> && i_lock,
               typename InnerQueue::template put_transaction<ELEMENT_COMPLETE_TYPE> &&
                 i_put_transaction) noexcept
                 : m_lock(std::move(i_lock)), m_put_transaction(std::move(i_put_transaction))
@@ -519,7 +681,7 @@ namespace density
             }
 
           private: // data members
-            std::unique_lock<std::mutex>                                         m_lock;
+            std::unique_lock<MUTEX>                                              m_lock;
             typename InnerQueue::template put_transaction<ELEMENT_COMPLETE_TYPE> m_put_transaction;
             template <typename OTHERTYPE> friend class put_transaction;
         };
@@ -704,7 +866,7 @@ namespace density
             /** \internal - private function, usable only within the library */
             consume_operation(
               PrivateType,
-              std::unique_lock<std::mutex> &&           i_lock,
+              std::unique_lock<MUTEX> &&                i_lock,
               typename InnerQueue::consume_operation && i_consume_operation) noexcept
                 : m_lock(std::move(i_lock)), m_consume_operation(std::move(i_consume_operation))
             {
@@ -716,16 +878,16 @@ namespace density
                 if (m_lock.owns_lock())
                     cancel();
 
-                m_lock = std::unique_lock<std::mutex>(i_queue->m_mutex);
+                m_lock = std::unique_lock<MUTEX>(i_queue->m_mutex);
 
-                bool const result = i_queue->m_queue.try_start_consume(m_consume_operation);
+                bool const result = i_queue->start_consume_locked(m_consume_operation);
                 if (!result)
                     m_lock.unlock();
                 return result;
             }
 
           private:
-            std::unique_lock<std::mutex>           m_lock;
+            std::unique_lock<MUTEX>                m_lock;
             typename InnerQueue::consume_operation m_consume_operation;
         };
 
@@ -895,11 +1057,11 @@ namespace density
         template <typename ELEMENT_TYPE, typename... CONSTRUCTION_PARAMS>
         put_transaction<ELEMENT_TYPE> start_emplace(CONSTRUCTION_PARAMS &&... i_construction_params)
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
+            std::unique_lock<MUTEX> lock(tail_mutex());
             return put_transaction<ELEMENT_TYPE>(
               PrivateType(),
               std::move(lock),
-              m_queue.template start_emplace<ELEMENT_TYPE>(
+              tail_queue().template start_emplace<ELEMENT_TYPE>(
                 std::forward<CONSTRUCTION_PARAMS>(i_construction_params)...));
         }
 
@@ -923,9 +1085,9 @@ namespace density
             \snippet conc_queue_examples.cpp conc_heter_queue start_dyn_push example 1 */
         put_transaction<> start_dyn_push(const runtime_type & i_type)
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
+            std::unique_lock<MUTEX> lock(tail_mutex());
             return put_transaction<>(
-              PrivateType(), std::move(lock), m_queue.start_dyn_push(i_type));
+              PrivateType(), std::move(lock), tail_queue().start_dyn_push(i_type));
         }
 
 
@@ -951,9 +1113,9 @@ namespace density
             \snippet conc_queue_examples.cpp conc_heter_queue start_dyn_push_copy example 1 */
         put_transaction<> start_dyn_push_copy(const runtime_type & i_type, const void * i_source)
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
+            std::unique_lock<MUTEX> lock(tail_mutex());
             return put_transaction<>(
-              PrivateType(), std::move(lock), m_queue.start_dyn_push_copy(i_type, i_source));
+              PrivateType(), std::move(lock), tail_queue().start_dyn_push_copy(i_type, i_source));
         }
 
         /** Begins a transaction that appends an element of a type known at runtime, move-constructing it from the source..
@@ -978,9 +1140,9 @@ namespace density
             \snippet conc_queue_examples.cpp conc_heter_queue start_dyn_push_move example 1 */
         put_transaction<> start_dyn_push_move(const runtime_type & i_type, void * i_source)
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
+            std::unique_lock<MUTEX> lock(tail_mutex());
             return put_transaction<>(
-              PrivateType(), std::move(lock), m_queue.start_dyn_push_move(i_type, i_source));
+              PrivateType(), std::move(lock), tail_queue().start_dyn_push_move(i_type, i_source));
         }
 
 
@@ -1028,9 +1190,9 @@ namespace density
             \snippet conc_queue_examples.cpp conc_heter_queue try_start_consume example 1 */
         consume_operation try_start_consume() noexcept
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            auto                         consume = m_queue.try_start_consume();
-            if (!consume)
+            std::unique_lock<MUTEX>                lock(m_mutex);
+            typename InnerQueue::consume_operation consume;
+            if (!start_consume_locked(consume))
                 lock.unlock();
             return consume_operation(PrivateType(), std::move(lock), std::move(consume));
         }
@@ -1053,6 +1215,28 @@ namespace density
             return i_consume.start_consume_impl(PrivateType(), this);
         }
 
+        /** Tries to consume an element, invoking a visitor on it.
+                @tparam TYPES... types of elements handled by the visitor with their complete type.
+                @param i_visitor callable object that is invoked with an lvalue reference to the element, if
+                    its type is one of TYPES..., or with a dynamic_reference<RUNTIME_TYPE> otherwise.
+            @return whether an element was consumed, that is whether the queue was not empty.
+
+            The dispatch is performed with a table mapping runtime types to functions, that is built the first
+            time this function is called with a given visitor type and TYPES..., so the cost of the dispatch is
+            constant regardless of the number of types. RUNTIME_TYPE must be hashable with std::hash.
+            If the visitor throws an exception, the consume is canceled and the element remains in the queue.
+
+            \snippet conc_queue_examples.cpp conc_heter_queue consume_visit example 1 */
+        template <typename... TYPES, typename VISITOR> bool try_consume_visit(VISITOR && i_visitor)
+        {
+            consume_operation consume;
+            if (!try_start_consume(consume))
+                return false;
+            detail::visit_element<TYPES...>(i_visitor, consume.complete_type(), consume.element_ptr());
+            consume.commit();
+            return true;
+        }
+
 
         /** Move-only class template that can be bound to a reentrant put transaction, otherwise it's empty.
 
@@ -1170,7 +1354,7 @@ namespace density
             void * raw_allocate(size_t i_size, size_t i_alignment)
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                std::lock_guard<MUTEX> lock(m_queue->tail_mutex());
                 return m_put_transaction.raw_allocate(i_size, i_alignment);
             }
 
@@ -1203,7 +1387,7 @@ namespace density
               raw_allocate_copy(INPUT_ITERATOR i_begin, INPUT_ITERATOR i_end)
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                std::lock_guard<MUTEX> lock(m_queue->tail_mutex());
                 return m_put_transaction.raw_allocate_copy(i_begin, i_end);
             }
 
@@ -1235,7 +1419,7 @@ namespace density
                 std::begin(i_source_range), std::end(i_source_range)))
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                std::lock_guard<MUTEX> lock(m_queue->tail_mutex());
                 return m_put_transaction.raw_allocate_copy(
                   std::begin(i_source_range), std::end(i_source_range));
             }
@@ -1251,7 +1435,7 @@ namespace density
             void commit() noexcept
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                AllLocks lock(*m_queue);
                 m_put_transaction.commit();
                 m_queue = nullptr;
             }
@@ -1270,7 +1454,7 @@ namespace density
             void cancel() noexcept
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                AllLocks lock(*m_queue);
                 m_put_transaction.cancel();
                 m_queue = nullptr;
             }
@@ -1462,7 +1646,7 @@ namespace density
             void commit() noexcept
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                std::lock_guard<MUTEX> lock(m_queue->m_mutex);
                 m_consume_operation.commit();
             }
 
@@ -1486,7 +1670,7 @@ namespace density
             void commit_nodestroy() noexcept
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                std::lock_guard<MUTEX> lock(m_queue->m_mutex);
                 m_consume_operation.commit_nodestroy();
             }
 
@@ -1503,7 +1687,7 @@ namespace density
             void cancel() noexcept
             {
                 DENSITY_ASSERT(!empty());
-                std::lock_guard<std::mutex> lock(m_queue->m_mutex);
+                std::lock_guard<MUTEX> lock(m_queue->m_mutex);
                 m_consume_operation.cancel();
             }
 
@@ -1565,15 +1749,15 @@ namespace density
                 DENSITY_ASSUME(i_queue != nullptr);
 
                 // first we take the locks, because they may throw
-                std::unique_lock<std::mutex> lock;
+                std::unique_lock<MUTEX> lock;
                 if (m_queue != nullptr)
                 {
-                    lock = std::unique_lock<std::mutex>(m_queue->m_mutex);
+                    lock = std::unique_lock<MUTEX>(m_queue->m_mutex);
                 }
-                std::unique_lock<std::mutex> new_lock;
+                std::unique_lock<MUTEX> new_lock;
                 if (m_queue != i_queue && i_queue != nullptr)
                 {
-                    new_lock = std::unique_lock<std::mutex>(i_queue->m_mutex);
+                    new_lock = std::unique_lock<MUTEX>(i_queue->m_mutex);
                 }
 
                 // nothing can throw from now on
@@ -1581,7 +1765,7 @@ namespace density
                     m_consume_operation.cancel();
                 lock    = std::move(new_lock);
                 m_queue = i_queue;
-                return m_queue->m_queue.try_start_reentrant_consume(m_consume_operation);
+                return m_queue->start_consume_locked(m_consume_operation);
             }
 
           private:
@@ -1664,8 +1848,8 @@ namespace density
         reentrant_put_transaction<ELEMENT_TYPE>
           start_reentrant_emplace(CONSTRUCTION_PARAMS &&... i_construction_params)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            auto put_transaction = m_queue.template start_reentrant_emplace<ELEMENT_TYPE>(
+            std::lock_guard<MUTEX> lock(tail_mutex());
+            auto put_transaction = tail_queue().template start_reentrant_emplace<ELEMENT_TYPE>(
               std::forward<CONSTRUCTION_PARAMS>(i_construction_params)...);
             return reentrant_put_transaction<ELEMENT_TYPE>(
               PrivateType(), this, std::move(put_transaction));
@@ -1678,8 +1862,8 @@ namespace density
             \snippet conc_queue_examples.cpp conc_heter_queue start_reentrant_dyn_push example 1 */
         reentrant_put_transaction<> start_reentrant_dyn_push(const runtime_type & i_type)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            auto                        put_transaction = m_queue.start_reentrant_dyn_push(i_type);
+            std::lock_guard<MUTEX> lock(tail_mutex());
+            auto put_transaction = tail_queue().start_reentrant_dyn_push(i_type);
             return reentrant_put_transaction<>(PrivateType(), this, std::move(put_transaction));
         }
 
@@ -1692,8 +1876,8 @@ namespace density
         reentrant_put_transaction<>
           start_reentrant_dyn_push_copy(const runtime_type & i_type, const void * i_source)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            auto put_transaction = m_queue.start_reentrant_dyn_push_copy(i_type, i_source);
+            std::lock_guard<MUTEX> lock(tail_mutex());
+            auto put_transaction = tail_queue().start_reentrant_dyn_push_copy(i_type, i_source);
             return reentrant_put_transaction<>(PrivateType(), this, std::move(put_transaction));
         }
 
@@ -1705,8 +1889,8 @@ namespace density
         reentrant_put_transaction<>
           start_reentrant_dyn_push_move(const runtime_type & i_type, void * i_source)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            auto put_transaction = m_queue.start_reentrant_dyn_push_move(i_type, i_source);
+            std::lock_guard<MUTEX> lock(tail_mutex());
+            auto put_transaction = tail_queue().start_reentrant_dyn_push_move(i_type, i_source);
             return reentrant_put_transaction<>(PrivateType(), this, std::move(put_transaction));
         }
 
@@ -1759,9 +1943,10 @@ namespace density
             \snippet conc_queue_examples.cpp conc_heter_queue try_start_reentrant_consume example 1 */
         reentrant_consume_operation try_start_reentrant_consume() noexcept
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            return reentrant_consume_operation(
-              PrivateType(), this, m_queue.try_start_reentrant_consume());
+            std::lock_guard<MUTEX>                           lock(m_mutex);
+            typename InnerQueue::reentrant_consume_operation consume;
+            start_consume_locked(consume);
+            return reentrant_consume_operation(PrivateType(), this, std::move(consume));
         }
 
         /** Tries to start a consume operation using an existing consume_operation object.
@@ -1785,8 +1970,55 @@ namespace density
         }
 
       private:
-        mutable std::mutex m_mutex;
-        InnerQueue         m_queue;
+        /** Locks both the head mutex and the tail mutex. With lock_single there is only one mutex. */
+        class AllLocks
+        {
+          public:
+            explicit AllLocks(const conc_heter_queue & i_queue)
+                : m_head_lock(i_queue.m_mutex, std::defer_lock),
+                  m_tail_lock(i_queue.tail_mutex(), std::defer_lock)
+            {
+                if (LOCKING == lock_head_tail)
+                    std::lock(m_head_lock, m_tail_lock);
+                else
+                    m_head_lock.lock();
+            }
+
+          private:
+            std::unique_lock<MUTEX> m_head_lock, m_tail_lock;
+        };
+
+        /** Mutex that protects the queue used by producers. With lock_single it is m_mutex. */
+        MUTEX & tail_mutex() const noexcept { return Tail::tail_mutex(m_mutex); }
+
+        /** Queue used by producers. With lock_single it is m_queue. */
+        InnerQueue & tail_queue() noexcept { return Tail::tail_queue(m_queue); }
+
+        /** Queue used by producers. With lock_single it is m_queue. */
+        const InnerQueue & tail_queue() const noexcept { return Tail::tail_queue(m_queue); }
+
+        /** Starts a consume operation on the head queue. The caller must own the lock on m_mutex. */
+        template <typename INNER_CONSUME_OPERATION>
+        bool start_consume_locked(INNER_CONSUME_OPERATION & i_consume) noexcept
+        {
+            return try_start_inner_consume(i_consume) ||
+                   (Tail::refill_head(m_queue) && try_start_inner_consume(i_consume));
+        }
+
+        bool try_start_inner_consume(typename InnerQueue::consume_operation & i_consume) noexcept
+        {
+            return m_queue.try_start_consume(i_consume);
+        }
+
+        bool try_start_inner_consume(
+          typename InnerQueue::reentrant_consume_operation & i_consume) noexcept
+        {
+            return m_queue.try_start_reentrant_consume(i_consume);
+        }
+
+      private:
+        mutable MUTEX m_mutex; /**< Protects m_queue. With lock_head_tail it is used only by consumers. */
+        InnerQueue         m_queue; /**< Head queue. With lock_single it is also the tail queue. */
     };
 
 
@@ -452,6 +452,25 @@ namespace density
             return PageAllocator::get_pin_count(i_address);
         }
 
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+        /** Returns the counters of the page allocator of the calling thread. Every specialization of
+            basic_default_allocator has its own page allocator. Available only if the macro
+            DENSITY_PAGE_ALLOCATOR_STATISTICS is defined.
+
+            \n <b>Progress guarantee</b>: wait-free
+            \n <b>Throws</b>: nothing. */
+        static const page_allocator_statistics & thread_statistics() noexcept
+        {
+            return PageAllocator::thread_local_instance().statistics();
+        }
+
+        /** Sets to zero the counters of the page allocator of the calling thread. */
+        static void reset_thread_statistics() noexcept
+        {
+            PageAllocator::thread_local_instance().statistics() = page_allocator_statistics();
+        }
+#endif
+
         /** Returns whether the right-side allocator can be used to deallocate block and pages allocated by this allocator.
             @return always true. */
         bool operator==(const basic_default_allocator &) const noexcept { return true; }
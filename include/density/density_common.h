@@ -102,6 +102,14 @@ namespace density
                                     without invocation is not supported.*/
     };
 
+    /** Specifies how a lock-based queue (conc_heter_queue and conc_function_queue) protects its state. */
+    enum lock_granularity
+    {
+        lock_single, /**< A single mutex is locked by both producers and consumers. */
+        lock_head_tail /**< Producers and consumers lock different mutexes, and they contend only when
+                            the consumers run out of elements. */
+    };
+
     // address functions
 
     /** Returns true whether the given unsigned integer number is a power of 2 (1, 2, 4, 8, ...)
@@ -438,6 +446,83 @@ namespace density
 
     /** \endcond */
 
+/** \def DENSITY_INSTRUMENT If defined, every thread counts the memory operations of the library in
+        an instrument_counters. It must be defined in every translation unit of the program. It implies
+        DENSITY_PAGE_ALLOCATOR_STATISTICS, that counts the page operations. */
+#ifdef DENSITY_INSTRUMENT
+#ifndef DENSITY_PAGE_ALLOCATOR_STATISTICS
+#define DENSITY_PAGE_ALLOCATOR_STATISTICS
+#endif
+
+    /** Counters of the memory operations performed by a thread, returned by thread_instrument_counters.
+        They exist only if the macro DENSITY_INSTRUMENT is defined. The counters are updated regardless
+        of the allocator. The page operations of basic_default_allocator are not counted here: they are
+        in the page_allocator_statistics returned by basic_default_allocator::thread_statistics. */
+    struct instrument_counters
+    {
+        uintptr_t m_aligned_allocations{};   /**< calls to aligned_allocate and try_aligned_allocate */
+        uintptr_t m_aligned_deallocations{}; /**< calls to aligned_deallocate */
+        uintptr_t m_region_creations{};      /**< memory regions requested by the page manager */
+        uintptr_t m_external_allocations{};  /**< elements allocated outside the pages */
+
+        /** Returns the number of operations that reached the memory of the system, that is the
+            aligned allocations and the region creations. */
+        uintptr_t system_allocations() const noexcept
+        {
+            return m_aligned_allocations + m_region_creations;
+        }
+    };
+
+    /** Returns the counters of the calling thread. */
+    inline instrument_counters & thread_instrument_counters() noexcept
+    {
+        static thread_local instrument_counters t_counters;
+        return t_counters;
+    }
+
+    /** Takes a snapshot of the counters of the calling thread when constructed, and returns the
+        operations performed since then. It can be used by a test to check that a loop does not
+        allocate from the system:
+
+        @code
+        instrument_scope scope;
+        // ... steady-state loop
+        assert(scope.system_allocations() == 0);
+        @endcode
+
+        An instrument_scope must be used by the thread that constructed it. */
+    class instrument_scope
+    {
+      public:
+        instrument_scope() noexcept : m_start(thread_instrument_counters()) {}
+
+        /** Returns the operations performed by the calling thread since the construction. */
+        instrument_counters counters() const noexcept
+        {
+            auto const & current = thread_instrument_counters();
+            instrument_counters result;
+            result.m_aligned_allocations =
+              current.m_aligned_allocations - m_start.m_aligned_allocations;
+            result.m_aligned_deallocations =
+              current.m_aligned_deallocations - m_start.m_aligned_deallocations;
+            result.m_region_creations = current.m_region_creations - m_start.m_region_creations;
+            result.m_external_allocations =
+              current.m_external_allocations - m_start.m_external_allocations;
+            return result;
+        }
+
+        /** Returns the operations that reached the memory of the system since the construction. */
+        uintptr_t system_allocations() const noexcept { return counters().system_allocations(); }
+
+      private:
+        instrument_counters const m_start;
+    };
+
+#define DENSITY_INSTRUMENT_COUNT(counter) (++::density::thread_instrument_counters().counter)
+#else
+#define DENSITY_INSTRUMENT_COUNT(counter) ((void)0)
+#endif
+
     /** Uses the global operator new to allocate a memory block with at least the specified size and alignment
             @param i_size size of the requested memory block, in bytes
             @param i_alignment alignment of the requested memory block, in bytes
@@ -462,6 +547,7 @@ namespace density
         DENSITY_ASSERT(is_power_of_2(i_alignment));
         DENSITY_ASSUME(i_alignment > 0);
         DENSITY_ASSUME(i_alignment_offset <= i_size);
+        DENSITY_INSTRUMENT_COUNT(m_aligned_allocations);
 
         void * user_block;
         if (i_alignment <= detail::MaxAlignment && i_alignment_offset == 0)
@@ -513,6 +599,7 @@ namespace density
         DENSITY_ASSERT(is_power_of_2(i_alignment));
         DENSITY_ASSUME(i_alignment > 0);
         DENSITY_ASSUME(i_alignment_offset <= i_size);
+        DENSITY_INSTRUMENT_COUNT(m_aligned_allocations);
 
         void * user_block;
         if (i_alignment <= detail::MaxAlignment && i_alignment_offset == 0)
@@ -566,6 +653,7 @@ namespace density
     {
         DENSITY_ASSERT(is_power_of_2(i_alignment));
         DENSITY_ASSUME(i_alignment > 0);
+        DENSITY_INSTRUMENT_COUNT(m_aligned_deallocations);
 
         if (i_alignment <= detail::MaxAlignment && i_alignment_offset == 0)
         {
@@ -738,13 +826,13 @@ Relaxed guarantees
 ------------
 Function queues use type erasure to handle callable objects of heterogeneous types. By default two operations are captured for each element type: invoke-destroy, and just-destroy.
 The third template parameter of all function queues is an enum of type [function_type_erasure](namespacedensity.html#a80100b808e35e98df3ffe74cc2293309) that controls the type erasure: the value function_manual_clear excludes the second operation, so that the function queue will not be able to destroy a callable without invoking it. This gives a performance benefit, at the price that the queue can't be cleared, and that the user must ensure that the queue is empty when destroyed.
-Internally, in manual-clean mode, the layout of a value in the function queue is composed by:
+Internally the layout of a value in the function queue is composed by:
 
  - an overhead pointer (that points to the next value, and keeps the state of the value in the least significant bits)
- - the runtime type, actually a pointer to the invoke-destroy function
+ - the runtime type, actually a single pointer: in manual-clean mode it points to the invoke-destroy function, otherwise to a static table with both operations
  - the eventual capture
 
-So if you put a capture-less lambda or a pointer to a function, you are advancing the tail pointer by the space required by 2 pointers.
+So if you put a capture-less lambda or a pointer to a function, you are advancing the tail pointer by the space required by 2 pointers. In manual-clean mode consuming a value requires one indirection less.
 Anyway lock-free queues and spin-locking queues align their values to [density::destructive_interference_size](namespacedensity.html#ae8f72b2dd386b61bf0bc4f30478c2941), so they are less dense than the other queues.
 
 All queues but `function_queue` and `heter_queue` are concurrency enabled. By default they allow multiple producers and multiple consumers.
@@ -111,6 +111,12 @@ namespace density
         This is a configuration variable, intended to be customized by the user of the library. The default value is 1024 * 64. */
     constexpr size_t default_page_capacity = 1024 * 64;
 
+    /** Maximum number of target types that can be bound to instances of a specialization of compact_runtime_type.
+        Every specialization has a static registry of feature tables with this capacity.
+
+        This is a configuration variable, intended to be customized by the user of the library. The default value is 4096. */
+    constexpr size_t compact_runtime_type_capacity = 4096;
+
     /** In this version of the library relaxed atomic operations are disabled.
         Concurrently data structures has been tested on x86-x64, but not on architectures with weak
         memory ordering. If you want to contribute to density, running the tests on other
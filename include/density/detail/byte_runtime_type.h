@@ -0,0 +1,123 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <cstring>
+#include <density/density_common.h>
+
+namespace density
+{
+    /** Non-owning view of a contiguous sequence of bytes. byte_span is used by byte_queue and
+        lf_byte_queue to expose the storage of a message, which can be read or written in place.
+
+        \snippet byte_queue_examples.cpp byte_queue reserve example 1 */
+    class byte_span
+    {
+      public:
+        /** Constructs an empty span */
+        constexpr byte_span() noexcept = default;
+
+        /** Constructs a span from the address of the first byte and the number of bytes */
+        constexpr byte_span(void * i_data, size_t i_size) noexcept : m_data(i_data), m_size(i_size)
+        {
+        }
+
+        /** Returns the address of the first byte */
+        void * data() const noexcept { return m_data; }
+
+        /** Returns the number of bytes */
+        size_t size() const noexcept { return m_size; }
+
+        /** Returns whether the span has no bytes */
+        bool empty() const noexcept { return m_size == 0; }
+
+        /** Returns a pointer to the first byte */
+        unsigned char * begin() const noexcept { return static_cast<unsigned char *>(m_data); }
+
+        /** Returns a pointer past the last byte */
+        unsigned char * end() const noexcept { return begin() + m_size; }
+
+        /** Returns a reference to the byte at the specified index */
+        unsigned char & operator[](size_t i_index) const noexcept
+        {
+            DENSITY_ASSERT(i_index < m_size);
+            return begin()[i_index];
+        }
+
+        /** Returns the span of i_count bytes starting at i_offset */
+        byte_span subspan(size_t i_offset, size_t i_count) const noexcept
+        {
+            DENSITY_ASSERT(i_offset <= m_size && i_count <= m_size - i_offset);
+            return byte_span(begin() + i_offset, i_count);
+        }
+
+      private:
+        void * m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    namespace detail
+    {
+        /** \internal Private class used as runtime type for byte queues. It is the length prefix of a
+            message: the bytes of the message are the element, so they are allocated right after the
+            runtime type (or in an external block if they don't fit in a page). All the messages have the
+            same alignment, so that the prefix holds only the length. The size can be reduced before the
+            put is committed, so that a message can be reserved with an upper bound. */
+        class ByteRuntimeType
+        {
+          public:
+            /** Alignment of the first byte of every message. The control block and the length prefix
+                have the same alignment, so no padding is needed between the prefix and the message. */
+            constexpr static size_t s_message_alignment = alignof(size_t);
+
+            ByteRuntimeType() noexcept = default;
+
+            explicit ByteRuntimeType(size_t i_size) noexcept : m_size(i_size) {}
+
+            /** A default constructed ByteRuntimeType is empty: its size is s_empty_size, that is never
+                the size of a message. */
+            bool empty() const noexcept { return m_size == s_empty_size; }
+
+            void clear() noexcept { m_size = s_empty_size; }
+
+            /** Returns the size of the storage of the message, that the queues require to be a
+                multiple of the alignment */
+            size_t size() const noexcept { return uint_upper_align(m_size, s_message_alignment); }
+
+            /** Returns the size of the message */
+            size_t message_size() const noexcept { return m_size; }
+
+            constexpr static size_t alignment() noexcept { return s_message_alignment; }
+
+            void default_construct(void * /*i_dest*/) const noexcept {}
+
+            void copy_construct(void * i_dest, const void * i_source) const noexcept
+            {
+                std::memcpy(i_dest, i_source, m_size);
+            }
+
+            void move_construct(void * i_dest, void * i_source) const noexcept
+            {
+                std::memcpy(i_dest, i_source, m_size);
+            }
+
+            void destroy(void * /*i_dest*/) const noexcept {}
+
+            /** Reduces the size of the message. The allocated space is not changed. */
+            void shrink(size_t i_size) noexcept
+            {
+                DENSITY_ASSERT(i_size <= m_size);
+                m_size = i_size;
+            }
+
+          private:
+            constexpr static size_t s_empty_size = static_cast<size_t>(-1);
+            size_t                  m_size       = s_empty_size;
+        };
+
+    } // namespace detail
+
+} // namespace density
@@ -35,91 +35,119 @@ namespace density
             return std::mem_fn(i_functor)(std::forward<PARAMS>(i_params)...);
         }
 
+        /** \internal Returns the address of a callable object of a function queue, given the address
+            following its runtime type. Function queues allocate a callable right after its runtime type,
+            or in an external block aligned to its alignment. Since a FunctionRuntimeType is a single pointer,
+            if the alignment of the callable is not greater than alignof(void*) the address is already aligned. */
+        template <typename ACTUAL_TYPE> ACTUAL_TYPE * function_element_ptr(void * i_dest) noexcept
+        {
+            return static_cast<ACTUAL_TYPE *>(
+              alignof(ACTUAL_TYPE) <= alignof(void *)
+                ? i_dest
+                : address_upper_align(i_dest, alignof(ACTUAL_TYPE)));
+        }
+
+        /** \internal Type-erased operations on a callable object of a function queue */
+        template <typename ACTUAL_TYPE, typename RET_VAL, typename... PARAMS> struct FunctionImpl
+        {
+            static RET_VAL align_invoke_destroy(void * i_dest, PARAMS... i_params)
+            {
+                return align_invoke_destroy_impl(
+                  std::is_void<RET_VAL>(), i_dest, std::forward<PARAMS>(i_params)...);
+            }
+
+            static void align_destroy(void * i_dest) noexcept
+            {
+                auto const aligned_dest = function_element_ptr<ACTUAL_TYPE>(i_dest);
+                aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
+            }
+
+            static RET_VAL
+              align_invoke_destroy_impl(std::false_type, void * i_dest, PARAMS... i_params)
+            {
+                auto const aligned_dest = function_element_ptr<ACTUAL_TYPE>(i_dest);
+                auto && ret =
+                  density::detail::invoke(*aligned_dest, std::forward<PARAMS>(i_params)...);
+                aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
+                return ret;
+            }
+
+            static void align_invoke_destroy_impl(std::true_type, void * i_dest, PARAMS... i_params)
+            {
+                auto const aligned_dest = function_element_ptr<ACTUAL_TYPE>(i_dest);
+                density::detail::invoke(*aligned_dest, std::forward<PARAMS>(i_params)...);
+                aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
+            }
+        };
+
+        /** \internal Table of the functions captured by function_standard_erasure. There is an
+            instance for every callable type, so that the runtime type can be a single pointer. */
+        template <typename RET_VAL, typename... PARAMS> struct FunctionTable
+        {
+            RET_VAL (*m_align_invoke_destroy)(void * i_dest, PARAMS... i_params);
+            void (*m_align_destroy)(void * i_dest);
+        };
+
+        template <typename ACTUAL_TYPE, typename RET_VAL, typename... PARAMS>
+        struct FunctionTableInstance
+        {
+            constexpr static FunctionTable<RET_VAL, PARAMS...> s_table = {
+              &FunctionImpl<ACTUAL_TYPE, RET_VAL, PARAMS...>::align_invoke_destroy,
+              &FunctionImpl<ACTUAL_TYPE, RET_VAL, PARAMS...>::align_destroy};
+        };
+        template <typename ACTUAL_TYPE, typename RET_VAL, typename... PARAMS>
+        constexpr FunctionTable<RET_VAL, PARAMS...>
+          FunctionTableInstance<ACTUAL_TYPE, RET_VAL, PARAMS...>::s_table;
+
         /** \internal Private class template used as runtime type for function queues */
         template <function_type_erasure MODE, typename CALLABLE> class FunctionRuntimeType;
 
-        /** \internal Private class template used as runtime type for function queues with function_standard_erasure */
+        /** \internal Private class template used as runtime type for function queues with function_standard_erasure.
+            It is a pointer to the FunctionTable of the target type. */
         template <typename RET_VAL, typename... PARAMS>
         class FunctionRuntimeType<function_standard_erasure, RET_VAL(PARAMS...)>
         {
           public:
             template <typename TYPE> static FunctionRuntimeType make() noexcept
             {
+                static_assert(
+                  alignof(FunctionRuntimeType) >= alignof(void *),
+                  "function_element_ptr relies on this");
                 FunctionRuntimeType result;
-                result.m_align_invoke_destroy = &Impl<TYPE>::align_invoke_destroy;
-                result.m_align_destroy        = &Impl<TYPE>::align_destroy;
+                result.m_table = &FunctionTableInstance<TYPE, RET_VAL, PARAMS...>::s_table;
                 return result;
             }
 
-            bool empty() const noexcept { return m_align_invoke_destroy == nullptr; }
+            bool empty() const noexcept { return m_table == nullptr; }
 
-            void clear() noexcept
-            {
-                m_align_invoke_destroy = nullptr;
-                m_align_destroy        = nullptr;
-            }
+            void clear() noexcept { m_table = nullptr; }
 
-            void destroy(void * i_dest) const noexcept { (*m_align_destroy)(i_dest); }
+            void destroy(void * i_dest) const noexcept { (*m_table->m_align_destroy)(i_dest); }
 
             RET_VAL align_invoke_destroy(void * i_dest, PARAMS... i_params) const
             {
-                return (*m_align_invoke_destroy)(i_dest, std::forward<PARAMS>(i_params)...);
+                return (*m_table->m_align_invoke_destroy)(i_dest, std::forward<PARAMS>(i_params)...);
             }
 
             size_t alignment() const { return 1; }
 
-            template <typename ACTUAL_TYPE> struct Impl
-            {
-                static RET_VAL align_invoke_destroy(void * i_dest, PARAMS... i_params)
-                {
-                    return align_invoke_destroy_impl(
-                      std::is_void<RET_VAL>(), i_dest, std::forward<PARAMS>(i_params)...);
-                }
-
-                static void align_destroy(void * i_dest) noexcept
-                {
-                    auto const aligned_dest =
-                      static_cast<ACTUAL_TYPE *>(address_upper_align(i_dest, alignof(ACTUAL_TYPE)));
-                    aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
-                }
-
-                static RET_VAL
-                  align_invoke_destroy_impl(std::false_type, void * i_dest, PARAMS... i_params)
-                {
-                    auto const aligned_dest =
-                      static_cast<ACTUAL_TYPE *>(address_upper_align(i_dest, alignof(ACTUAL_TYPE)));
-                    auto && ret =
-                      density::detail::invoke(*aligned_dest, std::forward<PARAMS>(i_params)...);
-                    aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
-                    return ret;
-                }
-
-                static void
-                  align_invoke_destroy_impl(std::true_type, void * i_dest, PARAMS... i_params)
-                {
-                    auto const aligned_dest =
-                      static_cast<ACTUAL_TYPE *>(address_upper_align(i_dest, alignof(ACTUAL_TYPE)));
-                    density::detail::invoke(*aligned_dest, std::forward<PARAMS>(i_params)...);
-                    aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
-                }
-            };
-
-            using AlignInvokeDestroyFunc = RET_VAL (*)(void * i_dest, PARAMS... i_params);
-            using AlignDestroyFunc       = void (*)(void * i_dest);
-
-            AlignInvokeDestroyFunc m_align_invoke_destroy = nullptr;
-            AlignDestroyFunc       m_align_destroy        = nullptr;
+            const FunctionTable<RET_VAL, PARAMS...> * m_table = nullptr;
         };
 
-        /** \internal Private class template used as runtime type for function queues with function_manual_clear */
+        /** \internal Private class template used as runtime type for function queues with function_manual_clear.
+            It is a pointer to the invoke-destroy function of the target type. */
         template <typename RET_VAL, typename... PARAMS>
         class FunctionRuntimeType<function_manual_clear, RET_VAL(PARAMS...)>
         {
           public:
             template <typename TYPE> static FunctionRuntimeType make() noexcept
             {
+                static_assert(
+                  alignof(FunctionRuntimeType) >= alignof(void *),
+                  "function_element_ptr relies on this");
                 FunctionRuntimeType result;
-                result.m_align_invoke_destroy = &Impl<TYPE>::align_invoke_destroy;
+                result.m_align_invoke_destroy =
+                  &FunctionImpl<TYPE, RET_VAL, PARAMS...>::align_invoke_destroy;
                 return result;
             }
 
@@ -141,36 +169,6 @@ namespace density
 
             size_t alignment() const { return 1; }
 
-            template <typename ACTUAL_TYPE> struct Impl
-            {
-                static RET_VAL align_invoke_destroy(void * i_dest, PARAMS... i_params)
-                {
-                    return align_invoke_destroy_impl(
-                      std::is_void<RET_VAL>(), i_dest, std::forward<PARAMS>(i_params)...);
-                }
-
-                static RET_VAL
-                  align_invoke_destroy_impl(std::false_type, void * i_dest, PARAMS... i_params)
-                {
-                    auto const aligned_dest =
-                      static_cast<ACTUAL_TYPE *>(address_upper_align(i_dest, alignof(ACTUAL_TYPE)));
-                    auto && ret =
-                      density::detail::invoke(*aligned_dest, std::forward<PARAMS>(i_params)...);
-                    ;
-                    aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
-                    return ret;
-                }
-
-                static void
-                  align_invoke_destroy_impl(std::true_type, void * i_dest, PARAMS... i_params)
-                {
-                    auto const aligned_dest =
-                      static_cast<ACTUAL_TYPE *>(address_upper_align(i_dest, alignof(ACTUAL_TYPE)));
-                    density::detail::invoke(*aligned_dest, std::forward<PARAMS>(i_params)...);
-                    aligned_dest->ACTUAL_TYPE::~ACTUAL_TYPE();
-                }
-            };
-
             using AlignInvokeDestroyFunc = RET_VAL (*)(void * i_dest, PARAMS... i_params);
             AlignInvokeDestroyFunc m_align_invoke_destroy = nullptr;
         };
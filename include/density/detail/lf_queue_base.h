@@ -7,6 +7,7 @@
 #pragma once
 #include <density/raw_atomic.h>
 #include <type_traits>
+#include <vector>
 
 namespace density
 {
@@ -271,6 +272,97 @@ namespace density
                 return result;
             }
 
+            /** Set of consumable elements that are marked as busy (as if a consume operation were in progress on them)
+                and whose pages are pinned, so that they can be visited while other threads put and consume. The
+                elements are grouped by page. The destructor restores the elements and unpins the pages.
+                CONSUME is the Consume class of the head layer. */
+            template <typename CONSUME> class Snapshot
+            {
+              public:
+                Snapshot(ALLOCATOR_TYPE & i_allocator) noexcept : m_allocator(i_allocator) {}
+
+                Snapshot(const Snapshot &) = delete;
+                Snapshot & operator=(const Snapshot &) = delete;
+
+                ~Snapshot()
+                {
+                    for (auto const & element : m_elements)
+                    {
+                        raw_atomic_store(&element.m_control->m_next, element.m_next, mem_release);
+                    }
+                    for (auto const first_element : m_page_starts)
+                    {
+                        m_allocator.unpin_page(m_elements[first_element].m_control);
+                    }
+                }
+
+                /** Marks as busy all the elements that can be consumed, and pins their pages. */
+                template <typename QUEUE_HEAD> void take(QUEUE_HEAD * i_queue)
+                {
+                    CONSUME consume;
+                    consume.begin_iteration(i_queue);
+                    while (!consume.empty())
+                    {
+                        if (
+                          (consume.m_next_ptr &
+                           (LfQueue_Busy | LfQueue_Dead | LfQueue_InvalidNextPage)) == 0)
+                        {
+                            // reserve before claiming the element, so that nothing can throw after
+                            if (m_elements.size() == m_elements.capacity())
+                                m_elements.reserve(m_elements.size() * 2 + 64);
+                            if (m_page_starts.size() == m_page_starts.capacity())
+                                m_page_starts.reserve(m_page_starts.size() * 2 + 8);
+
+                            uintptr_t const next_ptr = consume.m_next_ptr;
+                            if (!consume.try_claim())
+                            {
+                                // the element has been consumed, or the control block has been zeroed
+                                if (consume.empty())
+                                    consume.begin_iteration(i_queue);
+                                continue;
+                            }
+
+                            if (
+                              m_elements.empty() ||
+                              !same_page(m_elements.back().m_control, consume.m_control))
+                            {
+                                m_allocator.pin_page(consume.m_control);
+                                m_page_starts.push_back(m_elements.size());
+                            }
+                            m_elements.push_back(Element{consume.m_control, next_ptr});
+                        }
+                        consume.move_next();
+                    }
+                }
+
+                size_t page_count() const noexcept { return m_page_starts.size(); }
+
+                /** Invokes i_func on the elements of the i_page-th page */
+                template <typename FUNC> void visit_page(size_t i_page, FUNC & i_func) const
+                {
+                    auto const end = i_page + 1 < m_page_starts.size() ? m_page_starts[i_page + 1]
+                                                                       : m_elements.size();
+                    for (auto index = m_page_starts[i_page]; index < end; index++)
+                    {
+                        auto const & element = m_elements[index];
+                        i_func(
+                          *type_after_control(element.m_control),
+                          get_element(element.m_control, (element.m_next & LfQueue_External) != 0));
+                    }
+                }
+
+              private:
+                struct Element
+                {
+                    ControlBlock * m_control;
+                    uintptr_t      m_next; /**< value of m_next before the element was marked as busy */
+                };
+
+                ALLOCATOR_TYPE &     m_allocator;
+                std::vector<Element> m_elements;
+                std::vector<size_t>  m_page_starts; /**< index of the first element of every page */
+            };
+
             Allocation try_inplace_allocate(
               progress_guarantee i_progress_guarantee,
               uintptr_t          i_control_bits,
@@ -356,6 +448,7 @@ namespace density
                 auto guarantee = PROGRESS_GUARANTEE; // used to avoid warnings about
                                                      // constant conditional expressions
                 DENSITY_ASSUME(guarantee == LfQueue_Throwing || guarantee == LfQueue_Blocking);
+                DENSITY_INSTRUMENT_COUNT(m_external_allocations);
 
                 void * external_block;
                 if (guarantee == LfQueue_Throwing)
@@ -238,6 +238,18 @@ namespace density
                     return true;
                 }
 
+                /** Tries to mark as busy the current element, that must be consumable, without starting a
+                    consume operation. On failure m_next_ptr is updated, and may be empty. */
+                bool try_claim() noexcept
+                {
+                    return raw_atomic_compare_exchange_strong(
+                      &m_control->m_next,
+                      &m_next_ptr,
+                      m_next_ptr | LfQueue_Busy,
+                      mem_acquire,
+                      mem_relaxed);
+                }
+
                 /** Tries to start a consume operation. The Consume must be initially empty.
                     If there are no consumable elements, the Consume remains empty (m_next_ptr <= LfQueue_AllFlags).
                     Otherwise m_next_ptr is the value to set on the ControlBox to commit the consume
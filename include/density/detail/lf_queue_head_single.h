@@ -175,6 +175,14 @@ namespace density
                     return true;
                 }
 
+                /** Marks as busy the current element, that must be consumable, without starting a
+                    consume operation. Always succeeds, since there are no other consumers. */
+                bool try_claim() noexcept
+                {
+                    raw_atomic_store(&m_control->m_next, m_next_ptr | LfQueue_Busy, mem_relaxed);
+                    return true;
+                }
+
                 /** Tries to start a consume operation. The Consume must be initially empty.
                     If there are no consumable elements, the Consume remains empty (m_next_ptr <= LfQueue_AllFlags).
                     Otherwise m_next_ptr is the value to set on the ControlBox to commit the consume
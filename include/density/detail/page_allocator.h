@@ -19,6 +19,35 @@
 
 namespace density
 {
+    /** Counters of the page allocator of a thread, returned by basic_default_allocator::thread_statistics.
+        They are updated only if the macro DENSITY_PAGE_ALLOCATOR_STATISTICS is defined. Every allocation
+        is counted in the first of these sources that provides the page: the private stack of the thread,
+        the current slot, the victim slot, or the slow path. */
+    struct page_allocator_statistics
+    {
+        uintptr_t m_allocations{};           /**< page allocations requested */
+        uintptr_t m_private_allocations{};   /**< pages taken from the private stack */
+        uintptr_t m_slot_allocations{};      /**< pages taken from the slot of the thread */
+        uintptr_t m_steal_allocations{};     /**< pages stolen from the victim slot */
+        uintptr_t m_slow_path_allocations{}; /**< allocations that entered the slow path */
+        uintptr_t m_system_allocations{};    /**< pages carved from the system memory regions */
+        uintptr_t m_zeroing_allocations{};   /**< zeroed pages obtained zeroing a recycled page */
+        uintptr_t m_failed_allocations{};    /**< allocations that returned no page */
+        uintptr_t m_deallocations{};         /**< page deallocations */
+        uintptr_t m_private_deallocations{}; /**< pages put in the private stack, all slots busy */
+        uintptr_t m_pins{};                  /**< pins, including the successful try_pin_page */
+        uintptr_t m_deferred_unpins{};       /**< unpins delayed because of contention */
+    };
+
+/** \def DENSITY_PAGE_ALLOCATOR_STATISTICS If defined, the page allocator of every thread updates a
+        page_allocator_statistics. It must be defined in every translation unit of the program. It is
+        defined by density_common.h if DENSITY_INSTRUMENT is defined. */
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+#define DENSITY_PAGE_ALLOCATOR_COUNT(instance, counter) (++(instance).m_statistics.counter)
+#else
+#define DENSITY_PAGE_ALLOCATOR_COUNT(instance, counter) ((void)0)
+#endif
+
     namespace detail
     {
         enum class page_allocation_type
@@ -130,6 +159,9 @@ namespace density
             PageStack          m_private_page_stack, m_private_zeroed_page_stack;
             SingletonPtr<GlobalState<SYSTYEM_PAGE_MANAGER>> m_global_state;
             PageStack                                       m_pages_to_unpin;
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+            page_allocator_statistics m_statistics;
+#endif
 
             static thread_local PageAllocator t_instance;
 
@@ -143,10 +175,15 @@ namespace density
 
             static PageAllocator & thread_local_instance() { return t_instance; }
 
+#ifdef DENSITY_PAGE_ALLOCATOR_STATISTICS
+            page_allocator_statistics & statistics() noexcept { return m_statistics; }
+#endif
+
             template <page_allocation_type ALLOCATION_TYPE>
             void * try_allocate_page(progress_guarantee i_progress_guarantee) noexcept
             {
                 process_pending_unpins(i_progress_guarantee);
+                DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_allocations);
 
                 // try from the private stack...
                 auto * new_page = get_private_stack(ALLOCATION_TYPE).pop_unpinned();
@@ -162,11 +199,20 @@ namespace density
                         // if still do not have a page, we go to the next level
                         if (new_page == nullptr)
                         {
+                            DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_slow_path_allocations);
                             new_page =
                               allocate_page_slow_path(ALLOCATION_TYPE, i_progress_guarantee);
+                            if (new_page == nullptr)
+                                DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_failed_allocations);
                         }
+                        else
+                            DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_steal_allocations);
                     }
+                    else
+                        DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_slot_allocations);
                 }
+                else
+                    DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_private_allocations);
 
                 // flush any pending write
                 if (enable_relaxed_atomics)
@@ -179,6 +225,7 @@ namespace density
             void deallocate_page(void * i_page) noexcept
             {
                 process_pending_unpins(progress_wait_free);
+                DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_deallocations);
 
                 auto const page = get_footer(i_page);
 
@@ -200,6 +247,7 @@ namespace density
                 // this is unlikely, but it may happen
                 if (!done)
                 {
+                    DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_private_deallocations);
                     get_private_stack(ALLOCATION_TYPE).push(page);
                 }
             }
@@ -216,6 +264,7 @@ namespace density
             static void pin_page(void * const i_address) noexcept
             {
                 t_instance.process_pending_unpins(progress_lock_free);
+                DENSITY_PAGE_ALLOCATOR_COUNT(t_instance, m_pins);
 
                 auto const footer = get_footer(i_address);
                 footer->m_pin_count.fetch_add(1, detail::mem_relaxed);
@@ -229,14 +278,18 @@ namespace density
                 auto const footer = get_footer(i_address);
                 if (i_progress_guarantee <= progress_guarantee::progress_lock_free)
                 {
+                    DENSITY_PAGE_ALLOCATOR_COUNT(t_instance, m_pins);
                     footer->m_pin_count.fetch_add(1, detail::mem_relaxed);
                     return true;
                 }
                 else
                 {
-                    auto curr_value = footer->m_pin_count.load(detail::mem_relaxed);
-                    return footer->m_pin_count.compare_exchange_weak(
+                    auto       curr_value = footer->m_pin_count.load(detail::mem_relaxed);
+                    bool const pinned     = footer->m_pin_count.compare_exchange_weak(
                       curr_value, curr_value + 1, detail::mem_relaxed);
+                    if (pinned)
+                        DENSITY_PAGE_ALLOCATOR_COUNT(t_instance, m_pins);
+                    return pinned;
                 }
             }
 
@@ -268,6 +321,7 @@ namespace density
                           curr_value, curr_value - 1, detail::mem_relaxed))
                     {
                         // failed due to contention, we must retry later
+                        DENSITY_PAGE_ALLOCATOR_COUNT(t_instance, m_deferred_unpins);
                         t_instance.m_pages_to_unpin.push(footer);
                     }
                 }
@@ -354,6 +408,7 @@ namespace density
                   m_global_state->sys_page_manager().try_allocate_page(progress_wait_free);
                 if (new_page_mem != nullptr)
                 {
+                    DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_system_allocations);
                     new_page = initialize_page(i_allocation_type, new_page_mem);
                 }
                 else
@@ -371,6 +426,26 @@ namespace density
 
                     } while (m_victim_slot != starting_victim_slot);
 
+                    /* ...then zero an uninitialized page. Some queues allocate zeroed pages but
+                        deallocate them without zeroing, so without this step they would keep
+                        allocating memory from the system. */
+                    if (new_page == nullptr && i_allocation_type == page_allocation_type::zeroed)
+                    {
+                        new_page = m_private_page_stack.pop_unpinned();
+                        if (new_page == nullptr)
+                            new_page =
+                              m_current_slot->get_stack(page_allocation_type::uninitialized)
+                                .try_pop_unpinned();
+                        if (new_page != nullptr)
+                        {
+                            DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_zeroing_allocations);
+                            std::memset(
+                              address_lower_align(new_page, page_alignment),
+                              0,
+                              page_size); // the page footer is not touched
+                        }
+                    }
+
                     if (new_page == nullptr && i_progress_guarantee == progress_blocking)
                     {
                         // ...last chance, try possibly allocating new memory from the system
@@ -378,6 +453,7 @@ namespace density
                           m_global_state->sys_page_manager().try_allocate_page(progress_blocking);
                         if (new_page_mem != nullptr)
                         {
+                            DENSITY_PAGE_ALLOCATOR_COUNT(*this, m_system_allocations);
                             new_page = initialize_page(i_allocation_type, new_page_mem);
                         }
                     }
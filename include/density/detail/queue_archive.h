@@ -0,0 +1,199 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <density/density_common.h>
+#include <density/io_runtimetype_features.h>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace density
+{
+    namespace detail
+    {
+        /** \internal First 4 bytes of a queue saved by heter_queue::save ('DNSQ' in little endian) */
+        constexpr uint32_t s_queue_archive_magic = 0x51534E44;
+
+        /** \internal Version of the format written by heter_queue::save */
+        constexpr uint32_t s_queue_archive_version = 1;
+
+        /** \internal Accumulates the output in a buffer with a fixed capacity, so that the stream is written
+            in big chunks rather than once per element. Objects that are not bitwise serializable are written
+            directly to the stream, after the buffer has been flushed. */
+        class QueueArchiveWriter
+        {
+          public:
+            QueueArchiveWriter(std::ostream & i_stream, size_t i_chunk_size)
+                : m_stream(i_stream), m_buffer(i_chunk_size), m_used(0)
+            {
+            }
+
+            void write(const void * i_source, size_t i_size)
+            {
+                if (i_size > m_buffer.size() - m_used)
+                {
+                    flush();
+                    if (i_size > m_buffer.size())
+                    {
+                        m_stream.write(static_cast<const char *>(i_source), static_cast<std::streamsize>(i_size));
+                        return;
+                    }
+                }
+                std::memcpy(m_buffer.data() + m_used, i_source, i_size);
+                m_used += i_size;
+            }
+
+            template <typename UINT> void write_uint(UINT i_value) { write(&i_value, sizeof(i_value)); }
+
+            /** Writes the content of the buffer to the stream, and returns the stream */
+            std::ostream & flush()
+            {
+                if (m_used != 0)
+                {
+                    m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_used));
+                    m_used = 0;
+                }
+                return m_stream;
+            }
+
+          private:
+            std::ostream &    m_stream;
+            std::vector<char> m_buffer;
+            size_t            m_used;
+        };
+
+        /** \internal Reads the fields written by QueueArchiveWriter. Throws std::runtime_error if the stream ends
+            or fails. */
+        class QueueArchiveReader
+        {
+          public:
+            explicit QueueArchiveReader(std::istream & i_stream) noexcept : m_stream(i_stream) {}
+
+            void read(void * i_dest, size_t i_size)
+            {
+                m_stream.read(static_cast<char *>(i_dest), static_cast<std::streamsize>(i_size));
+                check();
+            }
+
+            template <typename UINT> UINT read_uint()
+            {
+                UINT result;
+                read(&result, sizeof(result));
+                return result;
+            }
+
+            void check() const
+            {
+                if (!m_stream)
+                    throw std::runtime_error("heter_queue::load: unexpected end of the stream");
+            }
+
+            std::istream & stream() noexcept { return m_stream; }
+
+          private:
+            std::istream & m_stream;
+        };
+
+        /** \internal Implementation of heter_queue::save and heter_queue::load. It is defined here rather than in
+            heter_queue.h, so that only the users of save and load pay for the stream and hash map headers. */
+        template <typename QUEUE> class QueueArchive
+        {
+          public:
+            using RuntimeType = typename QUEUE::runtime_type;
+
+            template <typename REGISTRY>
+            static void save(const QUEUE & i_queue, std::ostream & i_dest, const REGISTRY & i_registry)
+            {
+                // first pass: build the type table
+                std::unordered_map<RuntimeType, uint32_t> type_indices;
+                std::vector<uint32_t>                     type_ids;
+                uint64_t                                  element_count = 0;
+                for (auto it = i_queue.cbegin(); it != i_queue.cend(); ++it)
+                {
+                    auto const insertion = type_indices.emplace(
+                      it.complete_type(), static_cast<uint32_t>(type_ids.size()));
+                    if (insertion.second)
+                    {
+                        auto const id = i_registry.find_id(it.complete_type());
+                        if (id == nullptr)
+                            throw std::invalid_argument(
+                              "heter_queue::save: the type of an element is not registered");
+                        type_ids.push_back(*id);
+                    }
+                    element_count++;
+                }
+
+                QueueArchiveWriter writer(i_dest, QUEUE::allocator_type::page_size);
+                writer.write_uint(s_queue_archive_magic);
+                writer.write_uint(s_queue_archive_version);
+                writer.write_uint(static_cast<uint32_t>(type_ids.size()));
+                for (auto id : type_ids)
+                    writer.write_uint(id);
+                writer.write_uint(element_count);
+
+                // second pass: the elements
+                for (auto it = i_queue.cbegin(); it != i_queue.cend(); ++it)
+                {
+                    writer.write_uint(type_indices.find(it.complete_type())->second);
+                    auto const & serialize = it.complete_type().template get_feature<f_serialize>();
+                    if (serialize.is_trivial())
+                        writer.write(it.element_ptr(), serialize.size());
+                    else
+                        serialize(writer.flush(), it.element_ptr());
+                }
+                writer.flush();
+            }
+
+            template <typename REGISTRY>
+            static void load(QUEUE & i_queue, std::istream & i_source, const REGISTRY & i_registry)
+            {
+                QueueArchiveReader reader(i_source);
+                if (
+                  reader.read_uint<uint32_t>() != s_queue_archive_magic ||
+                  reader.read_uint<uint32_t>() != s_queue_archive_version)
+                {
+                    throw std::runtime_error("heter_queue::load: the stream does not contain a queue");
+                }
+
+                /* the types in the table are distinct and registered, so a bigger table can only come from a
+                    corrupt stream: it is rejected before allocating it */
+                auto const type_count = reader.read_uint<uint32_t>();
+                if (type_count > i_registry.size())
+                    throw std::runtime_error("heter_queue::load: invalid type count");
+                std::vector<const RuntimeType *> types(type_count);
+                for (auto & type : types)
+                {
+                    type = i_registry.find_type(reader.read_uint<uint32_t>());
+                    if (type == nullptr)
+                        throw std::runtime_error("heter_queue::load: unknown type identifier");
+                }
+
+                // the elements are loaded in a temporary queue, that is spliced only at the end
+                QUEUE loaded(static_cast<const typename QUEUE::allocator_type &>(i_queue));
+                for (auto element_count = reader.read_uint<uint64_t>(); element_count > 0;
+                     element_count--)
+                {
+                    auto const type_index = reader.read_uint<uint32_t>();
+                    if (type_index >= types.size())
+                        throw std::runtime_error("heter_queue::load: invalid type index");
+                    auto const & type = *types[type_index];
+                    loaded.template dyn_put<0>(type, [&type, &i_source](void * i_dest) {
+                        type.template get_feature<f_deserialize>()(i_source, i_dest);
+                    });
+                    reader.check();
+                }
+                i_queue.splice_back(loaded);
+            }
+        };
+
+    } // namespace detail
+
+} // namespace density
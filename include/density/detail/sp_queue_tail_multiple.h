@@ -10,38 +10,91 @@ namespace density
 {
     namespace detail
     {
+        /** \internal Invokes a busy wait function that supports parking: it gets the number of
+            previous waits for the same lock, and returns whether the thread should park. */
+        template <typename BUSY_WAIT_FUNC>
+        auto invoke_busy_wait(BUSY_WAIT_FUNC & i_busy_wait, uint32_t i_iteration, int) noexcept
+          -> decltype(static_cast<bool>(i_busy_wait(i_iteration)))
+        {
+            return static_cast<bool>(i_busy_wait(i_iteration));
+        }
+
+        /** \internal Invokes a busy wait function with an empty parameter list, that never parks. */
+        template <typename BUSY_WAIT_FUNC>
+        bool invoke_busy_wait(BUSY_WAIT_FUNC & i_busy_wait, uint32_t, long) noexcept
+        {
+            i_busy_wait();
+            return false;
+        }
+
+        /** \internal Whether BUSY_WAIT_FUNC can be invoked with an iteration index. */
+        template <typename BUSY_WAIT_FUNC, typename = void>
+        struct BusyWaitCanPark : std::false_type
+        {
+        };
+        template <typename BUSY_WAIT_FUNC>
+        struct BusyWaitCanPark<
+          BUSY_WAIT_FUNC,
+          decltype(static_cast<void>(std::declval<BUSY_WAIT_FUNC &>()(uint32_t()) == true))>
+            : std::true_type
+        {
+        };
+
+        /** \internal Spin-locking mutex used by the tail of sp_heter_queue. If BUSY_WAIT_FUNC
+            can be invoked with an iteration index and asks to park the thread, the thread blocks
+            on the lock word (see wait_on_address). In this case unlock has to check the number of
+            parked threads, so it uses a sequentially consistent store. */
         template <typename BUSY_WAIT_FUNC> class SpinlockMutex : private BUSY_WAIT_FUNC
         {
           public:
-            SpinlockMutex() noexcept { m_lock.clear(); }
+            SpinlockMutex() noexcept = default;
 
             SpinlockMutex(BUSY_WAIT_FUNC && i_busy_wait) : BUSY_WAIT_FUNC(std::move(i_busy_wait))
             {
-                m_lock.clear();
             }
 
-            SpinlockMutex(const BUSY_WAIT_FUNC & i_busy_wait) : BUSY_WAIT_FUNC(i_busy_wait)
-            {
-                m_lock.clear();
-            }
+            SpinlockMutex(const BUSY_WAIT_FUNC & i_busy_wait) : BUSY_WAIT_FUNC(i_busy_wait) {}
 
-            bool try_lock() noexcept { return !m_lock.test_and_set(mem_acquire); }
+            bool try_lock() noexcept { return m_lock.exchange(1, mem_acquire) == 0; }
 
             void lock() noexcept
             {
                 BUSY_WAIT_FUNC & busy_wait = *this;
-                while (m_lock.test_and_set(mem_acquire))
+                uint32_t         iteration = 0;
+                while (!try_lock())
                 {
-                    busy_wait();
+                    do
+                    {
+                        if (invoke_busy_wait(busy_wait, iteration++, 0))
+                            park();
+                    } while (m_lock.load(mem_relaxed) != 0);
                 }
             }
 
-            void unlock() noexcept { m_lock.clear(mem_release); }
+            void unlock() noexcept { unlock(BusyWaitCanPark<BUSY_WAIT_FUNC>()); }
+
+            ~SpinlockMutex() { DENSITY_ASSERT_INTERNAL(m_lock.load() == 0); }
+
+          private:
+            void park() noexcept
+            {
+                m_parked.fetch_add(1, mem_seq_cst);
+                wait_on_address(m_lock, 1);
+                m_parked.fetch_sub(1, mem_relaxed);
+            }
+
+            void unlock(std::true_type) noexcept
+            {
+                m_lock.store(0, mem_seq_cst);
+                if (m_parked.load(mem_seq_cst) != 0)
+                    wake_address(m_lock);
+            }
 
-            ~SpinlockMutex() { DENSITY_ASSERT_INTERNAL(m_lock.test_and_set() == false); }
+            void unlock(std::false_type) noexcept { m_lock.store(0, mem_release); }
 
           private:
-            std::atomic_flag m_lock;
+            std::atomic<uint32_t> m_lock{0};
+            std::atomic<uint32_t> m_parked{0};
         };
 
         /** \internal Class template that implements put operations for spin-locking queues */
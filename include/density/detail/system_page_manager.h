@@ -344,6 +344,7 @@ namespace density
                 After failing with region_min_size_bytes, return nullptr. */
             static Region * create_region() noexcept
             {
+                DENSITY_INSTRUMENT_COUNT(m_region_creations);
                 Region * region = new (std::nothrow) Region;
                 if (region == nullptr)
                 {
@@ -0,0 +1,165 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <density/density_common.h>
+#include <density/dynamic_reference.h>
+#include <functional> // for std::hash
+#include <type_traits>
+
+namespace density
+{
+    namespace detail
+    {
+        /** Dispatch table used by the consume_visit functions of the heterogeneous queues. It maps
+            the runtime type of an element to a function that casts the element to its complete type
+            and invokes the visitor on it.
+
+            The table is built once for every combination of runtime type, visitor type and list of
+            visited types (see VisitDispatchTable::instance), so the cost of a dispatch does not
+            depend on the number of visited types: the runtime type is hashed with std::hash, and
+            the resulting slot is compared with the runtime type.
+            During the construction the capacity of the table is doubled until every type lands in
+            a distinct slot, so in most cases a dispatch is a single hash and a single comparison.
+            If this does not happen within s_capacity slots, collisions are resolved by linear probing.
+
+            Elements whose type is not in TYPES... are passed to the visitor as a
+            dynamic_reference<RUNTIME_TYPE>. */
+        template <typename RUNTIME_TYPE, typename VISITOR, typename... TYPES>
+        class VisitDispatchTable
+        {
+          public:
+            using Handler = void (*)(VISITOR & i_visitor, const RUNTIME_TYPE & i_type, void * i_element);
+
+            /** Returns the table associated to the template arguments. The construction is
+                thread-safe, and happens on the first call. */
+            static const VisitDispatchTable & instance()
+            {
+                static const VisitDispatchTable s_instance;
+                return s_instance;
+            }
+
+            /** Invokes the visitor on the element, with its complete type if it is one of TYPES...,
+                otherwise with a dynamic_reference. */
+            void dispatch(VISITOR & i_visitor, const RUNTIME_TYPE & i_type, void * i_element) const
+            {
+                size_t slot = slot_of(i_type, m_size_mask);
+                for (;;)
+                {
+                    Entry const & entry = m_entries[slot];
+                    if (DENSITY_LIKELY(entry.m_handler != nullptr && entry.m_type == i_type))
+                    {
+                        entry.m_handler(i_visitor, i_type, i_element);
+                        return;
+                    }
+                    if (entry.m_handler == nullptr)
+                        break;
+                    slot = (slot + 1) & m_size_mask;
+                }
+                visit_fallback(i_visitor, i_type, i_element);
+            }
+
+          private:
+            struct Entry
+            {
+                RUNTIME_TYPE m_type;
+                Handler      m_handler = nullptr;
+            };
+
+            /** Minimum power of 2 greater or equal to 2 * sizeof...(TYPES) */
+            static constexpr size_t s_min_size =
+              size_t(2) << size_log2((size_max(size_t(4), size_t(4) * sizeof...(TYPES)) - 1) / 2);
+
+            static constexpr size_t s_capacity = s_min_size * 8;
+
+            VisitDispatchTable()
+            {
+                RUNTIME_TYPE const types[] = {RUNTIME_TYPE(), RUNTIME_TYPE::template make<TYPES>()...};
+                Handler const      handlers[] = {nullptr, &invoke_visitor<TYPES>...};
+                size_t const       type_count = sizeof...(TYPES);
+
+                // search the smallest table without collisions
+                for (size_t size = s_min_size; size <= s_capacity; size *= 2)
+                {
+                    m_size_mask = size - 1;
+                    if (size == s_capacity || !has_collisions(types + 1, type_count))
+                        break;
+                }
+
+                for (size_t type_index = 1; type_index <= type_count; type_index++)
+                {
+                    size_t slot = slot_of(types[type_index], m_size_mask);
+                    while (m_entries[slot].m_handler != nullptr &&
+                           !(m_entries[slot].m_type == types[type_index]))
+                    {
+                        slot = (slot + 1) & m_size_mask;
+                    }
+                    if (m_entries[slot].m_handler == nullptr) // ignore duplicates in TYPES...
+                    {
+                        m_entries[slot].m_type    = types[type_index];
+                        m_entries[slot].m_handler = handlers[type_index];
+                    }
+                }
+            }
+
+            bool has_collisions(const RUNTIME_TYPE * i_types, size_t i_count) const noexcept
+            {
+                for (size_t first = 0; first < i_count; first++)
+                {
+                    for (size_t second = first + 1; second < i_count; second++)
+                    {
+                        if (
+                          !(i_types[first] == i_types[second]) &&
+                          slot_of(i_types[first], m_size_mask) ==
+                            slot_of(i_types[second], m_size_mask))
+                            return true;
+                    }
+                }
+                return false;
+            }
+
+            /** Fibonacci hashing, to spread the low bits of addresses, which are usually zero */
+            static size_t slot_of(const RUNTIME_TYPE & i_type, size_t i_size_mask) noexcept
+            {
+                auto const hash = static_cast<uint64_t>(std::hash<RUNTIME_TYPE>()(i_type));
+                return static_cast<size_t>((hash * 0x9E3779B97F4A7C15ull) >> 32) & i_size_mask;
+            }
+
+            template <typename TYPE>
+            static void invoke_visitor(VISITOR & i_visitor, const RUNTIME_TYPE &, void * i_element)
+            {
+                i_visitor(*static_cast<TYPE *>(i_element));
+            }
+
+            static void
+              visit_fallback(VISITOR & i_visitor, const RUNTIME_TYPE & i_type, void * i_element)
+            {
+                i_visitor(dynamic_reference<RUNTIME_TYPE>(i_type, i_element));
+            }
+
+          private:
+            size_t m_size_mask = 0;
+            Entry  m_entries[s_capacity];
+        };
+
+        template <typename RUNTIME_TYPE, typename VISITOR, typename... TYPES>
+        constexpr size_t VisitDispatchTable<RUNTIME_TYPE, VISITOR, TYPES...>::s_min_size;
+
+        template <typename RUNTIME_TYPE, typename VISITOR, typename... TYPES>
+        constexpr size_t VisitDispatchTable<RUNTIME_TYPE, VISITOR, TYPES...>::s_capacity;
+
+        /** Invokes a visitor on an element of a heterogeneous queue, using the dispatch table
+            associated to the types of the visitor and of the runtime type. */
+        template <typename... TYPES, typename RUNTIME_TYPE, typename VISITOR>
+        void visit_element(VISITOR & i_visitor, const RUNTIME_TYPE & i_type, void * i_element)
+        {
+            VisitDispatchTable<RUNTIME_TYPE, VISITOR, typename std::decay<TYPES>::type...>::
+              instance()
+                .dispatch(i_visitor, i_type, i_element);
+        }
+
+    } // namespace detail
+} // namespace density
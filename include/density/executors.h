@@ -0,0 +1,106 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <density/density_common.h>
+#include <thread>
+#include <vector>
+
+namespace density
+{
+    /** Executor that runs all the tasks in the calling thread, in order.
+
+        An executor is a callable object that can be invoked as <code>i_executor(i_task_count, i_task)</code>,
+        where i_task is a callable object that can be invoked as <code>i_task(i_index)</code>. The executor must invoke i_task
+        once for every index in the range [0, i_task_count), possibly concurrently, and must return when all the
+        invocations have returned. Executors are used by the function parallel_for_each of the queues.
+
+        \snippet heter_queue_examples.cpp heter_queue parallel_for_each example 1 */
+    class sequential_executor
+    {
+      public:
+        /** Invokes i_task for every index in [0, i_task_count). Exceptions thrown by i_task are propagated
+            to the caller, and the remaining tasks are not executed. */
+        template <typename TASK> void operator()(size_t i_task_count, const TASK & i_task) const
+        {
+            for (size_t index = 0; index < i_task_count; index++)
+                i_task(index);
+        }
+    };
+
+    /** Executor that runs the tasks on a set of threads created for every invocation. The calling thread
+        executes tasks too. The tasks are assigned to the threads dynamically, so that a thread that completes
+        a task takes the next one. See sequential_executor for the requirements of executors.
+
+        The tasks must not throw: an exception thrown by a task executed by a thread other than the calling one
+        causes a call to std::terminate. */
+    class thread_executor
+    {
+      public:
+        /** Constructs a thread_executor.
+            @param i_thread_count maximum number of threads to use, including the calling thread. If it is zero,
+                std::thread::hardware_concurrency is used. */
+        explicit thread_executor(size_t i_thread_count = 0) noexcept
+            : m_thread_count(i_thread_count != 0 ? i_thread_count : std::thread::hardware_concurrency())
+        {
+            if (m_thread_count == 0)
+                m_thread_count = 1;
+        }
+
+        /** Returns the maximum number of threads used, including the calling thread. */
+        size_t thread_count() const noexcept { return m_thread_count; }
+
+        /** Invokes i_task for every index in [0, i_task_count), using up to thread_count() threads.
+            Returns when all the tasks have been executed.
+
+            \n <b>Throws</b>: std::system_error if a thread can't be created, or std::bad_alloc. In this case no
+                other task is started, the threads already created are joined, and then the exception is
+                propagated to the caller. Some tasks may have been executed. */
+        template <typename TASK> void operator()(size_t i_task_count, const TASK & i_task) const
+        {
+            std::atomic<size_t> next_task{0};
+            auto const          worker = [&next_task, i_task_count, &i_task] {
+                for (;;)
+                {
+                    size_t const index = next_task.fetch_add(1, std::memory_order_relaxed);
+                    if (index >= i_task_count)
+                        break;
+                    i_task(index);
+                }
+            };
+
+            size_t const             thread_count = detail::size_min(m_thread_count, i_task_count);
+            std::vector<std::thread> threads;
+            if (thread_count > 1)
+            {
+                threads.reserve(thread_count - 1);
+                try
+                {
+                    for (size_t index = 1; index < thread_count; index++)
+                        threads.emplace_back(worker);
+                }
+                catch (...)
+                {
+                    // destroying a joinable std::thread would call std::terminate
+                    next_task.store(i_task_count, std::memory_order_relaxed);
+                    for (auto & thread : threads)
+                        thread.join();
+                    throw;
+                }
+            }
+
+            worker();
+
+            for (auto & thread : threads)
+                thread.join();
+        }
+
+      private:
+        size_t m_thread_count;
+    };
+
+} // namespace density
@@ -7,14 +7,22 @@
 #pragma once
 #include <density/default_allocator.h>
 #include <density/density_common.h>
+#include <density/detail/visit_dispatch.h>
 #include <density/dynamic_reference.h>
 #include <density/runtime_type.h>
+#include <iosfwd>
 #include <iterator>
+#include <utility>
+#include <vector>
 
 namespace density
 {
+    template <typename RUNTIME_TYPE> class type_registry;
+
     namespace detail
     {
+        template <typename QUEUE> class QueueArchive;
+
         struct QueueControl
         {
             uintptr_t
@@ -25,13 +33,14 @@ namespace density
         /** \internal Defines flags that can be set on QueueControl::m_next */
         enum Queue_Flags : uintptr_t
         {
-            Queue_Busy = 1, /**< if set someone is producing or consuming this value **/
+            Queue_Busy = 1, /**< if set someone is producing or consuming this value. Values being consumed
+                                    have also Queue_Dead set. **/
             Queue_Dead =
-              2, /**< if set this has not an alive, consumable element. This flag makes Queue_Busy meaningless.
-                                    Dead elements are:
+              2, /**< if set this has not an alive, consumable element. Dead elements are:
                                     - elements already consumed, or elements whose constructor threw an exception
                                     - raw allocations
-                                    - page jump elements */
+                                    - page jump elements
+                                    - elements being consumed (with Queue_Busy set too) */
             Queue_External =
               4, /**< if set the element is a ExternalBlock that points to an externally allocated element */
             Queue_AllFlags = Queue_Busy | Queue_Dead | Queue_External
@@ -185,6 +194,10 @@ namespace density
         The default allocator, that is \ref default_allocator, is designed to handle efficiently page allocations and
         deallocations.
 
+        Values that are being consumed or have been consumed can't be deallocated while there is a value in the same
+        page still being consumed. The queue keeps a pointer to the first value that may be consumable, so that consume
+        operations don't scan them. This pointer is moved back to the head only when a consume is canceled.
+
         Values are never moved by the queue, and are copied only in case of copy-construction or copy assignment
         of the queue.
 
@@ -207,6 +220,10 @@ namespace density
         /** Pointer to the tail. It is equal to s_invalid_control_block, or it is aligned to min_alignment. */
         ControlBlock * m_tail;
 
+        /** Pointer to the first value that may be consumable. All the values between m_head and m_consume_hint
+            are dead, so consumers can start searching from here. */
+        ControlBlock * m_consume_hint;
+
         /** This type is used to make some functions of the inner classes accessible only by the queue */
         enum class PrivateType
         {
@@ -214,7 +231,9 @@ namespace density
 
       public:
         /** Minimum guaranteed alignment for every element. The actual alignment of an element may be stricter
-            if the type requires it. */
+            if the type requires it. If the size of RUNTIME_TYPE is not a multiple of min_alignment (like
+            for compact_runtime_type), elements are packed after the runtime type, and they are aligned
+            only according to their type. */
         constexpr static size_t min_alignment = detail::size_max(
           detail::Queue_AllFlags + 1, alignof(ControlBlock), alignof(RUNTIME_TYPE));
 
@@ -241,10 +260,21 @@ namespace density
         constexpr static size_t s_sizeof_ControlBlock =
           uint_upper_align(sizeof(ControlBlock), min_alignment);
 
-        /** Actual space allocated for a RUNTIME_TYPE, which is forced to be aligned to min_alignment. This is
-            to avoid too many address upper-align operations. */
+        /** Whether elements are allocated right after the runtime type, without aligning them to min_alignment.
+            This happens when the runtime type is smaller than min_alignment, to save space in the pages. In this
+            case the end of every element is upper-aligned to min_alignment, so that control blocks are still
+            aligned. */
+        constexpr static bool s_packed_elements = (sizeof(RUNTIME_TYPE) % min_alignment) != 0;
+
+        /** Actual space allocated for a RUNTIME_TYPE. If elements are not packed, this is forced to be aligned
+            to min_alignment, to avoid too many address upper-align operations. */
         constexpr static size_t s_sizeof_RuntimeType =
-          uint_upper_align(sizeof(RUNTIME_TYPE), min_alignment);
+          s_packed_elements ? sizeof(RUNTIME_TYPE)
+                            : uint_upper_align(sizeof(RUNTIME_TYPE), min_alignment);
+
+        /** Offset of the ExternalBlock from the control block, for elements allocated outside the pages. */
+        constexpr static size_t s_external_block_offset =
+          uint_upper_align(s_sizeof_ControlBlock + s_sizeof_RuntimeType, alignof(void *));
 
         /** Maximum size for an element to be allocated in a page. */
         constexpr static auto s_max_size_inpage = ALLOCATOR_TYPE::page_size -
@@ -294,7 +324,8 @@ namespace density
         \snippet heter_queue_examples.cpp heter_queue default_construct example 1 */
         constexpr heter_queue() noexcept
             : m_head(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
-              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
+              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
+              m_consume_hint(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
         {
             static_assert(std::is_nothrow_default_constructible<ALLOCATOR_TYPE>::value, "");
         }
@@ -312,7 +343,8 @@ namespace density
         constexpr explicit heter_queue(const ALLOCATOR_TYPE & i_source_allocator) noexcept
             : ALLOCATOR_TYPE(i_source_allocator),
               m_head(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
-              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
+              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
+              m_consume_hint(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
         {
         }
 
@@ -329,7 +361,8 @@ namespace density
         constexpr explicit heter_queue(ALLOCATOR_TYPE && i_source_allocator) noexcept
             : ALLOCATOR_TYPE(std::move(i_source_allocator)),
               m_head(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
-              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
+              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
+              m_consume_hint(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
         {
             static_assert(std::is_nothrow_move_constructible<ALLOCATOR_TYPE>::value, "");
         }
@@ -345,11 +378,12 @@ namespace density
         \snippet heter_queue_examples.cpp heter_queue move_construct example 1 */
         heter_queue(heter_queue && i_source) noexcept
             : ALLOCATOR_TYPE(std::move(static_cast<ALLOCATOR_TYPE &&>(i_source))),
-              m_head(i_source.m_head), m_tail(i_source.m_tail)
+              m_head(i_source.m_head), m_tail(i_source.m_tail),
+              m_consume_hint(i_source.m_consume_hint)
         {
             static_assert(std::is_nothrow_move_constructible<ALLOCATOR_TYPE>::value, "");
 
-            i_source.m_tail = i_source.m_head =
+            i_source.m_consume_hint = i_source.m_tail = i_source.m_head =
               reinterpret_cast<ControlBlock *>(s_invalid_control_block);
         }
 
@@ -361,17 +395,23 @@ namespace density
             <b>Complexity</b>: linear in the number of elements of the source.
             \n <b>Throws</b>: unspecified.
             \n <b>Exception guarantee</b>: strong (in case of exception the function has no observable effects).
+            \n <i>Implementation notes</i>:
+                - If the runtime type is trivially copyable and supports the feature f_relocate, the trivially copyable
+                  elements that are contiguous in a page of the source are copied with a single memcpy.
 
             \snippet heter_queue_examples.cpp heter_queue copy_construct example 1 */
         heter_queue(const heter_queue & i_source)
             : allocator_type(static_cast<const allocator_type &>(i_source)),
               m_head(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
-              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
-        {
-            for (auto source_it = i_source.cbegin(); source_it != i_source.cend(); source_it++)
-            {
-                dyn_push_copy(source_it.complete_type(), source_it.element_ptr());
-            }
+              m_tail(reinterpret_cast<ControlBlock *>(s_invalid_control_block)),
+              m_consume_hint(reinterpret_cast<ControlBlock *>(s_invalid_control_block))
+        {
+            copy_elements(
+              i_source,
+              std::integral_constant<
+                bool,
+                detail::RuntimeTypeHasRelocate<RUNTIME_TYPE>::value &&
+                  std::is_trivially_copyable<RUNTIME_TYPE>::value>());
         }
 
         /** Move assignment. The allocator is move-assigned from the one of the source.
@@ -389,7 +429,8 @@ namespace density
         heter_queue & operator=(heter_queue && i_source) noexcept
         {
             destroy();
-            m_tail = m_head = reinterpret_cast<ControlBlock *>(s_invalid_control_block);
+            m_consume_hint = m_tail = m_head =
+              reinterpret_cast<ControlBlock *>(s_invalid_control_block);
             swap(*this, i_source);
             return *this;
         }
@@ -440,6 +481,7 @@ namespace density
             swap(static_cast<ALLOCATOR_TYPE &>(i_first), static_cast<ALLOCATOR_TYPE &>(i_second));
             swap(i_first.m_head, i_second.m_head);
             swap(i_first.m_tail, i_second.m_tail);
+            swap(i_first.m_consume_hint, i_second.m_consume_hint);
         }
 
         /** Destructor.
@@ -458,7 +500,7 @@ namespace density
         bool empty() const noexcept
         {
             // the queue may contain busy or dead elements, that must be ignored
-            for (auto curr = m_head; curr != m_tail;)
+            for (auto curr = m_consume_hint; curr != m_tail;)
             {
                 auto const control_bits = curr->m_next & (detail::Queue_Busy | detail::Queue_Dead);
                 if (control_bits == 0) // if not busy and not dead
@@ -490,6 +532,160 @@ namespace density
             clean_dead_elements();
         }
 
+        /** Invokes a function on every element of the queue, splitting the work between the tasks of an executor.
+            Every task visits the elements allocated in a page, so pages can be visited concurrently.
+                @param i_executor callable object that can be invoked as <code>i_executor(task_count, task)</code>.
+                    See sequential_executor and thread_executor.
+                @param i_func callable object that is invoked as <code>i_func(const RUNTIME_TYPE &, void *)</code>
+                    on every element. If the executor is concurrent, i_func is invoked concurrently on different elements.
+
+            Elements with a put or a consume in progress are not visited. The order in which the elements are visited
+            is unspecified. The calling thread splits the queue before starting the tasks, reading only the control
+            blocks of the elements.
+
+            \pre The behavior is undefined if either:
+                - a put or a consume operation is started or committed during the call
+                - i_func alters the queue
+
+            <b>Complexity</b>: linear.
+            \n <b>Effects on iterators</b>: no iterator is invalidated
+            \n <b>Throws</b>: std::bad_alloc, and anything thrown by the executor or by i_func.
+
+        \snippet heter_queue_examples.cpp heter_queue parallel_for_each example 1 */
+        template <typename EXECUTOR, typename FUNC>
+        void parallel_for_each(EXECUTOR && i_executor, FUNC && i_func)
+        {
+            auto const ranges = page_ranges();
+            i_executor(ranges.size(), [&ranges, &i_func](size_t i_range) {
+                for (auto curr = ranges[i_range].first; curr != ranges[i_range].second;
+                     curr      = reinterpret_cast<ControlBlock *>(curr->m_next & ~detail::Queue_AllFlags))
+                {
+                    if ((curr->m_next & (detail::Queue_Busy | detail::Queue_Dead)) == 0)
+                    {
+                        i_func(*type_after_control(curr), get_element(curr));
+                    }
+                }
+            });
+        }
+
+        /** Invokes a function on every element of the queue, splitting the work between the tasks of an executor.
+            This overload is equivalent to the non-const one, but i_func is invoked as
+            <code>i_func(const RUNTIME_TYPE &, const void *)</code>. */
+        template <typename EXECUTOR, typename FUNC>
+        void parallel_for_each(EXECUTOR && i_executor, FUNC && i_func) const
+        {
+            const_cast<heter_queue *>(this)->parallel_for_each(
+              std::forward<EXECUTOR>(i_executor),
+              [&i_func](const RUNTIME_TYPE & i_type, void * i_element) {
+                  i_func(i_type, static_cast<const void *>(i_element));
+              });
+        }
+
+        /** Moves all the elements of another queue to the end of this queue. No element is copied or moved:
+            the pages of the source queue are linked after the last page of this queue.
+                @param i_source queue to take the elements from. After the call it is empty.
+
+            \pre The behavior is undefined if either:
+                - i_source is this queue
+                - there is a non-reentrant put or a consume operation in progress on i_source
+                - the allocator of this queue can't deallocate the pages allocated by the allocator of i_source
+                    (default_allocator can always deallocate the pages allocated by another instance).
+
+            Put and consume operations in progress on this queue are not affected. Reentrant put transactions in
+            progress on i_source can still be committed or canceled: the element becomes consumable from this queue.
+
+            <b>Complexity</b>: constant.
+            \n <b>Effects on iterators</b>: any iterator pointing to i_source is invalidated. Any end iterator of this queue is invalidated.
+            \n <b>Throws</b>: Nothing.
+
+        \snippet heter_queue_examples.cpp heter_queue splice_back example 1 */
+        void splice_back(heter_queue & i_source) noexcept
+        {
+            DENSITY_ASSERT(&i_source != this);
+
+            auto const invalid_control_block =
+              reinterpret_cast<ControlBlock *>(s_invalid_control_block);
+
+            if (i_source.m_head == i_source.m_tail)
+            {
+                // the source does not contain any element, not even a dead one
+                return;
+            }
+
+            if (m_head == m_tail)
+            {
+                // this queue contains no element, so it can just adopt the pages of the source
+                if (m_head != invalid_control_block)
+                {
+                    allocator_type::deallocate_page(m_head);
+                }
+                m_head         = i_source.m_head;
+                m_consume_hint = i_source.m_consume_hint;
+            }
+            else
+            {
+                /* the tail of this queue always has room for a control block. The link to the
+                    first page of the source is a dead element, so that the current last page is
+                    deallocated as usual when the consumers go past it. */
+                auto const control_block = m_tail;
+                DENSITY_ASSUME(control_block != nullptr);
+                new (control_block) ControlBlock();
+                control_block->m_next =
+                  reinterpret_cast<uintptr_t>(i_source.m_head) + detail::Queue_Dead;
+            }
+            m_tail = i_source.m_tail;
+
+            i_source.m_consume_hint = i_source.m_tail = i_source.m_head = invalid_control_block;
+        }
+
+        /** Writes all the elements of the queue to a binary stream. The queue is not altered.
+                @param i_dest stream to write to. It should be opened in binary mode.
+                @param i_registry registry that provides a stable identifier for the type of every element.
+
+            The runtime type must support the feature f_serialize. The output starts with a table of the identifiers of the
+            types used in the queue, so every element is prefixed by a 32-bit index in the table. Elements whose type is
+            bitwise serializable are copied with memcpy in a buffer of the size of a page, and the stream is written once per
+            buffer. Other elements are written by the function density_serialize. The format uses the byte order and the
+            type sizes of the machine, so it can be read only on the same platform.
+
+            Errors of the stream are reported by the state of the stream. This function is defined in the header
+            density/type_registry.h, that must be included to use it.
+
+            \pre The behavior is undefined if a put or a consume operation is in progress
+
+            <b>Complexity</b>: linear.
+            \n <b>Throws</b>: std::invalid_argument if the type of an element is not in the registry, std::bad_alloc, and
+                anything thrown by the stream and by density_serialize.
+
+        \snippet heter_queue_examples.cpp heter_queue save example 1 */
+        void save(std::ostream & i_dest, const type_registry<RUNTIME_TYPE> & i_registry) const
+        {
+            detail::QueueArchive<heter_queue>::save(*this, i_dest, i_registry);
+        }
+
+        /** Reads from a binary stream the elements written by heter_queue::save, and adds them at the end of the queue.
+                @param i_source stream to read from. It should be opened in binary mode.
+                @param i_registry registry that provides the runtime type associated to every identifier. It may be a
+                    different object from the one used to save the queue, but it must associate the same identifiers to
+                    the same types.
+
+            The runtime type must support the feature f_deserialize. The elements are constructed directly in the pages
+            of the queue: if their type is bitwise serializable, they are read with a single call to <code>std::istream::read</code>.
+            This function is defined in the header density/type_registry.h, that must be included to use it.
+
+            <b>Complexity</b>: linear in the number of elements read.
+            \n <b>Effects on iterators</b>: Any end iterator of this queue is invalidated.
+            \n <b>Throws</b>: std::runtime_error if the stream ends or fails, or if the content is not a queue saved by
+                heter_queue::save, or if it contains a type that is not in the registry. Anything thrown by the allocator and by
+                density_deserialize.
+            \n <b>Exception guarantee</b>: strong (in case of exception the function has no observable effects).
+
+        \snippet heter_queue_examples.cpp heter_queue save example 1 */
+        void load(std::istream & i_source, const type_registry<RUNTIME_TYPE> & i_registry)
+        {
+            detail::QueueArchive<heter_queue>::load(*this, i_source, i_registry);
+        }
+
         /** Move-only class template that can be bound to a put transaction, otherwise it's empty.
 
             @tparam ELEMENT_COMPLETE_TYPE Complete type of elements that can be handled by a transaction, or void.
@@ -798,6 +994,15 @@ namespace density
                 return *type_after_control(m_put_data.m_control_block);
             }
 
+            /** \internal - private function, usable only within the library. Returns the type of the object
+                being added, that can be modified until the transaction is committed (byte_queue uses it to
+                shrink a message). */
+            RUNTIME_TYPE & mutable_complete_type() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return *type_after_control(m_put_data.m_control_block);
+            }
+
             /** If this transaction is empty the destructor has no side effects. Otherwise it cancels it.
 
                 \snippet heter_queue_examples.cpp heter_queue put_transaction destroy example 1 */
@@ -1158,6 +1363,9 @@ namespace density
 
         /** Adds at the end of the queue an element of a type known at runtime, move-constructing it from the source.
 
+            If the runtime type supports the feature f_relocate, and the target type is trivially copyable, the element
+            is copied with memcpy.
+
             @param i_type type of the new element
             @param i_source pointer to the object to use as source. If this pointer does dot point to an object whose
                 dynamic type is the the target type i_type was bound to, the behavior is undefined.
@@ -1179,6 +1387,35 @@ namespace density
             start_dyn_push_move(i_type, i_source).commit();
         }
 
+        /** Adds at the end of the queue an element of a type known at runtime, relocating it from the source:
+            the new element is move-constructed from the source, and then the source is destroyed.
+            If the runtime type supports the feature f_relocate, and the target type is trivially relocatable,
+            the element is copied with memcpy. Otherwise the element is relocated with move_construct and destroy.
+
+            @param i_type type of the new element
+            @param i_source pointer to the object to use as source. If this pointer does dot point to an object whose
+                dynamic type is the the target type i_type was bound to, the behavior is undefined. After the call
+                the source object is destroyed, unless an exception is thrown.
+
+            This function can be used to move the elements of a queue to another queue:
+
+            \snippet heter_queue_examples.cpp heter_queue dyn_push_relocate example 1
+
+            \n <b>Requires</b>:
+                - The functions <code>RUNTIME_TYPE::move_construct</code> and <code>RUNTIME_TYPE::destroy</code>
+                  must be invokable, unless the feature f_relocate is supported.
+
+            <b>Complexity</b>: constant.
+            \n <b>Effects on iterators</b>: no iterator is invalidated
+            \n <b>Throws</b>: unspecified.
+            \n <b>Exception guarantee</b>: strong (in case of exception the function has no observable effects). */
+        void dyn_push_relocate(const RUNTIME_TYPE & i_type, void * i_source)
+        {
+            dyn_put<0>(i_type, [&i_type, i_source](void * i_dest) {
+                detail::relocate_object(i_type, i_dest, i_source);
+            });
+        }
+
         /** Begins a transaction that appends an element of type <code>ELEMENT_TYPE</code>, copy-constructing
                 or move-constructing it from the source.
             \n This function allocates the required space, constructs the new element, and returns a transaction object that may be used to
@@ -1336,28 +1573,9 @@ namespace density
             \snippet heter_queue_examples.cpp heter_queue start_dyn_push_copy example 1 */
         put_transaction<> start_dyn_push_copy(const RUNTIME_TYPE & i_type, const void * i_source)
         {
-            auto push_data = inplace_allocate<0, true>(i_type.size(), i_type.alignment());
-
-            RUNTIME_TYPE * type = nullptr;
-            try
-            {
-                auto const type_storage = type_after_control(push_data.m_control_block);
-                DENSITY_ASSUME(type_storage != nullptr);
-                type = new (type_storage) RUNTIME_TYPE(i_type);
-
-                DENSITY_ASSUME(push_data.m_user_storage != nullptr);
-                i_type.copy_construct(push_data.m_user_storage, i_source);
-            }
-            catch (...)
-            {
-                if (type != nullptr)
-                    type->RUNTIME_TYPE::~RUNTIME_TYPE();
-                DENSITY_ASSERT_INTERNAL(
-                  (push_data.m_control_block->m_next & (detail::Queue_Busy | detail::Queue_Dead)) ==
-                  0);
-                push_data.m_control_block->m_next += detail::Queue_Dead;
-                throw;
-            }
+            auto const push_data = dyn_put<0>(i_type, [&i_type, i_source](void * i_dest) {
+                detail::copy_construct_object(i_type, i_dest, i_source);
+            });
 
             return put_transaction<void>(PrivateType(), this, push_data);
         }
@@ -1384,28 +1602,9 @@ namespace density
             \snippet heter_queue_examples.cpp heter_queue start_dyn_push_move example 1 */
         put_transaction<> start_dyn_push_move(const RUNTIME_TYPE & i_type, void * i_source)
         {
-            auto push_data = inplace_allocate<0, true>(i_type.size(), i_type.alignment());
-
-            RUNTIME_TYPE * type = nullptr;
-            try
-            {
-                auto const type_storage = type_after_control(push_data.m_control_block);
-                DENSITY_ASSUME(type_storage != nullptr);
-                type = new (type_storage) RUNTIME_TYPE(i_type);
-
-                DENSITY_ASSUME(push_data.m_user_storage != nullptr);
-                i_type.move_construct(push_data.m_user_storage, i_source);
-            }
-            catch (...)
-            {
-                if (type != nullptr)
-                    type->RUNTIME_TYPE::~RUNTIME_TYPE();
-                DENSITY_ASSERT_INTERNAL(
-                  (push_data.m_control_block->m_next & (detail::Queue_Busy | detail::Queue_Dead)) ==
-                  0);
-                push_data.m_control_block->m_next += detail::Queue_Dead;
-                throw;
-            }
+            auto const push_data = dyn_put<0>(i_type, [&i_type, i_source](void * i_dest) {
+                detail::move_construct_object(i_type, i_dest, i_source);
+            });
 
             return put_transaction<void>(PrivateType(), this, push_data);
         }
@@ -1476,6 +1675,28 @@ namespace density
             return i_consume.start_consume_impl(PrivateType(), this);
         }
 
+        /** Tries to consume an element, invoking a visitor on it.
+                @tparam TYPES... types of elements handled by the visitor with their complete type.
+                @param i_visitor callable object that is invoked with an lvalue reference to the element, if
+                    its type is one of TYPES..., or with a dynamic_reference<RUNTIME_TYPE> otherwise.
+            @return whether an element was consumed, that is whether the queue was not empty.
+
+            The dispatch is performed with a table mapping runtime types to functions, that is built the first
+            time this function is called with a given visitor type and TYPES..., so the cost of the dispatch is
+            constant regardless of the number of types. RUNTIME_TYPE must be hashable with std::hash.
+            If the visitor throws an exception, the consume is canceled and the element remains in the queue.
+
+            \snippet heter_queue_examples.cpp heter_queue consume_visit example 1 */
+        template <typename... TYPES, typename VISITOR> bool try_consume_visit(VISITOR && i_visitor)
+        {
+            consume_operation consume;
+            if (!try_start_consume(consume))
+                return false;
+            detail::visit_element<TYPES...>(i_visitor, consume.complete_type(), consume.element_ptr());
+            consume.commit();
+            return true;
+        }
+
 
         /** Move-only class template that can be bound to a reentrant put transaction, otherwise it's empty.
 
@@ -2210,29 +2431,10 @@ namespace density
         reentrant_put_transaction<>
           start_reentrant_dyn_push_copy(const RUNTIME_TYPE & i_type, const void * i_source)
         {
-            auto push_data =
-              inplace_allocate<detail::Queue_Busy, true>(i_type.size(), i_type.alignment());
-
-            RUNTIME_TYPE * type = nullptr;
-            try
-            {
-                auto const type_storage = type_after_control(push_data.m_control_block);
-                DENSITY_ASSUME(type_storage != nullptr);
-                type = new (type_storage) RUNTIME_TYPE(i_type);
-
-                DENSITY_ASSUME(push_data.m_user_storage != nullptr);
-                i_type.copy_construct(push_data.m_user_storage, i_source);
-            }
-            catch (...)
-            {
-                if (type != nullptr)
-                    type->RUNTIME_TYPE::~RUNTIME_TYPE();
-                DENSITY_ASSERT_INTERNAL(
-                  (push_data.m_control_block->m_next & (detail::Queue_Busy | detail::Queue_Dead)) ==
-                  detail::Queue_Busy);
-                push_data.m_control_block->m_next += detail::Queue_Dead - detail::Queue_Busy;
-                throw;
-            }
+            auto const push_data = dyn_put<detail::Queue_Busy>(
+              i_type, [&i_type, i_source](void * i_dest) {
+                  detail::copy_construct_object(i_type, i_dest, i_source);
+              });
 
             return reentrant_put_transaction<void>(PrivateType(), this, push_data);
         }
@@ -2245,29 +2447,10 @@ namespace density
         reentrant_put_transaction<>
           start_reentrant_dyn_push_move(const RUNTIME_TYPE & i_type, void * i_source)
         {
-            auto push_data =
-              inplace_allocate<detail::Queue_Busy, true>(i_type.size(), i_type.alignment());
-
-            RUNTIME_TYPE * type = nullptr;
-            try
-            {
-                auto const type_storage = type_after_control(push_data.m_control_block);
-                DENSITY_ASSUME(type_storage != nullptr);
-                type = new (type_storage) RUNTIME_TYPE(i_type);
-
-                DENSITY_ASSUME(push_data.m_user_storage != nullptr);
-                i_type.move_construct(push_data.m_user_storage, i_source);
-            }
-            catch (...)
-            {
-                if (type != nullptr)
-                    type->RUNTIME_TYPE::~RUNTIME_TYPE();
-                DENSITY_ASSERT_INTERNAL(
-                  (push_data.m_control_block->m_next & (detail::Queue_Busy | detail::Queue_Dead)) ==
-                  detail::Queue_Busy);
-                push_data.m_control_block->m_next += detail::Queue_Dead - detail::Queue_Busy;
-                throw;
-            }
+            auto const push_data = dyn_put<detail::Queue_Busy>(
+              i_type, [&i_type, i_source](void * i_dest) {
+                  detail::move_construct_object(i_type, i_dest, i_source);
+              });
 
             return reentrant_put_transaction<void>(PrivateType(), this, push_data);
         }
@@ -2553,13 +2736,13 @@ namespace density
             } m_value;
         };
 
-        iterator begin() noexcept { return iterator(this, first_valid(m_head)); }
+        iterator begin() noexcept { return iterator(this, first_valid(m_consume_hint)); }
         iterator end() noexcept { return iterator(); }
 
-        const_iterator begin() const noexcept { return const_iterator(this, first_valid(m_head)); }
+        const_iterator begin() const noexcept { return const_iterator(this, first_valid(m_consume_hint)); }
         const_iterator end() const noexcept { return const_iterator(); }
 
-        const_iterator cbegin() const noexcept { return const_iterator(this, first_valid(m_head)); }
+        const_iterator cbegin() const noexcept { return const_iterator(this, first_valid(m_consume_hint)); }
         const_iterator cend() const noexcept { return const_iterator(); }
 
         /** Returns whether this queue and another queue compare equal.
@@ -2612,6 +2795,118 @@ namespace density
         bool operator!=(const heter_queue & i_source) const { return !operator==(i_source); }
 
       private:
+        template <typename QUEUE> friend class detail::QueueArchive;
+
+        /** Allocates an element with its runtime type, and constructs it with i_construct(storage).
+            If the construction throws, the element is left dead. Used by the dynamic puts and by load. */
+        template <uintptr_t CONTROL_BITS, typename CONSTRUCT>
+        Allocation dyn_put(const RUNTIME_TYPE & i_type, CONSTRUCT && i_construct)
+        {
+            auto push_data =
+              inplace_allocate<CONTROL_BITS, true>(i_type.size(), i_type.alignment());
+
+            RUNTIME_TYPE * type = nullptr;
+            try
+            {
+                auto const type_storage = type_after_control(push_data.m_control_block);
+                DENSITY_ASSUME(type_storage != nullptr);
+                type = new (type_storage) RUNTIME_TYPE(i_type);
+
+                DENSITY_ASSUME(push_data.m_user_storage != nullptr);
+                i_construct(push_data.m_user_storage);
+            }
+            catch (...)
+            {
+                if (type != nullptr)
+                    type->RUNTIME_TYPE::~RUNTIME_TYPE();
+                DENSITY_ASSERT_INTERNAL(
+                  (push_data.m_control_block->m_next & (detail::Queue_Busy | detail::Queue_Dead)) ==
+                  CONTROL_BITS);
+                push_data.m_control_block->m_next += detail::Queue_Dead - CONTROL_BITS;
+                throw;
+            }
+            return push_data;
+        }
+
+        /** Appends a copy of all the elements of the source, one at a time. */
+        void copy_elements(const heter_queue & i_source, std::false_type)
+        {
+            for (auto source_it = i_source.cbegin(); source_it != i_source.cend(); source_it++)
+            {
+                dyn_push_copy(source_it.complete_type(), source_it.element_ptr());
+            }
+        }
+
+        /** Appends a copy of all the elements of the source. The runs of trivially copyable elements that are
+            contiguous in a page of the source are copied with a single memcpy, and then their links are
+            adjusted. Other elements are copied one at a time. */
+        void copy_elements(const heter_queue & i_source, std::true_type)
+        {
+            ControlBlock * run_begin = nullptr;
+            ControlBlock * run_end   = nullptr;
+            for (auto curr = i_source.m_head; curr != i_source.m_tail;)
+            {
+                auto const next =
+                  reinterpret_cast<ControlBlock *>(curr->m_next & ~detail::Queue_AllFlags);
+                if ((curr->m_next & detail::Queue_AllFlags) == 0)
+                {
+                    auto const & type = *type_after_control(curr);
+                    if (detail::is_trivially_copyable_object(type))
+                    {
+                        if (m_tail == reinterpret_cast<ControlBlock *>(s_invalid_control_block))
+                            allocate_new_page();
+
+                        // the element keeps its layout if the offset to the source preserves its alignment
+                        auto const begin  = run_begin != nullptr ? run_begin : curr;
+                        auto const offset = reinterpret_cast<uintptr_t>(m_tail) -
+                                            reinterpret_cast<uintptr_t>(begin);
+                        if (uint_is_aligned(offset, static_cast<uintptr_t>(type.alignment())) &&
+                            address_add(m_tail, address_diff(next, begin)) <=
+                              get_end_of_page(m_tail))
+                        {
+                            run_begin = begin;
+                            run_end   = next;
+                            curr      = next;
+                            continue;
+                        }
+                    }
+                }
+
+                // curr is not part of the run
+                if (run_begin != nullptr)
+                {
+                    copy_run(run_begin, run_end);
+                    run_begin = nullptr;
+                }
+                if ((curr->m_next & (detail::Queue_Busy | detail::Queue_Dead)) == 0)
+                {
+                    dyn_push_copy(*type_after_control(curr), get_element(curr));
+                }
+                curr = next;
+            }
+            if (run_begin != nullptr)
+                copy_run(run_begin, run_end);
+        }
+
+        /** Copies the elements [i_begin, i_end) of a page of another queue to the tail, which must have
+            enough space. */
+        void copy_run(ControlBlock * i_begin, ControlBlock * i_end) noexcept
+        {
+            auto const size = address_diff(i_end, i_begin);
+            DENSITY_ASSERT_INTERNAL(address_add(m_tail, size) <= get_end_of_page(m_tail));
+            std::memcpy(m_tail, i_begin, size);
+
+            auto const offset =
+              reinterpret_cast<uintptr_t>(m_tail) - reinterpret_cast<uintptr_t>(i_begin);
+            auto const end    = static_cast<ControlBlock *>(address_add(m_tail, size));
+            for (auto curr = m_tail; curr != end;)
+            {
+                curr->m_next += offset;
+                curr = reinterpret_cast<ControlBlock *>(curr->m_next);
+            }
+            m_tail = end;
+        }
+
         ControlBlock * first_valid(ControlBlock * i_from) const
         {
             for (auto curr = i_from; curr != m_tail;)
@@ -2629,7 +2924,7 @@ namespace density
         {
             DENSITY_ASSUME(i_from != m_tail);
             for (auto curr =
-                   reinterpret_cast<ControlBlock *>(i_from->m_next & ~static_cast<uintptr_t>(3));
+                   reinterpret_cast<ControlBlock *>(i_from->m_next & ~detail::Queue_AllFlags);
                  curr != m_tail;)
             {
                 if ((curr->m_next & (detail::Queue_Busy | detail::Queue_Dead)) == 0)
@@ -2641,6 +2936,29 @@ namespace density
             return nullptr;
         }
 
+        /** Splits the queue in ranges of control blocks [first, second) that do not cross page boundaries.
+            Ranges that do not contain live elements are omitted. Used by parallel_for_each. */
+        std::vector<std::pair<ControlBlock *, ControlBlock *>> page_ranges() const
+        {
+            std::vector<std::pair<ControlBlock *, ControlBlock *>> ranges;
+            ControlBlock *                                         range_begin = m_consume_hint;
+            bool                                                   has_live    = false;
+            for (auto curr = m_consume_hint; curr != m_tail;)
+            {
+                has_live = has_live || (curr->m_next & (detail::Queue_Busy | detail::Queue_Dead)) == 0;
+                auto const next = reinterpret_cast<ControlBlock *>(curr->m_next & ~detail::Queue_AllFlags);
+                if (next == m_tail || !same_page(curr, next))
+                {
+                    if (has_live)
+                        ranges.emplace_back(range_begin, next);
+                    range_begin = next;
+                    has_live    = false;
+                }
+                curr = next;
+            }
+            return ranges;
+        }
+
         static RUNTIME_TYPE * type_after_control(ControlBlock * i_control) noexcept
         {
             return reinterpret_cast<RUNTIME_TYPE *>(address_add(i_control, s_sizeof_ControlBlock));
@@ -2648,26 +2966,24 @@ namespace density
 
         static void * get_unaligned_element(ControlBlock * i_control) noexcept
         {
-            auto result = address_add(i_control, s_sizeof_ControlBlock + s_sizeof_RuntimeType);
             if (i_control->m_next & detail::Queue_External)
             {
-                result = static_cast<ExternalBlock *>(result)->m_element;
+                return static_cast<ExternalBlock *>(address_add(i_control, s_external_block_offset))
+                  ->m_element;
             }
-            return result;
+            return address_add(i_control, s_sizeof_ControlBlock + s_sizeof_RuntimeType);
         }
 
         static void * get_element(detail::QueueControl * i_control) noexcept
         {
-            auto result = address_add(i_control, s_sizeof_ControlBlock + s_sizeof_RuntimeType);
             if (i_control->m_next & detail::Queue_External)
             {
-                result = static_cast<ExternalBlock *>(result)->m_element;
-            }
-            else
-            {
-                result = address_upper_align(result, type_after_control(i_control)->alignment());
+                return static_cast<ExternalBlock *>(address_add(i_control, s_external_block_offset))
+                  ->m_element;
             }
-            return result;
+            return address_upper_align(
+              address_add(i_control, s_sizeof_ControlBlock + s_sizeof_RuntimeType),
+              type_after_control(i_control)->alignment());
         }
 
         /** Returns whether the input addresses belong to the same page or they are both nullptr */
@@ -2699,7 +3015,7 @@ namespace density
         {
             DENSITY_ASSERT_INTERNAL(is_power_of_2(i_alignment) && (i_size % i_alignment) == 0);
 
-            if (i_alignment < min_alignment)
+            if (!s_packed_elements && i_alignment < min_alignment)
             {
                 i_alignment = min_alignment;
                 i_size      = uint_upper_align(i_size, min_alignment);
@@ -2722,6 +3038,10 @@ namespace density
                 new_tail                  = address_upper_align(new_tail, i_alignment);
                 void * const user_storage = new_tail;
                 new_tail                  = address_add(new_tail, i_size);
+                if (s_packed_elements)
+                {
+                    new_tail = address_upper_align(new_tail, min_alignment);
+                }
 
                 // check if a page overflow would occur
                 void * end_of_page = get_end_of_page(control_block);
@@ -2735,8 +3055,10 @@ namespace density
                     return Allocation{control_block, user_storage};
                 }
                 else if (
-                  i_size + (i_alignment - min_alignment) <=
-                  s_max_size_inpage) // if this allocation may fit in a page
+                  s_packed_elements
+                    ? i_size + i_alignment + min_alignment <= s_max_size_inpage
+                    : i_size + (i_alignment - min_alignment) <=
+                        s_max_size_inpage) // if this allocation may fit in a page
                 {
                     // allocate a new page and redo
                     allocate_new_page();
@@ -2759,20 +3081,22 @@ namespace density
               address_is_aligned(m_tail, min_alignment) ||
               m_tail == reinterpret_cast<ControlBlock *>(s_invalid_control_block));
 
-            constexpr size_t alignment = detail::size_max(ALIGNMENT, min_alignment);
-            constexpr size_t size      = uint_upper_align(SIZE, alignment);
+            constexpr size_t alignment =
+              s_packed_elements ? ALIGNMENT : detail::size_max(ALIGNMENT, min_alignment);
+            constexpr size_t size = uint_upper_align(SIZE, alignment);
             constexpr bool   can_fit_in_a_page =
-              size + (alignment - min_alignment) <= s_max_size_inpage;
-            constexpr bool over_aligned = alignment > min_alignment;
+              s_packed_elements ? size + alignment + min_alignment <= s_max_size_inpage
+                                : size + (alignment - min_alignment) <= s_max_size_inpage;
+            constexpr size_t header_size =
+              INCLUDE_TYPE ? (s_sizeof_ControlBlock + s_sizeof_RuntimeType) : s_sizeof_ControlBlock;
+            constexpr bool over_aligned = alignment > min_alignment || (header_size % alignment) != 0;
+            constexpr bool unaligned_end = s_packed_elements && ((header_size + size) % min_alignment) != 0;
 
             for (;;)
             {
                 // allocate space for the control block and the runtime type
                 auto const control_block = m_tail;
-                void *     new_tail      = address_add(
-                  control_block,
-                  INCLUDE_TYPE ? (s_sizeof_ControlBlock + s_sizeof_RuntimeType)
-                               : s_sizeof_ControlBlock);
+                void *     new_tail      = address_add(control_block, header_size);
 
                 // allocate space for the element
                 if (over_aligned)
@@ -2780,10 +3104,14 @@ namespace density
                     new_tail = address_upper_align(new_tail, alignment);
                 }
                 DENSITY_ASSERT_INTERNAL(
-                  address_is_aligned(new_tail, min_alignment) ||
+                  address_is_aligned(new_tail, s_packed_elements ? alignment : min_alignment) ||
                   m_tail == reinterpret_cast<ControlBlock *>(s_invalid_control_block));
                 void * new_element = new_tail;
                 new_tail           = address_add(new_tail, size);
+                if (unaligned_end)
+                {
+                    new_tail = address_upper_align(new_tail, min_alignment);
+                }
 
                 // check if a page overflow would occur
                 void * end_of_page = get_end_of_page(control_block);
@@ -2812,6 +3140,7 @@ namespace density
         template <uintptr_t CONTROL_BITS>
         Allocation external_allocate(size_t i_size, size_t i_alignment)
         {
+            DENSITY_INSTRUMENT_COUNT(m_external_allocations);
             auto const external_block = ALLOCATOR_TYPE::allocate(i_size, i_alignment);
             try
             {
@@ -2853,7 +3182,8 @@ namespace density
             else
             {
                 // this happens only on a virgin queue
-                m_tail = m_head = static_cast<ControlBlock *>(allocator_type::allocate_page());
+                m_consume_hint = m_tail = m_head =
+                  static_cast<ControlBlock *>(allocator_type::allocate_page());
             }
         }
 
@@ -2892,17 +3222,29 @@ namespace density
 
         ControlBlock * start_consume_impl() noexcept
         {
-            auto       curr = m_head;
-            auto const tail = m_tail;
+            /* The hint is moved forward as long as the scanned values are dead. It can't skip a value
+                being put, because a reentrant put is committed without notifying the queue. */
+            auto       curr         = m_consume_hint;
+            auto const tail         = m_tail;
+            bool       advance_hint = true;
             while (curr != tail)
             {
-                if ((curr->m_next & (detail::Queue_Busy | detail::Queue_Dead)) == 0)
-                {
-                    curr->m_next += detail::Queue_Busy;
+                auto const next =
+                  reinterpret_cast<ControlBlock *>(curr->m_next & ~detail::Queue_AllFlags);
+
+                bool const consumable =
+                  (curr->m_next & (detail::Queue_Busy | detail::Queue_Dead)) == 0;
+                if (consumable)
+                    curr->m_next += detail::Queue_Busy | detail::Queue_Dead;
+
+                advance_hint = advance_hint && (curr->m_next & detail::Queue_Dead) != 0;
+                if (advance_hint)
+                    m_consume_hint = next;
+
+                if (consumable)
                     return curr;
-                }
 
-                curr = reinterpret_cast<ControlBlock *>(curr->m_next & ~detail::Queue_AllFlags);
+                curr = next;
             }
 
             return nullptr;
@@ -2912,15 +3254,16 @@ namespace density
         {
             DENSITY_ASSERT_INTERNAL(
               (i_control_block->m_next & (detail::Queue_Busy | detail::Queue_Dead)) ==
-              detail::Queue_Busy);
-            i_control_block->m_next += (detail::Queue_Dead - detail::Queue_Busy);
+              (detail::Queue_Busy | detail::Queue_Dead));
+            i_control_block->m_next -= detail::Queue_Busy;
 
             clean_dead_elements();
         }
 
         void clean_dead_elements() noexcept
         {
-            auto curr = m_head;
+            auto curr        = m_head;
+            bool hint_passed = false;
             while (curr != m_tail)
             {
                 // break if the current block is busy or is not dead
@@ -2930,11 +3273,13 @@ namespace density
                     break;
                 }
 
+                hint_passed = hint_passed || curr == m_consume_hint;
+
                 auto next =
                   reinterpret_cast<ControlBlock *>(curr->m_next & ~detail::Queue_AllFlags);
                 if (curr->m_next & detail::Queue_External)
                 {
-                    auto result = address_add(curr, s_sizeof_ControlBlock + s_sizeof_RuntimeType);
+                    auto result = address_add(curr, s_external_block_offset);
                     const auto & block = *static_cast<ExternalBlock *>(result);
                     ALLOCATOR_TYPE::deallocate(block.m_element, block.m_size, block.m_alignment);
                 }
@@ -2951,14 +3296,20 @@ namespace density
               curr == m_tail ||
               (curr->m_next & (detail::Queue_Busy | detail::Queue_Dead)) != detail::Queue_Dead);
             m_head = curr;
+            if (hint_passed)
+                m_consume_hint = curr;
         }
 
         void cancel_consume_impl(ControlBlock * i_control_block) noexcept
         {
             DENSITY_ASSERT_INTERNAL(
               (i_control_block->m_next & (detail::Queue_AllFlags - detail::Queue_External)) ==
-              detail::Queue_Busy);
-            i_control_block->m_next -= detail::Queue_Busy;
+              (detail::Queue_Busy | detail::Queue_Dead));
+            i_control_block->m_next -= detail::Queue_Busy | detail::Queue_Dead;
+
+            /* the value is consumable again. Its position relative to the hint is not known,
+                so consumers have to start again from the head */
+            m_consume_hint = m_head;
         }
 
         void destroy() noexcept
@@ -8,8 +8,13 @@
 #include <density/density_common.h>
 #include <density/dynamic_reference.h>
 #include <density/runtime_type.h>
+#include <cstdint>
 #include <istream>
+#include <new>
 #include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 namespace density
 {
@@ -115,4 +120,242 @@ namespace density
         return i_dest_stream;
     }
 
+    /** Traits that tells whether an object of type TYPE can be serialized by f_serialize and f_deserialize by
+        copying its bytes. The default is true for trivially copyable types that are not pointers. Users can specialize
+        this template to false for trivially copyable types that contain pointers or handles: such types are serialized
+        with the functions density_serialize and density_deserialize, like the types that are not trivially copyable. */
+    template <typename TYPE>
+    struct is_bitwise_serializable
+        : std::integral_constant<
+            bool,
+            std::is_trivially_copyable<TYPE>::value && !std::is_pointer<TYPE>::value>
+    {
+    };
+
+    template <typename CHAR, typename TRAITS, typename ALLOCATOR>
+    void density_serialize(
+      std::ostream & i_ostream, const std::basic_string<CHAR, TRAITS, ALLOCATOR> & i_source);
+
+    template <typename CHAR, typename TRAITS, typename ALLOCATOR>
+    void density_deserialize(
+      std::istream & i_istream, std::basic_string<CHAR, TRAITS, ALLOCATOR> & i_dest);
+
+    template <typename TYPE, typename ALLOCATOR>
+    void density_serialize(std::ostream & i_ostream, const std::vector<TYPE, ALLOCATOR> & i_source);
+
+    template <typename TYPE, typename ALLOCATOR>
+    void density_deserialize(std::istream & i_istream, std::vector<TYPE, ALLOCATOR> & i_dest);
+
+    namespace detail
+    {
+        /** \internal Writes an object in binary format, copying its bytes if it is bitwise serializable, or
+            using density_serialize (found with ADL) otherwise. */
+        template <typename TYPE>
+        void serialize_object(std::ostream & i_ostream, const TYPE & i_source, std::true_type)
+        {
+            i_ostream.write(reinterpret_cast<const char *>(&i_source), sizeof(TYPE));
+        }
+
+        template <typename TYPE>
+        void serialize_object(std::ostream & i_ostream, const TYPE & i_source, std::false_type)
+        {
+            density_serialize(i_ostream, i_source);
+        }
+
+        template <typename TYPE>
+        void deserialize_object(std::istream & i_istream, TYPE & i_dest, std::true_type)
+        {
+            i_istream.read(reinterpret_cast<char *>(&i_dest), sizeof(TYPE));
+        }
+
+        template <typename TYPE>
+        void deserialize_object(std::istream & i_istream, TYPE & i_dest, std::false_type)
+        {
+            density_deserialize(i_istream, i_dest);
+        }
+
+        /** \internal Reads the length prefix of a sequence. Sets the failbit if the stream ends. */
+        inline uint64_t deserialize_length(std::istream & i_istream)
+        {
+            uint64_t length = 0;
+            i_istream.read(reinterpret_cast<char *>(&length), sizeof(length));
+            return i_istream ? length : 0;
+        }
+    } // namespace detail
+
+    /** Writes a string in binary format: the length is followed by the characters. */
+    template <typename CHAR, typename TRAITS, typename ALLOCATOR>
+    void density_serialize(
+      std::ostream & i_ostream, const std::basic_string<CHAR, TRAITS, ALLOCATOR> & i_source)
+    {
+        static_assert(is_bitwise_serializable<CHAR>::value, "unsupported character type");
+        uint64_t const length = i_source.size();
+        i_ostream.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        i_ostream.write(
+          reinterpret_cast<const char *>(i_source.data()),
+          static_cast<std::streamsize>(length * sizeof(CHAR)));
+    }
+
+    /** Reads a string written by density_serialize. */
+    template <typename CHAR, typename TRAITS, typename ALLOCATOR>
+    void density_deserialize(
+      std::istream & i_istream, std::basic_string<CHAR, TRAITS, ALLOCATOR> & i_dest)
+    {
+        static_assert(is_bitwise_serializable<CHAR>::value, "unsupported character type");
+        i_dest.resize(static_cast<size_t>(detail::deserialize_length(i_istream)));
+        if (!i_dest.empty())
+            i_istream.read(
+              reinterpret_cast<char *>(&i_dest[0]),
+              static_cast<std::streamsize>(i_dest.size() * sizeof(CHAR)));
+    }
+
+    /** Writes a vector in binary format: the length is followed by the elements. */
+    template <typename TYPE, typename ALLOCATOR>
+    void density_serialize(std::ostream & i_ostream, const std::vector<TYPE, ALLOCATOR> & i_source)
+    {
+        uint64_t const length = i_source.size();
+        i_ostream.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        for (auto const & element : i_source)
+            detail::serialize_object(i_ostream, element, is_bitwise_serializable<TYPE>());
+    }
+
+    /** Reads a vector written by density_serialize. The elements must be default constructible. */
+    template <typename TYPE, typename ALLOCATOR>
+    void density_deserialize(std::istream & i_istream, std::vector<TYPE, ALLOCATOR> & i_dest)
+    {
+        auto const length = detail::deserialize_length(i_istream);
+        i_dest.clear();
+        for (uint64_t index = 0; index < length && i_istream; index++)
+        {
+            i_dest.emplace_back();
+            detail::deserialize_object(i_istream, i_dest.back(), is_bitwise_serializable<TYPE>());
+        }
+    }
+
+    /** This feature writes an object to an std::ostream in a compact binary format. If is_bitwise_serializable
+        is true for the target type, the bytes of the object are written. Otherwise the function
+        <code>density_serialize(std::ostream &, const TARGET_TYPE &)</code> is invoked, and it is found with
+        argument-dependent lookup. density provides overloads of density_serialize for std::basic_string
+        and std::vector.
+
+        The format depends on the architecture, and it is not intended to be exchanged between
+        different platforms. See heter_queue::save.
+
+        \snippet heter_queue_examples.cpp heter_queue save example 2 */
+    class f_serialize
+    {
+      public:
+        /** Creates an instance of this feature bound to the specified target type */
+        template <typename TARGET_TYPE> constexpr static f_serialize make() noexcept
+        {
+            return f_serialize{
+              function<TARGET_TYPE>(is_bitwise_serializable<TARGET_TYPE>()), sizeof(TARGET_TYPE)};
+        }
+
+        /** Writes the target object to an output stream.
+            @param i_source pointer to an instance of the target type. Can't be null.
+                If the dynamic type of the pointed object is not the target type (assigned
+                by the function make), the behavior is undefined. */
+        void operator()(std::ostream & i_ostream, const void * i_source) const
+        {
+            DENSITY_ASSUME(i_source != nullptr);
+            if (m_function == nullptr)
+                i_ostream.write(static_cast<const char *>(i_source), static_cast<std::streamsize>(m_size));
+            else
+                (*m_function)(i_ostream, i_source);
+        }
+
+        /** Returns whether the target type is bitwise serializable. */
+        constexpr bool is_trivial() const noexcept { return m_function == nullptr; }
+
+        /** Returns the size of the target type. */
+        constexpr size_t size() const noexcept { return m_size; }
+
+      private:
+        using Function = void (*)(std::ostream & i_ostream, const void * i_source);
+        Function const m_function;
+        size_t const   m_size;
+        constexpr f_serialize(Function i_function, size_t i_size) noexcept
+            : m_function(i_function), m_size(i_size)
+        {
+        }
+        template <typename TARGET_TYPE> constexpr static Function function(std::true_type) noexcept
+        {
+            return nullptr;
+        }
+        template <typename TARGET_TYPE> constexpr static Function function(std::false_type) noexcept
+        {
+            return &invoke<TARGET_TYPE>;
+        }
+        template <typename TARGET_TYPE>
+        static void invoke(std::ostream & i_ostream, const void * i_source)
+        {
+            detail::serialize_object(
+              i_ostream, *static_cast<const TARGET_TYPE *>(i_source), std::false_type());
+        }
+    };
+
+    /** This feature constructs an object reading it from an std::istream, in the format written by f_serialize.
+        If is_bitwise_serializable is false for the target type, the object is default constructed, and then the function
+        <code>density_deserialize(std::istream &, TARGET_TYPE &)</code> is invoked. It is found with argument-dependent lookup.
+
+        \snippet heter_queue_examples.cpp heter_queue save example 2 */
+    class f_deserialize
+    {
+      public:
+        /** Creates an instance of this feature bound to the specified target type */
+        template <typename TARGET_TYPE> constexpr static f_deserialize make() noexcept
+        {
+            return f_deserialize{
+              function<TARGET_TYPE>(is_bitwise_serializable<TARGET_TYPE>()), sizeof(TARGET_TYPE)};
+        }
+
+        /** Constructs an instance of the target type, reading it from an input stream. If the stream fails,
+            the object is constructed anyway, and its value is unspecified.
+            @param i_dest where the target object must be constructed. Can't be null. If the buffer
+                pointed by this parameter does not respect the size and alignment of the target type,
+                the behavior is undefined. */
+        void operator()(std::istream & i_istream, void * i_dest) const
+        {
+            DENSITY_ASSUME(i_dest != nullptr);
+            if (m_function == nullptr)
+                i_istream.read(static_cast<char *>(i_dest), static_cast<std::streamsize>(m_size));
+            else
+                (*m_function)(i_istream, i_dest);
+        }
+
+        /** Returns whether the target type is bitwise serializable. */
+        constexpr bool is_trivial() const noexcept { return m_function == nullptr; }
+
+      private:
+        using Function = void (*)(std::istream & i_istream, void * i_dest);
+        Function const m_function;
+        size_t const   m_size;
+        constexpr f_deserialize(Function i_function, size_t i_size) noexcept
+            : m_function(i_function), m_size(i_size)
+        {
+        }
+        template <typename TARGET_TYPE> constexpr static Function function(std::true_type) noexcept
+        {
+            return nullptr;
+        }
+        template <typename TARGET_TYPE> constexpr static Function function(std::false_type) noexcept
+        {
+            return &invoke<TARGET_TYPE>;
+        }
+        template <typename TARGET_TYPE> static void invoke(std::istream & i_istream, void * i_dest)
+        {
+            auto const object = new (i_dest) TARGET_TYPE();
+            try
+            {
+                detail::deserialize_object(i_istream, *object, std::false_type());
+            }
+            catch (...)
+            {
+                object->TARGET_TYPE::~TARGET_TYPE();
+                throw;
+            }
+        }
+    };
+
 } // namespace density
@@ -0,0 +1,279 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <density/detail/byte_runtime_type.h>
+#include <density/lf_heter_queue.h>
+
+namespace density
+{
+    /** Concurrent FIFO pseudo-container of byte messages. lf_byte_queue is an adaptor for lf_heter_queue.
+
+        @tparam ALLOCATOR_TYPE Allocator type to be used. This type must satisfy the requirements of both \ref UntypedAllocator_requirements
+                "UntypedAllocator" and \ref PagedAllocator_requirements "PagedAllocator". The default is density::default_allocator.
+        @tparam PROD_CARDINALITY specifies whether multiple threads can do put transactions concurrently. Must be a member of density::concurrency_cardinality.
+        @tparam CONSUMER_CARDINALITY specifies whether multiple threads can do consume operations concurrently. Must be a member of density::concurrency_cardinality.
+        @tparam CONSISTENCY_MODEL Specifies whether the queue is linearizable. Must be a member of density::consistency_model.
+
+        See byte_queue for a description of byte messages. In addition to the functions of byte_queue, lf_byte_queue provides
+        try_reserve and try_push, that don't throw in case of failure allocating memory, and allow to specify a progress guarantee.
+        A thread can receive network payloads directly in the pages of the queue, while other threads parse them in place:
+
+        \snippet byte_queue_examples.cpp lf_byte_queue reserve example 1
+
+        \n <b>Thread safeness</b>: A thread doing put operations and another thread doing consumes don't need to be synchronized.
+                If PROD_CARDINALITY is concurrency_multiple, multiple threads are allowed to put without any synchronization.
+                If CONSUMER_CARDINALITY is concurrency_multiple, multiple threads are allowed to consume without any synchronization.
+        \n <b>Exception safeness</b>: Any function of lf_byte_queue is noexcept or provides the strong exception guarantee.
+    */
+    template <
+      typename ALLOCATOR_TYPE                      = default_allocator,
+      concurrency_cardinality PROD_CARDINALITY     = concurrency_multiple,
+      concurrency_cardinality CONSUMER_CARDINALITY = concurrency_multiple,
+      consistency_model       CONSISTENCY_MODEL    = consistency_sequential>
+    class lf_byte_queue
+    {
+      private:
+        using UnderlyingQueue = lf_heter_queue<
+          detail::ByteRuntimeType,
+          ALLOCATOR_TYPE,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          CONSISTENCY_MODEL>;
+        UnderlyingQueue m_queue;
+
+      public:
+        /** Whether multiple threads can do put operations on the same queue without any further synchronization. */
+        static constexpr bool concurrent_puts = PROD_CARDINALITY == concurrency_multiple;
+
+        /** Whether multiple threads can do consume operations on the same queue without any further synchronization. */
+        static constexpr bool concurrent_consumes = CONSUMER_CARDINALITY == concurrency_multiple;
+
+        /** Whether puts and consumes can be done concurrently without any further synchronization. In any case unsynchronized concurrency is
+            constrained by concurrent_puts and concurrent_consumes. */
+        static constexpr bool concurrent_put_consumes = true;
+
+        /** Whether this queue is sequential consistent. */
+        static constexpr bool is_seq_cst = CONSISTENCY_MODEL == consistency_sequential;
+
+        /** Alignment of the first byte of every message. */
+        static constexpr size_t message_alignment = detail::ByteRuntimeType::s_message_alignment;
+
+        /** Default constructor. */
+        lf_byte_queue() noexcept = default;
+
+        /** Move constructor. */
+        lf_byte_queue(lf_byte_queue && i_source) noexcept = default;
+
+        /** Move assignment. */
+        lf_byte_queue & operator=(lf_byte_queue && i_source) noexcept = default;
+
+        /** Swaps two byte queues. */
+        friend void swap(lf_byte_queue & i_first, lf_byte_queue & i_second) noexcept
+        {
+            using std::swap;
+            swap(i_first.m_queue, i_second.m_queue);
+        }
+
+        /** Move-only class that holds the state of a put transaction. See byte_queue::put_transaction. */
+        class put_transaction
+        {
+          public:
+            /** Constructs an empty put transaction */
+            put_transaction() noexcept = default;
+
+            /** Move constructs a put_transaction, transferring the state from the source. */
+            put_transaction(put_transaction && i_source) noexcept = default;
+
+            /** Move assigns a put_transaction, transferring the state from the source. If this object
+                is not empty, its transaction is canceled. */
+            put_transaction & operator=(put_transaction && i_source) noexcept = default;
+
+            /** Swaps two instances of put_transaction. */
+            friend void swap(put_transaction & i_first, put_transaction & i_second) noexcept
+            {
+                using std::swap;
+                swap(i_first.m_put, i_second.m_put);
+            }
+
+            /** Returns true whether this object is not currently bound to a transaction. */
+            bool empty() const noexcept { return m_put.empty(); }
+
+            /** Returns true whether this object is bound to a transaction. Same to !put_transaction::empty. */
+            explicit operator bool() const noexcept { return m_put.operator bool(); }
+
+            /** Returns the storage reserved for the message. Its content is indeterminate until it is written.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            byte_span span() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return byte_span(m_put.element_ptr(), m_put.complete_type().message_size());
+            }
+
+            /** Truncates the message to the specified size. See byte_queue::put_transaction::shrink. */
+            void shrink(size_t i_size) noexcept { m_put.mutable_complete_type().shrink(i_size); }
+
+            /** Makes the message observable, with its current size. This object becomes empty.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            void commit() noexcept { m_put.commit(); }
+
+            /** Makes the message observable, truncating it to the specified size. This object becomes empty.
+                Equivalent to a call to shrink followed by a call to commit.
+
+                \pre The behavior is undefined if either:
+                    - this transaction is empty
+                    - i_actual_size is greater than the current size of the message */
+            void commit(size_t i_actual_size) noexcept
+            {
+                shrink(i_actual_size);
+                m_put.commit();
+            }
+
+            /** Cancels the transaction. This object becomes empty.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            void cancel() noexcept { m_put.cancel(); }
+
+          private:
+            explicit put_transaction(typename UnderlyingQueue::template put_transaction<> && i_put) noexcept
+                : m_put(std::move(i_put))
+            {
+            }
+            friend class lf_byte_queue;
+
+          private:
+            typename UnderlyingQueue::template put_transaction<> m_put;
+        };
+
+        /** Move-only class that holds the state of a consume operation. See byte_queue::consume_operation. */
+        class consume_operation
+        {
+          public:
+            /** Constructs an empty consume operation */
+            consume_operation() noexcept = default;
+
+            /** Move constructs a consume_operation, transferring the state from the source. */
+            consume_operation(consume_operation && i_source) noexcept = default;
+
+            /** Move assigns a consume_operation, transferring the state from the source. If this object
+                is not empty, its operation is canceled. */
+            consume_operation & operator=(consume_operation && i_source) noexcept = default;
+
+            /** Swaps two instances of consume_operation. */
+            friend void swap(consume_operation & i_first, consume_operation & i_second) noexcept
+            {
+                using std::swap;
+                swap(i_first.m_consume, i_second.m_consume);
+            }
+
+            /** Returns true whether this object does not hold the state of an operation. */
+            bool empty() const noexcept { return m_consume.empty(); }
+
+            /** Returns true whether this object holds the state of an operation. Same to !consume_operation::empty. */
+            explicit operator bool() const noexcept { return m_consume.operator bool(); }
+
+            /** Returns the message being consumed. The bytes can be read and modified in place until the
+                operation is committed.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            byte_span span() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return byte_span(m_consume.element_ptr(), m_consume.complete_type().message_size());
+            }
+
+            /** Removes the message from the queue. This object becomes empty.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void commit() noexcept { m_consume.commit(); }
+
+            /** Cancels the operation, leaving the message in the queue. This object becomes empty.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void cancel() noexcept { m_consume.cancel(); }
+
+          private:
+            typename UnderlyingQueue::consume_operation m_consume;
+            friend class lf_byte_queue;
+        };
+
+        /** Begins a transaction that appends a message of the specified size. See byte_queue::reserve.
+
+            \snippet byte_queue_examples.cpp lf_byte_queue reserve example 1 */
+        put_transaction reserve(size_t i_size)
+        {
+            return put_transaction(m_queue.start_dyn_push(detail::ByteRuntimeType(i_size)));
+        }
+
+        /** Tries to begin a transaction that appends a message of the specified size, respecting a progress guarantee.
+                @param i_progress_guarantee progress guarantee to respect
+                @param i_size size of the message in bytes. It is the maximum size that can be committed.
+            @return The associated transaction object, that is empty in case of failure.
+
+            \snippet byte_queue_examples.cpp lf_byte_queue try_reserve example 1 */
+        put_transaction try_reserve(progress_guarantee i_progress_guarantee, size_t i_size) noexcept
+        {
+            return put_transaction(
+              m_queue.try_start_dyn_push(i_progress_guarantee, detail::ByteRuntimeType(i_size)));
+        }
+
+        /** Appends a message, copying it from the source. See byte_queue::push. */
+        void push(const void * i_source, size_t i_size)
+        {
+            auto put = reserve(i_size);
+            if (i_size != 0) // i_source may be null
+                std::memcpy(put.span().data(), i_source, i_size);
+            put.commit();
+        }
+
+        /** Tries to append a message, copying it from the source, respecting a progress guarantee.
+            @return whether the message has been added */
+        bool try_push(
+          progress_guarantee i_progress_guarantee, const void * i_source, size_t i_size) noexcept
+        {
+            auto put = try_reserve(i_progress_guarantee, i_size);
+            if (!put)
+                return false;
+            if (i_size != 0) // i_source may be null
+                std::memcpy(put.span().data(), i_source, i_size);
+            put.commit();
+            return true;
+        }
+
+        /** Tries to start a consume operation.
+            @return a consume_operation which is empty if there are no messages to consume */
+        consume_operation try_start_consume() noexcept
+        {
+            consume_operation result;
+            m_queue.try_start_consume(result.m_consume);
+            return result;
+        }
+
+        /** Tries to start a consume operation using an existing consume_operation object. This overload is
+            faster than the one taking no arguments, because the queue does not need to pin a page at every call.
+            @param i_consume reference to a consume_operation to be used. If it is non-empty
+                it gets canceled before trying to start the new consume.
+            @return whether i_consume is non-empty after the call, that is whether the queue was
+                not empty. */
+        bool try_start_consume(consume_operation & i_consume) noexcept
+        {
+            return m_queue.try_start_consume(i_consume.m_consume);
+        }
+
+        /** Removes the first message of the queue, if any.
+            @return whether a message was removed, that is whether the queue was not empty. */
+        bool try_pop() noexcept { return m_queue.try_pop(); }
+
+        /** Deletes all the messages in the queue. */
+        void clear() noexcept { m_queue.clear(); }
+
+        /** Returns whether the queue contains no messages. */
+        bool empty() const noexcept { return m_queue.empty(); }
+    };
+
+} // namespace density
@@ -23,6 +23,7 @@
 #include <density/detail/lf_queue_tail_multiple_relaxed.h>
 #include <density/detail/lf_queue_tail_multiple_seq_cst.h>
 #include <density/detail/lf_queue_tail_single.h>
+#include <density/detail/visit_dispatch.h>
 
 namespace density
 {
@@ -367,6 +368,35 @@ namespace density
             }
         }
 
+        /** Invokes a function on every element of the queue, splitting the work between the tasks of an executor.
+            See heter_queue::parallel_for_each.
+
+            This function can be called while other threads put and consume. It visits a snapshot of the queue: first
+            the calling thread marks as busy the elements that can be consumed (as a consume operation would do) and
+            pins their pages; then the elements are visited by the tasks, grouped by page; finally the elements are
+            released. Consumers skip the elements of the snapshot until they are released. Elements put after the
+            snapshot has been taken are not visited.
+
+            \pre The behavior is undefined if either:
+                - i_func alters the queue
+                - CONSUMER_CARDINALITY is concurrency_single, and a consume operation is in progress or is started
+                    during the call
+
+            <b>Complexity</b>: linear.
+            \n <b>Throws</b>: std::bad_alloc, and anything thrown by the executor or by i_func. In case of exception
+                the elements of the snapshot are released.
+
+        \snippet lf_queue_examples.cpp lf_heter_queue parallel_for_each example 1 */
+        template <typename EXECUTOR, typename FUNC>
+        void parallel_for_each(EXECUTOR && i_executor, FUNC && i_func)
+        {
+            typename Base::template Snapshot<Consume> snapshot(get_allocator_ref());
+            snapshot.take(static_cast<Base *>(this));
+            i_executor(snapshot.page_count(), [&snapshot, &i_func](size_t i_page) {
+                snapshot.visit_page(i_page, i_func);
+            });
+        }
+
         /** Move-only class template that can be bound to a put transaction, otherwise it's empty.
 
             @tparam ELEMENT_COMPLETE_TYPE Complete type of elements that can be handled by a transaction, or void.
@@ -816,6 +846,15 @@ namespace density
                 return *Base::type_after_control(m_put.m_control_block);
             }
 
+            /** \internal - private function, usable only within the library. Returns the type of the object
+                being added, that can be modified until the transaction is committed (lf_byte_queue uses it to
+                shrink a message). Consumers don't read the type before the commit, that has release semantics. */
+            RUNTIME_TYPE & mutable_complete_type() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return *Base::type_after_control(m_put.m_control_block);
+            }
+
             /** If this transaction is empty the destructor has no side effects. Otherwise it cancels it.
 
                 \snippet lf_queue_examples.cpp lf_heter_queue put_transaction destroy example 1 */
@@ -1943,6 +1982,28 @@ namespace density
             return i_consume.start_consume_impl(PrivateType(), this);
         }
 
+        /** Tries to consume an element, invoking a visitor on it.
+                @tparam TYPES... types of elements handled by the visitor with their complete type.
+                @param i_visitor callable object that is invoked with an lvalue reference to the element, if
+                    its type is one of TYPES..., or with a dynamic_reference<RUNTIME_TYPE> otherwise.
+            @return whether an element was consumed, that is whether the queue was not empty.
+
+            The dispatch is performed with a table mapping runtime types to functions, that is built the first
+            time this function is called with a given visitor type and TYPES..., so the cost of the dispatch is
+            constant regardless of the number of types. RUNTIME_TYPE must be hashable with std::hash.
+            If the visitor throws an exception, the consume is canceled and the element remains in the queue.
+
+            \snippet lf_queue_examples.cpp lf_heter_queue consume_visit example 1 */
+        template <typename... TYPES, typename VISITOR> bool try_consume_visit(VISITOR && i_visitor)
+        {
+            consume_operation consume;
+            if (!try_start_consume(consume))
+                return false;
+            detail::visit_element<TYPES...>(i_visitor, consume.complete_type(), consume.element_ptr());
+            consume.commit();
+            return true;
+        }
+
 
         /** Move-only class template that can be bound to a reentrant put transaction, otherwise it's empty.
 
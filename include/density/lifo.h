@@ -257,6 +257,7 @@ namespace density
             else
             {
                 // external block
+                DENSITY_INSTRUMENT_COUNT(m_external_allocations);
                 return UNDERLYING_ALLOCATOR::allocate(i_size, alignment);
             }
         }
@@ -313,6 +314,7 @@ namespace density
             else
             {
                 // external block
+                DENSITY_INSTRUMENT_COUNT(m_external_allocations);
                 auto const new_external_block = UNDERLYING_ALLOCATOR::allocate(i_size, alignment);
                 m_top                         = reinterpret_cast<uintptr_t>(i_current_top);
                 return new_external_block;
@@ -0,0 +1,234 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <density/density_common.h>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <immintrin.h> // for _mm_pause
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace density
+{
+    namespace detail
+    {
+        /** \internal Hints the processor that the calling thread is in a spin loop. On x86 it
+            executes a pause instruction. */
+        inline void cpu_relax() noexcept
+        {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+            _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+            __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+            __asm__ __volatile__("yield");
+#endif
+        }
+
+        /** \internal Blocks the calling thread while i_address contains i_expected, or until a
+            wake_address. Spurious wakeups are possible. On systems without futexes the thread just
+            yields its time slice. */
+        inline void wait_on_address(std::atomic<uint32_t> & i_address, uint32_t i_expected) noexcept
+        {
+#if defined(__linux__)
+            static_assert(
+              sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futexes require a plain 32-bit word");
+            syscall(
+              SYS_futex,
+              reinterpret_cast<uint32_t *>(&i_address),
+              FUTEX_WAIT_PRIVATE,
+              i_expected,
+              nullptr,
+              nullptr,
+              0);
+#else
+            (void)i_address;
+            (void)i_expected;
+            std::this_thread::yield();
+#endif
+        }
+
+        /** \internal Wakes one thread blocked by wait_on_address on i_address, if any */
+        inline void wake_address(std::atomic<uint32_t> & i_address) noexcept
+        {
+#if defined(__linux__)
+            syscall(
+              SYS_futex,
+              reinterpret_cast<uint32_t *>(&i_address),
+              FUTEX_WAKE_PRIVATE,
+              1,
+              nullptr,
+              nullptr,
+              0);
+#else
+            (void)i_address;
+#endif
+        }
+
+    } // namespace detail
+
+    /** Mutex that spins for a while before blocking the calling thread. It satisfies the requirements of
+        [Lockable](https://en.cppreference.com/w/cpp/named_req/Lockable), so it can be used as MUTEX with
+        conc_heter_queue and conc_function_queue.
+
+        When the mutex is owned by another thread, lock spins with a pause instruction up to spin_count times,
+        expecting that the owner releases it soon. If this does not happen, the thread blocks on a futex until
+        the owner unlocks the mutex. Unlocking the mutex requires a system call only if there may be blocked threads.
+        On systems without futexes (currently every system but Linux) blocked threads yield their time slice
+        in a loop.
+
+        adaptive_mutex is a good choice when critical sections are short, and the number of threads does not exceed
+        the number of cores. The mutex is not fair. */
+    class adaptive_mutex
+    {
+      public:
+        /** Number of spins before blocking. */
+        static constexpr uint32_t spin_count = 256;
+
+        /** Constructs an unlocked mutex. */
+        constexpr adaptive_mutex() noexcept = default;
+
+        /** Copy construction is not allowed. */
+        adaptive_mutex(const adaptive_mutex &) = delete;
+
+        /** Copy assignment is not allowed. */
+        adaptive_mutex & operator=(const adaptive_mutex &) = delete;
+
+        /** Destroys the mutex. The behavior is undefined if the mutex is locked. */
+        ~adaptive_mutex() { DENSITY_ASSERT(m_state.load(std::memory_order_relaxed) == s_unlocked); }
+
+        /** Locks the mutex if it is not locked by another thread, without blocking.
+            Returns whether the lock was acquired. */
+        bool try_lock() noexcept
+        {
+            uint32_t expected = s_unlocked;
+            return m_state.compare_exchange_strong(
+              expected, s_locked, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        /** Locks the mutex, eventually blocking the calling thread. */
+        void lock() noexcept
+        {
+            for (uint32_t spin = 0; spin < spin_count; spin++)
+            {
+                if (m_state.load(std::memory_order_relaxed) == s_unlocked && try_lock())
+                    return;
+                detail::cpu_relax();
+            }
+
+            /* From now on the state is set to s_contended, so the thread that unlocks the mutex
+                knows that it has to wake a waiter. */
+            while (m_state.exchange(s_contended, std::memory_order_acquire) != s_unlocked)
+            {
+                detail::wait_on_address(m_state, s_contended);
+            }
+        }
+
+        /** Unlocks the mutex. The behavior is undefined if the mutex is not owned by the calling thread. */
+        void unlock() noexcept
+        {
+            if (m_state.exchange(s_unlocked, std::memory_order_release) == s_contended)
+            {
+                detail::wake_address(m_state);
+            }
+        }
+
+      private:
+        constexpr static uint32_t s_unlocked  = 0;
+        constexpr static uint32_t s_locked    = 1;
+        constexpr static uint32_t s_contended = 2; /**< locked, and there may be blocked threads */
+
+        std::atomic<uint32_t> m_state{s_unlocked};
+    };
+
+    /** Fair spinning mutex: threads acquire the lock in the same order in which they call lock. It satisfies the
+        requirements of [Lockable](https://en.cppreference.com/w/cpp/named_req/Lockable), so it can be used as MUTEX
+        with conc_heter_queue and conc_function_queue.
+
+        Every call to lock takes a ticket, and spins until the ticket is served. The wait between two checks is
+        proportional to the number of threads ahead in the line, to reduce the traffic on the cache line of the mutex.
+        After a long wait the thread yields its time slice at every check.
+
+        ticket_mutex never blocks the calling thread, so it should be used only when the number of threads does
+        not exceed the number of cores. */
+    class ticket_mutex
+    {
+      public:
+        /** Number of checks of the served ticket after which a waiting thread starts yielding. */
+        static constexpr uint32_t spin_count = 1024;
+
+        /** Constructs an unlocked mutex. */
+        constexpr ticket_mutex() noexcept = default;
+
+        /** Copy construction is not allowed. */
+        ticket_mutex(const ticket_mutex &) = delete;
+
+        /** Copy assignment is not allowed. */
+        ticket_mutex & operator=(const ticket_mutex &) = delete;
+
+        /** Destroys the mutex. The behavior is undefined if the mutex is locked. */
+        ~ticket_mutex()
+        {
+            DENSITY_ASSERT(
+              m_next_ticket.load(std::memory_order_relaxed) ==
+              m_now_serving.load(std::memory_order_relaxed));
+        }
+
+        /** Locks the mutex if it is not locked and no other thread is waiting, without blocking.
+            Returns whether the lock was acquired. */
+        bool try_lock() noexcept
+        {
+            uint32_t serving = m_now_serving.load(std::memory_order_acquire);
+            return m_next_ticket.compare_exchange_strong(
+              serving, serving + 1, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        /** Locks the mutex, spinning until all the threads that called lock before have unlocked it. */
+        void lock() noexcept
+        {
+            uint32_t const ticket = m_next_ticket.fetch_add(1, std::memory_order_relaxed);
+            for (uint32_t check = 0;; check++)
+            {
+                uint32_t const serving = m_now_serving.load(std::memory_order_acquire);
+                if (serving == ticket)
+                    return;
+
+                if (check < spin_count)
+                {
+                    for (uint32_t spin = ticket - serving; spin > 0; spin--)
+                        detail::cpu_relax();
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        /** Unlocks the mutex. The behavior is undefined if the mutex is not owned by the calling thread. */
+        void unlock() noexcept
+        {
+            // only the owner writes m_now_serving
+            m_now_serving.store(
+              m_now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+      private:
+        std::atomic<uint32_t> m_next_ticket{0};
+        std::atomic<uint32_t> m_now_serving{0};
+    };
+
+} // namespace density
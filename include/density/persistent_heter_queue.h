@@ -0,0 +1,1007 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <density/density_common.h>
+#include <density/io_runtimetype_features.h>
+#include <density/shm_heter_queue.h>
+#include <initializer_list>
+#include <istream>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "persistent_heter_queue requires a POSIX system"
+#endif
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace density
+{
+    namespace detail
+    {
+        /** \internal State of a persistent_heter_queue, as it is known to be on the disk. */
+        struct PersistentQueueState
+        {
+            uint64_t m_sequence;       /**< incremented by every sync */
+            uint64_t m_head;           /**< offset of the first control block that may be not consumed */
+            uint64_t m_tail;           /**< offset of the control block that ends the queue */
+            uint64_t m_acquired_pages; /**< number of pages ever acquired, up to m_tail */
+            uint64_t m_released_pages; /**< number of pages ever released, up to m_head */
+            uint64_t m_checksum;       /**< see persistent_state_checksum */
+        };
+
+        /** \internal Header at the beginning of the file of a persistent_heter_queue. The state is written in the
+            two slots alternately, so that if the system crashes while a slot is being written the other one is
+            still valid. */
+        struct PersistentQueueHeader
+        {
+            uint64_t             m_magic; /**< s_persistent_queue_magic */
+            uint64_t             m_page_size;
+            uint64_t             m_page_count;
+            uint64_t             m_first_page; /**< offset of the first page */
+            PersistentQueueState m_states[2];
+        };
+
+        constexpr uint64_t s_persistent_queue_magic = 0x64656e7369747970; // "densityp"
+
+        /** \internal Checksum of a state, used to detect a slot whose write was interrupted. A slot that
+            contains only zeros is never valid. */
+        inline uint64_t persistent_state_checksum(const PersistentQueueState & i_state) noexcept
+        {
+            uint64_t result = s_persistent_queue_magic;
+            for (auto value : {i_state.m_sequence,
+                               i_state.m_head,
+                               i_state.m_tail,
+                               i_state.m_acquired_pages,
+                               i_state.m_released_pages})
+            {
+                result = (result ^ value) * 0x100000001b3;
+                result ^= result >> 29;
+            }
+            return result;
+        }
+
+        /** \internal Read-only stream buffer on a block of memory. */
+        class PersistentQueueStreamBuf : public std::streambuf
+        {
+          public:
+            PersistentQueueStreamBuf(void * i_data, size_t i_size) noexcept
+            {
+                auto const begin = static_cast<char *>(i_data);
+                setg(begin, begin, begin + i_size);
+            }
+        };
+
+    } // namespace detail
+
+    /** Specifies when a persistent_heter_queue flushes to its file the pages and the state of the queue (see
+        persistent_heter_queue::sync). The flushes can be triggered by the number of commits or by the time
+        elapsed since the last flush. The time is checked only when a put or consume is committed: a flush that
+        must happen even if the queue is idle can be done calling persistent_heter_queue::sync from a timer. */
+    class sync_policy
+    {
+      public:
+        /** The queue is flushed only by explicit calls to sync, and by the destructor. */
+        static sync_policy manual() noexcept { return sync_policy(0, std::chrono::milliseconds(0)); }
+
+        /** The queue is flushed by every commit. This is the slowest policy, and the only one that never
+            loses a committed element. */
+        static sync_policy every_commit() noexcept
+        {
+            return sync_policy(1, std::chrono::milliseconds(0));
+        }
+
+        /** The queue is flushed every i_commit_count commits. */
+        static sync_policy every_n_commits(uint32_t i_commit_count) noexcept
+        {
+            DENSITY_ASSERT(i_commit_count > 0);
+            return sync_policy(i_commit_count, std::chrono::milliseconds(0));
+        }
+
+        /** The queue is flushed by the first commit that happens at least i_interval after the last flush. */
+        static sync_policy periodic(std::chrono::milliseconds i_interval) noexcept
+        {
+            DENSITY_ASSERT(i_interval.count() > 0);
+            return sync_policy(0, i_interval);
+        }
+
+        /** Number of commits that cause a flush, or zero. */
+        uint32_t commit_count() const noexcept { return m_commit_count; }
+
+        /** Time after which a commit causes a flush, or zero. */
+        std::chrono::milliseconds interval() const noexcept { return m_interval; }
+
+      private:
+        sync_policy(uint32_t i_commit_count, std::chrono::milliseconds i_interval) noexcept
+            : m_commit_count(i_commit_count), m_interval(i_interval)
+        {
+        }
+
+      private:
+        uint32_t                  m_commit_count;
+        std::chrono::milliseconds m_interval;
+    };
+
+    /** Heterogeneous FIFO queue whose pages are a memory-mapped file, so that the elements survive the
+        termination of the process or a crash of the system. When the file is opened again, the queue is
+        restored in constant time, without reading the elements.
+
+        @tparam PROD_CARDINALITY specifies whether multiple threads can put concurrently. The consumer is
+            always single: only one thread at a time can consume, and it can have only one consume operation
+            in progress.
+
+        Like shm_heter_queue, elements are trivially copyable objects or raw blocks identified by a type tag
+        (a 32-bit integer) chosen by the user, and are written and read in place. Other types can be put with
+        push_serialized, that uses the format of the feature f_serialize.
+
+        The queue is flushed to the file by the function sync, that is called according to a sync_policy.
+        A sync makes durable all the puts and consumes committed before it: when the queue is opened, puts
+        committed after the last sync are lost, and elements consumed after the last sync may be consumed again
+        (delivery is at least once).
+        This holds for a crash of the process and for a crash of the system, because the state of the queue is
+        read only from the header written by the last sync, and the header is written only after the pages it
+        refers to have reached the disk. The pages released by the consumer are reused by the producers only after
+        a sync, so the elements referred by the header are never overwritten.
+
+        The file is locked with flock, so only one persistent_heter_queue at a time can use it. The pages
+        are used circularly, as in shm_heter_queue: when all the pages are in use the queue is full.
+
+        A persistent_heter_queue object is neither copyable nor movable.
+
+        \snippet persistent_queue_examples.cpp persistent_heter_queue example 1 */
+    template <concurrency_cardinality PROD_CARDINALITY = concurrency_multiple>
+    class persistent_heter_queue
+    {
+      private:
+        using ControlBlock = detail::ShmQueueControl;
+        using Header       = detail::PersistentQueueHeader;
+        using State        = detail::PersistentQueueState;
+
+        /** Alignment of the control blocks. All the blocks in a page are aligned at least to this value. */
+        constexpr static size_t s_block_alignment = alignof(ControlBlock);
+
+      public:
+        /** Default size of the pages, in bytes. */
+        static constexpr size_t default_page_size = 64 * 1024;
+
+        /** Maximum alignment of the elements. The first page is aligned to the page size of the system. */
+        static constexpr size_t max_alignment = 4096;
+
+        /** Type of the transaction returned by the put functions. */
+        class put_transaction;
+
+        /** Type of the consume operation returned by try_start_consume. */
+        class consume_operation;
+
+        /** Opens the queue contained in a file, or initializes a new queue if the file does not exist or is empty.
+                @param i_path path of the file
+                @param i_page_count number of pages of a new queue. Must be at least 2. Ignored if the file already
+                    contains a queue.
+                @param i_page_size size of the pages of a new queue. Must be a multiple of 64, at least 1024, and
+                    less than 4 GiB. Ignored if the file already contains a queue.
+                @param i_policy specifies when the queue is flushed to the file.
+
+            <b>Complexity</b>: constant.
+            \n <b>Throws</b>: std::system_error if the system fails to open, lock, resize or map the file.
+                std::runtime_error if the file is not empty and does not contain a queue.
+                std::invalid_argument if the page count or size is invalid.
+
+        \snippet persistent_queue_examples.cpp persistent_heter_queue example 1 */
+        persistent_heter_queue(
+          const char * i_path,
+          size_t       i_page_count,
+          size_t       i_page_size = default_page_size,
+          sync_policy  i_policy    = sync_policy::every_commit())
+            : m_policy(i_policy)
+        {
+            // the control blocks store sizes and offsets within a page in 32 bits
+            if (
+              i_page_count < 2 || i_page_size < 1024 || i_page_size % 64 != 0 ||
+              i_page_size > std::numeric_limits<uint32_t>::max())
+                throw std::invalid_argument("persistent_heter_queue: invalid page count or size");
+
+            m_file_descriptor = ::open(i_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+            if (m_file_descriptor < 0)
+                throw std::system_error(errno, std::system_category(), "open");
+            try
+            {
+                if (::flock(m_file_descriptor, LOCK_EX | LOCK_NB) != 0)
+                    throw std::system_error(errno, std::system_category(), "flock");
+
+                struct stat file_stat;
+                if (::fstat(m_file_descriptor, &file_stat) != 0)
+                    throw std::system_error(errno, std::system_category(), "fstat");
+
+                if (file_stat.st_size == 0)
+                    create_file(i_page_count, i_page_size);
+                else
+                    open_file(static_cast<size_t>(file_stat.st_size));
+            }
+            catch (...)
+            {
+                close_file();
+                throw;
+            }
+            m_last_sync.store(now(), std::memory_order_relaxed);
+        }
+
+        /** Copy construction is not allowed */
+        persistent_heter_queue(const persistent_heter_queue &) = delete;
+
+        /** Copy assignment is not allowed */
+        persistent_heter_queue & operator=(const persistent_heter_queue &) = delete;
+
+        /** Flushes the queue to the file, unmaps it and closes the file. Errors of the flush are ignored.
+            The behavior is undefined if a put or consume operation is in progress. */
+        ~persistent_heter_queue()
+        {
+            try
+            {
+                sync();
+            }
+            catch (...)
+            {
+            }
+            close_file();
+        }
+
+        /** Returns the size of the pages. */
+        size_t page_size() const noexcept { return static_cast<size_t>(header().m_page_size); }
+
+        /** Returns the number of pages. */
+        size_t page_count() const noexcept { return static_cast<size_t>(header().m_page_count); }
+
+        /** Returns the sync policy of the queue. */
+        const sync_policy & policy() const noexcept { return m_policy; }
+
+        /** Returns the maximum size of an element with the specified alignment. Returns zero if the
+            alignment is too big for the pages: such elements can't be put. */
+        size_t max_element_size(size_t i_alignment = alignof(std::max_align_t)) const noexcept
+        {
+            return detail::shm_queue_max_element_size(page_size(), i_alignment);
+        }
+
+        /** Returns whether the queue contains no elements. Elements being put are not considered.
+            This function can be called only by the consumer.
+
+            <b>Complexity</b>: Unspecified. */
+        bool empty() const noexcept
+        {
+            for (auto curr = m_head.load(std::memory_order_relaxed);;)
+            {
+                auto const next = control_at(curr)->m_next.load(std::memory_order_acquire);
+                if (next == 0)
+                    return true;
+                if ((next & detail::ShmQueue_AllFlags) == 0)
+                    return false;
+                curr = next & ~static_cast<uint64_t>(detail::ShmQueue_AllFlags);
+            }
+        }
+
+        /** Flushes to the file the pages and the state of the queue, so that all the puts and the consumes committed
+            before the call survive a crash. Puts in progress are not affected, and the puts committed after them
+            are made durable by the next sync. This function can be called by any thread at any time.
+
+            <b>Complexity</b>: linear in the number of elements put since the last sync. The system writes only the
+                pages modified since the last sync.
+            \n <b>Throws</b>: std::system_error if msync fails. In this case the state on the disk is unchanged.
+
+        \snippet persistent_queue_examples.cpp persistent_heter_queue sync example 1 */
+        void sync()
+        {
+            std::lock_guard<std::mutex> sync_lock(m_sync_mutex);
+
+            // the head is read before the tail, so that the tail can't be before the head
+            State state;
+            {
+                std::lock_guard<std::mutex> release_lock(m_release_mutex);
+                state.m_head           = m_head.load(std::memory_order_relaxed);
+                state.m_released_pages = m_released_pages.load(std::memory_order_relaxed);
+            }
+
+            // the tail of the state is the end of the committed elements
+            state.m_tail           = m_synced.m_tail;
+            state.m_acquired_pages = m_synced.m_acquired_pages;
+            for (;;)
+            {
+                auto const next = control_at(state.m_tail)->m_next.load(std::memory_order_acquire);
+                if (next == 0 || (next & detail::ShmQueue_Busy) != 0)
+                    break;
+                auto const next_control = next & ~static_cast<uint64_t>(detail::ShmQueue_AllFlags);
+                if (page_of(next_control) != page_of(state.m_tail))
+                    state.m_acquired_pages++;
+                state.m_tail = next_control;
+            }
+
+            auto & head = header();
+            if (
+              ::msync(
+                address_add(m_segment, static_cast<size_t>(head.m_first_page)),
+                static_cast<size_t>(head.m_page_count * head.m_page_size),
+                MS_SYNC) != 0)
+            {
+                throw std::system_error(errno, std::system_category(), "msync");
+            }
+
+            state.m_sequence = m_synced.m_sequence + 1;
+            state.m_checksum = detail::persistent_state_checksum(state);
+            head.m_states[state.m_sequence % 2] = state;
+            if (::msync(m_segment, static_cast<size_t>(head.m_first_page), MS_SYNC) != 0)
+                throw std::system_error(errno, std::system_category(), "msync");
+
+            m_synced = state;
+            m_unsynced_commits.store(0, std::memory_order_relaxed);
+            m_last_sync.store(now(), std::memory_order_relaxed);
+
+            // from now on the producers can reuse the pages released by the consumer
+            m_durable_released_pages.store(state.m_released_pages, std::memory_order_release);
+        }
+
+        /** Move-only class that can be bound to a put transaction, otherwise it's empty. The element becomes
+            observable by the consumer when the transaction is committed. Destroying a non-empty transaction
+            cancels it. */
+        class put_transaction
+        {
+          public:
+            /** Constructs an empty put transaction */
+            put_transaction() noexcept = default;
+
+            /** Copy construction is not allowed */
+            put_transaction(const put_transaction &) = delete;
+
+            /** Copy assignment is not allowed */
+            put_transaction & operator=(const put_transaction &) = delete;
+
+            /** Move constructs a put_transaction, transferring the state from the source. */
+            put_transaction(put_transaction && i_source) noexcept
+                : m_queue(i_source.m_queue), m_control(i_source.m_control)
+            {
+                i_source.m_queue = nullptr;
+            }
+
+            /** Move assigns a put_transaction, transferring the state from the source. */
+            put_transaction & operator=(put_transaction && i_source) noexcept
+            {
+                if (this != &i_source)
+                {
+                    if (!empty())
+                        cancel();
+                    m_queue          = i_source.m_queue;
+                    m_control        = i_source.m_control;
+                    i_source.m_queue = nullptr;
+                }
+                return *this;
+            }
+
+            /** If this transaction is not empty, cancels it. */
+            ~put_transaction()
+            {
+                if (!empty())
+                    cancel();
+            }
+
+            /** Returns true whether this object does not hold the state of a transaction. */
+            bool empty() const noexcept { return m_queue == nullptr; }
+
+            /** Returns true whether this object holds the state of a transaction. */
+            explicit operator bool() const noexcept { return m_queue != nullptr; }
+
+            /** Returns the type tag of the element. The behavior is undefined if the transaction is empty. */
+            uint32_t type() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_type;
+            }
+
+            /** Returns the size of the element. The behavior is undefined if the transaction is empty. */
+            size_t size() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_size;
+            }
+
+            /** Returns a pointer to the storage of the element, that the producer has to fill before committing.
+                The behavior is undefined if the transaction is empty. */
+            void * element_ptr() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return address_add(m_control, m_control->m_element_offset);
+            }
+
+            /** Makes the element observable by the consumer, and flushes the queue if the sync policy
+                requires it. After the call the transaction is empty.
+
+                \n <b>Throws</b>: std::system_error if the flush fails. The element is committed anyway. */
+            void commit()
+            {
+                DENSITY_ASSERT(!empty());
+                auto const next = m_control->m_next.load(std::memory_order_relaxed);
+                m_control->m_next.store(next - detail::ShmQueue_Busy, std::memory_order_release);
+                auto const queue = m_queue;
+                m_queue          = nullptr;
+                queue->on_commit();
+            }
+
+            /** Cancels the transaction: the element is never observed by the consumer. After the call the
+                transaction is empty. */
+            void cancel() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                auto const next = m_control->m_next.load(std::memory_order_relaxed);
+                m_control->m_next.store(
+                  next - detail::ShmQueue_Busy + detail::ShmQueue_Dead, std::memory_order_release);
+                m_queue = nullptr;
+            }
+
+          private:
+            put_transaction(persistent_heter_queue * i_queue, ControlBlock * i_control) noexcept
+                : m_queue(i_queue), m_control(i_control)
+            {
+            }
+
+            friend class persistent_heter_queue;
+
+          private:
+            persistent_heter_queue * m_queue   = nullptr;
+            ControlBlock *           m_control = nullptr;
+        };
+
+        /** Move-only class that can be bound to a consume operation, otherwise it's empty. Destroying a non-empty
+            consume operation cancels it. */
+        class consume_operation
+        {
+          public:
+            /** Constructs an empty consume operation */
+            consume_operation() noexcept = default;
+
+            /** Copy construction is not allowed */
+            consume_operation(const consume_operation &) = delete;
+
+            /** Copy assignment is not allowed */
+            consume_operation & operator=(const consume_operation &) = delete;
+
+            /** Move constructs a consume_operation, transferring the state from the source. */
+            consume_operation(consume_operation && i_source) noexcept
+                : m_queue(i_source.m_queue), m_control(i_source.m_control)
+            {
+                i_source.m_queue = nullptr;
+            }
+
+            /** Move assigns a consume_operation, transferring the state from the source. */
+            consume_operation & operator=(consume_operation && i_source) noexcept
+            {
+                if (this != &i_source)
+                {
+                    if (!empty())
+                        cancel();
+                    m_queue          = i_source.m_queue;
+                    m_control        = i_source.m_control;
+                    i_source.m_queue = nullptr;
+                }
+                return *this;
+            }
+
+            /** If this consume operation is not empty, cancels it. */
+            ~consume_operation()
+            {
+                if (!empty())
+                    cancel();
+            }
+
+            /** Returns true whether this object does not hold the state of an operation. */
+            bool empty() const noexcept { return m_queue == nullptr; }
+
+            /** Returns true whether this object holds the state of an operation. */
+            explicit operator bool() const noexcept { return m_queue != nullptr; }
+
+            /** Returns the type tag of the element. The behavior is undefined if the operation is empty. */
+            uint32_t type() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_type;
+            }
+
+            /** Returns the size of the element. The behavior is undefined if the operation is empty. */
+            size_t size() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_size;
+            }
+
+            /** Returns a pointer to the element. The behavior is undefined if the operation is empty. */
+            void * element_ptr() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return address_add(m_control, m_control->m_element_offset);
+            }
+
+            /** Returns a reference to the element. The behavior is undefined if the operation is empty, or
+                if the element is not an ELEMENT_TYPE. */
+            template <typename ELEMENT_TYPE> ELEMENT_TYPE & element() const noexcept
+            {
+                DENSITY_ASSERT(!empty() && m_control->m_size == sizeof(ELEMENT_TYPE));
+                return *static_cast<ELEMENT_TYPE *>(element_ptr());
+            }
+
+            /** Reads an element put by push_serialized. ELEMENT_TYPE must be default constructible.
+                The behavior is undefined if the operation is empty.
+
+                \n <b>Throws</b>: std::runtime_error if the element is shorter than expected, and anything
+                    thrown by density_deserialize.
+
+            \snippet persistent_queue_examples.cpp persistent_heter_queue push_serialized example 1 */
+            template <typename ELEMENT_TYPE> ELEMENT_TYPE deserialize() const
+            {
+                DENSITY_ASSERT(!empty());
+                detail::PersistentQueueStreamBuf buffer(element_ptr(), size());
+                std::istream                     stream(&buffer);
+                ELEMENT_TYPE                     result;
+                detail::deserialize_object(
+                  stream, result, is_bitwise_serializable<ELEMENT_TYPE>());
+                if (!stream)
+                    throw std::runtime_error(
+                      "persistent_heter_queue: the element can't be deserialized");
+                return result;
+            }
+
+            /** Removes the element from the queue, and flushes the queue if the sync policy requires it.
+                After the call the operation is empty.
+
+                \n <b>Throws</b>: std::system_error if the flush fails. The element is consumed anyway. */
+            void commit()
+            {
+                DENSITY_ASSERT(!empty());
+                auto const next = m_control->m_next.load(std::memory_order_relaxed);
+                m_control->m_next.store(next + detail::ShmQueue_Dead, std::memory_order_relaxed);
+                auto const queue = m_queue;
+                m_queue          = nullptr;
+                queue->advance_head();
+                queue->on_commit();
+            }
+
+            /** Cancels the operation: the element is left in the queue. After the call the operation is empty. */
+            void cancel() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                m_queue = nullptr;
+            }
+
+          private:
+            consume_operation(persistent_heter_queue * i_queue, ControlBlock * i_control) noexcept
+                : m_queue(i_queue), m_control(i_control)
+            {
+            }
+
+            friend class persistent_heter_queue;
+
+          private:
+            persistent_heter_queue * m_queue   = nullptr;
+            ControlBlock *           m_control = nullptr;
+        };
+
+        /** Adds at the end of the queue a copy of an object, waiting while the queue is full.
+                @param i_type type tag of the element, chosen by the user
+                @param i_source object to copy. It must be trivially copyable.
+
+            <b>Throws</b>: std::length_error if the element is bigger than max_element_size. std::system_error
+                if a flush fails.
+
+        \snippet persistent_queue_examples.cpp persistent_heter_queue example 1 */
+        template <typename ELEMENT_TYPE> void push(uint32_t i_type, const ELEMENT_TYPE & i_source)
+        {
+            auto put = start_raw_push(i_type, sizeof(ELEMENT_TYPE), alignof(ELEMENT_TYPE));
+            copy_element(put, i_source);
+        }
+
+        /** Adds at the end of the queue a copy of an object, if the queue is not full. Returns whether the
+            object has been added. See push. */
+        template <typename ELEMENT_TYPE> bool try_push(uint32_t i_type, const ELEMENT_TYPE & i_source)
+        {
+            auto put = try_start_raw_push(i_type, sizeof(ELEMENT_TYPE), alignof(ELEMENT_TYPE));
+            if (!put)
+                return false;
+            copy_element(put, i_source);
+            return true;
+        }
+
+        /** Adds at the end of the queue an object in the binary format of the feature f_serialize, waiting while
+            the queue is full. The object can be read with consume_operation::deserialize.
+                @param i_type type tag of the element, chosen by the user
+                @param i_source object to write
+
+            <b>Throws</b>: std::length_error if the serialized object is bigger than max_element_size(1).
+                std::system_error if a flush fails. Anything thrown by density_serialize.
+
+        \snippet persistent_queue_examples.cpp persistent_heter_queue push_serialized example 1 */
+        template <typename ELEMENT_TYPE>
+        void push_serialized(uint32_t i_type, const ELEMENT_TYPE & i_source)
+        {
+            std::ostringstream stream(std::ios::out | std::ios::binary);
+            detail::serialize_object(stream, i_source, is_bitwise_serializable<ELEMENT_TYPE>());
+            auto const bytes = stream.str();
+
+            auto put = start_raw_push(i_type, bytes.size(), 1);
+            std::memcpy(put.element_ptr(), bytes.data(), bytes.size());
+            put.commit();
+        }
+
+        /** Allocates an element in the queue, waiting while the queue is full, and returns a transaction that the
+            producer uses to write it in place before committing.
+                @param i_type type tag of the element, chosen by the user
+                @param i_size size of the element
+                @param i_alignment alignment of the element. Must be an integer power of 2, not greater than max_alignment.
+
+            <b>Throws</b>: std::length_error if the element is bigger than max_element_size. std::system_error
+                if a flush fails.
+
+        \snippet persistent_queue_examples.cpp persistent_heter_queue start_raw_push example 1 */
+        put_transaction start_raw_push(
+          uint32_t i_type, size_t i_size, size_t i_alignment = alignof(std::max_align_t))
+        {
+            check_element_size(i_size, i_alignment);
+            for (uint32_t iteration = 0;; iteration++)
+            {
+                auto const control = allocate(i_type, i_size, i_alignment);
+                if (control != nullptr)
+                    return put_transaction(this, control);
+                if (!sync_releases())
+                {
+                    if (iteration < 64)
+                        detail::cpu_relax();
+                    else
+                        std::this_thread::yield();
+                }
+            }
+        }
+
+        /** Allocates an element in the queue if it is not full. Returns an empty transaction on failure.
+            See start_raw_push. */
+        put_transaction try_start_raw_push(
+          uint32_t i_type, size_t i_size, size_t i_alignment = alignof(std::max_align_t))
+        {
+            check_element_size(i_size, i_alignment);
+            auto control = allocate(i_type, i_size, i_alignment);
+            if (control == nullptr && sync_releases())
+                control = allocate(i_type, i_size, i_alignment);
+            return control != nullptr ? put_transaction(this, control) : put_transaction();
+        }
+
+        /** Tries to start a consume operation. Returns an empty consume_operation if there are no consumable elements.
+            Elements being put are skipped. Only one consume operation at a time can be in progress.
+
+        \snippet persistent_queue_examples.cpp persistent_heter_queue example 1 */
+        consume_operation try_start_consume() noexcept
+        {
+            consume_operation result;
+            try_start_consume(result);
+            return result;
+        }
+
+        /** Tries to start a consume operation, reusing the consume_operation passed as argument. Returns
+            false if there are no consumable elements. */
+        bool try_start_consume(consume_operation & i_consume) noexcept
+        {
+            if (!i_consume.empty())
+                i_consume.cancel();
+
+            for (auto curr = m_head.load(std::memory_order_relaxed);;)
+            {
+                auto const control = control_at(curr);
+                auto const next    = control->m_next.load(std::memory_order_acquire);
+                if (next == 0)
+                    return false;
+                if ((next & detail::ShmQueue_AllFlags) == 0)
+                {
+                    /* the consumer does not mark the element as busy, otherwise after a crash
+                        the flag would have to be removed from the file */
+                    i_consume = consume_operation(this, control);
+                    return true;
+                }
+                curr = next & ~static_cast<uint64_t>(detail::ShmQueue_AllFlags);
+            }
+        }
+
+        /** Removes the first element of the queue. Returns false if there are no consumable elements.
+
+            \n <b>Throws</b>: std::system_error if a flush fails. */
+        bool try_pop()
+        {
+            consume_operation consume;
+            if (!try_start_consume(consume))
+                return false;
+            consume.commit();
+            return true;
+        }
+
+      private:
+        Header & header() const noexcept { return *static_cast<Header *>(m_segment); }
+
+        ControlBlock * control_at(uint64_t i_offset) const noexcept
+        {
+            return static_cast<ControlBlock *>(address_add(m_segment, static_cast<size_t>(i_offset)));
+        }
+
+        /** Returns the offset of the first byte of the page containing the specified offset */
+        uint64_t page_of(uint64_t i_offset) const noexcept
+        {
+            auto const & head = header();
+            return head.m_first_page +
+                   (i_offset - head.m_first_page) / head.m_page_size * head.m_page_size;
+        }
+
+        static int64_t now() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now().time_since_epoch())
+              .count();
+        }
+
+        void close_file() noexcept
+        {
+            if (m_segment != nullptr)
+                ::munmap(m_segment, m_segment_size);
+            if (m_file_descriptor >= 0)
+                ::close(m_file_descriptor);
+            m_segment         = nullptr;
+            m_file_descriptor = -1;
+        }
+
+        void map(size_t i_size)
+        {
+            auto const segment =
+              ::mmap(nullptr, i_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file_descriptor, 0);
+            if (segment == MAP_FAILED)
+                throw std::system_error(errno, std::system_category(), "mmap");
+            m_segment      = segment;
+            m_segment_size = i_size;
+        }
+
+        void create_file(size_t i_page_count, size_t i_page_size)
+        {
+            // the header takes a whole page of the system, so that it can be flushed alone
+            auto const system_page = detail::size_max(
+              static_cast<size_t>(::sysconf(_SC_PAGESIZE)), max_alignment);
+            auto const first_page = uint_upper_align(sizeof(Header), system_page);
+            auto const file_size  = first_page + i_page_count * i_page_size;
+            if (::ftruncate(m_file_descriptor, static_cast<off_t>(file_size)) != 0)
+                throw std::system_error(errno, std::system_category(), "ftruncate");
+            map(file_size);
+
+            auto const head    = new (m_segment) Header{};
+            head->m_magic      = detail::s_persistent_queue_magic;
+            head->m_page_size  = i_page_size;
+            head->m_page_count = i_page_count;
+            head->m_first_page = first_page;
+            new (control_at(first_page)) ControlBlock{};
+
+            auto & state            = head->m_states[1];
+            state.m_sequence        = 1;
+            state.m_head            = first_page;
+            state.m_tail            = first_page;
+            state.m_acquired_pages  = 1;
+            state.m_released_pages  = 0;
+            state.m_checksum        = detail::persistent_state_checksum(state);
+            if (::msync(m_segment, file_size, MS_SYNC) != 0)
+                throw std::system_error(errno, std::system_category(), "msync");
+
+            restore(state);
+        }
+
+        void open_file(size_t i_file_size)
+        {
+            if (i_file_size < sizeof(Header))
+                throw std::runtime_error("persistent_heter_queue: the file does not contain a queue");
+            map(i_file_size);
+
+            auto const & head = header();
+            if (
+              head.m_magic != detail::s_persistent_queue_magic || head.m_page_count < 2 ||
+              head.m_first_page < sizeof(Header) ||
+              head.m_page_size > std::numeric_limits<uint32_t>::max() ||
+              head.m_first_page + head.m_page_count * head.m_page_size > i_file_size)
+            {
+                throw std::runtime_error("persistent_heter_queue: the file does not contain a queue");
+            }
+
+            // the valid slot with the highest sequence is the last written
+            const State * state = nullptr;
+            for (auto & slot : head.m_states)
+            {
+                if (
+                  slot.m_checksum == detail::persistent_state_checksum(slot) &&
+                  (state == nullptr || slot.m_sequence > state->m_sequence))
+                {
+                    state = &slot;
+                }
+            }
+            if (state == nullptr)
+                throw std::runtime_error("persistent_heter_queue: the state of the queue is corrupted");
+
+            /* the control block at the tail was the end of the queue when the state was written: puts
+                that followed are discarded */
+            auto const tail = control_at(state->m_tail);
+            new (tail) ControlBlock{};
+            restore(*state);
+        }
+
+        void restore(const State & i_state) noexcept
+        {
+            m_synced         = i_state;
+            m_tail           = i_state.m_tail;
+            m_acquired_pages = i_state.m_acquired_pages;
+            m_head.store(i_state.m_head, std::memory_order_relaxed);
+            m_released_pages.store(i_state.m_released_pages, std::memory_order_relaxed);
+            m_durable_released_pages.store(i_state.m_released_pages, std::memory_order_relaxed);
+        }
+
+        void check_element_size(size_t i_size, size_t i_alignment) const
+        {
+            DENSITY_ASSERT(is_power_of_2(i_alignment) && i_alignment <= max_alignment);
+            detail::shm_queue_check_element_size(
+              page_size(),
+              i_size,
+              i_alignment,
+              "persistent_heter_queue: the element is too big for a page");
+        }
+
+        /** Allocates an element at the end of the queue, and returns its control block, which has the
+            flag ShmQueue_Busy. If all the pages are in use, returns nullptr. */
+        ControlBlock * allocate(uint32_t i_type, size_t i_size, size_t i_alignment)
+        {
+            auto const & head      = header();
+            auto const   alignment = detail::size_max(i_alignment, s_block_alignment);
+            std::unique_lock<std::mutex> lock(m_tail_mutex, std::defer_lock);
+            if (PROD_CARDINALITY == concurrency_multiple)
+                lock.lock();
+            for (;;)
+            {
+                auto const control  = m_tail;
+                auto const element  = uint_upper_align(control + sizeof(ControlBlock), alignment);
+                auto const next     = uint_upper_align(element + i_size, s_block_alignment);
+                auto const page_end = page_of(control) + head.m_page_size - sizeof(ControlBlock);
+                if (next <= page_end)
+                {
+                    /* the next control block may contain garbage from a previous use of the page, so
+                        it is zeroed before it becomes reachable */
+                    new (control_at(next)) ControlBlock{};
+
+                    auto const result        = control_at(control);
+                    result->m_type           = i_type;
+                    result->m_size           = static_cast<uint32_t>(i_size);
+                    result->m_element_offset = static_cast<uint32_t>(element - control);
+                    result->m_next.store(next + detail::ShmQueue_Busy, std::memory_order_release);
+                    m_tail = next;
+                    return result;
+                }
+
+                // the page is full, we need a new one that has been released by a sync
+                if (
+                  m_acquired_pages - m_durable_released_pages.load(std::memory_order_acquire) >=
+                  head.m_page_count)
+                {
+                    return nullptr;
+                }
+                auto const new_page =
+                  head.m_first_page + m_acquired_pages % head.m_page_count * head.m_page_size;
+                m_acquired_pages++;
+                new (control_at(new_page)) ControlBlock{};
+                control_at(control)->m_next.store(
+                  new_page + detail::ShmQueue_Dead, std::memory_order_release);
+                m_tail = new_page;
+            }
+        }
+
+        /** If the consumer has released pages after the last sync, syncs so that the producers can reuse them.
+            Returns whether a sync happened. */
+        bool sync_releases()
+        {
+            if (
+              m_released_pages.load(std::memory_order_relaxed) ==
+              m_durable_released_pages.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+            sync();
+            return true;
+        }
+
+        template <typename ELEMENT_TYPE>
+        static void copy_element(put_transaction & i_put, const ELEMENT_TYPE & i_source)
+        {
+            static_assert(
+              std::is_trivially_copyable<ELEMENT_TYPE>::value,
+              "elements of persistent_heter_queue must be trivially copyable, use push_serialized");
+            new (i_put.element_ptr()) ELEMENT_TYPE(i_source);
+            i_put.commit();
+        }
+
+        /** Moves the head past the dead elements, releasing the pages it leaves. Called by the consumer. */
+        void advance_head() noexcept
+        {
+            for (;;)
+            {
+                auto const curr = m_head.load(std::memory_order_relaxed);
+                auto const next = control_at(curr)->m_next.load(std::memory_order_acquire);
+                if ((next & detail::ShmQueue_AllFlags) != detail::ShmQueue_Dead)
+                    break;
+
+                auto const next_control = next - detail::ShmQueue_Dead;
+                if (page_of(next_control) != page_of(curr))
+                {
+                    // sync must read the head and the released pages consistently
+                    std::lock_guard<std::mutex> lock(m_release_mutex);
+                    m_released_pages.store(
+                      m_released_pages.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+                    m_head.store(next_control, std::memory_order_relaxed);
+                }
+                else
+                    m_head.store(next_control, std::memory_order_relaxed);
+            }
+        }
+
+        /** Called after every commit of a put or a consume. Syncs if the policy requires it. */
+        void on_commit()
+        {
+            auto const commit_count = m_policy.commit_count();
+            if (
+              commit_count != 0 &&
+              m_unsynced_commits.fetch_add(1, std::memory_order_relaxed) + 1 >= commit_count)
+            {
+                sync();
+            }
+            else if (
+              m_policy.interval().count() != 0 &&
+              now() - m_last_sync.load(std::memory_order_relaxed) >= m_policy.interval().count())
+            {
+                sync();
+            }
+        }
+
+      private:
+        int         m_file_descriptor = -1;
+        void *      m_segment         = nullptr;
+        size_t      m_segment_size    = 0;
+        sync_policy m_policy;
+
+        // producers
+        std::mutex            m_tail_mutex; /**< used only if there are multiple producers */
+        uint64_t              m_tail           = 0;
+        uint64_t              m_acquired_pages = 0;
+        std::atomic<uint64_t> m_durable_released_pages{0};
+
+        // consumer
+        std::mutex            m_release_mutex; /**< protects the changes of m_released_pages */
+        std::atomic<uint64_t> m_head{0};
+        std::atomic<uint64_t> m_released_pages{0};
+
+        // sync
+        std::mutex            m_sync_mutex;
+        State                 m_synced = State(); /**< state written by the last sync */
+        std::atomic<uint32_t> m_unsynced_commits{0};
+        std::atomic<int64_t>  m_last_sync{0};
+    };
+
+} // namespace density
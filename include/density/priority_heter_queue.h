@@ -0,0 +1,709 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <density/lf_heter_queue.h>
+#include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier
+#endif
+
+namespace density
+{
+    namespace detail
+    {
+        /** \internal Returns the index of the least significant set bit. i_value can't be zero. */
+        inline size_t count_trailing_zeros(uint64_t i_value) noexcept
+        {
+            DENSITY_ASSERT_INTERNAL(i_value != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, i_value);
+            return index;
+#elif defined(__GNUC__) || defined(__clang__)
+            return static_cast<size_t>(__builtin_ctzll(i_value));
+#else
+            size_t index = 0;
+            while ((i_value & 1) == 0)
+            {
+                i_value >>= 1;
+                index++;
+            }
+            return index;
+#endif
+        }
+    } // namespace detail
+
+    /** Concurrent lock-free heterogeneous priority queue. Every element is put in a priority level, and consumers
+        get the elements of the highest non-empty level. Level 0 has the highest priority. Within a level the order
+        is FIFO.
+
+        @tparam RUNTIME_TYPE Runtime-type object used to store the actual complete type of each element.
+                This type must satisfy the requirements of \ref RuntimeType_requirements "RuntimeType". The default is runtime_type.
+        @tparam N_LEVELS number of priority levels. It must be between 1 and 64.
+        @tparam ALLOCATOR_TYPE Allocator type to be used. This type must satisfy the requirements of both \ref UntypedAllocator_requirements
+                "UntypedAllocator" and \ref PagedAllocator_requirements "PagedAllocator". The default is density::default_allocator.
+        @tparam PROD_CARDINALITY specifies whether multiple threads can do put transactions concurrently. Must be a member of density::concurrency_cardinality.
+        @tparam CONSUMER_CARDINALITY specifies whether multiple threads can do consume operations concurrently. Must be a member of density::concurrency_cardinality.
+
+        Every level is an lf_heter_queue, with its own page chain, so producers on different levels never touch the same
+        pages. The queue keeps a bitmap of the levels that may be non-empty: a consumer finds the highest non-empty level
+        with a single count-trailing-zeros on it, instead of polling every level. After a commit a producer reads the bit
+        of its level, and sets it only if it is clear, that is only on the transition from empty to non-empty. A consumer that
+        finds a level empty clears its bit, and then checks the level again, so that an element committed concurrently is
+        never left behind a clear bit.
+
+        Elements of different levels are not ordered with respect to each other: an element put in a high priority level after
+        an element of a lower level may be consumed first even if it has been put after the start of the consume.
+
+        \snippet priority_queue_examples.cpp priority_heter_queue example 1
+
+        \n <b>Thread safeness</b>: A thread doing put operations and another thread doing consumes don't need to be synchronized.
+                If PROD_CARDINALITY is concurrency_multiple, multiple threads are allowed to put without any synchronization.
+                If CONSUMER_CARDINALITY is concurrency_multiple, multiple threads are allowed to consume without any synchronization.
+        \n <b>Exception safeness</b>: Any function of priority_heter_queue is noexcept or provides the strong exception guarantee.
+    */
+    template <
+      typename RUNTIME_TYPE                        = runtime_type<>,
+      size_t                  N_LEVELS             = 8,
+      typename ALLOCATOR_TYPE                      = default_allocator,
+      concurrency_cardinality PROD_CARDINALITY     = concurrency_multiple,
+      concurrency_cardinality CONSUMER_CARDINALITY = concurrency_multiple>
+    class priority_heter_queue
+    {
+        static_assert(N_LEVELS >= 1 && N_LEVELS <= 64, "N_LEVELS must be between 1 and 64");
+
+      private:
+        /* Relaxed consistency is not supported: during the first phase of a put the level would be truncated,
+            and a consumer checking it again after clearing its bit could miss a committed element. */
+        using LevelQueue = lf_heter_queue<
+          RUNTIME_TYPE,
+          ALLOCATOR_TYPE,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          consistency_sequential>;
+
+      public:
+        /** Alias for the template arguments */
+        using runtime_type   = RUNTIME_TYPE;
+        using allocator_type = ALLOCATOR_TYPE;
+
+        /** Number of priority levels. */
+        static constexpr size_t levels = N_LEVELS;
+
+        /** Whether multiple threads can do put operations on the same queue without any further synchronization. */
+        static constexpr bool concurrent_puts = PROD_CARDINALITY == concurrency_multiple;
+
+        /** Whether multiple threads can do consume operations on the same queue without any further synchronization. */
+        static constexpr bool concurrent_consumes = CONSUMER_CARDINALITY == concurrency_multiple;
+
+        /** Whether puts and consumes can be done concurrently without any further synchronization. In any case unsynchronized concurrency is
+            constrained by concurrent_puts and concurrent_consumes. */
+        static constexpr bool concurrent_put_consumes = true;
+
+        /** Whether every level is sequential consistent. */
+        static constexpr bool is_seq_cst = true;
+
+        /** Default constructor. The allocator is default-constructed. */
+        priority_heter_queue() noexcept = default;
+
+        /** Copy construction is not allowed. */
+        priority_heter_queue(const priority_heter_queue &) = delete;
+
+        /** Copy assignment is not allowed. */
+        priority_heter_queue & operator=(const priority_heter_queue &) = delete;
+
+        /** Destructor: destroys all the elements. */
+        ~priority_heter_queue() = default;
+
+        /** Move-only class template that can be bound to a put transaction on a level, otherwise it's empty.
+            See lf_heter_queue::put_transaction. Committing the transaction marks the level as non-empty.
+
+            @tparam ELEMENT_COMPLETE_TYPE Complete type of elements that can be handled by a transaction, or void. */
+        template <typename ELEMENT_COMPLETE_TYPE = void> class put_transaction
+        {
+          public:
+            /** Constructs an empty put transaction */
+            put_transaction() noexcept = default;
+
+            /** Copy construction is not allowed. */
+            put_transaction(const put_transaction &) = delete;
+
+            /** Copy assignment is not allowed. */
+            put_transaction & operator=(const put_transaction &) = delete;
+
+            /** Move constructs a put_transaction, transferring the state from the source. */
+            template <
+              typename OTHERTYPE,
+              typename = typename std::enable_if<
+                std::is_same<OTHERTYPE, ELEMENT_COMPLETE_TYPE>::value ||
+                std::is_void<ELEMENT_COMPLETE_TYPE>::value>::type>
+            put_transaction(put_transaction<OTHERTYPE> && i_source) noexcept
+                : m_put(std::move(i_source.m_put)), m_queue(i_source.m_queue),
+                  m_level(i_source.m_level)
+            {
+            }
+
+            /** Move assigns a put_transaction, transferring the state from the source. If this object
+                is not empty, its transaction is canceled when the source is destroyed. */
+            template <
+              typename OTHERTYPE,
+              typename = typename std::enable_if<
+                std::is_same<OTHERTYPE, ELEMENT_COMPLETE_TYPE>::value ||
+                std::is_void<ELEMENT_COMPLETE_TYPE>::value>::type>
+            put_transaction & operator=(put_transaction<OTHERTYPE> && i_source) noexcept
+            {
+                using std::swap;
+                m_put = std::move(i_source.m_put);
+                swap(m_queue, i_source.m_queue);
+                swap(m_level, i_source.m_level);
+                return *this;
+            }
+
+            /** Swaps two instances of put_transaction. */
+            friend void swap(put_transaction & i_first, put_transaction & i_second) noexcept
+            {
+                using std::swap;
+                swap(i_first.m_put, i_second.m_put);
+                swap(i_first.m_queue, i_second.m_queue);
+                swap(i_first.m_level, i_second.m_level);
+            }
+
+            /** Allocates a memory block associated to the element being added. See lf_heter_queue::put_transaction::raw_allocate. */
+            void * raw_allocate(size_t i_size, size_t i_alignment)
+            {
+                return m_put.raw_allocate(i_size, i_alignment);
+            }
+
+            /** Allocates a memory block associated to the element being added, and copies the content from a range
+                of iterators. See lf_heter_queue::put_transaction::raw_allocate_copy. */
+            template <typename INPUT_ITERATOR>
+            typename std::iterator_traits<INPUT_ITERATOR>::value_type *
+              raw_allocate_copy(INPUT_ITERATOR i_begin, INPUT_ITERATOR i_end)
+            {
+                return m_put.raw_allocate_copy(i_begin, i_end);
+            }
+
+            /** Tries to allocate a memory block associated to the element being added, respecting a progress guarantee.
+                See lf_heter_queue::put_transaction::try_raw_allocate. */
+            void * try_raw_allocate(
+              progress_guarantee i_progress_guarantee, size_t i_size, size_t i_alignment) noexcept
+            {
+                return m_put.try_raw_allocate(i_progress_guarantee, i_size, i_alignment);
+            }
+
+            /** Makes the element observable, and marks its level as non-empty. This object becomes empty.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            void commit() noexcept
+            {
+                m_put.commit();
+                m_queue->notify_level(m_level);
+            }
+
+            /** Cancels the transaction. This object becomes empty.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            void cancel() noexcept { m_put.cancel(); }
+
+            /** Returns true whether this object is not currently bound to a transaction. */
+            bool empty() const noexcept { return m_put.empty(); }
+
+            /** Returns true whether this object is bound to a transaction. Same to !put_transaction::empty. */
+            explicit operator bool() const noexcept { return !m_put.empty(); }
+
+            /** Returns a pointer to the target queue if a transaction is bound, otherwise returns nullptr */
+            priority_heter_queue * queue() const noexcept
+            {
+                return !m_put.empty() ? m_queue : nullptr;
+            }
+
+            /** Returns the level of the element being added.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            size_t level() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_level;
+            }
+
+            /** Returns a pointer to the object being added.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            void * element_ptr() const noexcept { return m_put.element_ptr(); }
+
+            /** Returns a reference to the element being added.
+
+                \n <b>Requires</b>:
+                    - ELEMENT_COMPLETE_TYPE must not be void
+
+                \pre The behavior is undefined if this transaction is empty. */
+#ifndef DOXYGEN_DOC_GENERATION
+            template <
+              typename EL                                               = ELEMENT_COMPLETE_TYPE,
+              typename std::enable_if<!std::is_void<EL>::value>::type * = nullptr>
+            EL &
+#else
+            ELEMENT_COMPLETE_TYPE &
+#endif
+              element() const noexcept
+            {
+                return *static_cast<ELEMENT_COMPLETE_TYPE *>(element_ptr());
+            }
+
+            /** Returns the type of the object being added.
+
+                \pre The behavior is undefined if this transaction is empty. */
+            const RUNTIME_TYPE & complete_type() const noexcept { return m_put.complete_type(); }
+
+          private:
+            put_transaction(
+              typename LevelQueue::template put_transaction<ELEMENT_COMPLETE_TYPE> && i_put,
+              priority_heter_queue *                                                  i_queue,
+              size_t i_level) noexcept
+                : m_put(std::move(i_put)), m_queue(i_queue), m_level(i_level)
+            {
+            }
+            friend class priority_heter_queue;
+            template <typename OTHERTYPE> friend class put_transaction;
+
+          private:
+            typename LevelQueue::template put_transaction<ELEMENT_COMPLETE_TYPE> m_put;
+            priority_heter_queue * m_queue = nullptr;
+            size_t                 m_level = 0;
+        };
+
+        /** Move-only class that can be bound to a consume operation, otherwise it's empty. See lf_heter_queue::consume_operation.
+            If the operation is canceled, the element returns in its level, that is marked as non-empty. */
+        class consume_operation
+        {
+          public:
+            /** Constructs an empty consume operation */
+            consume_operation() noexcept = default;
+
+            /** Copy construction is not allowed */
+            consume_operation(const consume_operation &) = delete;
+
+            /** Copy assignment is not allowed */
+            consume_operation & operator=(const consume_operation &) = delete;
+
+            /** Move constructor. The source is left empty. */
+            consume_operation(consume_operation && i_source) noexcept
+                : m_consume(std::move(i_source.m_consume)), m_queue(i_source.m_queue),
+                  m_level(i_source.m_level)
+            {
+            }
+
+            /** Move assignment. The source is left in a valid but indeterminate state. */
+            consume_operation & operator=(consume_operation && i_source) noexcept
+            {
+                swap(*this, i_source);
+                return *this;
+            }
+
+            /** Destructor: cancel the operation (if any). */
+            ~consume_operation()
+            {
+                if (!empty())
+                    cancel();
+            }
+
+            /** Swaps two instances of consume_operation. */
+            friend void swap(consume_operation & i_first, consume_operation & i_second) noexcept
+            {
+                using std::swap;
+                swap(i_first.m_consume, i_second.m_consume);
+                swap(i_first.m_queue, i_second.m_queue);
+                swap(i_first.m_level, i_second.m_level);
+            }
+
+            /** Returns true whether this object does not hold the state of an operation. */
+            bool empty() const noexcept { return m_consume.empty(); }
+
+            /** Returns true whether this object holds the state of an operation. Same to !consume_operation::empty. */
+            explicit operator bool() const noexcept { return !m_consume.empty(); }
+
+            /** Returns a pointer to the target queue if an operation is bound, otherwise returns nullptr */
+            priority_heter_queue * queue() const noexcept
+            {
+                return !m_consume.empty() ? m_queue : nullptr;
+            }
+
+            /** Returns the level of the element being consumed.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            size_t level() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_level;
+            }
+
+            /** Destroys the element, making the consume irreversible. This consume_operation becomes empty.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void commit() noexcept { m_consume.commit(); }
+
+            /** Makes the consume irreversible without destroying the element. The caller should destroy the
+                element before calling this function. See lf_heter_queue::consume_operation::commit_nodestroy.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void commit_nodestroy() noexcept { m_consume.commit_nodestroy(); }
+
+            /** Cancels the operation, leaving the element in its level. This consume_operation becomes empty.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void cancel() noexcept
+            {
+                m_consume.cancel();
+                /* a consumer may have found the level empty while the element was busy */
+                m_queue->notify_level(m_level);
+            }
+
+            /** Returns the type of the element being consumed.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            const RUNTIME_TYPE & complete_type() const noexcept { return m_consume.complete_type(); }
+
+            /** Returns a pointer that, if properly aligned to the alignment of the element type, points to the element.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void * unaligned_element_ptr() const noexcept
+            {
+                return m_consume.unaligned_element_ptr();
+            }
+
+            /** Returns a pointer to the element being consumed.
+
+                \pre The behavior is undefined if this consume_operation is empty. */
+            void * element_ptr() const noexcept { return m_consume.element_ptr(); }
+
+            /** Returns a reference to the element being consumed.
+
+                \pre The behavior is undefined if this consume_operation is empty.
+                \pre The behavior is undefined if COMPLETE_ELEMENT_TYPE is not exactly the complete type of the element. */
+            template <typename COMPLETE_ELEMENT_TYPE>
+            COMPLETE_ELEMENT_TYPE & element() const noexcept
+            {
+                return m_consume.template element<COMPLETE_ELEMENT_TYPE>();
+            }
+
+          private:
+            typename LevelQueue::consume_operation m_consume;
+            priority_heter_queue *                 m_queue = nullptr;
+            size_t                                 m_level = 0;
+            friend class priority_heter_queue;
+        };
+
+        /** Appends an element at the end of a level, copy-constructing or move-constructing it from the source.
+                @param i_level priority level of the element. It must be less than N_LEVELS.
+                @param i_source object to be used as source to construct of new element.
+
+            \snippet priority_queue_examples.cpp priority_heter_queue example 1 */
+        template <typename ELEMENT_TYPE> void push(size_t i_level, ELEMENT_TYPE && i_source)
+        {
+            start_push(i_level, std::forward<ELEMENT_TYPE>(i_source)).commit();
+        }
+
+        /** Appends an element at the end of a level, in-place constructing it from a perfect forwarded parameter pack. */
+        template <typename ELEMENT_TYPE, typename... CONSTRUCTION_PARAMS>
+        void emplace(size_t i_level, CONSTRUCTION_PARAMS &&... i_construction_params)
+        {
+            start_emplace<ELEMENT_TYPE>(
+              i_level, std::forward<CONSTRUCTION_PARAMS>(i_construction_params)...)
+              .commit();
+        }
+
+        /** Appends an element of a type known at runtime at the end of a level, default-constructing it. */
+        void dyn_push(size_t i_level, const runtime_type & i_type)
+        {
+            start_dyn_push(i_level, i_type).commit();
+        }
+
+        /** Appends an element of a type known at runtime at the end of a level, copy-constructing it from the source. */
+        void dyn_push_copy(size_t i_level, const runtime_type & i_type, const void * i_source)
+        {
+            start_dyn_push_copy(i_level, i_type, i_source).commit();
+        }
+
+        /** Appends an element of a type known at runtime at the end of a level, move-constructing it from the source. */
+        void dyn_push_move(size_t i_level, const runtime_type & i_type, void * i_source)
+        {
+            start_dyn_push_move(i_level, i_type, i_source).commit();
+        }
+
+        /** Begins a transaction that appends an element at the end of a level, copy-constructing or move-constructing
+            it from the source. See lf_heter_queue::start_push.
+
+            \snippet priority_queue_examples.cpp priority_heter_queue start_push example 1 */
+        template <typename ELEMENT_TYPE>
+        put_transaction<typename std::decay<ELEMENT_TYPE>::type>
+          start_push(size_t i_level, ELEMENT_TYPE && i_source)
+        {
+            return start_emplace<typename std::decay<ELEMENT_TYPE>::type>(
+              i_level, std::forward<ELEMENT_TYPE>(i_source));
+        }
+
+        /** Begins a transaction that appends an element at the end of a level, in-place constructing it from a perfect
+            forwarded parameter pack. See lf_heter_queue::start_emplace. */
+        template <typename ELEMENT_TYPE, typename... CONSTRUCTION_PARAMS>
+        put_transaction<ELEMENT_TYPE>
+          start_emplace(size_t i_level, CONSTRUCTION_PARAMS &&... i_construction_params)
+        {
+            return put_transaction<ELEMENT_TYPE>(
+              level_queue(i_level).template start_emplace<ELEMENT_TYPE>(
+                std::forward<CONSTRUCTION_PARAMS>(i_construction_params)...),
+              this,
+              i_level);
+        }
+
+        /** Begins a transaction that appends an element of a type known at runtime at the end of a level,
+            default-constructing it. See lf_heter_queue::start_dyn_push. */
+        put_transaction<> start_dyn_push(size_t i_level, const runtime_type & i_type)
+        {
+            return put_transaction<>(level_queue(i_level).start_dyn_push(i_type), this, i_level);
+        }
+
+        /** Begins a transaction that appends an element of a type known at runtime at the end of a level,
+            copy-constructing it from the source. See lf_heter_queue::start_dyn_push_copy. */
+        put_transaction<>
+          start_dyn_push_copy(size_t i_level, const runtime_type & i_type, const void * i_source)
+        {
+            return put_transaction<>(
+              level_queue(i_level).start_dyn_push_copy(i_type, i_source), this, i_level);
+        }
+
+        /** Begins a transaction that appends an element of a type known at runtime at the end of a level,
+            move-constructing it from the source. See lf_heter_queue::start_dyn_push_move. */
+        put_transaction<>
+          start_dyn_push_move(size_t i_level, const runtime_type & i_type, void * i_source)
+        {
+            return put_transaction<>(
+              level_queue(i_level).start_dyn_push_move(i_type, i_source), this, i_level);
+        }
+
+        /** Tries to append an element at the end of a level, respecting a progress guarantee. See lf_heter_queue::try_push.
+            @return whether the element has been added */
+        template <typename ELEMENT_TYPE>
+        bool try_push(
+          progress_guarantee i_progress_guarantee,
+          size_t             i_level,
+          ELEMENT_TYPE &&    i_source) noexcept(noexcept(std::declval<priority_heter_queue>()
+                                                          .try_start_push(
+                                                            i_progress_guarantee,
+                                                            i_level,
+                                                            std::forward<ELEMENT_TYPE>(i_source))))
+        {
+            auto transaction =
+              try_start_push(i_progress_guarantee, i_level, std::forward<ELEMENT_TYPE>(i_source));
+            if (!transaction)
+                return false;
+            transaction.commit();
+            return true;
+        }
+
+        /** Tries to append an element at the end of a level, in-place constructing it, respecting a progress guarantee.
+            See lf_heter_queue::try_emplace.
+            @return whether the element has been added */
+        template <typename ELEMENT_TYPE, typename... CONSTRUCTION_PARAMS>
+        bool try_emplace(
+          progress_guarantee i_progress_guarantee,
+          size_t             i_level,
+          CONSTRUCTION_PARAMS &&... i_construction_params)
+        {
+            auto transaction = try_start_emplace<ELEMENT_TYPE>(
+              i_progress_guarantee,
+              i_level,
+              std::forward<CONSTRUCTION_PARAMS>(i_construction_params)...);
+            if (!transaction)
+                return false;
+            transaction.commit();
+            return true;
+        }
+
+        /** Tries to append an element of a type known at runtime at the end of a level, respecting a progress guarantee.
+            See lf_heter_queue::try_dyn_push.
+            @return whether the element has been added */
+        bool try_dyn_push(
+          progress_guarantee i_progress_guarantee, size_t i_level, const runtime_type & i_type)
+        {
+            auto transaction = try_start_dyn_push(i_progress_guarantee, i_level, i_type);
+            if (!transaction)
+                return false;
+            transaction.commit();
+            return true;
+        }
+
+        /** Tries to begin a transaction that appends an element at the end of a level, respecting a progress guarantee.
+            See lf_heter_queue::try_start_push.
+            @return The associated transaction object, that is empty in case of failure. */
+        template <typename ELEMENT_TYPE>
+        put_transaction<typename std::decay<ELEMENT_TYPE>::type> try_start_push(
+          progress_guarantee i_progress_guarantee,
+          size_t             i_level,
+          ELEMENT_TYPE &&    i_source) noexcept(noexcept(std::declval<LevelQueue>()
+                                                          .try_start_push(
+                                                            i_progress_guarantee,
+                                                            std::forward<ELEMENT_TYPE>(i_source))))
+        {
+            return put_transaction<typename std::decay<ELEMENT_TYPE>::type>(
+              level_queue(i_level).try_start_push(
+                i_progress_guarantee, std::forward<ELEMENT_TYPE>(i_source)),
+              this,
+              i_level);
+        }
+
+        /** Tries to begin a transaction that appends an element at the end of a level, in-place constructing it,
+            respecting a progress guarantee. See lf_heter_queue::try_start_emplace.
+            @return The associated transaction object, that is empty in case of failure. */
+        template <typename ELEMENT_TYPE, typename... CONSTRUCTION_PARAMS>
+        put_transaction<ELEMENT_TYPE> try_start_emplace(
+          progress_guarantee i_progress_guarantee,
+          size_t             i_level,
+          CONSTRUCTION_PARAMS &&... i_construction_params)
+        {
+            return put_transaction<ELEMENT_TYPE>(
+              level_queue(i_level).template try_start_emplace<ELEMENT_TYPE>(
+                i_progress_guarantee, std::forward<CONSTRUCTION_PARAMS>(i_construction_params)...),
+              this,
+              i_level);
+        }
+
+        /** Tries to begin a transaction that appends an element of a type known at runtime at the end of a level,
+            respecting a progress guarantee. See lf_heter_queue::try_start_dyn_push.
+            @return The associated transaction object, that is empty in case of failure. */
+        put_transaction<> try_start_dyn_push(
+          progress_guarantee i_progress_guarantee, size_t i_level, const runtime_type & i_type)
+        {
+            return put_transaction<>(
+              level_queue(i_level).try_start_dyn_push(i_progress_guarantee, i_type), this, i_level);
+        }
+
+        /** Tries to start a consume operation on the first element of the highest non-empty level.
+            @return a consume_operation which is empty if there are no elements to consume
+
+            \snippet priority_queue_examples.cpp priority_heter_queue try_start_consume example 1 */
+        consume_operation try_start_consume() noexcept
+        {
+            consume_operation consume;
+            try_start_consume(consume);
+            return consume;
+        }
+
+        /** Tries to start a consume operation using an existing consume_operation object. This overload is
+            faster than the one taking no arguments if the consumed elements are often in the same level,
+            because the queue does not need to pin a page at every call.
+            @param i_consume reference to a consume_operation to be used. If it is non-empty
+                it gets canceled before trying to start the new consume.
+            @return whether i_consume is non-empty after the call, that is whether the queue was
+                not empty. */
+        bool try_start_consume(consume_operation & i_consume) noexcept
+        {
+            if (!i_consume.empty())
+                i_consume.cancel();
+
+            for (;;)
+            {
+                uint64_t const non_empty_levels = m_non_empty_levels.load(std::memory_order_relaxed);
+                if (non_empty_levels == 0)
+                    return false;
+
+                auto const level = detail::count_trailing_zeros(non_empty_levels);
+                if (start_consume_on_level(i_consume, level))
+                    return true;
+
+                /* The level looks empty: its bit is cleared, and then the level is checked again. A producer
+                    that has committed an element before the fence may have seen the bit still set, and
+                    didn't set it. The fence pairs with the one in notify_level. */
+                uint64_t const bit = uint64_t(1) << level;
+                m_non_empty_levels.fetch_and(~bit, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (start_consume_on_level(i_consume, level))
+                {
+                    m_non_empty_levels.fetch_or(bit, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+
+        /** Removes the first element of the highest non-empty level, if any.
+            @return whether an element was removed, that is whether the queue was not empty. */
+        bool try_pop() noexcept
+        {
+            if (auto consume = try_start_consume())
+            {
+                consume.commit();
+                return true;
+            }
+            return false;
+        }
+
+        /** Deletes all the elements in the queue. */
+        void clear() noexcept
+        {
+            consume_operation consume;
+            while (try_start_consume(consume))
+                consume.commit();
+        }
+
+        /** Returns whether the queue contains no elements. Only the levels marked as non-empty are checked. */
+        bool empty() const noexcept
+        {
+            uint64_t non_empty_levels = m_non_empty_levels.load(std::memory_order_relaxed);
+            while (non_empty_levels != 0)
+            {
+                auto const level = detail::count_trailing_zeros(non_empty_levels);
+                if (!m_levels[level].empty())
+                    return false;
+                non_empty_levels &= non_empty_levels - 1;
+            }
+            return true;
+        }
+
+      private:
+        LevelQueue & level_queue(size_t i_level) noexcept
+        {
+            DENSITY_ASSERT(i_level < N_LEVELS);
+            return m_levels[i_level];
+        }
+
+        bool start_consume_on_level(consume_operation & i_consume, size_t i_level) noexcept
+        {
+            if (i_consume.m_queue != nullptr && i_consume.m_level != i_level)
+            {
+                /* the page pinned on the previous level must be unpinned by its queue */
+                typename LevelQueue::consume_operation previous(std::move(i_consume.m_consume));
+            }
+            i_consume.m_queue = this;
+            i_consume.m_level = i_level;
+            return m_levels[i_level].try_start_consume(i_consume.m_consume);
+        }
+
+        /** Marks a level as non-empty after an element has been committed in it, or after a consume has been canceled.
+            The fence orders the commit before the load of the bit, and pairs with the fence in try_start_consume. */
+        void notify_level(size_t i_level) noexcept
+        {
+            uint64_t const bit = uint64_t(1) << i_level;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if ((m_non_empty_levels.load(std::memory_order_relaxed) & bit) == 0)
+                m_non_empty_levels.fetch_or(bit, std::memory_order_relaxed);
+        }
+
+      private:
+        LevelQueue m_levels[N_LEVELS];
+        alignas(destructive_interference_size) std::atomic<uint64_t> m_non_empty_levels{0};
+    };
+
+} // namespace density
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
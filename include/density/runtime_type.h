@@ -5,6 +5,7 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #pragma once
+#include <cstring>
 #include <density/density_common.h>
 #include <density/detail/runtime_type_internals.h>
 #include <functional> // for std::hash
@@ -21,8 +22,8 @@ namespace density
 
         Each type in the template arguments is either:
         - a type satisfying the requirements of [TypeFeature](TypeFeature_requirements.html), like a built-in type feature
-          (f_size, f_alignment, f_default_construct, f_copy_construct, f_move_construct, f_destroy, f_hash, f_rtti, f_equal,
-          f_less, f_istream, f_ostream), or a user defined type feature.
+          (f_size, f_alignment, f_default_construct, f_copy_construct, f_move_construct, f_relocate, f_destroy, f_hash, f_rtti,
+          f_equal, f_less, f_istream, f_ostream), or a user defined type feature.
         - a nested feature_list
         - the special tag type f_none
 
@@ -349,6 +350,82 @@ namespace density
         }
     };
 
+    /** Traits that tells whether an object of type TYPE can be relocated (moved to another storage, ending the
+        lifetime of the source) by copying its bytes. The default is true for trivially copyable types. Users
+        can specialize this template for types that do not depend on their address, like most implementations of
+        std::unique_ptr or std::vector, to enable the fast path of f_relocate.
+
+        \snippet runtime_type_examples.cpp f_relocate example 1 */
+    template <typename TYPE>
+    struct is_trivially_relocatable
+        : std::integral_constant<bool, std::is_trivially_copyable<TYPE>::value>
+    {
+    };
+
+    /** Relocates an instance of the target type from a storage to another: the object is move-constructed to
+        the destination, and the source is destroyed. If is_trivially_relocatable is true for the target type, the
+        relocation is a memcpy, and no function pointer is invoked. The target type must satisfy the requirements of
+        [MoveConstructible](https://en.cppreference.com/w/cpp/named_req/MoveConstructible) and
+        [Destructible](https://en.cppreference.com/w/cpp/named_req/Destructible).
+
+        This feature also tells whether the target type is trivially copyable: the heterogeneous queues use this
+        information to copy and move such elements with memcpy, and to copy whole runs of them at once.
+
+        \snippet runtime_type_examples.cpp f_relocate example 2 */
+    class f_relocate
+    {
+      public:
+        /** Creates an instance of this feature bound to the specified target type */
+        template <typename TARGET_TYPE> constexpr static f_relocate make() noexcept
+        {
+            return f_relocate{
+              is_trivially_relocatable<TARGET_TYPE>::value ? nullptr : &invoke<TARGET_TYPE>,
+              sizeof(TARGET_TYPE),
+              std::is_trivially_copyable<TARGET_TYPE>::value};
+        }
+
+        /** Relocates an instance of the target type to an uninitialized memory buffer.
+            @param i_dest where the target object must be constructed. Can't be null. If the buffer
+                pointed by this parameter does not respect the size and alignment of the target type,
+                the behavior is undefined.
+            @param i_source pointer to the source object. Can't be null. If the dynamic type of the
+                pointed object is not the target type (assigned by the function make), the behavior is
+                undefined. After the call the source object is destroyed. If the move constructor throws,
+                the source object is not destroyed. */
+        void operator()(void * i_dest, void * i_source) const
+        {
+            if (m_function == nullptr)
+                memcpy(i_dest, i_source, m_size);
+            else
+                (*m_function)(i_dest, i_source);
+        }
+
+        /** Returns whether the target type is trivially relocatable. */
+        constexpr bool is_trivial() const noexcept { return m_function == nullptr; }
+
+        /** Returns whether the target type is trivially copyable, so that it can be copied or moved with memcpy,
+            without destroying the source. A trivially copyable type is also trivially relocatable. */
+        constexpr bool is_trivially_copyable() const noexcept { return m_trivially_copyable; }
+
+      private:
+        using Function = void (*)(void * i_dest, void * i_source);
+        Function const m_function;
+        size_t const   m_size;
+        bool const     m_trivially_copyable;
+        constexpr f_relocate(Function i_function, size_t i_size, bool i_trivially_copyable)
+            : m_function(i_function), m_size(i_size), m_trivially_copyable(i_trivially_copyable)
+        {
+        }
+        template <typename TARGET_TYPE> static void invoke(void * i_dest, void * i_source)
+        {
+            DENSITY_ASSUME(i_dest != nullptr);
+            DENSITY_ASSUME(i_source != nullptr);
+            TARGET_TYPE & source = *static_cast<TARGET_TYPE *>(i_source);
+            new (i_dest) TARGET_TYPE(std::move(source));
+            source.TARGET_TYPE::~TARGET_TYPE();
+        }
+    };
+
     /** Compares two objects for equality. The target type must satisfy the requirements of
         [EqualityComparable](https://en.cppreference.com/w/cpp/named_req/EqualityComparable). */
     class f_equal
@@ -1052,10 +1129,93 @@ namespace density
       private:
 #ifndef DOXYGEN_DOC_GENERATION
         template <typename...> friend class runtime_type;
+        template <typename...> friend class compact_runtime_type;
         friend struct std::hash<density::runtime_type<FEATURES...>>;
 #endif
         const tuple_type * m_feature_table = nullptr;
     };
+
+    namespace detail
+    {
+        /** Whether RUNTIME_TYPE has a feature list including f_relocate */
+        template <typename RUNTIME_TYPE, typename = void>
+        struct RuntimeTypeHasRelocate : std::false_type
+        {
+        };
+        template <typename RUNTIME_TYPE>
+        struct RuntimeTypeHasRelocate<
+          RUNTIME_TYPE,
+          typename std::enable_if<
+            has_features<typename RUNTIME_TYPE::feature_list_type, f_relocate>::value>::type>
+            : std::true_type
+        {
+        };
+
+        template <typename RUNTIME_TYPE>
+        void relocate_object(
+          const RUNTIME_TYPE & i_type, void * i_dest, void * i_source, std::true_type)
+        {
+            i_type.template get_feature<f_relocate>()(i_dest, i_source);
+        }
+
+        template <typename RUNTIME_TYPE>
+        void relocate_object(
+          const RUNTIME_TYPE & i_type, void * i_dest, void * i_source, std::false_type)
+        {
+            i_type.move_construct(i_dest, i_source);
+            i_type.destroy(i_source);
+        }
+
+        /** Relocates an object with f_relocate, if the runtime type supports it, or otherwise with
+            move_construct followed by destroy. */
+        template <typename RUNTIME_TYPE>
+        void relocate_object(const RUNTIME_TYPE & i_type, void * i_dest, void * i_source)
+        {
+            relocate_object(i_type, i_dest, i_source, RuntimeTypeHasRelocate<RUNTIME_TYPE>());
+        }
+
+        template <typename RUNTIME_TYPE>
+        bool is_trivially_copyable_object(const RUNTIME_TYPE & i_type, std::true_type) noexcept
+        {
+            return i_type.template get_feature<f_relocate>().is_trivially_copyable();
+        }
+
+        template <typename RUNTIME_TYPE>
+        bool is_trivially_copyable_object(const RUNTIME_TYPE &, std::false_type) noexcept
+        {
+            return false;
+        }
+
+        /** Returns whether the runtime type supports f_relocate, and its target type is trivially copyable. */
+        template <typename RUNTIME_TYPE>
+        bool is_trivially_copyable_object(const RUNTIME_TYPE & i_type) noexcept
+        {
+            return is_trivially_copyable_object(i_type, RuntimeTypeHasRelocate<RUNTIME_TYPE>());
+        }
+
+        /** Copy-constructs an object with memcpy if it is trivially copyable, or otherwise with
+            copy_construct. */
+        template <typename RUNTIME_TYPE>
+        void copy_construct_object(
+          const RUNTIME_TYPE & i_type, void * i_dest, const void * i_source)
+        {
+            if (is_trivially_copyable_object(i_type))
+                memcpy(i_dest, i_source, i_type.size());
+            else
+                i_type.copy_construct(i_dest, i_source);
+        }
+
+        /** Move-constructs an object with memcpy if it is trivially copyable, or otherwise with
+            move_construct. */
+        template <typename RUNTIME_TYPE>
+        void move_construct_object(const RUNTIME_TYPE & i_type, void * i_dest, void * i_source)
+        {
+            if (is_trivially_copyable_object(i_type))
+                memcpy(i_dest, i_source, i_type.size());
+            else
+                i_type.move_construct(i_dest, i_source);
+        }
+    } // namespace detail
 } // namespace density
 
 namespace std
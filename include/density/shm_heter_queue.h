@@ -0,0 +1,856 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <density/density_common.h>
+#include <density/mutexes.h>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "shm_heter_queue requires a POSIX system"
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace density
+{
+    namespace detail
+    {
+        /** \internal Flags of the link of a ShmQueueControl. */
+        enum ShmQueue_Flags : uint64_t
+        {
+            ShmQueue_Busy     = 1, /**< set while an element is being put or consumed */
+            ShmQueue_Dead     = 2, /**< set on consumed or canceled elements, and on links to the next page */
+            ShmQueue_AllFlags = ShmQueue_Busy | ShmQueue_Dead
+        };
+
+        /** \internal Control block of an element of a shm_heter_queue. Since the segment is mapped at
+            different addresses in different processes, links are offsets from the beginning of the segment. */
+        struct ShmQueueControl
+        {
+            std::atomic<uint64_t> m_next; /**< offset of the next control block, bitwise-or-ed with ShmQueue_Flags.
+                                            Zero if this is the end of the queue. */
+            uint32_t m_type;           /**< type tag of the element */
+            uint32_t m_size;           /**< size of the element */
+            uint32_t m_element_offset; /**< offset of the element from the control block */
+        };
+
+        /** \internal Header at the beginning of the segment of a shm_heter_queue. The members used by producers
+            and the ones used by the consumer are on different cache lines. */
+        struct ShmQueueHeader
+        {
+            std::atomic<uint64_t> m_magic; /**< s_shm_queue_magic when the segment is initialized */
+            uint64_t              m_producer_cardinality;
+            uint64_t              m_page_size;
+            uint64_t              m_page_count;
+            uint64_t              m_first_page; /**< offset of the first page */
+
+            alignas(64) std::atomic<uint32_t> m_tail_lock; /**< spinlock of the producers, if they are multiple */
+            uint64_t m_tail;           /**< offset of the last control block, that has m_next == 0 */
+            uint64_t m_acquired_pages; /**< number of pages ever acquired by the producers */
+
+            alignas(64) uint64_t m_head; /**< offset of the first control block that is not dead */
+            std::atomic<uint64_t> m_released_pages; /**< number of pages ever released by the consumer */
+        };
+
+        constexpr uint64_t s_shm_queue_magic = 0x64656e7369747971; // "densityq"
+
+        /** \internal Returns the maximum size of an element with the specified alignment in a page of a
+            queue made of ShmQueueControl blocks, or zero if the alignment leaves no room in the page. Used
+            by shm_heter_queue and persistent_heter_queue. */
+        inline size_t shm_queue_max_element_size(size_t i_page_size, size_t i_alignment) noexcept
+        {
+            auto const overhead =
+              2 * sizeof(ShmQueueControl) + size_max(i_alignment, alignof(ShmQueueControl));
+            return i_page_size > overhead ? i_page_size - overhead : 0;
+        }
+
+        /** \internal Throws std::length_error with the specified message if an element with the specified
+            size and alignment can't fit in a page of a queue made of ShmQueueControl blocks. */
+        inline void shm_queue_check_element_size(
+          size_t i_page_size, size_t i_size, size_t i_alignment, const char * i_message)
+        {
+            if (
+              i_alignment + 2 * sizeof(ShmQueueControl) >= i_page_size ||
+              i_size > shm_queue_max_element_size(i_page_size, i_alignment))
+            {
+                throw std::length_error(i_message);
+            }
+        }
+
+    } // namespace detail
+
+    /** Heterogeneous FIFO queue that lives in a memory segment shared between processes. Elements are handed
+        from producers to the consumer without copying them: an element is allocated directly in the segment, the
+        producer writes it, and the consumer reads it in place.
+
+        @tparam PROD_CARDINALITY specifies whether multiple threads or processes can put concurrently. With
+            concurrency_multiple producers serialize the allocation with a spinlock in the segment, while the element is
+            written outside the lock. The consumer is always single: only one thread of one process can consume at a time.
+
+        Runtime types can't be shared between processes (their feature tables are at different addresses in
+        different processes), so elements are trivially copyable objects or raw blocks, and are identified by a
+        type tag (a 32-bit integer) chosen by the user.
+
+        The segment is divided in pages of fixed size, which are used circularly: the consumer releases a page when
+        it has consumed all its elements, and producers reuse the oldest released page. When all the pages are in use
+        the queue is full: try_ functions fail, while the other put functions wait. Elements can't be bigger than a
+        page (see max_element_size).
+
+        A queue can be created from the name of a POSIX shared memory object (see shm_open), or from a file
+        descriptor, for example a descriptor returned by memfd_create and passed to other processes. Any process that
+        maps the segment can put, and one at a time can consume. If a process dies while owning the spinlock of
+        the producers, or while a put is in progress, the queue remains blocked.
+
+        A shm_heter_queue object is movable but not copyable. The destructor unmaps the segment, but does not remove
+        the shared memory object (see unlink).
+
+        \snippet shm_queue_examples.cpp shm_heter_queue example 1 */
+    template <concurrency_cardinality PROD_CARDINALITY = concurrency_multiple> class shm_heter_queue
+    {
+      private:
+        using ControlBlock = detail::ShmQueueControl;
+        using Header       = detail::ShmQueueHeader;
+
+        static_assert(
+          ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+          "atomics shared between processes must be lock-free");
+
+        /** Alignment of the control blocks. All the blocks in a page are aligned at least to this value. */
+        constexpr static size_t s_block_alignment = alignof(ControlBlock);
+
+        /** Alignment of the beginning of the first page, relative to the beginning of the segment. */
+        constexpr static size_t s_first_page_alignment = 64;
+
+      public:
+        /** Default size of the pages, in bytes. */
+        static constexpr size_t default_page_size = 64 * 1024;
+
+        /** Maximum alignment of the elements. The segment is mapped at addresses aligned at least to this value. */
+        static constexpr size_t max_alignment = 4096;
+
+        /** Type of the transaction returned by the put functions. */
+        class put_transaction;
+
+        /** Type of the consume operation returned by try_start_consume. */
+        class consume_operation;
+
+        /** Creates a POSIX shared memory object with the specified name, and initializes a new queue in it.
+                @param i_name name of the shared memory object. See shm_open.
+                @param i_page_count number of pages of the queue. Must be at least 2.
+                @param i_page_size size of the pages. Must be a multiple of 64, at least 1024, and less than 4 GiB.
+
+            <b>Throws</b>: std::system_error if the shared memory object already exists, or if the system fails
+                to create or map it. std::invalid_argument if the page count or size is invalid.
+
+        \snippet shm_queue_examples.cpp shm_heter_queue create example 1 */
+        shm_heter_queue(
+          const char * i_name, size_t i_page_count, size_t i_page_size = default_page_size)
+        {
+            check_layout(i_page_count, i_page_size);
+            auto const file_descriptor = ::shm_open(i_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (file_descriptor < 0)
+                throw std::system_error(errno, std::system_category(), "shm_open");
+            m_file_descriptor = file_descriptor;
+            try
+            {
+                create_segment(i_page_count, i_page_size);
+            }
+            catch (...)
+            {
+                ::shm_unlink(i_name);
+                throw;
+            }
+        }
+
+        /** Opens a POSIX shared memory object with the specified name, that contains a queue created by another
+            shm_heter_queue with the same PROD_CARDINALITY.
+
+            <b>Throws</b>: std::system_error if the system fails to open or map the shared memory object.
+                std::runtime_error if the shared memory object does not contain an initialized queue.
+
+        \snippet shm_queue_examples.cpp shm_heter_queue create example 1 */
+        explicit shm_heter_queue(const char * i_name)
+        {
+            auto const file_descriptor = ::shm_open(i_name, O_RDWR, 0600);
+            if (file_descriptor < 0)
+                throw std::system_error(errno, std::system_category(), "shm_open");
+            m_file_descriptor = file_descriptor;
+            open_segment();
+        }
+
+        /** Initializes a new queue in a file, for example a descriptor returned by memfd_create. The file is
+            resized to fit the pages. The queue uses a duplicate of the descriptor, so the caller keeps the
+            ownership of i_file_descriptor.
+
+            <b>Throws</b>: std::system_error if the system fails to resize or map the file.
+                std::invalid_argument if the page count or size is invalid.
+
+        \snippet shm_queue_examples.cpp shm_heter_queue file_descriptor example 1 */
+        shm_heter_queue(
+          int i_file_descriptor, size_t i_page_count, size_t i_page_size = default_page_size)
+        {
+            check_layout(i_page_count, i_page_size);
+            duplicate_descriptor(i_file_descriptor);
+            create_segment(i_page_count, i_page_size);
+        }
+
+        /** Opens a queue previously initialized in a file. The queue uses a duplicate of the descriptor, so the
+            caller keeps the ownership of i_file_descriptor.
+
+            <b>Throws</b>: std::system_error if the system fails to map the file.
+                std::runtime_error if the file does not contain an initialized queue.
+
+        \snippet shm_queue_examples.cpp shm_heter_queue file_descriptor example 1 */
+        explicit shm_heter_queue(int i_file_descriptor)
+        {
+            duplicate_descriptor(i_file_descriptor);
+            open_segment();
+        }
+
+        /** Move constructor. The source is left empty: the only function that can be called on it is the destructor. */
+        shm_heter_queue(shm_heter_queue && i_source) noexcept
+            : m_file_descriptor(i_source.m_file_descriptor), m_segment(i_source.m_segment),
+              m_segment_size(i_source.m_segment_size)
+        {
+            i_source.m_file_descriptor = -1;
+            i_source.m_segment         = nullptr;
+            i_source.m_segment_size    = 0;
+        }
+
+        /** Move assignment. The source is left empty: the only function that can be called on it is the destructor. */
+        shm_heter_queue & operator=(shm_heter_queue && i_source) noexcept
+        {
+            swap(*this, i_source);
+            return *this;
+        }
+
+        /** Swaps two queues. */
+        friend void swap(shm_heter_queue & i_first, shm_heter_queue & i_second) noexcept
+        {
+            using std::swap;
+            swap(i_first.m_file_descriptor, i_second.m_file_descriptor);
+            swap(i_first.m_segment, i_second.m_segment);
+            swap(i_first.m_segment_size, i_second.m_segment_size);
+        }
+
+        /** Unmaps the segment and closes the file descriptor. The elements in the queue are not affected. */
+        ~shm_heter_queue()
+        {
+            if (m_segment != nullptr)
+                ::munmap(m_segment, m_segment_size);
+            if (m_file_descriptor >= 0)
+                ::close(m_file_descriptor);
+        }
+
+        /** Removes the name of a POSIX shared memory object. Processes that have mapped it can continue to use it,
+            and the memory is released when the last mapping is removed. Returns false if the name does not exist. */
+        static bool unlink(const char * i_name) noexcept { return ::shm_unlink(i_name) == 0; }
+
+        /** Returns the file descriptor of the segment, that can be passed to another process. */
+        int file_descriptor() const noexcept { return m_file_descriptor; }
+
+        /** Returns the size of the pages. */
+        size_t page_size() const noexcept { return static_cast<size_t>(header().m_page_size); }
+
+        /** Returns the number of pages. */
+        size_t page_count() const noexcept { return static_cast<size_t>(header().m_page_count); }
+
+        /** Returns the maximum size of an element with the specified alignment. Returns zero if the
+            alignment is too big for the pages: such elements can't be put. */
+        size_t max_element_size(size_t i_alignment = alignof(std::max_align_t)) const noexcept
+        {
+            return detail::shm_queue_max_element_size(page_size(), i_alignment);
+        }
+
+        /** Returns whether the queue contains no elements. Elements being put or consumed are not considered.
+            This function can be called only by the consumer.
+
+            <b>Complexity</b>: Unspecified. */
+        bool empty() const noexcept
+        {
+            for (auto curr = header().m_head;;)
+            {
+                auto const next = control_at(curr)->m_next.load(std::memory_order_acquire);
+                if (next == 0)
+                    return true;
+                if ((next & detail::ShmQueue_AllFlags) == 0)
+                    return false;
+                curr = next & ~static_cast<uint64_t>(detail::ShmQueue_AllFlags);
+            }
+        }
+
+        /** Move-only class that can be bound to a put transaction, otherwise it's empty. The element becomes
+            observable by the consumer when the transaction is committed. Destroying a non-empty transaction
+            cancels it. */
+        class put_transaction
+        {
+          public:
+            /** Constructs an empty put transaction */
+            put_transaction() noexcept = default;
+
+            /** Copy construction is not allowed */
+            put_transaction(const put_transaction &) = delete;
+
+            /** Copy assignment is not allowed */
+            put_transaction & operator=(const put_transaction &) = delete;
+
+            /** Move constructs a put_transaction, transferring the state from the source. */
+            put_transaction(put_transaction && i_source) noexcept
+                : m_queue(i_source.m_queue), m_control(i_source.m_control)
+            {
+                i_source.m_queue = nullptr;
+            }
+
+            /** Move assigns a put_transaction, transferring the state from the source. */
+            put_transaction & operator=(put_transaction && i_source) noexcept
+            {
+                if (this != &i_source)
+                {
+                    if (!empty())
+                        cancel();
+                    m_queue          = i_source.m_queue;
+                    m_control        = i_source.m_control;
+                    i_source.m_queue = nullptr;
+                }
+                return *this;
+            }
+
+            /** If this transaction is not empty, cancels it. */
+            ~put_transaction()
+            {
+                if (!empty())
+                    cancel();
+            }
+
+            /** Returns true whether this object does not hold the state of a transaction. */
+            bool empty() const noexcept { return m_queue == nullptr; }
+
+            /** Returns true whether this object holds the state of a transaction. */
+            explicit operator bool() const noexcept { return m_queue != nullptr; }
+
+            /** Returns the type tag of the element. The behavior is undefined if the transaction is empty. */
+            uint32_t type() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_type;
+            }
+
+            /** Returns the size of the element. The behavior is undefined if the transaction is empty. */
+            size_t size() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_size;
+            }
+
+            /** Returns a pointer to the storage of the element, that the producer has to fill before committing.
+                The behavior is undefined if the transaction is empty. */
+            void * element_ptr() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return address_add(m_control, m_control->m_element_offset);
+            }
+
+            /** Makes the element observable by the consumer. After the call the transaction is empty. */
+            void commit() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                auto const next = m_control->m_next.load(std::memory_order_relaxed);
+                m_control->m_next.store(next - detail::ShmQueue_Busy, std::memory_order_release);
+                m_queue = nullptr;
+            }
+
+            /** Cancels the transaction: the element is never observed by the consumer. After the call the
+                transaction is empty. */
+            void cancel() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                auto const next = m_control->m_next.load(std::memory_order_relaxed);
+                m_control->m_next.store(
+                  next - detail::ShmQueue_Busy + detail::ShmQueue_Dead, std::memory_order_release);
+                m_queue = nullptr;
+            }
+
+          private:
+            put_transaction(shm_heter_queue * i_queue, ControlBlock * i_control) noexcept
+                : m_queue(i_queue), m_control(i_control)
+            {
+            }
+
+            friend class shm_heter_queue;
+
+          private:
+            shm_heter_queue * m_queue   = nullptr;
+            ControlBlock *    m_control = nullptr;
+        };
+
+        /** Move-only class that can be bound to a consume operation, otherwise it's empty. Destroying a non-empty
+            consume operation cancels it. */
+        class consume_operation
+        {
+          public:
+            /** Constructs an empty consume operation */
+            consume_operation() noexcept = default;
+
+            /** Copy construction is not allowed */
+            consume_operation(const consume_operation &) = delete;
+
+            /** Copy assignment is not allowed */
+            consume_operation & operator=(const consume_operation &) = delete;
+
+            /** Move constructs a consume_operation, transferring the state from the source. */
+            consume_operation(consume_operation && i_source) noexcept
+                : m_queue(i_source.m_queue), m_control(i_source.m_control)
+            {
+                i_source.m_queue = nullptr;
+            }
+
+            /** Move assigns a consume_operation, transferring the state from the source. */
+            consume_operation & operator=(consume_operation && i_source) noexcept
+            {
+                if (this != &i_source)
+                {
+                    if (!empty())
+                        cancel();
+                    m_queue          = i_source.m_queue;
+                    m_control        = i_source.m_control;
+                    i_source.m_queue = nullptr;
+                }
+                return *this;
+            }
+
+            /** If this consume operation is not empty, cancels it. */
+            ~consume_operation()
+            {
+                if (!empty())
+                    cancel();
+            }
+
+            /** Returns true whether this object does not hold the state of an operation. */
+            bool empty() const noexcept { return m_queue == nullptr; }
+
+            /** Returns true whether this object holds the state of an operation. */
+            explicit operator bool() const noexcept { return m_queue != nullptr; }
+
+            /** Returns the type tag of the element. The behavior is undefined if the operation is empty. */
+            uint32_t type() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_type;
+            }
+
+            /** Returns the size of the element. The behavior is undefined if the operation is empty. */
+            size_t size() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return m_control->m_size;
+            }
+
+            /** Returns a pointer to the element. The behavior is undefined if the operation is empty. */
+            void * element_ptr() const noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                return address_add(m_control, m_control->m_element_offset);
+            }
+
+            /** Returns a reference to the element. The behavior is undefined if the operation is empty, or
+                if the element is not an ELEMENT_TYPE. */
+            template <typename ELEMENT_TYPE> ELEMENT_TYPE & element() const noexcept
+            {
+                DENSITY_ASSERT(!empty() && m_control->m_size == sizeof(ELEMENT_TYPE));
+                return *static_cast<ELEMENT_TYPE *>(element_ptr());
+            }
+
+            /** Removes the element from the queue. After the call the operation is empty. */
+            void commit() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                auto const next = m_control->m_next.load(std::memory_order_relaxed);
+                m_control->m_next.store(
+                  next - detail::ShmQueue_Busy + detail::ShmQueue_Dead, std::memory_order_relaxed);
+                m_queue->advance_head();
+                m_queue = nullptr;
+            }
+
+            /** Cancels the operation: the element is left in the queue. After the call the operation is empty. */
+            void cancel() noexcept
+            {
+                DENSITY_ASSERT(!empty());
+                auto const next = m_control->m_next.load(std::memory_order_relaxed);
+                m_control->m_next.store(next - detail::ShmQueue_Busy, std::memory_order_relaxed);
+                m_queue = nullptr;
+            }
+
+          private:
+            consume_operation(shm_heter_queue * i_queue, ControlBlock * i_control) noexcept
+                : m_queue(i_queue), m_control(i_control)
+            {
+            }
+
+            friend class shm_heter_queue;
+
+          private:
+            shm_heter_queue * m_queue   = nullptr;
+            ControlBlock *    m_control = nullptr;
+        };
+
+        /** Adds at the end of the queue a copy of an object, waiting while the queue is full.
+                @param i_type type tag of the element, chosen by the user
+                @param i_source object to copy. It must be trivially copyable.
+
+            <b>Throws</b>: std::length_error if the element is bigger than max_element_size.
+
+        \snippet shm_queue_examples.cpp shm_heter_queue example 1 */
+        template <typename ELEMENT_TYPE> void push(uint32_t i_type, const ELEMENT_TYPE & i_source)
+        {
+            auto put = start_raw_push(i_type, sizeof(ELEMENT_TYPE), alignof(ELEMENT_TYPE));
+            copy_element(put, i_source);
+        }
+
+        /** Adds at the end of the queue a copy of an object, if the queue is not full. Returns whether the
+            object has been added. See push. */
+        template <typename ELEMENT_TYPE> bool try_push(uint32_t i_type, const ELEMENT_TYPE & i_source)
+        {
+            auto put = try_start_raw_push(i_type, sizeof(ELEMENT_TYPE), alignof(ELEMENT_TYPE));
+            if (!put)
+                return false;
+            copy_element(put, i_source);
+            return true;
+        }
+
+        /** Allocates an element in the queue, waiting while the queue is full, and returns a transaction that the
+            producer uses to write it in place before committing.
+                @param i_type type tag of the element, chosen by the user
+                @param i_size size of the element
+                @param i_alignment alignment of the element. Must be an integer power of 2, not greater than max_alignment.
+
+            <b>Throws</b>: std::length_error if the element is bigger than max_element_size.
+
+        \snippet shm_queue_examples.cpp shm_heter_queue start_raw_push example 1 */
+        put_transaction start_raw_push(
+          uint32_t i_type, size_t i_size, size_t i_alignment = alignof(std::max_align_t))
+        {
+            check_element_size(i_size, i_alignment);
+            for (uint32_t iteration = 0;; iteration++)
+            {
+                auto const control = allocate(i_type, i_size, i_alignment);
+                if (control != nullptr)
+                    return put_transaction(this, control);
+                wait(iteration);
+            }
+        }
+
+        /** Allocates an element in the queue if it is not full. Returns an empty transaction on failure.
+            See start_raw_push. */
+        put_transaction try_start_raw_push(
+          uint32_t i_type, size_t i_size, size_t i_alignment = alignof(std::max_align_t))
+        {
+            check_element_size(i_size, i_alignment);
+            auto const control = allocate(i_type, i_size, i_alignment);
+            return control != nullptr ? put_transaction(this, control) : put_transaction();
+        }
+
+        /** Tries to start a consume operation. Returns an empty consume_operation if there are no consumable elements.
+            Elements being put are skipped. Only one thread at a time can consume, but it can have many
+            consume operations in progress.
+
+        \snippet shm_queue_examples.cpp shm_heter_queue example 1 */
+        consume_operation try_start_consume() noexcept
+        {
+            consume_operation result;
+            try_start_consume(result);
+            return result;
+        }
+
+        /** Tries to start a consume operation, reusing the consume_operation passed as argument. Returns
+            false if there are no consumable elements. */
+        bool try_start_consume(consume_operation & i_consume) noexcept
+        {
+            if (!i_consume.empty())
+                i_consume.cancel();
+
+            for (auto curr = header().m_head;;)
+            {
+                auto const control = control_at(curr);
+                auto const next    = control->m_next.load(std::memory_order_acquire);
+                if (next == 0)
+                    return false;
+                if ((next & detail::ShmQueue_AllFlags) == 0)
+                {
+                    // only the consumer writes the link of a committed element
+                    control->m_next.store(next + detail::ShmQueue_Busy, std::memory_order_relaxed);
+                    i_consume = consume_operation(this, control);
+                    return true;
+                }
+                curr = next & ~static_cast<uint64_t>(detail::ShmQueue_AllFlags);
+            }
+        }
+
+        /** Removes the first element of the queue. Returns false if there are no consumable elements. */
+        bool try_pop() noexcept
+        {
+            consume_operation consume;
+            if (!try_start_consume(consume))
+                return false;
+            consume.commit();
+            return true;
+        }
+
+      private:
+        Header & header() const noexcept { return *static_cast<Header *>(m_segment); }
+
+        ControlBlock * control_at(uint64_t i_offset) const noexcept
+        {
+            return static_cast<ControlBlock *>(address_add(m_segment, static_cast<size_t>(i_offset)));
+        }
+
+        /** Returns the offset of the first byte of the page containing the specified offset */
+        uint64_t page_of(uint64_t i_offset) const noexcept
+        {
+            auto const & head = header();
+            return head.m_first_page +
+                   (i_offset - head.m_first_page) / head.m_page_size * head.m_page_size;
+        }
+
+        void duplicate_descriptor(int i_file_descriptor)
+        {
+            auto const file_descriptor = ::fcntl(i_file_descriptor, F_DUPFD_CLOEXEC, 0);
+            if (file_descriptor < 0)
+                throw std::system_error(errno, std::system_category(), "fcntl");
+            m_file_descriptor = file_descriptor;
+        }
+
+        void map(size_t i_size)
+        {
+            auto const segment =
+              ::mmap(nullptr, i_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file_descriptor, 0);
+            if (segment == MAP_FAILED)
+            {
+                auto const error = errno;
+                ::close(m_file_descriptor);
+                m_file_descriptor = -1;
+                throw std::system_error(error, std::system_category(), "mmap");
+            }
+            m_segment      = segment;
+            m_segment_size = i_size;
+        }
+
+        static void check_layout(size_t i_page_count, size_t i_page_size)
+        {
+            // the control blocks store sizes and offsets within a page in 32 bits
+            if (
+              i_page_count < 2 || i_page_size < 1024 ||
+              i_page_size % s_first_page_alignment != 0 ||
+              i_page_size > std::numeric_limits<uint32_t>::max())
+                throw std::invalid_argument("shm_heter_queue: invalid page count or size");
+        }
+
+        void create_segment(size_t i_page_count, size_t i_page_size)
+        {
+            auto const first_page   = uint_upper_align(sizeof(Header), s_first_page_alignment);
+            auto const segment_size = first_page + i_page_count * i_page_size;
+            if (::ftruncate(m_file_descriptor, static_cast<off_t>(segment_size)) != 0)
+            {
+                auto const error = errno;
+                ::close(m_file_descriptor);
+                m_file_descriptor = -1;
+                throw std::system_error(error, std::system_category(), "ftruncate");
+            }
+            map(segment_size);
+
+            auto const head              = new (m_segment) Header;
+            head->m_producer_cardinality = static_cast<uint64_t>(PROD_CARDINALITY);
+            head->m_page_size            = i_page_size;
+            head->m_page_count           = i_page_count;
+            head->m_first_page           = first_page;
+            head->m_tail_lock.store(0, std::memory_order_relaxed);
+            head->m_tail           = first_page;
+            head->m_acquired_pages = 1;
+            head->m_head           = first_page;
+            head->m_released_pages.store(0, std::memory_order_relaxed);
+            new (control_at(first_page)) ControlBlock{};
+
+            head->m_magic.store(detail::s_shm_queue_magic, std::memory_order_release);
+        }
+
+        void open_segment()
+        {
+            struct stat file_stat;
+            if (::fstat(m_file_descriptor, &file_stat) != 0)
+            {
+                auto const error = errno;
+                ::close(m_file_descriptor);
+                m_file_descriptor = -1;
+                throw std::system_error(error, std::system_category(), "fstat");
+            }
+
+            auto const segment_size = static_cast<size_t>(file_stat.st_size);
+            if (segment_size < sizeof(Header))
+            {
+                ::close(m_file_descriptor);
+                m_file_descriptor = -1;
+                throw std::runtime_error("shm_heter_queue: the segment is not initialized");
+            }
+            map(segment_size);
+
+            auto const & head = header();
+            if (
+              head.m_magic.load(std::memory_order_acquire) != detail::s_shm_queue_magic ||
+              head.m_producer_cardinality != static_cast<uint64_t>(PROD_CARDINALITY) ||
+              head.m_page_size > std::numeric_limits<uint32_t>::max() ||
+              head.m_first_page + head.m_page_count * head.m_page_size > segment_size)
+            {
+                ::munmap(m_segment, m_segment_size);
+                ::close(m_file_descriptor);
+                m_segment         = nullptr;
+                m_file_descriptor = -1;
+                throw std::runtime_error(
+                  "shm_heter_queue: the segment is not initialized, or is not compatible");
+            }
+        }
+
+        void check_element_size(size_t i_size, size_t i_alignment) const
+        {
+            DENSITY_ASSERT(is_power_of_2(i_alignment) && i_alignment <= max_alignment);
+            detail::shm_queue_check_element_size(
+              page_size(), i_size, i_alignment, "shm_heter_queue: the element is too big for a page");
+        }
+
+        /** Waits for the consumer to release a page */
+        static void wait(uint32_t i_iteration) noexcept
+        {
+            if (i_iteration < 64)
+                detail::cpu_relax();
+            else
+                std::this_thread::yield();
+        }
+
+        /** Locks the tail if there are multiple producers. The lock is shared between processes, so it
+            can't block on a private futex: it spins and then yields. */
+        class TailLock
+        {
+          public:
+            TailLock(Header & i_header) noexcept : m_header(i_header)
+            {
+                if (PROD_CARDINALITY == concurrency_multiple)
+                {
+                    for (uint32_t iteration = 0;
+                         m_header.m_tail_lock.exchange(1, std::memory_order_acquire) != 0;)
+                    {
+                        while (m_header.m_tail_lock.load(std::memory_order_relaxed) != 0)
+                            wait(iteration++);
+                    }
+                }
+            }
+
+            TailLock(const TailLock &) = delete;
+            TailLock & operator=(const TailLock &) = delete;
+
+            ~TailLock()
+            {
+                if (PROD_CARDINALITY == concurrency_multiple)
+                    m_header.m_tail_lock.store(0, std::memory_order_release);
+            }
+
+          private:
+            Header & m_header;
+        };
+
+        /** Allocates an element at the end of the queue, and returns its control block, which has the
+            flag ShmQueue_Busy. If all the pages are in use, returns nullptr. */
+        ControlBlock * allocate(uint32_t i_type, size_t i_size, size_t i_alignment) noexcept
+        {
+            auto &   head      = header();
+            auto     alignment = detail::size_max(i_alignment, s_block_alignment);
+            TailLock lock(head);
+            for (;;)
+            {
+                auto const control  = head.m_tail;
+                auto const element  = uint_upper_align(control + sizeof(ControlBlock), alignment);
+                auto const next     = uint_upper_align(element + i_size, s_block_alignment);
+                auto const page_end = page_of(control) + head.m_page_size - sizeof(ControlBlock);
+                if (next <= page_end)
+                {
+                    /* the next control block may contain garbage from a previous use of the page, so
+                        it is zeroed before it becomes reachable */
+                    new (control_at(next)) ControlBlock{};
+
+                    auto const result        = control_at(control);
+                    result->m_type           = i_type;
+                    result->m_size           = static_cast<uint32_t>(i_size);
+                    result->m_element_offset = static_cast<uint32_t>(element - control);
+                    result->m_next.store(next + detail::ShmQueue_Busy, std::memory_order_release);
+                    head.m_tail = next;
+                    return result;
+                }
+
+                // the page is full, we need a new one
+                if (
+                  head.m_acquired_pages - head.m_released_pages.load(std::memory_order_acquire) >=
+                  head.m_page_count)
+                {
+                    return nullptr;
+                }
+                auto const new_page = head.m_first_page +
+                                      head.m_acquired_pages % head.m_page_count * head.m_page_size;
+                head.m_acquired_pages++;
+                new (control_at(new_page)) ControlBlock{};
+                control_at(control)->m_next.store(
+                  new_page + detail::ShmQueue_Dead, std::memory_order_release);
+                head.m_tail = new_page;
+            }
+        }
+
+        template <typename ELEMENT_TYPE>
+        static void copy_element(put_transaction & i_put, const ELEMENT_TYPE & i_source) noexcept
+        {
+            static_assert(
+              std::is_trivially_copyable<ELEMENT_TYPE>::value,
+              "elements of shm_heter_queue must be trivially copyable");
+            new (i_put.element_ptr()) ELEMENT_TYPE(i_source);
+            i_put.commit();
+        }
+
+        /** Moves the head past the dead elements, releasing the pages it leaves. Called by the consumer. */
+        void advance_head() noexcept
+        {
+            auto & head = header();
+            for (;;)
+            {
+                auto const next = control_at(head.m_head)->m_next.load(std::memory_order_acquire);
+                if ((next & detail::ShmQueue_AllFlags) != detail::ShmQueue_Dead)
+                    break;
+
+                auto const next_control = next - detail::ShmQueue_Dead;
+                if (page_of(next_control) != page_of(head.m_head))
+                {
+                    /* the release makes the reads of the consumer on the page happen before the
+                        writes of the producer that will reuse it */
+                    head.m_released_pages.fetch_add(1, std::memory_order_release);
+                }
+                head.m_head = next_control;
+            }
+        }
+
+      private:
+        int    m_file_descriptor = -1;
+        void * m_segment         = nullptr;
+        size_t m_segment_size    = 0;
+    };
+
+} // namespace density
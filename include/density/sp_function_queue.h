@@ -16,7 +16,7 @@ namespace density
       function_type_erasure   ERASURE              = function_standard_erasure,
       concurrency_cardinality PROD_CARDINALITY     = concurrency_multiple,
       concurrency_cardinality CONSUMER_CARDINALITY = concurrency_multiple,
-      typename BUSY_WAIT_FUNC                      = default_busy_wait>
+      typename BUSY_WAIT_FUNC                      = adaptive_busy_wait>
     class sp_function_queue;
 
     /** Heterogeneous FIFO pseudo-container specialized to hold callable objects. sp_function_queue is an adaptor for sp_heter_queue.
@@ -35,8 +35,8 @@ namespace density
         @tparam ERASURE Type erasure to use the callable objects. Must be a member of density::function_type_erasure.
         @tparam PROD_CARDINALITY specifies whether multiple threads can do put transactions concurrently. Must be a member of density::concurrency_cardinality.
         @tparam CONSUMER_CARDINALITY specifies whether multiple threads can do consume operations concurrently. Must be a member of density::concurrency_cardinality.
-        @tparam BUSY_WAIT_FUNC callable object to be invoked (with an empty parameter list) in the body of the spin lock.
-            The default is density::default_busy_wait, that calls std::this_thread::yield.
+        @tparam BUSY_WAIT_FUNC callable object to be invoked in the body of the spin lock. The default is density::adaptive_busy_wait.
+            See sp_heter_queue for details.
 
         If ERASURE == function_manual_clear, sp_function_queue is not able to destroy the callable objects without invoking them.
             This produces a performance benefit, but:
@@ -78,7 +78,7 @@ namespace density
       function_type_erasure   ERASURE              = function_standard_erasure,
       concurrency_cardinality PROD_CARDINALITY     = concurrency_multiple,
       concurrency_cardinality CONSUMER_CARDINALITY = concurrency_multiple,
-      typename BUSY_WAIT_FUNC                      = default_busy_wait>
+      typename BUSY_WAIT_FUNC                      = adaptive_busy_wait>
     class sp_function_queue
 #endif
     {
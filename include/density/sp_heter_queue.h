@@ -5,8 +5,11 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <density/default_allocator.h>
 #include <density/density_common.h>
+#include <density/mutexes.h>
 #include <density/raw_atomic.h>
 #include <density/runtime_type.h>
 #include <limits>
@@ -15,9 +18,6 @@
 #include <type_traits>
 
 #ifdef _MSC_VER
-#if defined(_M_IX86) || defined(_M_X64)
-#include <immintrin.h> // for _mm_pause
-#endif
 #pragma warning(push)
 #pragma warning(disable : 4324) // structure was padded due to alignment specifier
 #endif
@@ -27,6 +27,7 @@
 #include <density/detail/lf_queue_head_single.h>
 #include <density/detail/lf_queue_tail_single.h>
 #include <density/detail/sp_queue_tail_multiple.h>
+#include <density/detail/visit_dispatch.h>
 
 namespace density
 {
@@ -43,21 +44,98 @@ namespace density
           SpQueue_TailMultiple<RUNTIME_TYPE, ALLOCATOR_TYPE, BUSY_WAIT_FUNC>>::type;
     }
 
-    /** Callable empty type used as default busy wait by sp_heter_queue. */
+    /** Callable empty type that can be used as busy wait by sp_heter_queue. Before version 2.00.00 it was the default. */
     class default_busy_wait
     {
       public:
-        /** Calls std::this_thread::yield. */
+        /** Calls std::this_thread::yield (on Visual Studio it executes a pause instruction). */
         void operator()() noexcept
         {
 #if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
-            _mm_pause();
+            detail::cpu_relax();
 #else
             std::this_thread::yield();
 #endif
         }
     };
 
+    /** Contention counters updated by adaptive_busy_wait. The counters use relaxed atomic operations,
+        so they can be read while the queue is in use. */
+    struct busy_wait_stats
+    {
+        std::atomic<uint64_t> m_waits{0};  /**< Number of lock acquisitions that had to wait */
+        std::atomic<uint64_t> m_spins{0};  /**< Number of rounds of pause instructions */
+        std::atomic<uint64_t> m_yields{0}; /**< Number of calls to std::this_thread::yield */
+        std::atomic<uint64_t> m_parks{0};  /**< Number of times a thread was blocked */
+    };
+
+    /** Busy wait function used by default by sp_heter_queue and sp_function_queue. It adapts the wait to the
+        duration of the contention:
+        - for the first spin_iterations calls it executes a pause instruction a number of times that doubles
+            at every call (1, 2, 4, ...)
+        - for the next yield_iterations calls it yields the time slice of the thread
+        - then it asks the spin lock to park the thread, that is to block it until the lock is released. On Linux
+            this uses a futex, on other systems the thread yields.
+
+        If a busy_wait_stats is provided on construction, contention statistics are recorded in it. The busy_wait_stats
+        must outlive the queue. \n When invoked with an empty parameter list, adaptive_busy_wait just executes a pause
+        instruction.
+
+        \snippet sp_queue_examples.cpp adaptive_busy_wait example 1 */
+    class adaptive_busy_wait
+    {
+      public:
+        /** Number of calls that spin with pause instructions. */
+        static constexpr uint32_t spin_iterations = 8;
+
+        /** Number of calls that yield, after the spin phase. */
+        static constexpr uint32_t yield_iterations = 8;
+
+        /** Constructs an adaptive_busy_wait, optionally recording statistics in i_stats. */
+        constexpr explicit adaptive_busy_wait(busy_wait_stats * i_stats = nullptr) noexcept
+            : m_stats(i_stats)
+        {
+        }
+
+        /** Executes a pause instruction. */
+        void operator()() noexcept { detail::cpu_relax(); }
+
+        /** Waits for the release of a spin lock.
+            @param i_iteration number of previous calls for the same lock acquisition.
+            @return whether the calling thread should be blocked. */
+        bool operator()(uint32_t i_iteration) noexcept
+        {
+            if (i_iteration < spin_iterations)
+            {
+                if (m_stats != nullptr)
+                {
+                    if (i_iteration == 0)
+                        m_stats->m_waits.fetch_add(1, std::memory_order_relaxed);
+                    m_stats->m_spins.fetch_add(1, std::memory_order_relaxed);
+                }
+                for (uint32_t spin = uint32_t(1) << i_iteration; spin > 0; spin--)
+                    detail::cpu_relax();
+                return false;
+            }
+            else if (i_iteration < spin_iterations + yield_iterations)
+            {
+                if (m_stats != nullptr)
+                    m_stats->m_yields.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+                return false;
+            }
+            else
+            {
+                if (m_stats != nullptr)
+                    m_stats->m_parks.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+      private:
+        busy_wait_stats * m_stats;
+    };
+
     /** Concurrent heterogeneous FIFO container-like class template. sp_heter_queue is a concurrent version
         of heter_queue that uses a mix of lock free algorithms and spin locking.
         This class is very similar to lf_heter_queue, with the difference in multiple-producers mode it uses
@@ -72,8 +150,9 @@ namespace density
                 "UntypedAllocator" and \ref PagedAllocator_requirements "PagedAllocator". The default is density::default_allocator.
         @tparam PROD_CARDINALITY specifies whether multiple threads can do put transactions concurrently. Must be a member of density::concurrency_cardinality.
         @tparam CONSUMER_CARDINALITY specifies whether multiple threads can do consume operations concurrently. Must be a member of density::concurrency_cardinality.
-        @tparam BUSY_WAIT_FUNC callable object to be invoked (with an empty parameter list) in the body of the spin lock.
-            The default is density::default_busy_wait, that calls std::this_thread::yield.
+        @tparam BUSY_WAIT_FUNC callable object to be invoked in the body of the spin lock. If it can be invoked with an uint32_t (the
+            number of previous calls for the same lock acquisition) and it returns true, the thread is blocked until the lock is released.
+            Otherwise it is invoked with an empty parameter list. The default is density::adaptive_busy_wait.
 
 
         \n <b>Thread safeness</b>: A thread doing put operations and another thread doing consumes don't need to be synchronized.
@@ -204,7 +283,7 @@ namespace density
       typename ALLOCATOR_TYPE                      = default_allocator,
       concurrency_cardinality PROD_CARDINALITY     = concurrency_multiple,
       concurrency_cardinality CONSUMER_CARDINALITY = concurrency_multiple,
-      typename BUSY_WAIT_FUNC                      = default_busy_wait>
+      typename BUSY_WAIT_FUNC                      = adaptive_busy_wait>
     class sp_heter_queue
         : private detail::LFQueue_Head<
             RUNTIME_TYPE,
@@ -489,6 +568,35 @@ namespace density
             }
         }
 
+        /** Invokes a function on every element of the queue, splitting the work between the tasks of an executor.
+            See heter_queue::parallel_for_each.
+
+            This function can be called while other threads put and consume. It visits a snapshot of the queue: first
+            the calling thread marks as busy the elements that can be consumed (as a consume operation would do) and
+            pins their pages; then the elements are visited by the tasks, grouped by page; finally the elements are
+            released. Consumers skip the elements of the snapshot until they are released. Elements put after the
+            snapshot has been taken are not visited.
+
+            \pre The behavior is undefined if either:
+                - i_func alters the queue
+                - CONSUMER_CARDINALITY is concurrency_single, and a consume operation is in progress or is started
+                    during the call
+
+            <b>Complexity</b>: linear.
+            \n <b>Throws</b>: std::bad_alloc, and anything thrown by the executor or by i_func. In case of exception
+                the elements of the snapshot are released.
+
+        \snippet sp_queue_examples.cpp sp_heter_queue parallel_for_each example 1 */
+        template <typename EXECUTOR, typename FUNC>
+        void parallel_for_each(EXECUTOR && i_executor, FUNC && i_func)
+        {
+            typename Base::template Snapshot<Consume> snapshot(get_allocator_ref());
+            snapshot.take(static_cast<Base *>(this));
+            i_executor(snapshot.page_count(), [&snapshot, &i_func](size_t i_page) {
+                snapshot.visit_page(i_page, i_func);
+            });
+        }
+
         /** Move-only class template that can be bound to a put transaction, otherwise it's empty.
 
             @tparam ELEMENT_COMPLETE_TYPE Complete type of elements that can be handled by a transaction, or void.
@@ -2065,6 +2173,28 @@ namespace density
             return i_consume.start_consume_impl(PrivateType(), this);
         }
 
+        /** Tries to consume an element, invoking a visitor on it.
+                @tparam TYPES... types of elements handled by the visitor with their complete type.
+                @param i_visitor callable object that is invoked with an lvalue reference to the element, if
+                    its type is one of TYPES..., or with a dynamic_reference<RUNTIME_TYPE> otherwise.
+            @return whether an element was consumed, that is whether the queue was not empty.
+
+            The dispatch is performed with a table mapping runtime types to functions, that is built the first
+            time this function is called with a given visitor type and TYPES..., so the cost of the dispatch is
+            constant regardless of the number of types. RUNTIME_TYPE must be hashable with std::hash.
+            If the visitor throws an exception, the consume is canceled and the element remains in the queue.
+
+            \snippet sp_queue_examples.cpp sp_heter_queue consume_visit example 1 */
+        template <typename... TYPES, typename VISITOR> bool try_consume_visit(VISITOR && i_visitor)
+        {
+            consume_operation consume;
+            if (!try_start_consume(consume))
+                return false;
+            detail::visit_element<TYPES...>(i_visitor, consume.complete_type(), consume.element_ptr());
+            consume.commit();
+            return true;
+        }
+
 
         /** Move-only class template that can be bound to a reentrant put transaction, otherwise it's empty.
 
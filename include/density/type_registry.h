@@ -0,0 +1,93 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include <cstdint>
+#include <density/density_common.h>
+#include <density/detail/queue_archive.h>
+#include <density/runtime_type.h>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace density
+{
+    /** Associates stable numeric identifiers to runtime types. Runtime types are bound to the addresses of
+        their feature tables, so they can't be stored in a file or sent to another process. A type_registry
+        provides an identifier that does not depend on the program instance, and is used by heter_queue::save and
+        heter_queue::load to write and read the type of the elements. Including this header makes heter_queue::save and
+        heter_queue::load available.
+
+        @tparam RUNTIME_TYPE runtime type to register. It must be hashable with std::hash.
+
+        Every type and every identifier can be registered only once. The identifiers of a type should never change
+        in the life of the software, otherwise data saved by older versions can't be loaded.
+
+        \snippet heter_queue_examples.cpp heter_queue save example 1
+
+        \n <b>Thread safeness</b>: Const functions can be called concurrently. Non-const functions can't be
+            called concurrently with any other function.
+    */
+    template <typename RUNTIME_TYPE = runtime_type<>> class type_registry
+    {
+      public:
+        /** Type of the runtime types of the registry */
+        using runtime_type = RUNTIME_TYPE;
+
+        /** Registers a type with the specified identifier.
+            \n <b>Throws</b>: std::invalid_argument if the identifier or the type are already registered, or
+                anything the allocation of the entries throws.
+            \n <b>Exception guarantee</b>: strong (in case of exception the function has no observable effects). */
+        template <typename TARGET_TYPE> void add(uint32_t i_id)
+        {
+            add(i_id, RUNTIME_TYPE::template make<TARGET_TYPE>());
+        }
+
+        /** Registers a runtime type with the specified identifier.
+            \n <b>Throws</b>: std::invalid_argument if the identifier or the type are already registered, or
+                anything the allocation of the entries throws.
+            \n <b>Exception guarantee</b>: strong (in case of exception the function has no observable effects). */
+        void add(uint32_t i_id, const RUNTIME_TYPE & i_type)
+        {
+            if (m_ids.find(i_type) != m_ids.end())
+                throw std::invalid_argument("type_registry: the type is already registered");
+
+            auto const type_entry = m_types.emplace(i_id, i_type);
+            if (!type_entry.second)
+                throw std::invalid_argument("type_registry: the identifier is already in use");
+            try
+            {
+                m_ids.emplace(i_type, i_id);
+            }
+            catch (...)
+            {
+                m_types.erase(type_entry.first);
+                throw;
+            }
+        }
+
+        /** Returns the runtime type associated to an identifier, or nullptr if the identifier is not registered. */
+        const RUNTIME_TYPE * find_type(uint32_t i_id) const noexcept
+        {
+            auto const it = m_types.find(i_id);
+            return it != m_types.end() ? &it->second : nullptr;
+        }
+
+        /** Returns the identifier associated to a runtime type, or nullptr if the type is not registered. */
+        const uint32_t * find_id(const RUNTIME_TYPE & i_type) const noexcept
+        {
+            auto const it = m_ids.find(i_type);
+            return it != m_ids.end() ? &it->second : nullptr;
+        }
+
+        /** Returns the number of registered types */
+        size_t size() const noexcept { return m_types.size(); }
+
+      private:
+        std::unordered_map<uint32_t, RUNTIME_TYPE> m_types;
+        std::unordered_map<RUNTIME_TYPE, uint32_t> m_ids;
+    };
+
+} // namespace density
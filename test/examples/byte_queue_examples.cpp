@@ -0,0 +1,134 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "test_framework/progress.h"
+#include <assert.h>
+#include <cstring>
+#include <density/byte_queue.h>
+#include <density/lf_byte_queue.h>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// if assert expands to nothing, some local variable becomes unused
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(push)
+#pragma warning(disable : 4189) // local variable is initialized but not referenced
+#endif
+
+namespace density_tests
+{
+    namespace
+    {
+        /* Stand-in for a call like recv: writes at most i_capacity bytes of a payload, and returns
+            the number of bytes written. */
+        size_t receive_payload(void * i_dest, size_t i_capacity, int i_index)
+        {
+            std::string const payload = "payload " + std::to_string(i_index);
+            size_t const      size    = payload.size() < i_capacity ? payload.size() : i_capacity;
+            std::memcpy(i_dest, payload.data(), size);
+            return size;
+        }
+    } // namespace
+
+    void byte_queue_samples(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "byte queue samples");
+
+        using namespace density;
+
+        {
+            //! [byte_queue reserve example 1]
+            byte_queue<> queue;
+
+            // the payload is received directly in the page of the queue...
+            auto         put  = queue.reserve(1500);
+            size_t const size = receive_payload(put.span().data(), put.span().size(), 1);
+            // ...and the message is truncated to the actual size
+            put.commit(size);
+
+            // the consumer parses the message in place
+            auto const consume = queue.try_start_consume();
+            assert(consume.span().size() == size);
+            assert(std::memcmp(consume.span().data(), "payload 1", size) == 0);
+            //! [byte_queue reserve example 1]
+        }
+        {
+            //! [byte_queue push example 1]
+            byte_queue<> queue;
+            uint32_t     header[2] = {1, 2};
+            queue.push(header, sizeof(header));
+
+            auto consume = queue.try_start_consume();
+            assert(consume.span().size() == sizeof(header));
+            assert(static_cast<uint32_t *>(consume.span().data())[1] == 2);
+            consume.commit();
+            assert(queue.empty());
+            //! [byte_queue push example 1]
+        }
+        {
+            //! [byte_queue try_start_consume example 1]
+            byte_queue<> queue;
+            queue.push("abc", 3);
+            queue.push("defg", 4);
+
+            std::string all;
+            while (auto consume = queue.try_start_consume())
+            {
+                for (auto byte : consume.span())
+                    all += static_cast<char>(byte);
+                consume.commit();
+            }
+            assert(all == "abcdefg");
+            //! [byte_queue try_start_consume example 1]
+        }
+        {
+            //! [lf_byte_queue reserve example 1]
+            lf_byte_queue<default_allocator, concurrency_single, concurrency_single> queue;
+
+            std::thread receiver([&queue] {
+                for (int i = 0; i < 100; i++)
+                {
+                    auto put = queue.reserve(64);
+                    put.commit(receive_payload(put.span().data(), put.span().size(), i));
+                }
+            });
+
+            for (int i = 0; i < 100;)
+            {
+                if (auto consume = queue.try_start_consume())
+                {
+                    std::string const message(
+                      static_cast<char *>(consume.span().data()), consume.span().size());
+                    assert(message == "payload " + std::to_string(i));
+                    consume.commit();
+                    i++;
+                }
+            }
+            receiver.join();
+            //! [lf_byte_queue reserve example 1]
+        }
+        {
+            //! [lf_byte_queue try_reserve example 1]
+            lf_byte_queue<> queue;
+            if (auto put = queue.try_reserve(progress_lock_free, 256))
+            {
+                std::memset(put.span().data(), 0, put.span().size());
+                put.commit();
+            }
+            assert(queue.try_pop() || true); // the put may fail if a page can't be allocated in lock-freedom
+            //! [lf_byte_queue try_reserve example 1]
+        }
+    }
+
+} // namespace density_tests
+
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(pop)
+#endif
@@ -9,10 +9,13 @@
 
 #include "test_framework/progress.h"
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <complex>
 #include <density/conc_heter_queue.h>
+#include <density/executors.h>
 #include <density/io_runtimetype_features.h>
+#include <density/mutexes.h>
 #include <iostream>
 #include <iterator>
 #include <string>
@@ -1319,6 +1322,36 @@ namespace density_tests
             assert(queue.empty());
             //! [conc_heter_queue default_construct example 1]
         }
+        {
+            //! [conc_heter_queue lock_head_tail example 1]
+            conc_heter_queue<runtime_type<>, default_allocator, lock_head_tail> queue;
+
+            // while this transaction is alive, only producers are blocked
+            auto put = queue.start_push(std::string("Hello"));
+            put.commit();
+
+            // the first consume moves the elements of the producers to the consumers
+            auto consume = queue.try_start_consume();
+            assert(consume.element<std::string>() == "Hello");
+            consume.commit();
+            //! [conc_heter_queue lock_head_tail example 1]
+        }
+        {
+            //! [conc_heter_queue mutex example 1]
+            // short critical sections: spin before blocking
+            conc_heter_queue<runtime_type<>, default_allocator, lock_single, adaptive_mutex> queue;
+            queue.push(42);
+
+            // fair locking of both the head and the tail
+            conc_heter_queue<runtime_type<>, default_allocator, lock_head_tail, ticket_mutex>
+              fair_queue;
+            fair_queue.push(std::string("Hello"));
+
+            auto consume = queue.try_start_consume();
+            assert(consume.element<int>() == 42);
+            consume.commit();
+            //! [conc_heter_queue mutex example 1]
+        }
         {
             //! [conc_heter_queue move_construct example 1]
             using MyRunTimeType = runtime_type<
@@ -1433,6 +1466,36 @@ namespace density_tests
             assert(queue.empty());
             //! [conc_heter_queue clear example 1]
         }
+        {
+            //! [conc_heter_queue splice_back example 1]
+            conc_heter_queue<> queue, batch;
+            queue.push(1);
+            batch.push(2);
+
+            queue.splice_back(batch);
+            assert(batch.empty());
+
+            queue.pop();
+            auto consume = queue.try_start_consume();
+            assert(consume.element<int>() == 2);
+            consume.commit();
+            //! [conc_heter_queue splice_back example 1]
+        }
+        {
+            //! [conc_heter_queue parallel_for_each example 1]
+            conc_heter_queue<> queue;
+            for (int i = 0; i < 10000; i++)
+                queue.push(i);
+
+            // puts and consumes from other threads wait until the visit is complete
+            std::atomic<int> sum{0};
+            queue.parallel_for_each(
+              thread_executor(), [&sum](const runtime_type<> &, void * i_element) {
+                  sum += *static_cast<int *>(i_element);
+              });
+            assert(sum == 10000 * 9999 / 2);
+            //! [conc_heter_queue parallel_for_each example 1]
+        }
         {
             //! [conc_heter_queue pop example 1]
             conc_heter_queue<> queue;
@@ -1497,6 +1560,32 @@ namespace density_tests
             (void)bool_1;
             (void)bool_2;
         }
+        {
+            //! [conc_heter_queue consume_visit example 1]
+            struct Visitor
+            {
+                int         m_int_sum = 0;
+                std::string m_strings;
+                int         m_others = 0;
+
+                void operator()(int i_value) { m_int_sum += i_value; }
+                void operator()(const std::string & i_value) { m_strings += i_value; }
+                void operator()(const dynamic_reference<> &) { m_others++; }
+            };
+
+            conc_heter_queue<> queue;
+            queue.push(1);
+            queue.push(std::string("Hello"));
+            queue.push(2);
+            queue.push(3.14);
+
+            Visitor visitor;
+            while (queue.try_consume_visit<int, std::string>(visitor))
+            {
+            }
+            assert(visitor.m_int_sum == 3 && visitor.m_strings == "Hello" && visitor.m_others == 1);
+            //! [conc_heter_queue consume_visit example 1]
+        }
         {
             conc_heter_queue<> queue;
 
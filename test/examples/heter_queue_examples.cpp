@@ -9,13 +9,18 @@
 
 #include "test_framework/progress.h"
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <complex>
+#include <density/executors.h>
 #include <density/heter_queue.h>
 #include <density/io_runtimetype_features.h>
+#include <density/type_registry.h>
 #include <iostream>
 #include <iterator>
+#include <sstream>
 #include <string>
+#include <vector>
 
 // if assert expands to nothing, some local variable becomes unused
 #if defined(_MSC_VER) && defined(NDEBUG)
@@ -96,6 +101,23 @@ namespace density_tests
             queue.dyn_push_move(type, &source);
             //! [heter_queue dyn_push_move example 1]
         }
+        {
+            //! [heter_queue dyn_push_relocate example 1]
+            using MyRunTimeType =
+              runtime_type<f_move_construct, f_relocate, f_destroy, f_size, f_alignment>;
+            heter_queue<MyRunTimeType> source, dest;
+            source.push(42);
+            source.push(std::string("Hello world!!"));
+
+            while (auto consume = source.try_start_consume())
+            {
+                dest.dyn_push_relocate(consume.complete_type(), consume.element_ptr());
+                // the element has already been destroyed by dyn_push_relocate
+                consume.commit_nodestroy();
+            }
+            assert(source.empty() && !dest.empty());
+            //! [heter_queue dyn_push_relocate example 1]
+        }
 
         {
             //! [heter_queue start_dyn_push example 1]
@@ -1362,6 +1384,26 @@ namespace density_tests
     }
 
 
+    //! [heter_queue save example 2]
+    struct Job
+    {
+        std::string      m_name;
+        std::vector<int> m_arguments;
+    };
+
+    // found with argument-dependent lookup by f_serialize and f_deserialize
+    void density_serialize(std::ostream & i_ostream, const Job & i_job)
+    {
+        density::density_serialize(i_ostream, i_job.m_name);
+        density::density_serialize(i_ostream, i_job.m_arguments);
+    }
+    void density_deserialize(std::istream & i_istream, Job & i_job)
+    {
+        density::density_deserialize(i_istream, i_job.m_name);
+        density::density_deserialize(i_istream, i_job.m_arguments);
+    }
+    //! [heter_queue save example 2]
+
     void heterogeneous_queue_samples(std::ostream & i_ostream)
     {
         PrintScopeDuration dur(i_ostream, "heterogeneous queue samples");
@@ -1603,6 +1645,91 @@ namespace density_tests
             assert(queue.empty());
             //! [heter_queue clear example 1]
         }
+        {
+            //! [heter_queue splice_back example 1]
+            heter_queue<> queue, batch;
+            queue.push(1);
+            batch.push(2);
+            batch.push(std::string("abc"));
+
+            // the pages of batch are moved to the end of queue
+            queue.splice_back(batch);
+            assert(batch.empty());
+
+            queue.pop();
+            auto consume = queue.try_start_consume();
+            assert(consume.element<int>() == 2);
+            consume.commit();
+            //! [heter_queue splice_back example 1]
+        }
+        {
+            //! [heter_queue parallel_for_each example 1]
+            heter_queue<> queue;
+            for (int i = 0; i < 10000; i++)
+                queue.push(i);
+
+            // the pages of the queue are visited by a set of threads
+            std::atomic<int> sum{0};
+            queue.parallel_for_each(
+              thread_executor(), [&sum](const runtime_type<> & i_type, void * i_element) {
+                  if (i_type.is<int>())
+                      sum += *static_cast<int *>(i_element);
+              });
+            assert(sum == 10000 * 9999 / 2);
+
+            // with a sequential_executor the elements are visited by the calling thread
+            int sequential_sum = 0;
+            queue.parallel_for_each(
+              sequential_executor(), [&sequential_sum](const runtime_type<> &, void * i_element) {
+                  sequential_sum += *static_cast<int *>(i_element);
+              });
+            assert(sequential_sum == sum);
+            //! [heter_queue parallel_for_each example 1]
+        }
+        {
+            //! [heter_queue save example 1]
+            using Type = runtime_type<default_type_features, f_serialize, f_deserialize>;
+
+            // the identifiers must not change between the save and the load
+            type_registry<Type> registry;
+            registry.add<int>(1);
+            registry.add<double>(2);
+            registry.add<std::string>(3);
+
+            heter_queue<Type> queue;
+            queue.push(42);
+            queue.push(2.5);
+            queue.push(std::string("pending"));
+
+            // use an std::ofstream opened with std::ios::binary to save to a file
+            std::stringstream checkpoint;
+            queue.save(checkpoint, registry);
+
+            heter_queue<Type> restored;
+            restored.load(checkpoint, registry);
+            assert(restored.try_start_consume().element<int>() == 42);
+            //! [heter_queue save example 1]
+        }
+        {
+            //! [heter_queue save example 2]
+            using Type = runtime_type<default_type_features, f_serialize, f_deserialize>;
+            type_registry<Type> registry;
+            registry.add<Job>(1);
+
+            heter_queue<Type> queue;
+            queue.push(Job{"resize", {640, 480}});
+
+            std::stringstream checkpoint;
+            queue.save(checkpoint, registry);
+
+            heter_queue<Type> restored;
+            restored.load(checkpoint, registry);
+            auto consume = restored.try_start_consume();
+            assert(consume.element<Job>().m_name == "resize");
+            assert(consume.element<Job>().m_arguments[1] == 480);
+            consume.commit();
+            //! [heter_queue save example 2]
+        }
         {
             //! [heter_queue pop example 1]
             heter_queue<> queue;
@@ -1667,6 +1794,32 @@ namespace density_tests
             (void)bool_1;
             (void)bool_2;
         }
+        {
+            //! [heter_queue consume_visit example 1]
+            struct Visitor
+            {
+                int         m_int_sum = 0;
+                std::string m_strings;
+                int         m_others = 0;
+
+                void operator()(int i_value) { m_int_sum += i_value; }
+                void operator()(const std::string & i_value) { m_strings += i_value; }
+                void operator()(const dynamic_reference<> &) { m_others++; }
+            };
+
+            heter_queue<> queue;
+            queue.push(1);
+            queue.push(std::string("Hello"));
+            queue.push(2);
+            queue.push(3.14);
+
+            Visitor visitor;
+            while (queue.try_consume_visit<int, std::string>(visitor))
+            {
+            }
+            assert(visitor.m_int_sum == 3 && visitor.m_strings == "Hello" && visitor.m_others == 1);
+            //! [heter_queue consume_visit example 1]
+        }
         {
             heter_queue<> queue;
 
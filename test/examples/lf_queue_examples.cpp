@@ -9,8 +9,10 @@
 
 #include "test_framework/progress.h"
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <complex>
+#include <density/executors.h>
 #include <density/io_runtimetype_features.h>
 #include <density/lf_heter_queue.h>
 #include <iostream>
@@ -2598,6 +2600,33 @@ static void samples(std::ostream &)
         assert(!queue.empty());
         //! [lf_heter_queue empty example 1]
     }
+    {
+        //! [lf_heter_queue parallel_for_each example 1]
+        using LfQueue = lf_heter_queue<
+          runtime_type<>,
+          default_allocator,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          CONSISTENCY_MODEL>;
+
+        LfQueue queue;
+        for (int i = 0; i < 10000; i++)
+            queue.push(i);
+
+        /* the elements are marked as busy during the visit, so other threads can put and
+            consume concurrently (but with a single consumer this counts as a consume) */
+        std::atomic<int> sum{0};
+        queue.parallel_for_each(thread_executor(), [&sum](const runtime_type<> &, void * i_element) {
+            sum += *static_cast<int *>(i_element);
+        });
+        assert(sum == 10000 * 9999 / 2);
+
+        // after the visit the elements can be consumed
+        auto consume = queue.try_start_consume();
+        assert(consume.template element<int>() == 0);
+        consume.commit();
+        //! [lf_heter_queue parallel_for_each example 1]
+    }
     {
         //! [lf_heter_queue clear example 1]
         using LfQueue = lf_heter_queue<
@@ -2685,6 +2714,38 @@ static void samples(std::ostream &)
         (void)bool_1;
         (void)bool_2;
     }
+    {
+        //! [lf_heter_queue consume_visit example 1]
+        struct Visitor
+        {
+            int         m_int_sum = 0;
+            std::string m_strings;
+            int         m_others = 0;
+
+            void operator()(int i_value) { m_int_sum += i_value; }
+            void operator()(const std::string & i_value) { m_strings += i_value; }
+            void operator()(const dynamic_reference<> &) { m_others++; }
+        };
+
+        lf_heter_queue<
+          runtime_type<>,
+          default_allocator,
+          PROD_CARDINALITY,
+          CONSUMER_CARDINALITY,
+          CONSISTENCY_MODEL>
+          queue;
+        queue.push(1);
+        queue.push(std::string("Hello"));
+        queue.push(2);
+        queue.push(3.14);
+
+        Visitor visitor;
+        while (queue.template try_consume_visit<int, std::string>(visitor))
+        {
+        }
+        assert(visitor.m_int_sum == 3 && visitor.m_strings == "Hello" && visitor.m_others == 1);
+        //! [lf_heter_queue consume_visit example 1]
+    }
     {
         //! [lf_heter_queue reentrant example 1]
         // start 3 reentrant put transactions
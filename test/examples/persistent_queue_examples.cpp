@@ -0,0 +1,120 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "test_framework/progress.h"
+#include <assert.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <density/persistent_heter_queue.h>
+#include <unistd.h>
+#endif
+
+// if assert expands to nothing, some local variable becomes unused
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(push)
+#pragma warning(disable : 4189) // local variable is initialized but not referenced
+#endif
+
+namespace density_tests
+{
+#if defined(__linux__)
+
+    void persistent_heterogeneous_queue_samples(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "persistent heterogeneous queue samples");
+
+        using namespace density;
+
+        std::string const path = "/tmp/density_persistent_samples_" + std::to_string(::getpid());
+
+        {
+            //! [persistent_heter_queue example 1]
+            struct Job
+            {
+                uint64_t m_id;
+                uint32_t m_priority;
+            };
+
+            {
+                // creates the file with 16 pages, and syncs it at every commit
+                persistent_heter_queue<> backlog(path.c_str(), 16);
+                backlog.push(0, Job{1, 10});
+                backlog.push(0, Job{2, 20});
+            }
+
+            // after a restart the queue is remapped, without reading the elements
+            persistent_heter_queue<> backlog(path.c_str(), 16);
+            uint64_t                 last_id = 0;
+            while (auto consume = backlog.try_start_consume())
+            {
+                last_id = consume.element<Job>().m_id;
+                consume.commit();
+            }
+            assert(last_id == 2);
+            //! [persistent_heter_queue example 1]
+        }
+        ::unlink(path.c_str());
+        {
+            //! [persistent_heter_queue sync example 1]
+            // syncs every 64 commits
+            persistent_heter_queue<concurrency_single> queue(
+              path.c_str(), 16, 4096, sync_policy::every_n_commits(64));
+
+            for (int i = 0; i < 1000; i++)
+                queue.push(0, i);
+
+            // a crash now could lose the last 1000 % 64 puts, unless they are synced
+            queue.sync();
+            //! [persistent_heter_queue sync example 1]
+        }
+        ::unlink(path.c_str());
+        {
+            //! [persistent_heter_queue start_raw_push example 1]
+            persistent_heter_queue<> queue(path.c_str(), 4, 4096, sync_policy::manual());
+
+            // the message is written directly in the mapped file
+            char const message[] = "resize image 42";
+            auto       put       = queue.start_raw_push(7, sizeof(message), 1);
+            std::memcpy(put.element_ptr(), message, sizeof(message));
+            put.commit();
+
+            auto consume = queue.try_start_consume();
+            assert(consume.type() == 7 && consume.size() == sizeof(message));
+            assert(std::strcmp(static_cast<char *>(consume.element_ptr()), message) == 0);
+            consume.commit();
+            //! [persistent_heter_queue start_raw_push example 1]
+        }
+        ::unlink(path.c_str());
+        {
+            //! [persistent_heter_queue push_serialized example 1]
+            persistent_heter_queue<> queue(path.c_str(), 4);
+
+            // types that are not trivially copyable are written with density_serialize
+            std::vector<std::string> const arguments{"--width", "640"};
+            queue.push_serialized(1, arguments);
+
+            auto consume = queue.try_start_consume();
+            assert(consume.deserialize<std::vector<std::string>>() == arguments);
+            consume.commit();
+            //! [persistent_heter_queue push_serialized example 1]
+        }
+        ::unlink(path.c_str());
+    }
+
+#endif
+
+} // namespace density_tests
+
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(pop)
+#endif
@@ -0,0 +1,95 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "test_framework/progress.h"
+#include <assert.h>
+#include <density/priority_heter_queue.h>
+#include <iostream>
+#include <string>
+
+// if assert expands to nothing, some local variable becomes unused
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(push)
+#pragma warning(disable : 4189) // local variable is initialized but not referenced
+#endif
+
+namespace density_tests
+{
+    void priority_heterogeneous_queue_samples(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "priority heterogeneous queue samples");
+
+        using namespace density;
+
+        {
+            //! [priority_heter_queue example 1]
+            enum Priority : size_t
+            {
+                Urgent,
+                Normal,
+                Background
+            };
+            priority_heter_queue<runtime_type<>, 3> queue;
+
+            queue.push(Background, std::string("compact the log"));
+            queue.push(Normal, 42);
+            queue.push(Urgent, std::string("flush"));
+            queue.push(Normal, 43);
+
+            // the highest non-empty level is consumed first, and every level is FIFO
+            std::string log;
+            while (auto consume = queue.try_start_consume())
+            {
+                if (consume.complete_type().is<int>())
+                    log += std::to_string(consume.element<int>()) + ", ";
+                else
+                    log += consume.element<std::string>() + ", ";
+                consume.commit();
+            }
+            assert(log == "flush, 42, 43, compact the log, ");
+            //! [priority_heter_queue example 1]
+            assert(queue.empty());
+        }
+        {
+            //! [priority_heter_queue start_push example 1]
+            priority_heter_queue<> queue;
+            auto                   put = queue.start_push(5, std::string("request"));
+            put.element() += " 42";
+            assert(put.level() == 5);
+
+            // the level is observed as non-empty only after the commit
+            assert(queue.empty());
+            put.commit();
+            assert(!queue.empty());
+            //! [priority_heter_queue start_push example 1]
+        }
+        {
+            //! [priority_heter_queue try_start_consume example 1]
+            priority_heter_queue<> queue;
+            queue.push(3, 1);
+            queue.push(1, 2);
+
+            // a consume_operation can be reused across levels
+            priority_heter_queue<>::consume_operation consume;
+            int                                       sum = 0;
+            while (queue.try_start_consume(consume))
+            {
+                sum = sum * 10 + consume.element<int>();
+                consume.commit();
+            }
+            assert(sum == 21);
+            //! [priority_heter_queue try_start_consume example 1]
+        }
+    }
+
+} // namespace density_tests
+
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(pop)
+#endif
@@ -7,13 +7,31 @@
 #include "../test_framework/density_test_common.h"
 //
 #include <complex>
+#include <density/compact_runtime_type.h>
+#include <density/heter_queue.h>
 #include <density/io_runtimetype_features.h>
 #include <density/runtime_type.h>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <type_traits>
 
+//! [f_relocate example 1]
+// this type owns a resource, but it does not depend on its address
+struct RelocatableHandle
+{
+    std::unique_ptr<int> m_value;
+};
+
+namespace density
+{
+    template <> struct is_trivially_relocatable<RelocatableHandle> : std::true_type
+    {
+    };
+} // namespace density
+//! [f_relocate example 1]
+
 namespace density_tests
 {
     // clang-format off
@@ -269,6 +287,47 @@ namespace density_tests
             //! [runtime_type is example 1]
             // clang-format on
         }
+        {
+            // clang-format off
+            //! [compact_runtime_type example 1]
+    using Compact = compact_runtime_type<>;
+    static_assert(sizeof(Compact) == sizeof(uint32_t), "");
+
+    Compact const compact = Compact::make<std::string>();
+    assert(compact.is<std::string>() && compact.size() == sizeof(std::string));
+
+    runtime_type<> const full = compact.to_runtime_type();
+    assert(full == runtime_type<>::make<std::string>());
+
+    // elements of a queue of compact types don't need a pointer-sized header
+    heter_queue<Compact> queue;
+    queue.push(42);
+    queue.emplace<std::string>("Hello");
+    auto consume = queue.try_start_consume();
+    assert(consume.element<int>() == 42);
+    consume.commit();
+            //! [compact_runtime_type example 1]
+            // clang-format on
+        }
+        {
+            // clang-format off
+            //! [f_relocate example 2]
+    using Rt = runtime_type<f_size, f_alignment, f_relocate, f_destroy>;
+    assert(Rt::make<int>().get_feature<f_relocate>().is_trivial());
+    assert(Rt::make<RelocatableHandle>().get_feature<f_relocate>().is_trivial());
+    assert(!Rt::make<std::string>().get_feature<f_relocate>().is_trivial());
+
+    std::string source("a long enough string to be allocated in the heap");
+    auto        dest = static_cast<std::string *>(aligned_allocate(sizeof(std::string), alignof(std::string)));
+    Rt::make<std::string>().get_feature<f_relocate>()(dest, &source);
+    // now source is destroyed, and dest holds the string
+    new (&source) std::string();
+    assert(dest->size() > 0);
+    dest->std::string::~basic_string();
+    aligned_deallocate(dest, sizeof(std::string), alignof(std::string));
+            //! [f_relocate example 2]
+            // clang-format on
+        }
     }
 
     //! [runtime_type example 2]
@@ -0,0 +1,152 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "test_framework/progress.h"
+#include <assert.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#if defined(__linux__)
+#include <density/shm_heter_queue.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// if assert expands to nothing, some local variable becomes unused
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(push)
+#pragma warning(disable : 4189) // local variable is initialized but not referenced
+#endif
+
+namespace density_tests
+{
+#if defined(__linux__)
+
+    void shm_heterogeneous_queue_samples(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "shared memory heterogeneous queue samples");
+
+        using namespace density;
+
+        // the name of the shared memory object must be unique in the system
+        std::string const name = "/density_shm_samples_" + std::to_string(::getpid());
+
+        {
+            //! [shm_heter_queue example 1]
+            struct Quote
+            {
+                uint64_t m_instrument;
+                double   m_bid, m_ask;
+            };
+            struct Trade
+            {
+                uint64_t m_instrument;
+                double   m_price;
+                uint32_t m_quantity;
+            };
+            enum MessageType : uint32_t
+            {
+                QuoteMessage,
+                TradeMessage
+            };
+
+            // creates a shared memory object with 16 pages
+            shm_heter_queue<> queue(name.c_str(), 16);
+
+            queue.push(QuoteMessage, Quote{42, 1.5, 1.6});
+            queue.push(TradeMessage, Trade{42, 1.55, 100});
+
+            // this would happen in the consumer process, on its own mapping of the queue
+            double last_price = 0.;
+            while (auto consume = queue.try_start_consume())
+            {
+                if (consume.type() == TradeMessage)
+                    last_price = consume.element<Trade>().m_price;
+                consume.commit();
+            }
+            assert(last_price == 1.55);
+
+            shm_heter_queue<>::unlink(name.c_str());
+            //! [shm_heter_queue example 1]
+        }
+        {
+            //! [shm_heter_queue create example 1]
+            // the producer process creates the queue...
+            shm_heter_queue<concurrency_single> producer_side(name.c_str(), 4, 4096);
+
+            // ...and the consumer process opens it by name
+            shm_heter_queue<concurrency_single> consumer_side(name.c_str());
+
+            // the shared memory is released when the last mapping is removed
+            shm_heter_queue<concurrency_single>::unlink(name.c_str());
+
+            producer_side.push(1, 42);
+            auto consume = consumer_side.try_start_consume();
+            assert(consume.type() == 1 && consume.element<int>() == 42);
+            consume.commit();
+            //! [shm_heter_queue create example 1]
+        }
+        {
+            //! [shm_heter_queue file_descriptor example 1]
+            int const file_descriptor = ::memfd_create("density_queue", 0);
+            assert(file_descriptor >= 0);
+
+            // the queue uses a duplicate of the descriptor
+            shm_heter_queue<> queue(file_descriptor, 8, 4096);
+            ::close(file_descriptor);
+
+            pid_t const child = ::fork();
+            if (child == 0)
+            {
+                // the child process maps the queue again from the inherited descriptor
+                shm_heter_queue<> child_queue(queue.file_descriptor());
+                for (int i = 0; i < 1000; i++)
+                    child_queue.push(0, i); // waits while the queue is full
+                ::_exit(0);
+            }
+
+            for (int expected = 0; expected < 1000;)
+            {
+                if (auto consume = queue.try_start_consume())
+                {
+                    assert(consume.element<int>() == expected);
+                    consume.commit();
+                    expected++;
+                }
+            }
+            ::waitpid(child, nullptr, 0);
+            //! [shm_heter_queue file_descriptor example 1]
+        }
+        {
+            //! [shm_heter_queue start_raw_push example 1]
+            shm_heter_queue<> queue(name.c_str(), 4);
+            shm_heter_queue<>::unlink(name.c_str());
+
+            // the message is written directly in the shared memory
+            char const message[] = "market data";
+            auto       put       = queue.start_raw_push(7, sizeof(message), 1);
+            std::memcpy(put.element_ptr(), message, sizeof(message));
+            put.commit();
+
+            auto consume = queue.try_start_consume();
+            assert(consume.type() == 7 && consume.size() == sizeof(message));
+            assert(std::strcmp(static_cast<char *>(consume.element_ptr()), "market data") == 0);
+            consume.commit();
+            //! [shm_heter_queue start_raw_push example 1]
+        }
+    }
+
+#endif
+
+} // namespace density_tests
+
+#if defined(_MSC_VER) && defined(NDEBUG)
+#pragma warning(pop)
+#endif
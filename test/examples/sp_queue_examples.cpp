@@ -9,13 +9,16 @@
 
 #include "test_framework/progress.h"
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <complex>
+#include <density/executors.h>
 #include <density/io_runtimetype_features.h>
 #include <density/sp_heter_queue.h>
 #include <iostream>
 #include <iterator>
 #include <string>
+#include <thread>
 
 // if assert expands to nothing, some local variable becomes unused
 #if defined(_MSC_VER) && defined(NDEBUG)
@@ -2097,9 +2100,9 @@ static void samples(std::ostream &)
         using SpQueue =
           sp_heter_queue<runtime_type<>, default_allocator, PROD_CARDINALITY, CONSUMER_CARDINALITY>;
 
-        default_allocator allocator;
-        default_busy_wait busy_wait;
-        SpQueue           queue(allocator, busy_wait);
+        default_allocator  allocator;
+        adaptive_busy_wait busy_wait;
+        SpQueue            queue(allocator, busy_wait);
         assert(queue.empty());
         //! [sp_heter_queue construct_alloc_wait example 1]
     }
@@ -2108,9 +2111,9 @@ static void samples(std::ostream &)
         using SpQueue =
           sp_heter_queue<runtime_type<>, default_allocator, PROD_CARDINALITY, CONSUMER_CARDINALITY>;
 
-        default_allocator allocator;
-        default_busy_wait busy_wait;
-        SpQueue           queue(std::move(allocator), busy_wait);
+        default_allocator  allocator;
+        adaptive_busy_wait busy_wait;
+        SpQueue            queue(std::move(allocator), busy_wait);
         assert(queue.empty());
         //! [sp_heter_queue construct_alloc_wait example 2]
     }
@@ -2119,9 +2122,9 @@ static void samples(std::ostream &)
         using SpQueue =
           sp_heter_queue<runtime_type<>, default_allocator, PROD_CARDINALITY, CONSUMER_CARDINALITY>;
 
-        default_allocator allocator;
-        default_busy_wait busy_wait;
-        SpQueue           queue(allocator, std::move(busy_wait));
+        default_allocator  allocator;
+        adaptive_busy_wait busy_wait;
+        SpQueue            queue(allocator, std::move(busy_wait));
         assert(queue.empty());
         //! [sp_heter_queue construct_alloc_wait example 3]
     }
@@ -2130,12 +2133,36 @@ static void samples(std::ostream &)
         using SpQueue =
           sp_heter_queue<runtime_type<>, default_allocator, PROD_CARDINALITY, CONSUMER_CARDINALITY>;
 
-        default_allocator allocator;
-        default_busy_wait busy_wait;
-        SpQueue           queue(std::move(allocator), std::move(busy_wait));
+        default_allocator  allocator;
+        adaptive_busy_wait busy_wait;
+        SpQueue            queue(std::move(allocator), std::move(busy_wait));
         assert(queue.empty());
         //! [sp_heter_queue construct_alloc_wait example 4]
     }
+    {
+        //! [adaptive_busy_wait example 1]
+        busy_wait_stats stats;
+        {
+            using SpQueue = sp_heter_queue<
+              runtime_type<>,
+              default_allocator,
+              concurrency_multiple,
+              concurrency_single,
+              adaptive_busy_wait>;
+
+            SpQueue     queue{default_allocator(), adaptive_busy_wait(&stats)};
+            std::thread producer([&queue] {
+                for (int i = 0; i < 1000; i++)
+                    queue.push(i);
+            });
+            for (int i = 0; i < 1000; i++)
+                queue.push(i);
+            producer.join();
+        }
+        // every lock acquisition that had to wait did at least a round of spinning
+        assert(stats.m_spins.load() >= stats.m_waits.load());
+        //! [adaptive_busy_wait example 1]
+    }
 
 
     {
@@ -2231,6 +2258,29 @@ static void samples(std::ostream &)
         assert(!queue.empty());
         //! [sp_heter_queue empty example 1]
     }
+    {
+        //! [sp_heter_queue parallel_for_each example 1]
+        using SpQueue =
+          sp_heter_queue<runtime_type<>, default_allocator, PROD_CARDINALITY, CONSUMER_CARDINALITY>;
+
+        SpQueue queue;
+        for (int i = 0; i < 10000; i++)
+            queue.push(i);
+
+        /* the elements are marked as busy during the visit, so other threads can put and
+            consume concurrently (but with a single consumer this counts as a consume) */
+        std::atomic<int> sum{0};
+        queue.parallel_for_each(thread_executor(), [&sum](const runtime_type<> &, void * i_element) {
+            sum += *static_cast<int *>(i_element);
+        });
+        assert(sum == 10000 * 9999 / 2);
+
+        // after the visit the elements can be consumed
+        auto consume = queue.try_start_consume();
+        assert(consume.template element<int>() == 0);
+        consume.commit();
+        //! [sp_heter_queue parallel_for_each example 1]
+    }
     {
         //! [sp_heter_queue clear example 1]
         using SpQueue =
@@ -2302,6 +2352,33 @@ static void samples(std::ostream &)
         (void)bool_1;
         (void)bool_2;
     }
+    {
+        //! [sp_heter_queue consume_visit example 1]
+        struct Visitor
+        {
+            int         m_int_sum = 0;
+            std::string m_strings;
+            int         m_others = 0;
+
+            void operator()(int i_value) { m_int_sum += i_value; }
+            void operator()(const std::string & i_value) { m_strings += i_value; }
+            void operator()(const dynamic_reference<> &) { m_others++; }
+        };
+
+        sp_heter_queue<runtime_type<>, default_allocator, PROD_CARDINALITY, CONSUMER_CARDINALITY>
+          queue;
+        queue.push(1);
+        queue.push(std::string("Hello"));
+        queue.push(2);
+        queue.push(3.14);
+
+        Visitor visitor;
+        while (queue.template try_consume_visit<int, std::string>(visitor))
+        {
+        }
+        assert(visitor.m_int_sum == 3 && visitor.m_strings == "Hello" && visitor.m_others == 1);
+        //! [sp_heter_queue consume_visit example 1]
+    }
     {
         //! [sp_heter_queue reentrant example 1]
         // start 3 reentrant put transactions
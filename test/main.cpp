@@ -67,6 +67,20 @@ namespace density_tests
     void spinlocking_heterogeneous_queue_samples(std::ostream & i_ostream);
     void spinlocking_heterogeneous_queue_basic_tests(std::ostream & i_ostream);
 
+    void byte_queue_samples(std::ostream & i_ostream);
+    void byte_queue_basic_tests(std::ostream & i_ostream);
+
+    void priority_heterogeneous_queue_samples(std::ostream & i_ostream);
+    void priority_heterogeneous_queue_basic_tests(std::ostream & i_ostream);
+
+#if defined(__linux__)
+    void shm_heterogeneous_queue_samples(std::ostream & i_ostream);
+    void shm_heterogeneous_queue_basic_tests(std::ostream & i_ostream);
+
+    void persistent_heterogeneous_queue_samples(std::ostream & i_ostream);
+    void persistent_heterogeneous_queue_basic_tests(std::ostream & i_ostream);
+#endif
+
     void load_unload_tests(std::ostream & i_ostream);
 
     void overview_examples();
@@ -87,6 +101,8 @@ namespace density_tests
 
     void type_fetaures_tests();
 
+    void instrument_tests(std::ostream & i_ostream);
+
 } // namespace density_tests
 
 DENSITY_NO_INLINE void sandbox()
@@ -179,7 +195,7 @@ void do_tests(const TestSettings & i_settings, std::ostream & i_ostream, uint32_
 
     PrintScopeDuration dur(i_ostream, "all tests");
 
-    auto const alloc_test = std::unique_ptr<allocator_stress_test>{
+    auto alloc_test = std::unique_ptr<allocator_stress_test>{
       i_settings.m_allocator_stress_test ? new allocator_stress_test{} : nullptr};
 
     auto flags = QueueTesterFlags::eNone;
@@ -235,6 +251,32 @@ void do_tests(const TestSettings & i_settings, std::ostream & i_ostream, uint32_
         spinlocking_heterogeneous_queue_basic_tests(i_ostream);
     }
 
+    if (i_settings.should_run("byte_queue"))
+    {
+        byte_queue_samples(i_ostream);
+        byte_queue_basic_tests(i_ostream);
+    }
+
+    if (i_settings.should_run("priority_queue"))
+    {
+        priority_heterogeneous_queue_samples(i_ostream);
+        priority_heterogeneous_queue_basic_tests(i_ostream);
+    }
+
+#if defined(__linux__)
+    if (i_settings.should_run("shm_queue"))
+    {
+        shm_heterogeneous_queue_samples(i_ostream);
+        shm_heterogeneous_queue_basic_tests(i_ostream);
+    }
+
+    if (i_settings.should_run("persistent_queue"))
+    {
+        persistent_heterogeneous_queue_samples(i_ostream);
+        persistent_heterogeneous_queue_basic_tests(i_ostream);
+    }
+#endif
+
     overview_examples();
     dynamic_reference_examples();
 
@@ -275,6 +317,14 @@ void do_tests(const TestSettings & i_settings, std::ostream & i_ostream, uint32_
     i_ostream << "\n*** executing load unload tests..." << std::endl;
     load_unload_tests(std::cout);
 
+    if (i_settings.should_run("instrument"))
+    {
+        /* the instrument tests check that recycled pages are reused, so the allocator stresser
+            must not steal them */
+        alloc_test.reset();
+        instrument_tests(i_ostream);
+    }
+
     i_ostream.flags(prev_stream_flags);
 }
 
@@ -0,0 +1,22 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+#include "density_test_common.h"
+#include <density/density_common.h>
+
+#ifdef DENSITY_INSTRUMENT
+
+/** Asserts that the calling thread did not allocate memory from the system since the construction
+    of the density::instrument_scope. On failure the aligned allocations and the region creations
+    are printed. */
+#define DENSITY_TEST_ASSERT_NO_SYSTEM_ALLOCATIONS(scope)                                           \
+    DENSITY_TEST_ASSERT(                                                                           \
+      (scope).system_allocations() == 0,                                                           \
+      (scope).counters().m_aligned_allocations,                                                    \
+      (scope).counters().m_region_creations)
+
+#endif
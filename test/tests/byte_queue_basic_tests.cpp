@@ -0,0 +1,219 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "../test_framework/density_test_common.h"
+#include "../test_framework/progress.h"
+#include <atomic>
+#include <density/byte_queue.h>
+#include <density/lf_byte_queue.h>
+#include <thread>
+#include <vector>
+
+namespace density_tests
+{
+    namespace
+    {
+        // the only overhead of a message besides the control block is its length
+        static_assert(
+          sizeof(density::detail::ByteRuntimeType) == sizeof(size_t),
+          "the prefix of a byte message must hold only its length");
+
+        /* Fills a span with a pattern that depends on the seed */
+        void fill_bytes(density::byte_span i_span, size_t i_seed)
+        {
+            for (size_t index = 0; index < i_span.size(); index++)
+                i_span[index] = static_cast<unsigned char>(i_seed + index * 7);
+        }
+
+        bool check_bytes(density::byte_span i_span, size_t i_seed)
+        {
+            for (size_t index = 0; index < i_span.size(); index++)
+                if (i_span[index] != static_cast<unsigned char>(i_seed + index * 7))
+                    return false;
+            return true;
+        }
+
+        /* Message sizes, including empty messages and messages that don't fit in a page */
+        size_t message_size(size_t i_index)
+        {
+            return i_index % 97 == 0 ? density::default_allocator::page_size * 2 : i_index % 300;
+        }
+
+        template <typename QUEUE> void byte_queue_put_consume_tests(QUEUE & i_queue)
+        {
+            size_t const count = 1000;
+            for (size_t index = 0; index < count; index++)
+            {
+                auto put = i_queue.reserve(message_size(index));
+                DENSITY_TEST_ASSERT(
+                  put.span().size() == message_size(index) &&
+                  density::address_is_aligned(put.span().data(), QUEUE::message_alignment));
+                fill_bytes(put.span(), index);
+                if (index % 5 == 0)
+                {
+                    put.cancel();
+                }
+                else if (index % 5 == 1)
+                {
+                    put.commit(message_size(index) / 2);
+                }
+                else if (index % 5 == 2)
+                {
+                    put.shrink(message_size(index) / 3);
+                    DENSITY_TEST_ASSERT(put.span().size() == message_size(index) / 3);
+                    put.commit();
+                }
+                else
+                {
+                    put.commit();
+                }
+            }
+
+            typename QUEUE::consume_operation consume;
+            for (size_t index = 0; index < count; index++)
+            {
+                if (index % 5 == 0)
+                    continue;
+                DENSITY_TEST_ASSERT(i_queue.try_start_consume(consume));
+                size_t expected_size = message_size(index);
+                if (index % 5 == 1)
+                    expected_size /= 2;
+                else if (index % 5 == 2)
+                    expected_size /= 3;
+                DENSITY_TEST_ASSERT(
+                  consume.span().size() == expected_size && check_bytes(consume.span(), index));
+                if (index % 3 == 0)
+                {
+                    // a canceled consume leaves the message in the queue
+                    consume.cancel();
+                    DENSITY_TEST_ASSERT(i_queue.try_start_consume(consume));
+                    DENSITY_TEST_ASSERT(check_bytes(consume.span(), index));
+                }
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(i_queue.empty() && !i_queue.try_start_consume());
+        }
+
+        /* push can copy an empty message from a null pointer */
+        template <typename QUEUE> void byte_queue_empty_push_tests(QUEUE & i_queue)
+        {
+            i_queue.push(nullptr, 0);
+            auto consume = i_queue.try_start_consume();
+            DENSITY_TEST_ASSERT(consume && consume.span().size() == 0);
+            consume.commit();
+            DENSITY_TEST_ASSERT(i_queue.empty());
+        }
+
+        void byte_queue_copy_tests()
+        {
+            density::byte_queue<> queue;
+            for (size_t index = 0; index < 100; index++)
+            {
+                auto put = queue.reserve(message_size(index));
+                fill_bytes(put.span(), index);
+                put.commit();
+            }
+
+            auto copy = queue;
+            queue.clear();
+            DENSITY_TEST_ASSERT(queue.empty());
+
+            for (size_t index = 0; index < 100; index++)
+            {
+                auto consume = copy.try_start_consume();
+                DENSITY_TEST_ASSERT(
+                  consume.span().size() == message_size(index) &&
+                  check_bytes(consume.span(), index));
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(copy.empty());
+        }
+
+        /* Producers put messages whose first byte is the producer index, and the rest
+            is a pattern seeded with the sequence number of the message. */
+        void lf_byte_queue_concurrent_tests()
+        {
+            density::lf_byte_queue<> queue;
+
+            size_t const producer_count = 3, consumer_count = 2, count = 3000;
+
+            std::vector<std::thread> threads;
+            for (size_t producer = 0; producer < producer_count; producer++)
+            {
+                threads.emplace_back([&queue, producer] {
+                    for (size_t index = 0; index < count; index++)
+                    {
+                        auto put = queue.reserve(1 + message_size(index) % 300);
+                        fill_bytes(put.span(), index);
+                        put.span()[0] = static_cast<unsigned char>(producer);
+                        put.commit();
+                    }
+                });
+            }
+
+            std::atomic<size_t>      consumed{0};
+            std::atomic<bool>        errors{false};
+            std::vector<std::thread> consumers;
+            for (size_t consumer = 0; consumer < consumer_count; consumer++)
+            {
+                consumers.emplace_back([&] {
+                    density::lf_byte_queue<>::consume_operation consume;
+                    while (consumed.load() < producer_count * count)
+                    {
+                        if (queue.try_start_consume(consume))
+                        {
+                            auto const span = consume.span();
+                            if (span.empty() || span[0] >= producer_count)
+                                errors.store(true);
+                            consume.commit();
+                            consumed++;
+                        }
+                    }
+                });
+            }
+
+            for (auto & thread : threads)
+                thread.join();
+            for (auto & thread : consumers)
+                thread.join();
+            DENSITY_TEST_ASSERT(!errors.load() && queue.empty());
+        }
+
+    } // namespace
+
+    /** Basic tests for byte_queue<...> and lf_byte_queue<...> */
+    void byte_queue_basic_tests(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "byte queue basic tests");
+
+        using namespace density;
+
+        {
+            byte_queue<> queue;
+            byte_queue_put_consume_tests(queue);
+            byte_queue_empty_push_tests(queue);
+        }
+        {
+            lf_byte_queue<> queue;
+            byte_queue_put_consume_tests(queue);
+            byte_queue_empty_push_tests(queue);
+            DENSITY_TEST_ASSERT(queue.try_push(progress_lock_free, nullptr, 0));
+            auto consume = queue.try_start_consume();
+            DENSITY_TEST_ASSERT(consume && consume.span().size() == 0);
+            consume.commit();
+        }
+        {
+            lf_byte_queue<default_allocator, concurrency_single, concurrency_single> queue;
+            byte_queue_put_consume_tests(queue);
+        }
+        byte_queue_copy_tests();
+        lf_byte_queue_concurrent_tests();
+    }
+
+} // namespace density_tests
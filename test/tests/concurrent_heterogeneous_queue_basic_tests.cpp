@@ -13,8 +13,10 @@
 #include "../test_framework/test_objects.h"
 #include "complex_polymorphism.h"
 #include <density/conc_heter_queue.h>
+#include <density/executors.h>
 #include <iterator>
 #include <type_traits>
+#include <vector>
 
 namespace density_tests
 {
@@ -98,6 +100,31 @@ namespace density_tests
         i_queue.dyn_push_move(type, &move_source);
     }
 
+    /* Checks that parallel_for_each visits every element exactly once, including the elements
+        of the tail queue with lock_head_tail */
+    template <typename QUEUE> void conc_heterogeneous_queue_parallel_for_each_tests()
+    {
+        QUEUE queue;
+        for (int i = 0; i < 3000; i++)
+        {
+            queue.push(i);
+            if (i == 1000)
+            {
+                // moves the elements from the tail queue to the head queue, if any
+                queue.try_pop();
+            }
+        }
+
+        std::vector<int> visit_counts(3000);
+        queue.parallel_for_each(
+          density::thread_executor(4),
+          [&visit_counts](const density::runtime_type<> &, void * i_element) {
+              visit_counts[static_cast<size_t>(*static_cast<int *>(i_element))]++;
+          });
+        for (size_t i = 0; i < visit_counts.size(); i++)
+            DENSITY_TEST_ASSERT(visit_counts[i] == (i == 0 ? 0 : 1));
+    }
+
     /** Basic tests for conc_heter_queue<...> */
     void conc_heterogeneous_queue_basic_tests(std::ostream & i_ostream)
     {
@@ -114,5 +141,10 @@ namespace density_tests
 
         conc_heterogeneous_queue_basic_void_tests<
           conc_heter_queue<TestRuntimeTime<>, DeepTestAllocator<>>>();
+
+        conc_heterogeneous_queue_parallel_for_each_tests<conc_heter_queue<>>();
+
+        conc_heterogeneous_queue_parallel_for_each_tests<
+          conc_heter_queue<runtime_type<>, default_allocator, lock_head_tail>>();
     }
 } // namespace density_tests
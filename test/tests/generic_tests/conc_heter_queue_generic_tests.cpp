@@ -8,6 +8,7 @@
 //
 
 #include "queue_generic_tests.h"
+#include <density/mutexes.h>
 
 namespace density_tests
 {
@@ -38,11 +39,28 @@ namespace density_tests
             detail::single_queue_generic_test<
               conc_heter_queue<TestRuntimeTime<>, DeepTestAllocator<256>>>(
               i_flags, i_output, i_rand, i_element_count, concurrent_thread_counts);
+
+            // with lock_head_tail the pages are moved between two copies of the allocator
+            detail::single_queue_generic_test<
+              conc_heter_queue<runtime_type<>, basic_default_allocator<256>, lock_head_tail>>(
+              i_flags, i_output, i_rand, i_element_count, concurrent_thread_counts);
         }
         else
         {
             detail::single_queue_generic_test<conc_heter_queue<>>(
               i_flags, i_output, i_rand, i_element_count, concurrent_thread_counts);
+
+            detail::single_queue_generic_test<
+              conc_heter_queue<runtime_type<>, default_allocator, lock_head_tail>>(
+              i_flags, i_output, i_rand, i_element_count, concurrent_thread_counts);
+
+            detail::single_queue_generic_test<
+              conc_heter_queue<runtime_type<>, default_allocator, lock_single, adaptive_mutex>>(
+              i_flags, i_output, i_rand, i_element_count, concurrent_thread_counts);
+
+            detail::single_queue_generic_test<
+              conc_heter_queue<runtime_type<>, default_allocator, lock_head_tail, ticket_mutex>>(
+              i_flags, i_output, i_rand, i_element_count, concurrent_thread_counts);
         }
     }
 } // namespace density_tests
@@ -8,6 +8,7 @@
 //
 
 #include "queue_generic_tests.h"
+#include <density/compact_runtime_type.h>
 
 namespace density_tests
 {
@@ -35,11 +36,16 @@ namespace density_tests
             detail::single_queue_generic_test<
               heter_queue<TestRuntimeTime<>, DeepTestAllocator<256>>>(
               i_flags, i_output, i_rand, i_element_count, {1});
+            detail::single_queue_generic_test<
+              heter_queue<compact_runtime_type<>, UnmovableFastTestAllocator<256>>>(
+              i_flags, i_output, i_rand, i_element_count, {1});
         }
         else
         {
             detail::single_queue_generic_test<heter_queue<>>(
               i_flags, i_output, i_rand, i_element_count, {1});
+            detail::single_queue_generic_test<heter_queue<compact_runtime_type<>>>(
+              i_flags, i_output, i_rand, i_element_count, {1});
         }
     }
 } // namespace density_tests
@@ -12,9 +12,19 @@
 #include "../test_framework/test_allocators.h"
 #include "../test_framework/test_objects.h"
 #include "complex_polymorphism.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <density/executors.h>
 #include <density/heter_queue.h>
+#include <density/io_runtimetype_features.h>
+#include <density/type_registry.h>
 #include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 namespace density_tests
 {
@@ -206,6 +216,650 @@ namespace density_tests
         DENSITY_TEST_ASSERT(queue.empty());
     }
 
+    template <size_t INDEX> struct VisitTestElement
+    {
+        size_t m_value = INDEX;
+    };
+
+    struct VisitTestVisitor
+    {
+        size_t m_sum = 0, m_unknown = 0;
+        bool   m_throw = false;
+
+        template <size_t INDEX> void operator()(VisitTestElement<INDEX> & i_element)
+        {
+            if (m_throw)
+                throw std::exception();
+            DENSITY_TEST_ASSERT(i_element.m_value == INDEX);
+            m_sum += i_element.m_value;
+        }
+
+        void operator()(const density::dynamic_reference<> & i_element)
+        {
+            DENSITY_TEST_ASSERT(i_element.is<int>());
+            m_unknown++;
+        }
+    };
+
+    /** Test try_consume_visit with enough types to exercise the dispatch table */
+    void heterogeneous_queue_consume_visit_tests()
+    {
+        using namespace density;
+
+        heter_queue<> queue;
+        for (int i = 0; i < 3; i++)
+        {
+            queue.push(VisitTestElement<0>());
+            queue.push(VisitTestElement<1>());
+            queue.push(VisitTestElement<2>());
+            queue.push(VisitTestElement<3>());
+            queue.push(VisitTestElement<4>());
+            queue.push(VisitTestElement<5>());
+            queue.push(VisitTestElement<6>());
+            queue.push(VisitTestElement<7>());
+            queue.push(i);
+        }
+
+        VisitTestVisitor visitor;
+        size_t           consumed = 0;
+        while (queue.try_consume_visit<
+               VisitTestElement<0>,
+               VisitTestElement<1>,
+               VisitTestElement<2>,
+               VisitTestElement<3>,
+               VisitTestElement<4>,
+               VisitTestElement<5>,
+               VisitTestElement<6>,
+               VisitTestElement<7>,
+               VisitTestElement<7>>(visitor))
+        {
+            consumed++;
+        }
+        DENSITY_TEST_ASSERT(consumed == 27);
+        DENSITY_TEST_ASSERT(visitor.m_sum == 3 * (0 + 1 + 2 + 3 + 4 + 5 + 6 + 7));
+        DENSITY_TEST_ASSERT(visitor.m_unknown == 3);
+
+        // if the visitor throws the element is not consumed
+        queue.push(VisitTestElement<1>());
+        visitor.m_throw = true;
+        bool thrown     = false;
+        try
+        {
+            queue.try_consume_visit<VisitTestElement<1>>(visitor);
+        }
+        catch (const std::exception &)
+        {
+            thrown = true;
+        }
+        DENSITY_TEST_ASSERT(thrown && !queue.empty());
+        visitor.m_throw = false;
+        DENSITY_TEST_ASSERT(queue.try_consume_visit<VisitTestElement<1>>(visitor));
+        DENSITY_TEST_ASSERT(queue.empty());
+    }
+
+    template <typename QUEUE> void heterogeneous_queue_splice_tests()
+    {
+        for (int source_count = 0; source_count < 200; source_count += 13)
+        {
+            for (int dest_count = 0; dest_count < 200; dest_count += 17)
+            {
+                QUEUE source, dest;
+                for (int i = 0; i < source_count + 3; i++)
+                    source.push(std::to_string(i + dest_count));
+                for (int i = 0; i < dest_count + 3; i++)
+                    dest.push(i);
+
+                // consume some elements, so that the heads are not at the beginning of a page
+                for (int i = 0; i < 3; i++)
+                {
+                    source.pop();
+                    dest.pop();
+                }
+
+                dest.splice_back(source);
+                DENSITY_TEST_ASSERT(source.empty());
+                DENSITY_TEST_ASSERT(std::distance(dest.begin(), dest.end()) == dest_count + source_count);
+
+                // the source can be reused
+                source.push(1);
+                DENSITY_TEST_ASSERT(!source.empty());
+
+                for (int i = 0; i < dest_count; i++)
+                {
+                    auto consume = dest.try_start_consume();
+                    DENSITY_TEST_ASSERT(consume.template element<int>() == i + 3);
+                    consume.commit();
+                }
+                for (int i = 0; i < source_count; i++)
+                {
+                    auto consume = dest.try_start_consume();
+                    DENSITY_TEST_ASSERT(
+                      consume.template element<std::string>() == std::to_string(i + 3 + dest_count));
+                    consume.commit();
+                }
+                DENSITY_TEST_ASSERT(dest.empty());
+            }
+        }
+    }
+
+    /* Checks that the elements are consumed in order while many reentrant consumes are in progress,
+        and that canceled consumes and committed reentrant puts are not skipped. */
+    template <typename QUEUE> void heterogeneous_queue_consume_hint_tests()
+    {
+        QUEUE queue;
+        for (int i = 0; i < 200; i++)
+            queue.push(i);
+
+        // a put in progress in the middle of the queue
+        auto put = queue.start_reentrant_push(-1);
+
+        for (int i = 200; i < 300; i++)
+            queue.push(i);
+
+        std::vector<typename QUEUE::reentrant_consume_operation> consumes;
+        for (int i = 0; i < 100; i++)
+        {
+            consumes.push_back(queue.try_start_reentrant_consume());
+            DENSITY_TEST_ASSERT(consumes.back().template element<int>() == i);
+        }
+
+        // cancel a consume in the middle: the element becomes consumable again
+        consumes[50].cancel();
+        {
+            auto consume = queue.try_start_reentrant_consume();
+            DENSITY_TEST_ASSERT(consume.template element<int>() == 50);
+            consume.commit();
+        }
+
+        for (int i = 0; i < 100; i++)
+        {
+            if (i != 50)
+                consumes[static_cast<size_t>(i)].commit();
+        }
+
+        for (int i = 100; i < 300; i++)
+        {
+            auto consume = queue.try_start_reentrant_consume();
+            DENSITY_TEST_ASSERT(consume.template element<int>() == i);
+            consume.commit();
+        }
+
+        // commit the put after the consumers went past it
+        put.commit();
+
+        auto consume = queue.try_start_reentrant_consume();
+        DENSITY_TEST_ASSERT(consume.template element<int>() == -1);
+        consume.commit();
+        DENSITY_TEST_ASSERT(queue.empty());
+    }
+
+    /* Checks that parallel_for_each visits every element exactly once, and skips the elements with a
+        put or a consume in progress. */
+    template <typename QUEUE, typename EXECUTOR> void heterogeneous_queue_parallel_for_each_tests()
+    {
+        QUEUE queue;
+        for (int i = 0; i < 3000; i++)
+        {
+            if (i % 7 == 0)
+                queue.push(std::string(static_cast<size_t>(i % 100), 'a'));
+            queue.push(i);
+        }
+
+        auto       put     = queue.start_reentrant_push(-1);
+        auto       consume = queue.try_start_reentrant_consume();
+        auto const string  = consume.template element<std::string>();
+        DENSITY_TEST_ASSERT(string.empty());
+
+        std::vector<int> visit_counts(3000);
+        queue.parallel_for_each(
+          EXECUTOR(), [&visit_counts](const density::runtime_type<> & i_type, void * i_element) {
+              if (i_type.template is<int>())
+              {
+                  auto const value = *static_cast<int *>(i_element);
+                  DENSITY_TEST_ASSERT(value >= 0 && value < 3000);
+                  visit_counts[static_cast<size_t>(value)]++;
+              }
+              else
+              {
+                  DENSITY_TEST_ASSERT(i_type.template is<std::string>());
+              }
+          });
+        for (auto count : visit_counts)
+            DENSITY_TEST_ASSERT(count == 1);
+
+        // const overload
+        std::atomic<size_t> element_count{0};
+        auto const &        const_queue = queue;
+        const_queue.parallel_for_each(
+          EXECUTOR(), [&element_count](const density::runtime_type<> &, const void *) {
+              element_count++;
+          });
+        DENSITY_TEST_ASSERT(element_count == 3000 + 3000 / 7);
+
+        put.commit();
+        consume.commit();
+
+        // an empty queue is not visited
+        QUEUE empty_queue;
+        empty_queue.parallel_for_each(
+          EXECUTOR(), [](const density::runtime_type<> &, void *) { DENSITY_TEST_ASSERT(false); });
+    }
+
+    namespace
+    {
+        struct alignas(64) RelocateAligned
+        {
+            int m_value;
+        };
+
+        using RelocateBig = std::array<int, 400>;
+
+        /* Pushes the i-th element of the sequence used by the relocation tests. It mixes trivially
+            copyable elements (some over-aligned, some external) and std::string. */
+        template <typename QUEUE> void push_relocate_element(QUEUE & i_queue, int i_index)
+        {
+            switch (i_index % 5)
+            {
+            case 0: i_queue.push(i_index); break;
+            case 1: i_queue.push(static_cast<double>(i_index)); break;
+            case 2: i_queue.push(std::to_string(i_index) + " is not a short string"); break;
+            case 3: i_queue.push(RelocateAligned{i_index}); break;
+            default:
+                if (i_index % 50 == 4)
+                {
+                    RelocateBig big;
+                    big.fill(i_index);
+                    i_queue.push(big);
+                }
+                else
+                {
+                    i_queue.push(static_cast<unsigned>(i_index));
+                }
+                break;
+            }
+        }
+
+        /* Consumes the elements [i_first, i_last) of the sequence used by the relocation tests. */
+        template <typename QUEUE> void consume_relocate_elements(QUEUE & i_queue, int i_first, int i_last)
+        {
+            for (int i = i_first; i < i_last; i++)
+            {
+                auto consume = i_queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume);
+                switch (i % 5)
+                {
+                case 0: DENSITY_TEST_ASSERT(consume.template element<int>() == i); break;
+                case 1: DENSITY_TEST_ASSERT(consume.template element<double>() == i); break;
+                case 2:
+                    DENSITY_TEST_ASSERT(
+                      consume.template element<std::string>() ==
+                      std::to_string(i) + " is not a short string");
+                    break;
+                case 3:
+                    DENSITY_TEST_ASSERT(density::address_is_aligned(consume.element_ptr(), 64));
+                    DENSITY_TEST_ASSERT(consume.template element<RelocateAligned>().m_value == i);
+                    break;
+                default:
+                    if (i % 50 == 4)
+                    {
+                        auto const & big = consume.template element<RelocateBig>();
+                        DENSITY_TEST_ASSERT(std::all_of(
+                          big.begin(), big.end(), [i](int i_value) { return i_value == i; }));
+                    }
+                    else
+                    {
+                        DENSITY_TEST_ASSERT(
+                          consume.template element<unsigned>() == static_cast<unsigned>(i));
+                    }
+                    break;
+                }
+                consume.commit();
+            }
+        }
+
+        /* Moves all the elements of a queue to another with dyn_push_relocate. */
+        template <typename QUEUE> void relocate_drain_tests()
+        {
+            InstanceCounted::ScopedLeakCheck leak_check;
+
+            QUEUE source, dest;
+            for (int i = 0; i < 300; i++)
+            {
+                push_relocate_element(source, i);
+                source.push(TestObject<32, 8>());
+            }
+
+            while (auto consume = source.try_start_consume())
+            {
+                dest.dyn_push_relocate(consume.complete_type(), consume.element_ptr());
+                consume.commit_nodestroy();
+            }
+            DENSITY_TEST_ASSERT(source.empty());
+
+            for (int i = 0; i < 300; i++)
+            {
+                consume_relocate_elements(dest, i, i + 1);
+                auto consume = dest.try_start_consume();
+                consume.template element<TestObject<32, 8>>().check();
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(dest.empty());
+        }
+    } // namespace
+
+    /* Checks the copy of a queue whose runtime type supports f_relocate, that copies the runs of
+        trivially copyable elements with memcpy, dyn_push_move and dyn_push_relocate. */
+    void heterogeneous_queue_relocate_tests()
+    {
+        using namespace density;
+
+        using Rt = runtime_type<default_type_features, f_relocate>;
+        static_assert(std::is_trivially_copyable<Rt>::value, "the bulk copy would not be used");
+        using Queue = heter_queue<Rt, basic_default_allocator<1024>>;
+
+        // copy, with runs crossing pages, dead, over-aligned and external elements
+        for (int first = 0; first < 20; first += 7)
+        {
+            Queue source;
+            for (int i = 0; i < 500; i++)
+                push_relocate_element(source, i);
+            for (int i = 0; i < first; i++)
+                source.pop();
+
+            Queue copy(source);
+            consume_relocate_elements(copy, first, 500);
+            DENSITY_TEST_ASSERT(copy.empty());
+
+            copy = source;
+            consume_relocate_elements(source, first, 500);
+            DENSITY_TEST_ASSERT(source.empty());
+            consume_relocate_elements(copy, first, 500);
+            DENSITY_TEST_ASSERT(copy.empty());
+        }
+
+        // dyn_push_move of a trivially copyable element and of a std::string
+        {
+            Queue       queue;
+            int         value = 42;
+            std::string string(100, 'a');
+            queue.dyn_push_move(Rt::make<int>(), &value);
+            queue.dyn_push_move(Rt::make<std::string>(), &string);
+            DENSITY_TEST_ASSERT(value == 42);
+            DENSITY_TEST_ASSERT(queue.try_start_consume().template element<int>() == 42);
+            queue.pop();
+            DENSITY_TEST_ASSERT(
+              queue.try_start_consume().template element<std::string>() == std::string(100, 'a'));
+            queue.pop();
+            DENSITY_TEST_ASSERT(queue.empty());
+        }
+
+        // with and without f_relocate
+        relocate_drain_tests<Queue>();
+        relocate_drain_tests<heter_queue<runtime_type<>, basic_default_allocator<1024>>>();
+    }
+
+    /* Checks that the iterators skip correctly an element allocated outside the pages, so that a
+        queue holding an external element can be copied. */
+    template <typename QUEUE> void heterogeneous_queue_external_copy_tests()
+    {
+        using BigElement = std::array<char, 2000>;
+
+        QUEUE queue;
+        queue.push(1);
+        BigElement big;
+        big.fill('a');
+        queue.push(big);
+        for (int i = 2; i < 100; i++)
+            queue.push(i);
+
+        QUEUE copy(queue);
+        DENSITY_TEST_ASSERT(std::distance(copy.begin(), copy.end()) == 100);
+
+        DENSITY_TEST_ASSERT(copy.try_start_consume().template element<int>() == 1);
+        copy.pop();
+        {
+            auto consume = copy.try_start_consume();
+            DENSITY_TEST_ASSERT(consume.template element<BigElement>() == big);
+            consume.commit();
+        }
+        for (int i = 2; i < 100; i++)
+        {
+            auto consume = copy.try_start_consume();
+            DENSITY_TEST_ASSERT(consume.template element<int>() == i);
+            consume.commit();
+        }
+        DENSITY_TEST_ASSERT(copy.empty());
+    }
+
+    namespace
+    {
+        struct alignas(64) SerializedAligned
+        {
+            uint64_t m_value;
+        };
+
+        struct SerializedJob
+        {
+            std::string           m_name;
+            std::vector<uint32_t> m_values;
+        };
+
+        void density_serialize(std::ostream & i_ostream, const SerializedJob & i_job)
+        {
+            density::density_serialize(i_ostream, i_job.m_name);
+            density::density_serialize(i_ostream, i_job.m_values);
+        }
+
+        void density_deserialize(std::istream & i_istream, SerializedJob & i_job)
+        {
+            density::density_deserialize(i_istream, i_job.m_name);
+            density::density_deserialize(i_istream, i_job.m_values);
+        }
+
+        using SerializableType = density::runtime_type<
+          density::default_type_features,
+          density::f_serialize,
+          density::f_deserialize,
+          density::f_equal>;
+
+        bool operator==(const SerializedJob & i_first, const SerializedJob & i_second)
+        {
+            return i_first.m_name == i_second.m_name && i_first.m_values == i_second.m_values;
+        }
+
+        bool operator==(const SerializedAligned & i_first, const SerializedAligned & i_second)
+        {
+            return i_first.m_value == i_second.m_value;
+        }
+
+        using BigArray = std::array<uint64_t, 20000>;
+
+        density::type_registry<SerializableType> make_serialization_registry()
+        {
+            density::type_registry<SerializableType> registry;
+            registry.add<int>(10);
+            registry.add<double>(11);
+            registry.add<std::string>(12);
+            registry.add<SerializedJob>(13);
+            registry.add<SerializedAligned>(14);
+            registry.add<BigArray>(15);
+            return registry;
+        }
+
+        bool equal_queues(
+          const density::heter_queue<SerializableType> & i_first,
+          const density::heter_queue<SerializableType> & i_second)
+        {
+            auto it2 = i_second.cbegin();
+            for (auto it1 = i_first.cbegin(); it1 != i_first.cend(); ++it1, ++it2)
+            {
+                if (
+                  it2 == i_second.cend() || it1.complete_type() != it2.complete_type() ||
+                  !it1.complete_type().are_equal(it1.element_ptr(), it2.element_ptr()))
+                    return false;
+            }
+            return it2 == i_second.cend();
+        }
+
+        void heterogeneous_queue_save_load_tests()
+        {
+            using namespace density;
+            auto const registry = make_serialization_registry();
+
+            heter_queue<SerializableType> queue;
+            for (int i = 0; i < 5000; i++)
+            {
+                switch (i % 6)
+                {
+                case 0:
+                    queue.push(i);
+                    break;
+                case 1:
+                    queue.push(i * 0.5);
+                    break;
+                case 2:
+                    queue.push(std::string(static_cast<size_t>(i % 100), 'a'));
+                    break;
+                case 3:
+                    queue.push(SerializedJob{std::to_string(i), {1u, 2u, static_cast<uint32_t>(i)}});
+                    break;
+                case 4:
+                    queue.push(SerializedAligned{static_cast<uint64_t>(i)});
+                    break;
+                default:
+                    if (i % 1000 == 5)
+                    {
+                        BigArray big;
+                        big.fill(static_cast<uint64_t>(i));
+                        queue.push(big);
+                    }
+                    break;
+                }
+            }
+            // consumed elements are not saved
+            for (int i = 0; i < 10; i++)
+                queue.pop();
+
+            std::stringstream stream;
+            queue.save(stream, registry);
+
+            heter_queue<SerializableType> loaded;
+            loaded.load(stream, registry);
+            DENSITY_TEST_ASSERT(equal_queues(queue, loaded));
+
+            // load appends to the existing elements
+            stream.clear();
+            stream.seekg(0);
+            heter_queue<SerializableType> appended;
+            appended.push(1);
+            appended.load(stream, registry);
+            DENSITY_TEST_ASSERT(appended.try_start_consume().element<int>() == 1);
+            appended.pop();
+            DENSITY_TEST_ASSERT(equal_queues(queue, appended));
+
+            // an empty queue
+            heter_queue<SerializableType> empty_queue;
+            std::stringstream             empty_stream;
+            empty_queue.save(empty_stream, registry);
+            empty_queue.load(empty_stream, registry);
+            DENSITY_TEST_ASSERT(empty_queue.empty());
+
+            // a truncated stream leaves the queue unchanged
+            auto const content = stream.str();
+            for (size_t length : {size_t(0), size_t(7), content.size() / 2, content.size() - 1})
+            {
+                std::stringstream truncated(content.substr(0, length));
+                heter_queue<SerializableType> target;
+                target.push(std::string("unchanged"));
+                bool failed = false;
+                try
+                {
+                    target.load(truncated, registry);
+                }
+                catch (const std::runtime_error &)
+                {
+                    failed = true;
+                }
+                DENSITY_TEST_ASSERT(failed);
+                auto consume = target.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.element<std::string>() == "unchanged");
+                consume.commit();
+                DENSITY_TEST_ASSERT(target.empty());
+            }
+
+            // a type table bigger than the registry is rejected before being allocated
+            {
+                std::string corrupt = content.substr(0, 2 * sizeof(uint32_t));
+                uint32_t const type_count = UINT32_MAX;
+                corrupt.append(reinterpret_cast<const char *>(&type_count), sizeof(type_count));
+                std::stringstream source(corrupt);
+                bool              failed = false;
+                try
+                {
+                    loaded.load(source, registry);
+                }
+                catch (const std::runtime_error &)
+                {
+                    failed = true;
+                }
+                DENSITY_TEST_ASSERT(failed);
+            }
+
+            // a registry without a type can't load the queue
+            {
+                type_registry<SerializableType> partial_registry;
+                partial_registry.add<int>(10);
+                bool failed = false;
+                try
+                {
+                    std::stringstream source(content);
+                    loaded.load(source, partial_registry);
+                }
+                catch (const std::runtime_error &)
+                {
+                    failed = true;
+                }
+                DENSITY_TEST_ASSERT(failed);
+
+                failed = false;
+                try
+                {
+                    std::stringstream dest;
+                    queue.save(dest, partial_registry);
+                }
+                catch (const std::invalid_argument &)
+                {
+                    failed = true;
+                }
+                DENSITY_TEST_ASSERT(failed);
+            }
+
+            // types and identifiers can be registered only once
+            {
+                type_registry<SerializableType> other_registry;
+                other_registry.add<int>(1);
+                bool failed_type = false, failed_id = false;
+                try
+                {
+                    other_registry.add<int>(2);
+                }
+                catch (const std::invalid_argument &)
+                {
+                    failed_type = true;
+                }
+                try
+                {
+                    other_registry.add<double>(1);
+                }
+                catch (const std::invalid_argument &)
+                {
+                    failed_id = true;
+                }
+                DENSITY_TEST_ASSERT(failed_type && failed_id && other_registry.size() == 1);
+            }
+        }
+    } // namespace
+
     /** Basic tests for heter_queue<...> */
     void heterogeneous_queue_basic_tests(std::ostream & i_ostream)
     {
@@ -217,6 +871,31 @@ namespace density_tests
 
         heterogeneous_queue_basic_polymorphic_base_tests();
 
+        heterogeneous_queue_consume_visit_tests();
+
+        heterogeneous_queue_splice_tests<density::heter_queue<>>();
+
+        heterogeneous_queue_splice_tests<
+          density::heter_queue<density::runtime_type<>, density::basic_default_allocator<256>>>();
+
+        heterogeneous_queue_consume_hint_tests<density::heter_queue<>>();
+
+        heterogeneous_queue_consume_hint_tests<
+          density::heter_queue<density::runtime_type<>, density::basic_default_allocator<256>>>();
+
+        heterogeneous_queue_relocate_tests();
+
+        heterogeneous_queue_external_copy_tests<
+          density::heter_queue<density::runtime_type<>, density::basic_default_allocator<1024>>>();
+
+        heterogeneous_queue_parallel_for_each_tests<
+          density::heter_queue<>,
+          density::sequential_executor>();
+
+        heterogeneous_queue_parallel_for_each_tests<
+          density::heter_queue<density::runtime_type<>, density::basic_default_allocator<256>>,
+          density::thread_executor>();
+
         using namespace density;
 
         heterogeneous_queue_basic_void_tests<heter_queue<>>();
@@ -225,5 +904,7 @@ namespace density_tests
           heter_queue<runtime_type<>, UnmovableFastTestAllocator<>>>();
 
         heterogeneous_queue_basic_void_tests<heter_queue<TestRuntimeTime<>, DeepTestAllocator<>>>();
+
+        heterogeneous_queue_save_load_tests();
     }
 } // namespace density_tests
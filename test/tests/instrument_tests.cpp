@@ -0,0 +1,140 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "../test_framework/instrument_checks.h"
+#include "../test_framework/progress.h"
+#include <density/conc_heter_queue.h>
+#include <density/heter_queue.h>
+#include <density/lf_heter_queue.h>
+#include <density/lifo.h>
+#include <density/sp_heter_queue.h>
+#include <ostream>
+
+namespace density_tests
+{
+#ifdef DENSITY_INSTRUMENT
+
+    /* Returns the number of pages allocated by the calling thread with the specified allocator.
+        m_allocations counts also the allocations that returned no page. */
+    template <typename ALLOCATOR> uintptr_t allocated_pages() noexcept
+    {
+        auto const & statistics = ALLOCATOR::thread_statistics();
+        return statistics.m_allocations - statistics.m_failed_allocations;
+    }
+
+    /* Pushes and pops enough elements to fill many pages */
+    template <typename QUEUE> void instrument_load(QUEUE & i_queue)
+    {
+        for (int i = 0; i < 20000; i++)
+            i_queue.push(i);
+        while (i_queue.try_pop())
+        {
+        }
+    }
+
+    /* After a first round the pages of the queue are recycled by the page allocator, so the next
+        rounds must not allocate memory from the system. */
+    template <typename QUEUE> void steady_state_instrument_test()
+    {
+        QUEUE queue;
+        instrument_load(queue);
+
+        auto const                pages = allocated_pages<density::default_allocator>();
+        density::instrument_scope scope;
+        for (int round = 0; round < 10; round++)
+            instrument_load(queue);
+
+        DENSITY_TEST_ASSERT_NO_SYSTEM_ALLOCATIONS(scope);
+        DENSITY_TEST_ASSERT(allocated_pages<density::default_allocator>() > pages);
+        DENSITY_TEST_ASSERT(scope.counters().m_external_allocations == 0);
+    }
+
+    /* An element bigger than a page is allocated outside the pages, with aligned_allocate */
+    template <typename QUEUE> void external_instrument_test()
+    {
+        struct BigElement
+        {
+            unsigned char m_data[density::default_allocator::page_size * 2];
+        };
+
+        QUEUE queue;
+        instrument_load(queue);
+
+        density::instrument_scope scope;
+        queue.template emplace<BigElement>();
+        auto counters = scope.counters();
+        DENSITY_TEST_ASSERT(counters.m_external_allocations == 1);
+        DENSITY_TEST_ASSERT(counters.m_aligned_allocations == 1);
+
+        DENSITY_TEST_ASSERT(queue.try_pop());
+        counters = scope.counters();
+        DENSITY_TEST_ASSERT(counters.m_aligned_deallocations == 1);
+    }
+
+    template <typename QUEUE> void queue_instrument_tests()
+    {
+        steady_state_instrument_test<QUEUE>();
+        external_instrument_test<QUEUE>();
+    }
+
+    /* Lifo arrays smaller than half a page are allocated in the pages of the data stack, that are
+        recycled by the page allocator, so after a first round they do not allocate memory from the
+        system. */
+    void lifo_instrument_tests()
+    {
+        auto const load = [] {
+            density::lifo_array<int> first(6000);
+            for (int i = 0; i < 8; i++)
+            {
+                density::lifo_array<int>  second(6000);
+                density::lifo_array<int>  third(6000); // overflows the page
+                density::lifo_array<char> fourth(1000);
+            }
+        };
+        load();
+
+        using PageAllocator = density::data_stack_underlying_allocator;
+        auto const                pages = allocated_pages<PageAllocator>();
+        density::instrument_scope scope;
+        for (int round = 0; round < 10; round++)
+            load();
+
+        DENSITY_TEST_ASSERT_NO_SYSTEM_ALLOCATIONS(scope);
+        DENSITY_TEST_ASSERT(allocated_pages<PageAllocator>() > pages);
+        DENSITY_TEST_ASSERT(scope.counters().m_external_allocations == 0);
+    }
+
+#endif
+
+    void instrument_tests(std::ostream & i_ostream)
+    {
+#ifdef DENSITY_INSTRUMENT
+        using namespace density;
+
+        PrintScopeDuration dur(i_ostream, "instrument tests");
+
+        queue_instrument_tests<heter_queue<>>();
+        queue_instrument_tests<conc_heter_queue<>>();
+        queue_instrument_tests<lf_heter_queue<>>();
+        queue_instrument_tests<lf_heter_queue<
+          runtime_type<>,
+          default_allocator,
+          concurrency_single,
+          concurrency_single>>();
+        queue_instrument_tests<sp_heter_queue<>>();
+
+#ifndef DENSITY_USER_DATA_STACK // the user data stack may allocate memory from the system
+        lifo_instrument_tests();
+#endif
+#else
+        i_ostream << "instrument tests skipped: DENSITY_INSTRUMENT is not defined" << std::endl;
+#endif
+    }
+
+} // namespace density_tests
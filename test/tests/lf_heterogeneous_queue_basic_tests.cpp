@@ -12,12 +12,58 @@
 #include "../test_framework/test_allocators.h"
 #include "../test_framework/test_objects.h"
 #include "complex_polymorphism.h"
+#include <algorithm>
+#include <density/executors.h>
 #include <density/lf_heter_queue.h>
 #include <iterator>
+#include <thread>
 #include <type_traits>
+#include <unordered_set>
+#include <vector>
 
 namespace density_tests
 {
+    /* Allocator that records how many pages it has returned, and how many of them were distinct. It
+        is not thread safe. */
+    class PageTrackingAllocator : public density::basic_default_allocator<4096>
+    {
+        using Base = density::basic_default_allocator<4096>;
+
+      public:
+        void * allocate_page() { return track(Base::allocate_page()); }
+
+        void * try_allocate_page(density::progress_guarantee i_progress_guarantee) noexcept
+        {
+            return track(Base::try_allocate_page(i_progress_guarantee));
+        }
+
+        void * allocate_page_zeroed() { return track(Base::allocate_page_zeroed()); }
+
+        void * try_allocate_page_zeroed(density::progress_guarantee i_progress_guarantee) noexcept
+        {
+            return track(Base::try_allocate_page_zeroed(i_progress_guarantee));
+        }
+
+        size_t allocated_pages() const noexcept { return m_allocated_pages; }
+
+        size_t distinct_pages() const noexcept { return m_pages.size(); }
+
+      private:
+        void * track(void * i_page) noexcept
+        {
+            if (i_page != nullptr)
+            {
+                m_allocated_pages++;
+                m_pages.insert(i_page);
+            }
+            return i_page;
+        }
+
+      private:
+        size_t                     m_allocated_pages = 0;
+        std::unordered_set<void *> m_pages;
+    };
+
     template <
       density::concurrency_cardinality PROD_CARDINALITY,
       density::concurrency_cardinality CONSUMER_CARDINALITY,
@@ -205,6 +251,92 @@ namespace density_tests
             DENSITY_TEST_ASSERT(queue.empty());
         }
 
+        /* Checks that parallel_for_each visits every element exactly once, that the visited elements
+            can be consumed after the call, and that a concurrent consumer never loses an element. */
+        static void lf_heterogeneous_queue_parallel_for_each_tests()
+        {
+            using namespace density;
+
+            LfHeterQueue<> queue;
+            for (int i = 0; i < 5000; i++)
+                queue.push(i);
+
+            std::vector<int> visit_counts(5000);
+            queue.parallel_for_each(
+              thread_executor(4), [&visit_counts](const runtime_type<> &, void * i_element) {
+                  visit_counts[static_cast<size_t>(*static_cast<int *>(i_element))]++;
+              });
+            for (auto count : visit_counts)
+                DENSITY_TEST_ASSERT(count == 1);
+
+            for (int i = 0; i < 5000; i++)
+            {
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume && consume.template element<int>() == i);
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(queue.empty());
+
+            if (CONSUMER_CARDINALITY == concurrency_multiple)
+            {
+                for (int i = 0; i < 5000; i++)
+                    queue.push(i);
+
+                std::vector<int> consume_counts(5000);
+                std::thread      consumer([&queue, &consume_counts] {
+                    int consumed = 0;
+                    while (consumed < 5000)
+                    {
+                        auto consume = queue.try_start_consume();
+                        if (consume)
+                        {
+                            consume_counts[static_cast<size_t>(consume.template element<int>())]++;
+                            consume.commit();
+                            consumed++;
+                        }
+                    }
+                });
+
+                std::fill(visit_counts.begin(), visit_counts.end(), 0);
+                queue.parallel_for_each(
+                  thread_executor(2), [&visit_counts](const runtime_type<> &, void * i_element) {
+                      visit_counts[static_cast<size_t>(*static_cast<int *>(i_element))]++;
+                  });
+
+                consumer.join();
+                for (size_t i = 0; i < 5000; i++)
+                    DENSITY_TEST_ASSERT(consume_counts[i] == 1 && visit_counts[i] <= 1);
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+        }
+
+        /* Checks that a queue in a steady state reuses its pages instead of allocating new memory. The
+            queue allocates zeroed pages, and (depending on the consistency model) may deallocate
+            them without zeroing, so the page allocator must be able to recycle them. */
+        static void lf_heterogeneous_queue_page_recycling_tests()
+        {
+            using Queue = LfHeterQueue<density::runtime_type<>, PageTrackingAllocator>;
+
+            // pages in a memory region requested to the system
+            constexpr size_t region_pages =
+              density::detail::SystemPageManager<4096>::region_default_size_bytes / 4096;
+
+            Queue        queue;
+            auto const & allocator = queue.get_allocator_ref();
+            while (allocator.allocated_pages() < region_pages * 4)
+            {
+                for (int i = 0; i < 100; i++)
+                    queue.push(i);
+                for (int i = 0; i < 100; i++)
+                    DENSITY_TEST_ASSERT(queue.try_pop());
+            }
+            DENSITY_TEST_ASSERT(queue.empty());
+
+            /* The pages are carved from the current region before being recycled, so the queue can
+                see the pages of a whole region. */
+            DENSITY_TEST_ASSERT(allocator.distinct_pages() <= region_pages * 2);
+        }
+
         static void tests(std::ostream & /*i_ostream*/)
         {
             using density::runtime_type;
@@ -215,6 +347,10 @@ namespace density_tests
 
             lf_heterogeneous_queue_basic_polymorphic_base_tests();
 
+            lf_heterogeneous_queue_parallel_for_each_tests();
+
+            lf_heterogeneous_queue_page_recycling_tests();
+
             lf_heterogeneous_queue_basic_void_tests<LfHeterQueue<>>();
 
             lf_heterogeneous_queue_basic_void_tests<
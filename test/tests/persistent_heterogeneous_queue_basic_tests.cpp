@@ -0,0 +1,492 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "../test_framework/density_test_common.h"
+#include "../test_framework/progress.h"
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <density/persistent_heter_queue.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace density_tests
+{
+#if defined(__linux__)
+
+    template <density::concurrency_cardinality PROD_CARDINALITY> struct PersistentQueueBasicTests
+    {
+        using PersistentQueue = density::persistent_heter_queue<PROD_CARDINALITY>;
+
+        struct alignas(64) Aligned
+        {
+            uint64_t m_value;
+        };
+
+        /** Creates an empty temporary file, that is removed by the destructor */
+        struct TempFile
+        {
+            TempFile()
+            {
+                char path[] = "/tmp/density_persistent_tests_XXXXXX";
+                int  file   = ::mkstemp(path);
+                DENSITY_TEST_ASSERT(file >= 0);
+                ::close(file);
+                m_path = path;
+            }
+
+            ~TempFile() { ::unlink(m_path.c_str()); }
+
+            const char * path() const noexcept { return m_path.c_str(); }
+
+            std::string m_path;
+        };
+
+        /** Runs a function in a child process. The function simulates a crash calling crash, so that
+            the queue is not destroyed. */
+        template <typename FUNCTION> static void run_and_crash(FUNCTION && i_function)
+        {
+            pid_t const child = ::fork();
+            DENSITY_TEST_ASSERT(child >= 0);
+            if (child == 0)
+            {
+                i_function();
+                ::_exit(1);
+            }
+            int status = 0;
+            ::waitpid(child, &status, 0);
+            DENSITY_TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        }
+
+        static void crash() { ::_exit(0); }
+
+        static void put_element(PersistentQueue & i_queue, uint32_t i_index)
+        {
+            if (i_index % 3 == 0)
+            {
+                i_queue.push(0, static_cast<uint64_t>(i_index));
+            }
+            else if (i_index % 3 == 1)
+            {
+                i_queue.push(1, Aligned{i_index});
+            }
+            else
+            {
+                auto put = i_queue.start_raw_push(2, i_index % 300, 1);
+                std::memset(put.element_ptr(), static_cast<int>(i_index & 0xFF), i_index % 300);
+                put.commit();
+            }
+        }
+
+        static void consume_element(PersistentQueue & i_queue, uint32_t i_index)
+        {
+            auto consume = i_queue.try_start_consume();
+            DENSITY_TEST_ASSERT(consume && consume.type() == i_index % 3);
+            if (i_index % 3 == 0)
+            {
+                DENSITY_TEST_ASSERT(consume.template element<uint64_t>() == i_index);
+            }
+            else if (i_index % 3 == 1)
+            {
+                DENSITY_TEST_ASSERT(
+                  density::address_is_aligned(consume.element_ptr(), 64) &&
+                  consume.template element<Aligned>().m_value == i_index);
+            }
+            else
+            {
+                DENSITY_TEST_ASSERT(consume.size() == i_index % 300);
+                auto const bytes = static_cast<unsigned char *>(consume.element_ptr());
+                for (size_t j = 0; j < i_index % 300; j++)
+                    DENSITY_TEST_ASSERT(bytes[j] == (i_index & 0xFF));
+            }
+            consume.commit();
+        }
+
+        /* Puts and consumes elements of different sizes and alignments, so that the pages are reused many
+            times, closing and reopening the queue every now and then. */
+        static void persistent_heterogeneous_queue_reopen_tests()
+        {
+            TempFile file;
+            uint32_t put_index = 0, consume_index = 0;
+            for (int session = 0; session < 6; session++)
+            {
+                // the page count and size are ignored after the first session
+                PersistentQueue queue(
+                  file.path(), 3 + session, 1024, density::sync_policy::every_n_commits(7));
+                DENSITY_TEST_ASSERT(queue.page_count() == 3 && queue.page_size() == 1024);
+
+                // a few elements are left in the queue at the end of every session
+                for (int i = 0; i < 500; i++)
+                {
+                    put_element(queue, put_index++);
+                    if (put_index - consume_index > 3)
+                        consume_element(queue, consume_index++);
+                }
+            }
+
+            PersistentQueue queue(file.path(), 2, 1024);
+            while (consume_index < put_index)
+                consume_element(queue, consume_index++);
+            DENSITY_TEST_ASSERT(queue.empty());
+        }
+
+        /* Child processes crash after putting and consuming with different policies */
+        static void persistent_heterogeneous_queue_crash_tests()
+        {
+            TempFile file;
+
+            /* with a manual policy only the synced puts survive. A sync stops at the first put in progress, so
+                the puts committed after it are lost too. */
+            run_and_crash([&file] {
+                PersistentQueue queue(file.path(), 16, 4096, density::sync_policy::manual());
+                for (uint32_t i = 0; i < 100; i++)
+                    put_element(queue, i);
+                queue.sync();
+                for (uint32_t i = 100; i < 150; i++)
+                    put_element(queue, i);
+                auto put = queue.start_raw_push(0, 8, 8);
+                put_element(queue, 150);
+                queue.sync();
+                put_element(queue, 151);
+                crash();
+            });
+            {
+                PersistentQueue queue(file.path(), 16, 4096, density::sync_policy::manual());
+                for (uint32_t i = 0; i < 150; i++)
+                    consume_element(queue, i);
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+
+            // with every_commit nothing is lost
+            run_and_crash([&file] {
+                PersistentQueue queue(file.path(), 16, 4096, density::sync_policy::every_commit());
+                for (uint32_t i = 0; i < 100; i++)
+                    put_element(queue, i);
+                for (uint32_t i = 0; i < 30; i++)
+                    consume_element(queue, i);
+                crash();
+            });
+            {
+                PersistentQueue queue(file.path(), 16, 4096, density::sync_policy::manual());
+                for (uint32_t i = 30; i < 100; i++)
+                    consume_element(queue, i);
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+
+            // with every_n_commits the puts after the last multiple of n are lost
+            run_and_crash([&file] {
+                PersistentQueue queue(file.path(), 16, 4096, density::sync_policy::every_n_commits(10));
+                for (uint32_t i = 0; i < 25; i++)
+                    put_element(queue, i);
+                crash();
+            });
+            {
+                PersistentQueue queue(file.path(), 16, 4096, density::sync_policy::manual());
+                for (uint32_t i = 0; i < 20; i++)
+                    consume_element(queue, i);
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+
+            // a periodic policy syncs the first commit after the interval
+            run_and_crash([&file] {
+                PersistentQueue queue(
+                  file.path(), 16, 4096, density::sync_policy::periodic(std::chrono::milliseconds(1)));
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                put_element(queue, 0);
+                crash();
+            });
+            {
+                PersistentQueue queue(file.path(), 16, 4096);
+                consume_element(queue, 0);
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+        }
+
+        /* Corrupts the last state written, so the previous one is used */
+        static void persistent_heterogeneous_queue_torn_state_tests()
+        {
+            TempFile file;
+            {
+                PersistentQueue queue(file.path(), 2, 1024, density::sync_policy::manual());
+                put_element(queue, 0);
+                put_element(queue, 1);
+                queue.sync();
+                put_element(queue, 2);
+            }
+
+            // finds the slot with the highest sequence, and alters its checksum
+            int const file_descriptor = ::open(file.path(), O_RDWR);
+            DENSITY_TEST_ASSERT(file_descriptor >= 0);
+            density::detail::PersistentQueueHeader header;
+            DENSITY_TEST_ASSERT(::pread(file_descriptor, &header, sizeof(header), 0) == sizeof(header));
+            auto & last = header.m_states[0].m_sequence > header.m_states[1].m_sequence
+                            ? header.m_states[0]
+                            : header.m_states[1];
+            last.m_checksum++;
+            DENSITY_TEST_ASSERT(::pwrite(file_descriptor, &header, sizeof(header), 0) == sizeof(header));
+            ::close(file_descriptor);
+
+            {
+                PersistentQueue queue(file.path(), 2, 1024);
+                consume_element(queue, 0);
+                consume_element(queue, 1);
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+        }
+
+        /* Checks full queues, canceled puts and consumes, and invalid arguments */
+        static void persistent_heterogeneous_queue_state_tests()
+        {
+            TempFile        file;
+            PersistentQueue queue(file.path(), 2, 1024, density::sync_policy::manual());
+
+            // fill the queue
+            int count = 0;
+            while (queue.try_push(0, count))
+                count++;
+            DENSITY_TEST_ASSERT(count > 0 && !queue.try_start_raw_push(0, sizeof(int), alignof(int)));
+
+            // a canceled consume leaves the element in the queue
+            {
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.template element<int>() == 0);
+                consume.cancel();
+            }
+
+            // the released pages are reused after a sync, that the put does by itself
+            for (int i = 0; i < count; i++)
+            {
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.template element<int>() == i);
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(queue.empty() && queue.try_push(0, 1));
+
+            // a put in progress is skipped, and a canceled put is never consumed
+            {
+                auto put1 = queue.start_raw_push(1, sizeof(int), alignof(int));
+                auto put2 = queue.start_raw_push(2, sizeof(int), alignof(int));
+                DENSITY_TEST_ASSERT(queue.try_pop() && queue.empty());
+                put1.cancel();
+                *static_cast<int *>(put2.element_ptr()) = 2;
+                put2.commit();
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.type() == 2 && consume.template element<int>() == 2);
+                consume.commit();
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+
+            // serialized elements
+            {
+                std::vector<std::string> const strings{"first", "", "third"};
+                queue.push_serialized(3, strings);
+                queue.push_serialized(4, 42.5);
+                queue.push_serialized(5, static_cast<int32_t>(7));
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(
+                  consume.type() == 3 &&
+                  consume.template deserialize<std::vector<std::string>>() == strings);
+                consume.commit();
+                consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.template deserialize<double>() == 42.5);
+                consume.commit();
+
+                // the element is shorter than a double
+                consume     = queue.try_start_consume();
+                bool failed = false;
+                try
+                {
+                    consume.template deserialize<double>();
+                }
+                catch (const std::runtime_error &)
+                {
+                    failed = true;
+                }
+                DENSITY_TEST_ASSERT(failed);
+                consume.commit();
+            }
+
+            bool too_big = false;
+            try
+            {
+                queue.start_raw_push(0, queue.max_element_size(1) + 1, 1);
+            }
+            catch (const std::length_error &)
+            {
+                too_big = true;
+            }
+            DENSITY_TEST_ASSERT(too_big);
+
+            // the file is locked
+            bool locked = false;
+            try
+            {
+                PersistentQueue other(file.path(), 2, 1024);
+            }
+            catch (const std::system_error &)
+            {
+                locked = true;
+            }
+            DENSITY_TEST_ASSERT(locked);
+
+            bool invalid = false;
+            try
+            {
+                TempFile        other_file;
+                PersistentQueue invalid_queue(other_file.path(), 1);
+            }
+            catch (const std::invalid_argument &)
+            {
+                invalid = true;
+            }
+            DENSITY_TEST_ASSERT(invalid);
+
+            // the control blocks can't address a page of 4 GiB
+            invalid = false;
+            try
+            {
+                TempFile        other_file;
+                PersistentQueue invalid_queue(
+                  other_file.path(), 2, static_cast<size_t>(std::numeric_limits<uint32_t>::max()) + 1);
+            }
+            catch (const std::invalid_argument &)
+            {
+                invalid = true;
+            }
+            DENSITY_TEST_ASSERT(invalid);
+
+            // a file that does not contain a queue
+            bool not_a_queue = false;
+            {
+                TempFile  other_file;
+                int const file_descriptor = ::open(other_file.path(), O_WRONLY);
+                DENSITY_TEST_ASSERT(file_descriptor >= 0);
+                std::vector<char> garbage(8192, 'x');
+                DENSITY_TEST_ASSERT(
+                  ::write(file_descriptor, garbage.data(), garbage.size()) ==
+                  static_cast<ssize_t>(garbage.size()));
+                ::close(file_descriptor);
+                try
+                {
+                    PersistentQueue invalid_queue(other_file.path(), 2);
+                }
+                catch (const std::runtime_error &)
+                {
+                    not_a_queue = true;
+                }
+            }
+            DENSITY_TEST_ASSERT(not_a_queue);
+        }
+
+        /* Producer threads put while the consumer consumes and syncs. With concurrency_single there is
+            only one producer. */
+        static void persistent_heterogeneous_queue_thread_tests()
+        {
+            TempFile        file;
+            PersistentQueue queue(file.path(), 4, 4096, density::sync_policy::every_n_commits(64));
+
+            uint32_t const producer_count =
+              PROD_CARDINALITY == density::concurrency_multiple ? 3 : 1;
+            int const element_count = 5000;
+
+            std::vector<std::thread> producers;
+            for (uint32_t type = 0; type < producer_count; type++)
+            {
+                producers.emplace_back([&queue, type] {
+                    for (int i = 0; i < element_count; i++)
+                        queue.push(type, static_cast<int64_t>(i));
+                });
+            }
+
+            std::vector<int64_t> expected(producer_count);
+            for (uint32_t consumed = 0; consumed < producer_count * element_count;)
+            {
+                if (auto consume = queue.try_start_consume())
+                {
+                    auto const type = consume.type();
+                    DENSITY_TEST_ASSERT(
+                      type < producer_count &&
+                      consume.template element<int64_t>() == expected[type]);
+                    expected[type]++;
+                    consume.commit();
+                    consumed++;
+                }
+            }
+
+            for (auto & producer : producers)
+                producer.join();
+            DENSITY_TEST_ASSERT(queue.empty());
+        }
+
+        /* Elements whose alignment leaves no room in a page are rejected, rather than wrapping around
+            the size limit. */
+        static void persistent_heterogeneous_queue_alignment_tests()
+        {
+            TempFile        file;
+            PersistentQueue queue(file.path(), 4, 1024);
+
+            for (size_t alignment : {size_t(1024), size_t(4096)})
+            {
+                DENSITY_TEST_ASSERT(queue.max_element_size(alignment) == 0);
+                bool rejected = false;
+                try
+                {
+                    queue.start_raw_push(0, 0, alignment);
+                }
+                catch (const std::length_error &)
+                {
+                    rejected = true;
+                }
+                DENSITY_TEST_ASSERT(rejected && queue.empty());
+            }
+
+            // the biggest element with a big alignment still fits
+            size_t const max_size = queue.max_element_size(256);
+            DENSITY_TEST_ASSERT(max_size > 0 && max_size < 1024);
+            auto put = queue.start_raw_push(1, max_size, 256);
+            DENSITY_TEST_ASSERT(density::address_is_aligned(put.element_ptr(), 256));
+            std::memset(put.element_ptr(), 7, max_size);
+            put.commit();
+
+            auto consume = queue.try_start_consume();
+            DENSITY_TEST_ASSERT(consume && consume.type() == 1 && consume.size() == max_size);
+            consume.commit();
+            DENSITY_TEST_ASSERT(queue.empty());
+        }
+
+        static void tests()
+        {
+            persistent_heterogeneous_queue_reopen_tests();
+            persistent_heterogeneous_queue_alignment_tests();
+            persistent_heterogeneous_queue_crash_tests();
+            persistent_heterogeneous_queue_torn_state_tests();
+            persistent_heterogeneous_queue_state_tests();
+            persistent_heterogeneous_queue_thread_tests();
+        }
+    };
+
+    /** Basic tests for persistent_heter_queue<...> */
+    void persistent_heterogeneous_queue_basic_tests(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "persistent heterogeneous queue basic tests");
+
+        PersistentQueueBasicTests<density::concurrency_multiple>::tests();
+        PersistentQueueBasicTests<density::concurrency_single>::tests();
+    }
+
+#endif
+
+} // namespace density_tests
@@ -0,0 +1,194 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "../test_framework/progress.h"
+#include <atomic>
+#include <density/priority_heter_queue.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace density_tests
+{
+    namespace
+    {
+        /* Elements put by the concurrent tests */
+        struct Tagged
+        {
+            size_t m_producer;
+            size_t m_level;
+            size_t m_sequence;
+        };
+
+        template <typename QUEUE> void priority_queue_order_tests(QUEUE & i_queue)
+        {
+            using namespace density;
+
+            size_t const count = 2000;
+            for (size_t index = 0; index < count; index++)
+            {
+                size_t const level = (index * 7) % QUEUE::levels;
+                if (index % 3 == 0)
+                {
+                    i_queue.push(level, Tagged{0, level, index});
+                }
+                else if (index % 3 == 1)
+                {
+                    auto put = i_queue.template start_emplace<Tagged>(level, Tagged{0, level, index});
+                    DENSITY_TEST_ASSERT(put.level() == level && put.queue() == &i_queue);
+                    put.commit();
+                }
+                else
+                {
+                    Tagged source{0, level, index};
+                    i_queue.dyn_push_copy(
+                      level, QUEUE::runtime_type::template make<Tagged>(), &source);
+                }
+            }
+
+            // a canceled put leaves no element, and does not mark the level
+            i_queue.start_push(QUEUE::levels - 1, std::string("canceled")).cancel();
+
+            // levels are consumed in order, and every level is FIFO
+            typename QUEUE::consume_operation consume;
+            size_t                            last_level = 0, last_sequence = 0;
+            for (size_t index = 0; index < count; index++)
+            {
+                DENSITY_TEST_ASSERT(i_queue.try_start_consume(consume));
+                auto const & element = consume.template element<Tagged>();
+                DENSITY_TEST_ASSERT(element.m_level == consume.level());
+                if (index > 0)
+                {
+                    DENSITY_TEST_ASSERT(
+                      element.m_level > last_level ||
+                      (element.m_level == last_level && element.m_sequence > last_sequence));
+                }
+                last_level    = element.m_level;
+                last_sequence = element.m_sequence;
+
+                if (index % 5 == 0 && element.m_level == 0)
+                {
+                    // a canceled consume leaves the element in its level
+                    consume.cancel();
+                    DENSITY_TEST_ASSERT(i_queue.try_start_consume(consume));
+                    DENSITY_TEST_ASSERT(consume.template element<Tagged>().m_sequence == last_sequence);
+                }
+                else if (index % 5 == 0)
+                {
+                    // a higher level put while consuming is consumed first
+                    consume.cancel();
+                    i_queue.push(0, std::string("urgent"));
+                    DENSITY_TEST_ASSERT(i_queue.try_start_consume(consume));
+                    DENSITY_TEST_ASSERT(
+                      consume.level() == 0 && consume.template element<std::string>() == "urgent");
+                    consume.commit();
+                    DENSITY_TEST_ASSERT(i_queue.try_start_consume(consume));
+                    DENSITY_TEST_ASSERT(consume.template element<Tagged>().m_sequence == last_sequence);
+                }
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(i_queue.empty() && !i_queue.try_start_consume() && !i_queue.try_pop());
+
+            // try_ puts
+            DENSITY_TEST_ASSERT(i_queue.try_push(progress_lock_free, QUEUE::levels - 1, 10));
+            DENSITY_TEST_ASSERT(i_queue.template try_emplace<int>(progress_blocking, 0, 11));
+            int const first = QUEUE::levels > 1 ? 11 : 10;
+            DENSITY_TEST_ASSERT(i_queue.try_start_consume().template element<int>() == first);
+            DENSITY_TEST_ASSERT(i_queue.try_pop() && i_queue.try_pop() && i_queue.empty());
+
+            // elements are destroyed by clear
+            for (size_t index = 0; index < 100; index++)
+                i_queue.push(index % QUEUE::levels, std::string(index, 'a'));
+            i_queue.clear();
+            DENSITY_TEST_ASSERT(i_queue.empty());
+        }
+
+        /* Every producer puts elements in all the levels. The consumers check that the elements of the
+            same producer and level are consumed in order. */
+        void priority_queue_concurrent_tests()
+        {
+            density::priority_heter_queue<density::runtime_type<>, 4> queue;
+
+            size_t const producer_count = 3, consumer_count = 2, count = 5000;
+            size_t const level_count = decltype(queue)::levels;
+
+            std::vector<std::thread> producers;
+            for (size_t producer = 0; producer < producer_count; producer++)
+            {
+                producers.emplace_back([&queue, producer] {
+                    for (size_t index = 0; index < count; index++)
+                    {
+                        size_t const level = (index + producer) % level_count;
+                        queue.push(level, Tagged{producer, level, index});
+                    }
+                });
+            }
+
+            std::atomic<size_t>      consumed{0};
+            std::atomic<bool>        errors{false};
+            std::vector<std::thread> consumers;
+            for (size_t consumer = 0; consumer < consumer_count; consumer++)
+            {
+                consumers.emplace_back([&] {
+                    std::vector<size_t> next(producer_count * level_count, 0);
+                    decltype(queue)::consume_operation consume;
+                    while (consumed.load() < producer_count * count)
+                    {
+                        if (queue.try_start_consume(consume))
+                        {
+                            auto const & element = consume.element<Tagged>();
+                            auto &       expected = next[element.m_producer * level_count + element.m_level];
+                            if (element.m_level != consume.level() || element.m_sequence < expected)
+                                errors.store(true);
+                            expected = element.m_sequence + 1;
+                            consume.commit();
+                            consumed++;
+                        }
+                    }
+                });
+            }
+
+            for (auto & thread : producers)
+                thread.join();
+            for (auto & thread : consumers)
+                thread.join();
+            DENSITY_TEST_ASSERT(!errors.load() && queue.empty() && !queue.try_pop());
+        }
+
+    } // namespace
+
+    /** Basic tests for priority_heter_queue<...> */
+    void priority_heterogeneous_queue_basic_tests(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "priority heterogeneous queue basic tests");
+
+        using namespace density;
+
+        {
+            priority_heter_queue<> queue;
+            priority_queue_order_tests(queue);
+        }
+        {
+            priority_heter_queue<runtime_type<>, 64> queue;
+            priority_queue_order_tests(queue);
+        }
+        {
+            priority_heter_queue<
+              runtime_type<>,
+              1,
+              default_allocator,
+              concurrency_single,
+              concurrency_single>
+              queue;
+            priority_queue_order_tests(queue);
+        }
+        priority_queue_concurrent_tests();
+    }
+
+} // namespace density_tests
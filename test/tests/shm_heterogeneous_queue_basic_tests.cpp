@@ -0,0 +1,331 @@
+
+//   Copyright Giuseppe Campana (giu.campana@gmail.com) 2016-2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "../test_framework/density_test_common.h"
+//
+
+#include "../test_framework/density_test_common.h"
+#include "../test_framework/progress.h"
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <density/shm_heter_queue.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace density_tests
+{
+#if defined(__linux__)
+
+    template <density::concurrency_cardinality PROD_CARDINALITY> struct ShmQueueBasicTests
+    {
+        using ShmQueue = density::shm_heter_queue<PROD_CARDINALITY>;
+
+        struct alignas(64) Aligned
+        {
+            uint64_t m_value;
+        };
+
+        static std::string unique_name()
+        {
+            static int s_counter;
+            return "/density_shm_tests_" + std::to_string(::getpid()) + "_" +
+                   std::to_string(s_counter++);
+        }
+
+        /* Puts elements of different sizes and alignments through two mappings of the same segment, so
+            that the pages are reused many times. */
+        static void shm_heterogeneous_queue_wrap_tests()
+        {
+            auto const name = unique_name();
+            ShmQueue   producer(name.c_str(), 3, 1024);
+            ShmQueue   consumer(name.c_str());
+            ShmQueue::unlink(name.c_str());
+
+            for (uint32_t i = 0; i < 3000; i++)
+            {
+                DENSITY_TEST_ASSERT(consumer.empty());
+                if (i % 3 == 0)
+                {
+                    producer.push(0, static_cast<uint64_t>(i));
+                }
+                else if (i % 3 == 1)
+                {
+                    producer.push(1, Aligned{i});
+                }
+                else
+                {
+                    auto put = producer.start_raw_push(2, i % 300, 1);
+                    std::memset(put.element_ptr(), static_cast<int>(i & 0xFF), i % 300);
+                    put.commit();
+                }
+
+                auto consume = consumer.try_start_consume();
+                DENSITY_TEST_ASSERT(consume && consume.type() == i % 3);
+                if (i % 3 == 0)
+                {
+                    DENSITY_TEST_ASSERT(consume.template element<uint64_t>() == i);
+                }
+                else if (i % 3 == 1)
+                {
+                    DENSITY_TEST_ASSERT(
+                      density::address_is_aligned(consume.element_ptr(), 64) &&
+                      consume.template element<Aligned>().m_value == i);
+                }
+                else
+                {
+                    DENSITY_TEST_ASSERT(consume.size() == i % 300);
+                    auto const bytes = static_cast<unsigned char *>(consume.element_ptr());
+                    for (size_t j = 0; j < i % 300; j++)
+                        DENSITY_TEST_ASSERT(bytes[j] == (i & 0xFF));
+                }
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(consumer.empty() && producer.empty());
+        }
+
+        /* Checks full queues, canceled puts and consumes, and invalid arguments */
+        static void shm_heterogeneous_queue_state_tests()
+        {
+            auto const name = unique_name();
+            ShmQueue   queue(name.c_str(), 2, 1024);
+            ShmQueue::unlink(name.c_str());
+
+            // fill the queue
+            int count = 0;
+            while (queue.try_push(0, count))
+                count++;
+            DENSITY_TEST_ASSERT(count > 0 && !queue.try_start_raw_push(0, sizeof(int), alignof(int)));
+
+            // a canceled consume leaves the element in the queue
+            {
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.template element<int>() == 0);
+                consume.cancel();
+            }
+
+            // consuming releases the first page
+            for (int i = 0; i < count; i++)
+            {
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.template element<int>() == i);
+                consume.commit();
+                if (i == count - 1)
+                {
+                    DENSITY_TEST_ASSERT(queue.empty());
+                }
+            }
+            DENSITY_TEST_ASSERT(queue.try_push(0, 1));
+
+            // a put in progress is skipped, and a canceled put is never consumed
+            {
+                auto put1 = queue.start_raw_push(1, sizeof(int), alignof(int));
+                auto put2 = queue.start_raw_push(2, sizeof(int), alignof(int));
+                DENSITY_TEST_ASSERT(queue.try_pop() && queue.empty());
+                put1.cancel();
+                *static_cast<int *>(put2.element_ptr()) = 2;
+                put2.commit();
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume.type() == 2 && consume.template element<int>() == 2);
+                consume.commit();
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+
+            bool too_big = false;
+            try
+            {
+                queue.start_raw_push(0, queue.max_element_size(1) + 1, 1);
+            }
+            catch (const std::length_error &)
+            {
+                too_big = true;
+            }
+            DENSITY_TEST_ASSERT(too_big);
+
+            bool invalid = false;
+            try
+            {
+                ShmQueue invalid_queue(unique_name().c_str(), 1);
+            }
+            catch (const std::invalid_argument &)
+            {
+                invalid = true;
+            }
+            DENSITY_TEST_ASSERT(invalid);
+
+            // the control blocks can't address a page of 4 GiB
+            invalid = false;
+            try
+            {
+                ShmQueue invalid_queue(
+                  unique_name().c_str(),
+                  2,
+                  static_cast<size_t>(std::numeric_limits<uint32_t>::max()) + 1);
+            }
+            catch (const std::invalid_argument &)
+            {
+                invalid = true;
+            }
+            DENSITY_TEST_ASSERT(invalid);
+        }
+
+        /* A child process produces, the parent consumes. */
+        static void shm_heterogeneous_queue_process_tests()
+        {
+            int const file_descriptor = ::memfd_create("density_shm_tests", 0);
+            DENSITY_TEST_ASSERT(file_descriptor >= 0);
+            ShmQueue queue(file_descriptor, 4, 4096);
+            ::close(file_descriptor);
+
+            int const element_count = 20000;
+
+            pid_t const child = ::fork();
+            DENSITY_TEST_ASSERT(child >= 0);
+            if (child == 0)
+            {
+                ShmQueue child_queue(queue.file_descriptor());
+                for (int i = 0; i < element_count; i++)
+                    child_queue.push(0, i);
+                ::_exit(0);
+            }
+
+            for (int expected = 0; expected < element_count;)
+            {
+                if (auto consume = queue.try_start_consume())
+                {
+                    DENSITY_TEST_ASSERT(consume.template element<int>() == expected);
+                    consume.commit();
+                    expected++;
+                }
+            }
+
+            int status = 0;
+            ::waitpid(child, &status, 0);
+            DENSITY_TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+            DENSITY_TEST_ASSERT(queue.empty());
+        }
+
+        /* Producer threads and the consumer share the same mapping, so that the synchronization can
+            be checked by thread sanitizers. With concurrency_single there is only one producer. */
+        static void shm_heterogeneous_queue_thread_tests()
+        {
+            auto const name = unique_name();
+            ShmQueue   queue(name.c_str(), 4, 4096);
+            ShmQueue::unlink(name.c_str());
+
+            uint32_t const producer_count =
+              PROD_CARDINALITY == density::concurrency_multiple ? 3 : 1;
+            int const element_count = 10000;
+
+            std::vector<std::thread> producers;
+            for (uint32_t type = 0; type < producer_count; type++)
+            {
+                producers.emplace_back([&queue, type] {
+                    for (int i = 0; i < element_count; i++)
+                        queue.push(type, static_cast<int64_t>(i));
+                });
+            }
+
+            std::vector<int64_t> expected(producer_count);
+            for (uint32_t consumed = 0; consumed < producer_count * element_count;)
+            {
+                if (auto consume = queue.try_start_consume())
+                {
+                    auto const type = consume.type();
+                    DENSITY_TEST_ASSERT(
+                      type < producer_count &&
+                      consume.template element<int64_t>() == expected[type]);
+                    expected[type]++;
+                    consume.commit();
+                    consumed++;
+                }
+            }
+
+            for (auto & producer : producers)
+                producer.join();
+            DENSITY_TEST_ASSERT(queue.empty());
+        }
+
+        /* Elements whose alignment leaves no room in a page are rejected, rather than wrapping around
+            the size limit. */
+        static void shm_heterogeneous_queue_alignment_tests()
+        {
+            auto const name = unique_name();
+            ShmQueue   queue(name.c_str(), 4, 1024);
+            ShmQueue::unlink(name.c_str());
+
+            for (size_t alignment : {size_t(1024), size_t(4096)})
+            {
+                DENSITY_TEST_ASSERT(queue.max_element_size(alignment) == 0);
+                bool rejected = false;
+                try
+                {
+                    queue.start_raw_push(0, 0, alignment);
+                }
+                catch (const std::length_error &)
+                {
+                    rejected = true;
+                }
+                DENSITY_TEST_ASSERT(rejected && queue.empty());
+            }
+
+            // the biggest element with a big alignment still fits
+            size_t const max_size = queue.max_element_size(256);
+            DENSITY_TEST_ASSERT(max_size > 0 && max_size < 1024);
+            auto put = queue.start_raw_push(1, max_size, 256);
+            DENSITY_TEST_ASSERT(density::address_is_aligned(put.element_ptr(), 256));
+            std::memset(put.element_ptr(), 7, max_size);
+            put.commit();
+
+            auto consume = queue.try_start_consume();
+            DENSITY_TEST_ASSERT(consume && consume.type() == 1 && consume.size() == max_size);
+            consume.commit();
+            DENSITY_TEST_ASSERT(queue.empty());
+        }
+
+        static void tests()
+        {
+            shm_heterogeneous_queue_wrap_tests();
+            shm_heterogeneous_queue_alignment_tests();
+            shm_heterogeneous_queue_state_tests();
+            shm_heterogeneous_queue_process_tests();
+            shm_heterogeneous_queue_thread_tests();
+        }
+    };
+
+    /** Basic tests for shm_heter_queue<...> */
+    void shm_heterogeneous_queue_basic_tests(std::ostream & i_ostream)
+    {
+        PrintScopeDuration dur(i_ostream, "shared memory heterogeneous queue basic tests");
+
+        ShmQueueBasicTests<density::concurrency_multiple>::tests();
+        ShmQueueBasicTests<density::concurrency_single>::tests();
+
+        // a queue can't be opened with a different producer cardinality
+        std::string const name = "/density_shm_tests_" + std::to_string(::getpid());
+        density::shm_heter_queue<density::concurrency_multiple> queue(name.c_str(), 2);
+        bool                                                    incompatible = false;
+        try
+        {
+            density::shm_heter_queue<density::concurrency_single> other(name.c_str());
+        }
+        catch (const std::runtime_error &)
+        {
+            incompatible = true;
+        }
+        density::shm_heter_queue<density::concurrency_multiple>::unlink(name.c_str());
+        DENSITY_TEST_ASSERT(incompatible);
+    }
+
+#endif
+
+} // namespace density_tests
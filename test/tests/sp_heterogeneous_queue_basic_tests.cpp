@@ -12,9 +12,13 @@
 #include "../test_framework/test_allocators.h"
 #include "../test_framework/test_objects.h"
 #include "complex_polymorphism.h"
+#include <algorithm>
+#include <density/executors.h>
 #include <density/sp_heter_queue.h>
 #include <iterator>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 namespace density_tests
 {
@@ -201,6 +205,65 @@ namespace density_tests
             DENSITY_TEST_ASSERT(queue.empty());
         }
 
+        /* Checks that parallel_for_each visits every element exactly once, that the visited elements
+            can be consumed after the call, and that a concurrent consumer never loses an element. */
+        static void spinlocking_heterogeneous_queue_parallel_for_each_tests()
+        {
+            using namespace density;
+
+            SpHeterQueue<> queue;
+            for (int i = 0; i < 5000; i++)
+                queue.push(i);
+
+            std::vector<int> visit_counts(5000);
+            queue.parallel_for_each(
+              thread_executor(4), [&visit_counts](const runtime_type<> &, void * i_element) {
+                  visit_counts[static_cast<size_t>(*static_cast<int *>(i_element))]++;
+              });
+            for (auto count : visit_counts)
+                DENSITY_TEST_ASSERT(count == 1);
+
+            for (int i = 0; i < 5000; i++)
+            {
+                auto consume = queue.try_start_consume();
+                DENSITY_TEST_ASSERT(consume && consume.template element<int>() == i);
+                consume.commit();
+            }
+            DENSITY_TEST_ASSERT(queue.empty());
+
+            if (CONSUMER_CARDINALITY == concurrency_multiple)
+            {
+                for (int i = 0; i < 5000; i++)
+                    queue.push(i);
+
+                std::vector<int> consume_counts(5000);
+                std::thread      consumer([&queue, &consume_counts] {
+                    int consumed = 0;
+                    while (consumed < 5000)
+                    {
+                        auto consume = queue.try_start_consume();
+                        if (consume)
+                        {
+                            consume_counts[static_cast<size_t>(consume.template element<int>())]++;
+                            consume.commit();
+                            consumed++;
+                        }
+                    }
+                });
+
+                std::fill(visit_counts.begin(), visit_counts.end(), 0);
+                queue.parallel_for_each(
+                  thread_executor(2), [&visit_counts](const runtime_type<> &, void * i_element) {
+                      visit_counts[static_cast<size_t>(*static_cast<int *>(i_element))]++;
+                  });
+
+                consumer.join();
+                for (size_t i = 0; i < 5000; i++)
+                    DENSITY_TEST_ASSERT(consume_counts[i] == 1 && visit_counts[i] <= 1);
+                DENSITY_TEST_ASSERT(queue.empty());
+            }
+        }
+
         static void tests(std::ostream & /*i_ostream*/)
         {
             using density::runtime_type;
@@ -211,6 +274,8 @@ namespace density_tests
 
             spinlocking_heterogeneous_queue_basic_polymorphic_base_tests();
 
+            spinlocking_heterogeneous_queue_parallel_for_each_tests();
+
             spinlocking_heterogeneous_queue_basic_void_tests<SpHeterQueue<>>();
 
             spinlocking_heterogeneous_queue_basic_void_tests<